@@ -343,6 +343,63 @@ virAdmServerLookupClient(virAdmServerPtr srv,
 
 # define VIR_CLIENT_INFO_SELINUX_CONTEXT "selinux_context"
 
+/**
+ * VIR_CLIENT_INFO_COMPRESSION:
+ * Macro represents the algorithm replies to the client are compressed with,
+ * as VIR_TYPED_PARAM_STRING. Only present if the client asked for
+ * compression.
+ *
+ * NOTE: This attribute is read-only and any attempt to set it will be denied
+ * by daemon
+ */
+
+# define VIR_CLIENT_INFO_COMPRESSION "compression"
+
+/**
+ * VIR_CLIENT_INFO_COMPRESSION_MESSAGES:
+ * Macro represents the number of replies which were sent compressed to the
+ * client, as VIR_TYPED_PARAM_ULLONG.
+ *
+ * NOTE: This attribute is read-only and any attempt to set it will be denied
+ * by daemon
+ */
+
+# define VIR_CLIENT_INFO_COMPRESSION_MESSAGES "compression_messages"
+
+/**
+ * VIR_CLIENT_INFO_COMPRESSION_RAW_BYTES:
+ * Macro represents the payload size in bytes of the compressed replies
+ * before compression, as VIR_TYPED_PARAM_ULLONG.
+ *
+ * NOTE: This attribute is read-only and any attempt to set it will be denied
+ * by daemon
+ */
+
+# define VIR_CLIENT_INFO_COMPRESSION_RAW_BYTES "compression_raw_bytes"
+
+/**
+ * VIR_CLIENT_INFO_COMPRESSION_WIRE_BYTES:
+ * Macro represents the payload size in bytes of the compressed replies as
+ * sent to the client, as VIR_TYPED_PARAM_ULLONG.
+ *
+ * NOTE: This attribute is read-only and any attempt to set it will be denied
+ * by daemon
+ */
+
+# define VIR_CLIENT_INFO_COMPRESSION_WIRE_BYTES "compression_wire_bytes"
+
+/**
+ * VIR_CLIENT_INFO_COMPRESSION_CPU_TIME:
+ * Macro represents the CPU time in nanoseconds spent compressing replies to
+ * the client, as VIR_TYPED_PARAM_ULLONG. It is 0 on hosts which can't
+ * measure the CPU time of a thread.
+ *
+ * NOTE: This attribute is read-only and any attempt to set it will be denied
+ * by daemon
+ */
+
+# define VIR_CLIENT_INFO_COMPRESSION_CPU_TIME "compression_cpu_time"
+
 int virAdmClientGetInfo(virAdmClientPtr client,
                         virTypedParameterPtr *params,
                         int *nparams,
@@ -402,6 +459,33 @@ int virAdmServerSetClientLimits(virAdmServerPtr srv,
                                 int nparams,
                                 unsigned int flags);
 
+/* Per-server RPC statistics */
+
+/**
+ * VIR_SERVER_PROC_STATS_COUNT:
+ * Macro for the number of procedures for which statistics are returned,
+ * as VIR_TYPED_PARAM_UINT.
+ */
+
+# define VIR_SERVER_PROC_STATS_COUNT "proc.count"
+
+/**
+ * VIR_SERVER_PROC_STATS_HIST_BUCKETS:
+ * Macro for the number of buckets of the wait and execution time
+ * histograms, as VIR_TYPED_PARAM_UINT.
+ */
+
+# define VIR_SERVER_PROC_STATS_HIST_BUCKETS "proc.hist_buckets"
+
+typedef enum {
+    VIR_ADMIN_SERVER_PROC_STATS_RESET = (1 << 0), /* reset counters after reading */
+} virAdmServerProcStatsFlags;
+
+int virAdmServerGetProcStats(virAdmServerPtr srv,
+                             virTypedParameterPtr *params,
+                             int *nparams,
+                             unsigned int flags);
+
 int virAdmConnectGetLoggingOutputs(virAdmConnectPtr conn,
                                    char **outputs,
                                    unsigned int flags);
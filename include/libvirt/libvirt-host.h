@@ -622,6 +622,11 @@ int                     virNodeGetInfo          (virConnectPtr conn,
                                                  virNodeInfoPtr info);
 char *                  virConnectGetCapabilities (virConnectPtr conn);
 
+int                     virConnectGetCapabilitiesIfChanged(virConnectPtr conn,
+                                                           unsigned long long *generation,
+                                                           char **capabilities,
+                                                           unsigned int flags);
+
 int                     virNodeGetCPUStats (virConnectPtr conn,
                                             int cpuNum,
                                             virNodeCPUStatsPtr params,
@@ -2223,11 +2223,34 @@ acrnConnectGetCapabilities(virConnectPtr conn)
         return NULL;
     }
 
-    xml = virCapabilitiesFormatXML(caps);
+    xml = virCapabilitiesFormatXMLCached(caps);
     virObjectUnref(caps);
     return xml;
 }
 
+static int
+acrnConnectGetCapabilitiesIfChanged(virConnectPtr conn,
+                                    unsigned long long *generation,
+                                    char **capabilities,
+                                    unsigned int flags)
+{
+    acrnConnectPtr privconn = conn->privateData;
+    virCapsPtr caps;
+    int ret;
+
+    virCheckFlags(0, -1);
+
+    if (!(caps = acrnDriverGetCapabilities(privconn))) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("unable to get capabilities"));
+        return -1;
+    }
+
+    ret = virCapabilitiesFormatXMLIfChanged(caps, generation, capabilities);
+    virObjectUnref(caps);
+    return ret;
+}
+
 static int
 acrnConnectListAllDomains(virConnectPtr conn,
                           virDomainPtr **domains,
@@ -2840,6 +2863,7 @@ static virHypervisorDriver acrnHypervisorDriver = {
     .connectGetHostname = acrnConnectGetHostname, /* 0.0.1 */
     .nodeGetInfo = acrnNodeGetInfo, /* 0.0.1 */
     .connectGetCapabilities = acrnConnectGetCapabilities, /* 0.0.1 */
+    .connectGetCapabilitiesIfChanged = acrnConnectGetCapabilitiesIfChanged, /* 0.0.2 */
     .connectListAllDomains = acrnConnectListAllDomains, /* 0.0.1 */
     .domainCreateXML = acrnDomainCreateXML, /* 0.0.1 */
     .domainLookupByUUID = acrnDomainLookupByUUID, /* 0.0.1 */
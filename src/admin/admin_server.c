@@ -222,6 +222,8 @@ adminClientGetInfo(virNetServerClientPtr client,
     const char *attr = NULL;
     virTypedParameterPtr tmpparams = NULL;
     virIdentityPtr identity = NULL;
+    int compression;
+    virNetMessageCompressStats compressStats;
 
     virCheckFlags(0, -1);
 
@@ -291,6 +293,26 @@ adminClientGetInfo(virNetServerClientPtr client,
                                 VIR_CLIENT_INFO_SELINUX_CONTEXT, attr) < 0))
         goto cleanup;
 
+    compression = virNetServerClientGetCompression(client, &compressStats);
+    if (compression != VIR_NET_MESSAGE_COMPRESSION_NONE) {
+        if (virTypedParamsAddString(&tmpparams, nparams, &maxparams,
+                                    VIR_CLIENT_INFO_COMPRESSION,
+                                    virNetMessageCompressionTypeToString(compression)) < 0 ||
+            virTypedParamsAddULLong(&tmpparams, nparams, &maxparams,
+                                    VIR_CLIENT_INFO_COMPRESSION_MESSAGES,
+                                    compressStats.messages) < 0 ||
+            virTypedParamsAddULLong(&tmpparams, nparams, &maxparams,
+                                    VIR_CLIENT_INFO_COMPRESSION_RAW_BYTES,
+                                    compressStats.rawBytes) < 0 ||
+            virTypedParamsAddULLong(&tmpparams, nparams, &maxparams,
+                                    VIR_CLIENT_INFO_COMPRESSION_WIRE_BYTES,
+                                    compressStats.wireBytes) < 0 ||
+            virTypedParamsAddULLong(&tmpparams, nparams, &maxparams,
+                                    VIR_CLIENT_INFO_COMPRESSION_CPU_TIME,
+                                    compressStats.cpuTime) < 0)
+            goto cleanup;
+    }
+
     *params = tmpparams;
     tmpparams = NULL;
     ret = 0;
@@ -385,3 +407,112 @@ adminServerSetClientLimits(virNetServerPtr srv,
 
     return 0;
 }
+
+static int
+adminServerAddProcStats(virNetServerProgramPtr prog,
+                        int procedure,
+                        virNetServerProgramProcStatsPtr stats,
+                        size_t idx,
+                        virTypedParameterPtr *params,
+                        int *nparams,
+                        int *maxparams)
+{
+    char field[VIR_TYPED_PARAM_FIELD_LENGTH];
+    const char *name = virNetServerProgramGetProcName(prog, procedure);
+    size_t i;
+
+#define ADD_STAT(type, suffix, value) \
+    do { \
+        snprintf(field, sizeof(field), "proc.%zu." suffix, idx); \
+        if (virTypedParamsAdd ## type(params, nparams, maxparams, \
+                                      field, value) < 0) \
+            return -1; \
+    } while (0)
+
+    ADD_STAT(UInt, "program", virNetServerProgramGetID(prog));
+    ADD_STAT(UInt, "procedure", procedure);
+    if (name)
+        ADD_STAT(String, "name", name);
+    ADD_STAT(ULLong, "calls", stats->calls);
+    ADD_STAT(ULLong, "errors", stats->errors);
+    ADD_STAT(ULLong, "bytes_in", stats->bytesIn);
+    ADD_STAT(ULLong, "bytes_out", stats->bytesOut);
+    ADD_STAT(ULLong, "wait_time", stats->waitTime);
+    ADD_STAT(ULLong, "exec_time", stats->execTime);
+
+#undef ADD_STAT
+
+    for (i = 0; i < VIR_NET_SERVER_PROGRAM_STATS_BUCKETS; i++) {
+        if (stats->waitHist[i]) {
+            snprintf(field, sizeof(field), "proc.%zu.wait_hist.%zu", idx, i);
+            if (virTypedParamsAddULLong(params, nparams, maxparams,
+                                        field, stats->waitHist[i]) < 0)
+                return -1;
+        }
+        if (stats->execHist[i]) {
+            snprintf(field, sizeof(field), "proc.%zu.exec_hist.%zu", idx, i);
+            if (virTypedParamsAddULLong(params, nparams, maxparams,
+                                        field, stats->execHist[i]) < 0)
+                return -1;
+        }
+    }
+
+    return 0;
+}
+
+int
+adminServerGetProcStats(virNetServerPtr srv,
+                        virTypedParameterPtr *params,
+                        int *nparams,
+                        unsigned int flags)
+{
+    int ret = -1;
+    int maxparams = 0;
+    virTypedParameterPtr tmpparams = NULL;
+    virNetServerProgramPtr *progs = NULL;
+    int nprogs = 0;
+    virNetServerProgramProcStatsPtr stats = NULL;
+    size_t nstats = 0;
+    size_t count = 0;
+    size_t i, j;
+
+    virCheckFlags(VIR_ADMIN_SERVER_PROC_STATS_RESET, -1);
+
+    if ((nprogs = virNetServerGetPrograms(srv, &progs)) < 0)
+        goto cleanup;
+
+    for (i = 0; i < nprogs; i++) {
+        if (virNetServerProgramGetStats(progs[i], &stats, &nstats,
+                                        !!(flags & VIR_ADMIN_SERVER_PROC_STATS_RESET)) < 0)
+            goto cleanup;
+
+        for (j = 0; j < nstats; j++) {
+            if (!stats[j].calls)
+                continue;
+
+            if (adminServerAddProcStats(progs[i], j, &stats[j], count,
+                                        &tmpparams, nparams, &maxparams) < 0)
+                goto cleanup;
+            count++;
+        }
+
+        VIR_FREE(stats);
+    }
+
+    if (virTypedParamsAddUInt(&tmpparams, nparams, &maxparams,
+                              VIR_SERVER_PROC_STATS_COUNT, count) < 0 ||
+        virTypedParamsAddUInt(&tmpparams, nparams, &maxparams,
+                              VIR_SERVER_PROC_STATS_HIST_BUCKETS,
+                              VIR_NET_SERVER_PROGRAM_STATS_BUCKETS) < 0)
+        goto cleanup;
+
+    *params = tmpparams;
+    tmpparams = NULL;
+    ret = 0;
+
+ cleanup:
+    VIR_FREE(stats);
+    virObjectListFreeCount(progs, nprogs);
+    virTypedParamsFree(tmpparams, *nparams);
+    return ret;
+}
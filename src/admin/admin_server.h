@@ -69,4 +69,9 @@ int adminServerSetClientLimits(virNetServerPtr srv,
                                int nparams,
                                unsigned int flags);
 
+int adminServerGetProcStats(virNetServerPtr srv,
+                            virTypedParameterPtr *params,
+                            int *nparams,
+                            unsigned int flags);
+
 #endif /* LIBVIRT_ADMIN_SERVER_H */
@@ -30,6 +30,7 @@
 #include "physmem.h"
 #include "viralloc.h"
 #include "virarch.h"
+#include "viratomic.h"
 #include "virbuffer.h"
 #include "virerror.h"
 #include "virfile.h"
@@ -38,6 +39,7 @@
 #include "virlog.h"
 #include "virnuma.h"
 #include "virstring.h"
+#include "virtime.h"
 #include "virtypedparam.h"
 #include "viruuid.h"
 
@@ -54,10 +56,23 @@ VIR_ENUM_IMPL(virCapsHostPMTarget, VIR_NODE_SUSPEND_TARGET_LAST,
 static virClassPtr virCapsClass;
 static void virCapsDispose(void *obj);
 
+/* Generations handed out to capabilities objects are made of the time
+ * the library was initialized in the upper half and a counter in the
+ * lower half, so that a generation a client remembers from a previous
+ * daemon instance can never match one handed out by the current one. */
+static unsigned long long virCapabilitiesEpoch;
+static int virCapabilitiesCounter;
+
 static int virCapabilitiesOnceInit(void)
 {
-    if (!VIR_CLASS_NEW(virCaps, virClassForObject()))
+    unsigned long long now;
+
+    if (!VIR_CLASS_NEW(virCaps, virClassForObjectLockable()))
+        return -1;
+
+    if (virTimeMillisNow(&now) < 0)
         return -1;
+    virCapabilitiesEpoch = (now / 1000) << 32;
 
     return 0;
 }
@@ -82,9 +97,11 @@ virCapabilitiesNew(virArch hostarch,
     if (virCapabilitiesInitialize() < 0)
         return NULL;
 
-    if (!(caps = virObjectNew(virCapsClass)))
+    if (!(caps = virObjectLockableNew(virCapsClass)))
         return NULL;
 
+    caps->generation = virCapabilitiesEpoch |
+        (unsigned int) virAtomicIntInc(&virCapabilitiesCounter);
     caps->host.arch = hostarch;
     caps->host.offlineMigrate = offlineMigrate;
     caps->host.liveMigrate = liveMigrate;
@@ -231,6 +248,8 @@ virCapsDispose(void *object)
 
     virCapabilitiesFreeNUMAInfo(caps);
 
+    VIR_FREE(caps->xml);
+
     for (i = 0; i < caps->host.nmigrateTrans; i++)
         VIR_FREE(caps->host.migrateTrans[i]);
     VIR_FREE(caps->host.migrateTrans);
@@ -1070,6 +1089,11 @@ virCapabilitiesFormatXML(virCapsPtr caps)
     virBuffer buf = VIR_BUFFER_INITIALIZER;
     size_t i, j, k;
     char host_uuid[VIR_UUID_STRING_BUFLEN];
+    size_t hint = 4096 + 2048 * caps->nguests;
+
+    for (i = 0; i < caps->host.nnumaCell; i++)
+        hint += 512 + 96 * caps->host.numaCell[i]->ncpus;
+    virBufferReserve(&buf, MIN(hint, INT_MAX));
 
     virBufferAddLit(&buf, "<capabilities>\n\n");
     virBufferAdjustIndent(&buf, 2);
@@ -1282,6 +1306,111 @@ virCapabilitiesFormatXML(virCapsPtr caps)
     return NULL;
 }
 
+/**
+ * virCapabilitiesGetGeneration:
+ * @caps: capabilities object
+ *
+ * Returns the generation number of @caps. Every capabilities object
+ * gets its own generation when it is created, so drivers which
+ * replace their capabilities object when the host changes
+ * automatically hand out a new generation.
+ */
+unsigned long long
+virCapabilitiesGetGeneration(virCapsPtr caps)
+{
+    return caps->generation;
+}
+
+
+/**
+ * virCapabilitiesFormatXMLCached:
+ * @caps: capabilities to format
+ *
+ * Like virCapabilitiesFormatXML, but the document is only rendered
+ * the first time it is requested and kept with @caps afterwards.
+ * Callers must therefore not modify @caps once it is handed out to
+ * other threads, which is already the rule for capabilities objects
+ * held by drivers.
+ *
+ * Returns the XML document as a string which the caller must free
+ */
+char *
+virCapabilitiesFormatXMLCached(virCapsPtr caps)
+{
+    char *ret = NULL;
+
+    virObjectLock(caps);
+
+    if (!caps->xml &&
+        !(caps->xml = virCapabilitiesFormatXML(caps)))
+        goto cleanup;
+
+    ignore_value(VIR_STRDUP(ret, caps->xml));
+
+ cleanup:
+    virObjectUnlock(caps);
+    return ret;
+}
+
+
+/**
+ * virCapabilitiesFormatXMLIfChanged:
+ * @caps: capabilities to format
+ * @generation: in/out generation of the document known to the caller
+ * @xml: filled with the XML document
+ *
+ * Formats @caps unless @generation already matches its generation.
+ *
+ * Returns 1 if @xml and @generation were updated, 0 if the caller's
+ * copy is still current (@xml is set to NULL), -1 on error.
+ */
+int
+virCapabilitiesFormatXMLIfChanged(virCapsPtr caps,
+                                  unsigned long long *generation,
+                                  char **xml)
+{
+    *xml = NULL;
+
+    if (*generation == caps->generation)
+        return 0;
+
+    if (!(*xml = virCapabilitiesFormatXMLCached(caps)))
+        return -1;
+
+    *generation = caps->generation;
+    return 1;
+}
+
+
+/**
+ * virCapabilitiesIsEqual:
+ * @a: capabilities object
+ * @b: capabilities object
+ *
+ * Compares the XML representation of two capabilities objects.
+ *
+ * Returns 1 if they are the same, 0 if they differ, -1 on error.
+ */
+int
+virCapabilitiesIsEqual(virCapsPtr a,
+                       virCapsPtr b)
+{
+    char *axml = NULL;
+    char *bxml = NULL;
+    int ret = -1;
+
+    if (!(axml = virCapabilitiesFormatXMLCached(a)) ||
+        !(bxml = virCapabilitiesFormatXMLCached(b)))
+        goto cleanup;
+
+    ret = STREQ(axml, bxml) ? 1 : 0;
+
+ cleanup:
+    VIR_FREE(axml);
+    VIR_FREE(bxml);
+    return ret;
+}
+
 /* get the maximum ID of cpus in the host */
 static unsigned int
 virCapabilitiesGetHostMaxcpu(virCapsPtr caps)
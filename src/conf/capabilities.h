@@ -229,12 +229,15 @@ struct _virDomainXMLNamespace {
 typedef struct _virCaps virCaps;
 typedef virCaps *virCapsPtr;
 struct _virCaps {
-    virObject parent;
+    virObjectLockable parent;
 
     virCapsHost host;
     size_t nguests;
     size_t nguests_max;
     virCapsGuestPtr *guests;
+
+    unsigned long long generation;
+    char *xml; /* cached output of virCapabilitiesFormatXML */
 };
 
 typedef struct _virCapsDomainData virCapsDomainData;
@@ -338,6 +341,21 @@ virCapabilitiesClearHostNUMACellCPUTopology(virCapsHostNUMACellCPUPtr cpu,
 char *
 virCapabilitiesFormatXML(virCapsPtr caps);
 
+char *
+virCapabilitiesFormatXMLCached(virCapsPtr caps);
+
+int
+virCapabilitiesFormatXMLIfChanged(virCapsPtr caps,
+                                  unsigned long long *generation,
+                                  char **xml);
+
+unsigned long long
+virCapabilitiesGetGeneration(virCapsPtr caps);
+
+int
+virCapabilitiesIsEqual(virCapsPtr a,
+                       virCapsPtr b);
+
 virBitmapPtr virCapabilitiesGetCpusForNodemask(virCapsPtr caps,
                                                virBitmapPtr nodemask);
 
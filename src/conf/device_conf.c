@@ -233,6 +233,8 @@ int
 virPCIDeviceAddressParseXML(xmlNodePtr node,
                             virPCIDeviceAddressPtr addr)
 {
+    char arenabuf[128];
+    virArena arena = VIR_ARENA_INITIALIZER(arenabuf);
     char *domain, *slot, *bus, *function, *multi;
     xmlNodePtr cur;
     xmlNodePtr zpci = NULL;
@@ -240,11 +242,11 @@ virPCIDeviceAddressParseXML(xmlNodePtr node,
 
     memset(addr, 0, sizeof(*addr));
 
-    domain   = virXMLPropString(node, "domain");
-    bus      = virXMLPropString(node, "bus");
-    slot     = virXMLPropString(node, "slot");
-    function = virXMLPropString(node, "function");
-    multi    = virXMLPropString(node, "multifunction");
+    domain   = virXMLPropStringArena(node, "domain", &arena);
+    bus      = virXMLPropStringArena(node, "bus", &arena);
+    slot     = virXMLPropStringArena(node, "slot", &arena);
+    function = virXMLPropStringArena(node, "function", &arena);
+    multi    = virXMLPropStringArena(node, "multifunction", &arena);
 
     if (domain &&
         virStrToLong_uip(domain, NULL, 0, &addr->domain) < 0) {
@@ -300,11 +302,7 @@ virPCIDeviceAddressParseXML(xmlNodePtr node,
     ret = 0;
 
  cleanup:
-    VIR_FREE(domain);
-    VIR_FREE(bus);
-    VIR_FREE(slot);
-    VIR_FREE(function);
-    VIR_FREE(multi);
+    virArenaClear(&arena);
     return ret;
 }
 
@@ -9308,77 +9308,71 @@ static int
 virDomainDiskDefDriverParseXML(virDomainDiskDefPtr def,
                                xmlNodePtr cur)
 {
+    char arenabuf[256];
+    virArena arena = VIR_ARENA_INITIALIZER(arenabuf);
     char *tmp = NULL;
     int ret = -1;
 
     def->driverName = virXMLPropString(cur, "name");
 
-    if ((tmp = virXMLPropString(cur, "cache")) &&
+    if ((tmp = virXMLPropStringArena(cur, "cache", &arena)) &&
         (def->cachemode = virDomainDiskCacheTypeFromString(tmp)) < 0) {
         virReportError(VIR_ERR_CONFIG_UNSUPPORTED,
                        _("unknown disk cache mode '%s'"), tmp);
         goto cleanup;
     }
-    VIR_FREE(tmp);
 
-    if ((tmp = virXMLPropString(cur, "error_policy")) &&
+    if ((tmp = virXMLPropStringArena(cur, "error_policy", &arena)) &&
         (def->error_policy = virDomainDiskErrorPolicyTypeFromString(tmp)) <= 0) {
         virReportError(VIR_ERR_CONFIG_UNSUPPORTED,
                        _("unknown disk error policy '%s'"), tmp);
         goto cleanup;
     }
-    VIR_FREE(tmp);
 
-    if ((tmp = virXMLPropString(cur, "rerror_policy")) &&
+    if ((tmp = virXMLPropStringArena(cur, "rerror_policy", &arena)) &&
         (((def->rerror_policy = virDomainDiskErrorPolicyTypeFromString(tmp)) <= 0) ||
          (def->rerror_policy == VIR_DOMAIN_DISK_ERROR_POLICY_ENOSPACE))) {
         virReportError(VIR_ERR_CONFIG_UNSUPPORTED,
                        _("unknown disk read error policy '%s'"), tmp);
         goto cleanup;
     }
-    VIR_FREE(tmp);
 
-    if ((tmp = virXMLPropString(cur, "io")) &&
+    if ((tmp = virXMLPropStringArena(cur, "io", &arena)) &&
         (def->iomode = virDomainDiskIoTypeFromString(tmp)) <= 0) {
         virReportError(VIR_ERR_CONFIG_UNSUPPORTED,
                        _("unknown disk io mode '%s'"), tmp);
         goto cleanup;
     }
-    VIR_FREE(tmp);
 
-    if ((tmp = virXMLPropString(cur, "ioeventfd")) &&
+    if ((tmp = virXMLPropStringArena(cur, "ioeventfd", &arena)) &&
         (def->ioeventfd = virTristateSwitchTypeFromString(tmp)) <= 0) {
         virReportError(VIR_ERR_CONFIG_UNSUPPORTED,
                        _("unknown disk ioeventfd mode '%s'"), tmp);
         goto cleanup;
     }
-    VIR_FREE(tmp);
 
-    if ((tmp = virXMLPropString(cur, "event_idx")) &&
+    if ((tmp = virXMLPropStringArena(cur, "event_idx", &arena)) &&
         (def->event_idx = virTristateSwitchTypeFromString(tmp)) <= 0) {
         virReportError(VIR_ERR_CONFIG_UNSUPPORTED,
                        _("unknown disk event_idx mode '%s'"), tmp);
         goto cleanup;
     }
-    VIR_FREE(tmp);
 
-    if ((tmp = virXMLPropString(cur, "copy_on_read")) &&
+    if ((tmp = virXMLPropStringArena(cur, "copy_on_read", &arena)) &&
         (def->copy_on_read = virTristateSwitchTypeFromString(tmp)) <= 0) {
         virReportError(VIR_ERR_CONFIG_UNSUPPORTED,
                        _("unknown disk copy_on_read mode '%s'"), tmp);
         goto cleanup;
     }
-    VIR_FREE(tmp);
 
-    if ((tmp = virXMLPropString(cur, "discard")) &&
+    if ((tmp = virXMLPropStringArena(cur, "discard", &arena)) &&
         (def->discard = virDomainDiskDiscardTypeFromString(tmp)) <= 0) {
         virReportError(VIR_ERR_CONFIG_UNSUPPORTED,
                        _("unknown disk discard mode '%s'"), tmp);
         goto cleanup;
     }
-    VIR_FREE(tmp);
 
-    if ((tmp = virXMLPropString(cur, "iothread")) &&
+    if ((tmp = virXMLPropStringArena(cur, "iothread", &arena)) &&
         (virStrToLong_uip(tmp, NULL, 10, &def->iothread) < 0 ||
          def->iothread == 0)) {
         virReportError(VIR_ERR_XML_ERROR,
@@ -9386,9 +9380,8 @@ virDomainDiskDefDriverParseXML(virDomainDiskDefPtr def,
                        tmp);
         goto cleanup;
     }
-    VIR_FREE(tmp);
 
-    if ((tmp = virXMLPropString(cur, "type"))) {
+    if ((tmp = virXMLPropStringArena(cur, "type", &arena))) {
         if (STREQ(tmp, "aio")) {
             /* Xen back-compat */
             def->src->format = VIR_STORAGE_FILE_RAW;
@@ -9399,32 +9392,27 @@ virDomainDiskDefDriverParseXML(virDomainDiskDefPtr def,
                 goto cleanup;
             }
         }
-
-        VIR_FREE(tmp);
     }
 
-    if ((tmp = virXMLPropString(cur, "detect_zeroes")) &&
+    if ((tmp = virXMLPropStringArena(cur, "detect_zeroes", &arena)) &&
         (def->detect_zeroes = virDomainDiskDetectZeroesTypeFromString(tmp)) <= 0) {
         virReportError(VIR_ERR_CONFIG_UNSUPPORTED,
                        _("unknown driver detect_zeroes value '%s'"), tmp);
         goto cleanup;
     }
-    VIR_FREE(tmp);
 
-    if ((tmp = virXMLPropString(cur, "queues")) &&
+    if ((tmp = virXMLPropStringArena(cur, "queues", &arena)) &&
         virStrToLong_uip(tmp, NULL, 10, &def->queues) < 0) {
         virReportError(VIR_ERR_XML_ERROR,
                        _("'queues' attribute must be positive number: %s"),
                        tmp);
         goto cleanup;
     }
-    VIR_FREE(tmp);
 
     ret = 0;
 
  cleanup:
-    VIR_FREE(tmp);
-
+    virArenaClear(&arena);
     return ret;
 }
 
@@ -9473,6 +9461,8 @@ virDomainDiskDefParseXML(virDomainXMLOptionPtr xmlopt,
     virDomainDiskDefPtr def;
     xmlNodePtr cur;
     xmlNodePtr save_ctxt = ctxt->node;
+    char arenabuf[512];
+    virArena arena = VIR_ARENA_INITIALIZER(arenabuf);
     char *tmp = NULL;
     char *snapshot = NULL;
     char *rawio = NULL;
@@ -9503,26 +9493,24 @@ virDomainDiskDefParseXML(virDomainXMLOptionPtr xmlopt,
     def->src->type = VIR_STORAGE_TYPE_FILE;
     def->device = VIR_DOMAIN_DISK_DEVICE_DISK;
 
-    if ((tmp = virXMLPropString(node, "type")) &&
+    if ((tmp = virXMLPropStringArena(node, "type", &arena)) &&
         (def->src->type = virStorageTypeFromString(tmp)) <= 0) {
         virReportError(VIR_ERR_CONFIG_UNSUPPORTED,
                        _("unknown disk type '%s'"), tmp);
         goto error;
     }
-    VIR_FREE(tmp);
 
-    if ((tmp = virXMLPropString(node, "device")) &&
+    if ((tmp = virXMLPropStringArena(node, "device", &arena)) &&
         (def->device = virDomainDiskDeviceTypeFromString(tmp)) < 0) {
         virReportError(VIR_ERR_CONFIG_UNSUPPORTED,
                        _("unknown disk device '%s'"), tmp);
         goto error;
     }
-    VIR_FREE(tmp);
 
-    snapshot = virXMLPropString(node, "snapshot");
+    snapshot = virXMLPropStringArena(node, "snapshot", &arena);
 
-    rawio = virXMLPropString(node, "rawio");
-    sgio = virXMLPropString(node, "sgio");
+    rawio = virXMLPropStringArena(node, "rawio", &arena);
+    sgio = virXMLPropStringArena(node, "sgio", &arena);
 
     for (cur = node->children; cur != NULL; cur = cur->next) {
         if (cur->type != XML_ELEMENT_NODE)
@@ -9559,21 +9547,20 @@ virDomainDiskDefParseXML(virDomainXMLOptionPtr xmlopt,
 
             source = true;
 
-            startupPolicy = virXMLPropString(cur, "startupPolicy");
+            startupPolicy = virXMLPropStringArena(cur, "startupPolicy", &arena);
 
             if (!(flags & VIR_DOMAIN_DEF_PARSE_INACTIVE) &&
-                (tmp = virXMLPropString(cur, "index")) &&
+                (tmp = virXMLPropStringArena(cur, "index", &arena)) &&
                 virStrToLong_uip(tmp, NULL, 10, &def->src->id) < 0) {
                 virReportError(VIR_ERR_XML_ERROR, _("invalid disk index '%s'"), tmp);
                 goto error;
             }
-            VIR_FREE(tmp);
         } else if (!target &&
                    virXMLNodeNameEqual(cur, "target")) {
             target = virXMLPropString(cur, "dev");
-            bus = virXMLPropString(cur, "bus");
-            tray = virXMLPropString(cur, "tray");
-            removable = virXMLPropString(cur, "removable");
+            bus = virXMLPropStringArena(cur, "bus", &arena);
+            tray = virXMLPropStringArena(cur, "tray", &arena);
+            removable = virXMLPropStringArena(cur, "removable", &arena);
 
             /* HACK: Work around for compat with Xen
              * driver in previous libvirt releases */
@@ -9588,7 +9575,7 @@ virDomainDiskDefParseXML(virDomainXMLOptionPtr xmlopt,
                 goto error;
         } else if (virXMLNodeNameEqual(cur, "blockio")) {
             logical_block_size =
-                virXMLPropString(cur, "logical_block_size");
+                virXMLPropStringArena(cur, "logical_block_size", &arena);
             if (logical_block_size &&
                 virStrToLong_ui(logical_block_size, NULL, 0,
                                 &def->blockio.logical_block_size) < 0) {
@@ -9598,7 +9585,7 @@ virDomainDiskDefParseXML(virDomainXMLOptionPtr xmlopt,
                 goto error;
             }
             physical_block_size =
-                virXMLPropString(cur, "physical_block_size");
+                virXMLPropStringArena(cur, "physical_block_size", &arena);
             if (physical_block_size &&
                 virStrToLong_ui(physical_block_size, NULL, 0,
                                 &def->blockio.physical_block_size) < 0) {
@@ -9644,7 +9631,7 @@ virDomainDiskDefParseXML(virDomainXMLOptionPtr xmlopt,
         } else if ((flags & VIR_DOMAIN_DEF_PARSE_STATUS) &&
                    virXMLNodeNameEqual(cur, "state")) {
             /* Legacy back-compat. Don't add any more attributes here */
-            devaddr = virXMLPropString(cur, "devaddr");
+            devaddr = virXMLPropStringArena(cur, "devaddr", &arena);
         } else if (!encryption &&
                    virXMLNodeNameEqual(cur, "encryption")) {
             /* If we've already parsed <source> and found an <encryption> child,
@@ -9715,12 +9702,14 @@ virDomainDiskDefParseXML(virDomainXMLOptionPtr xmlopt,
 
     if (!target && !(flags & VIR_DOMAIN_DEF_PARSE_DISK_SOURCE)) {
         if (def->src->srcpool) {
-            if (virAsprintf(&tmp, "pool = '%s', volume = '%s'",
+            char *srcpool = NULL;
+
+            if (virAsprintf(&srcpool, "pool = '%s', volume = '%s'",
                 def->src->srcpool->pool, def->src->srcpool->volume) < 0)
                 goto error;
 
-            virReportError(VIR_ERR_NO_TARGET, "%s", tmp);
-            VIR_FREE(tmp);
+            virReportError(VIR_ERR_NO_TARGET, "%s", srcpool);
+            VIR_FREE(srcpool);
         } else {
             virReportError(VIR_ERR_NO_TARGET, def->src->path ? "%s" : NULL, def->src->path);
         }
@@ -9886,21 +9875,11 @@ virDomainDiskDefParseXML(virDomainXMLOptionPtr xmlopt,
         goto error;
 
  cleanup:
-    VIR_FREE(tmp);
-    VIR_FREE(bus);
-    VIR_FREE(snapshot);
-    VIR_FREE(rawio);
-    VIR_FREE(sgio);
+    virArenaClear(&arena);
     VIR_FREE(target);
-    VIR_FREE(tray);
-    VIR_FREE(removable);
     virStorageAuthDefFree(authdef);
-    VIR_FREE(devaddr);
     VIR_FREE(serial);
     virStorageEncryptionFree(encryption);
-    VIR_FREE(startupPolicy);
-    VIR_FREE(logical_block_size);
-    VIR_FREE(physical_block_size);
     VIR_FREE(wwn);
     VIR_FREE(vendor);
     VIR_FREE(product);
@@ -22911,7 +22890,8 @@ virDomainDefCheckABIStabilityFlags(virDomainDefPtr src,
         goto error;
     }
 
-    if (memcmp(src->uuid, dst->uuid, VIR_UUID_BUFLEN) != 0) {
+    if (!(flags & VIR_DOMAIN_DEF_ABI_CHECK_SKIP_IDENTITY) &&
+        memcmp(src->uuid, dst->uuid, VIR_UUID_BUFLEN) != 0) {
         char uuidsrc[VIR_UUID_STRING_BUFLEN];
         char uuiddst[VIR_UUID_STRING_BUFLEN];
         virUUIDFormat(src->uuid, uuidsrc);
@@ -22945,7 +22925,8 @@ virDomainDefCheckABIStabilityFlags(virDomainDefPtr src,
      * don't get silently re-named through the backdoor when passing
      * custom XML into various APIs, since this would create havoc
      */
-    if (STRNEQ_NULLABLE(src->name, dst->name)) {
+    if (!(flags & VIR_DOMAIN_DEF_ABI_CHECK_SKIP_IDENTITY) &&
+        STRNEQ_NULLABLE(src->name, dst->name)) {
         virReportError(VIR_ERR_CONFIG_UNSUPPORTED,
                        _("Target domain name '%s' does not match source '%s'"),
                        dst->name, src->name);
@@ -28004,6 +27985,12 @@ virDomainDefFormatInternal(virDomainDefPtr def,
     if (def->id == -1)
         flags |= VIR_DOMAIN_DEF_FORMAT_INACTIVE;
 
+    /* Rough per device estimate, so that definitions with hundreds of
+     * devices don't have to grow the buffer over and over */
+    virBufferReserve(buf, 2048 + 512 * (def->ndisks + def->nnets +
+                                        def->nhostdevs + def->ncontrollers +
+                                        def->nserials + def->nchannels));
+
     virBufferAsprintf(buf, "<domain type='%s'", type);
     if (!(flags & VIR_DOMAIN_DEF_FORMAT_INACTIVE))
         virBufferAsprintf(buf, " id='%d'", def->id);
@@ -29393,28 +29380,1400 @@ virDomainDiskDefForeachPath(virDomainDiskDefPtr disk,
     return ret;
 }
 
+/*
+ * Native deep copy of domain definitions.
+ *
+ * virDomainDefCopy() used to clone every definition by formatting it
+ * to XML and parsing it back with VIR_DOMAIN_DEF_PARSE_INACTIVE, which
+ * dominates the cost of starting a domain or editing its persistent
+ * config. The helpers below copy the structures directly, applying the
+ * same transformations the inactive parser does to live-only state.
+ * Definitions containing anything not handled here, and those of
+ * drivers with post parse callbacks, fall back to the XML round trip,
+ * so the two paths always produce equal results.
+ */
+
+static bool
+virDomainDefCopyNativeStorageSupported(virStorageSourcePtr src)
+{
+    virStorageSourcePtr n;
+
+    for (n = src; n; n = n->backingStore) {
+        if (n->type == VIR_STORAGE_TYPE_VOLUME)
+            return false;
+
+        if (n != src &&
+            n->type != VIR_STORAGE_TYPE_NONE &&
+            n->format <= 0)
+            return false;
+    }
+
+    return true;
+}
+
 
-/* Copy src into a new definition; with the quality of the copy
- * depending on the migratable flag (false for transitions between
- * persistent and active, true for transitions across save files or
- * snapshots).  */
-virDomainDefPtr
-virDomainDefCopy(virDomainDefPtr src,
-                 virCapsPtr caps,
-                 virDomainXMLOptionPtr xmlopt,
-                 void *parseOpaque,
-                 bool migratable)
+static bool
+virDomainDefCopyNativeSupported(virDomainDefPtr def,
+                                virDomainXMLOptionPtr xmlopt)
 {
-    char *xml;
-    virDomainDefPtr ret;
-    unsigned int format_flags = VIR_DOMAIN_DEF_FORMAT_SECURE;
-    unsigned int parse_flags = VIR_DOMAIN_DEF_PARSE_INACTIVE |
-                               VIR_DOMAIN_DEF_PARSE_SKIP_VALIDATE;
+    size_t i;
 
-    if (migratable)
-        format_flags |= VIR_DOMAIN_DEF_FORMAT_INACTIVE | VIR_DOMAIN_DEF_FORMAT_MIGRATABLE;
+    if (def->namespaceData || def->postParseFailed)
+        return false;
+
+    /* The driver's post parse callbacks may adjust the definition the
+     * parser produced in ways the native copy would not reproduce */
+    if (xmlopt &&
+        (xmlopt->config.domainPostParseBasicCallback ||
+         xmlopt->config.domainPostParseDataAlloc ||
+         xmlopt->config.domainPostParseCallback ||
+         xmlopt->config.devicesPostParseCallback ||
+         xmlopt->config.assignAddressesCallback))
+        return false;
+
+    if (def->nresctrls || def->nfss || def->nredirdevs ||
+        def->nsmartcards || def->nleases || def->nshmems || def->nmems ||
+        def->nvram || def->tpm || def->sysinfo || def->redirfilter)
+        return false;
+
+    for (i = 0; i < def->nseclabels; i++) {
+        if (!def->seclabels[i]->model)
+            return false;
+    }
+
+    for (i = 0; i < def->ndisks; i++) {
+        if (!virDomainDefCopyNativeStorageSupported(def->disks[i]->src))
+            return false;
+    }
+
+    for (i = 0; i < def->nnets; i++) {
+        virDomainNetDefPtr net = def->nets[i];
+
+        switch (net->type) {
+        case VIR_DOMAIN_NET_TYPE_NETWORK:
+            if (net->data.network.actual)
+                return false;
+            break;
+        case VIR_DOMAIN_NET_TYPE_USER:
+        case VIR_DOMAIN_NET_TYPE_ETHERNET:
+        case VIR_DOMAIN_NET_TYPE_BRIDGE:
+        case VIR_DOMAIN_NET_TYPE_INTERNAL:
+        case VIR_DOMAIN_NET_TYPE_DIRECT:
+            break;
+        case VIR_DOMAIN_NET_TYPE_VHOSTUSER:
+        case VIR_DOMAIN_NET_TYPE_SERVER:
+        case VIR_DOMAIN_NET_TYPE_CLIENT:
+        case VIR_DOMAIN_NET_TYPE_MCAST:
+        case VIR_DOMAIN_NET_TYPE_UDP:
+        case VIR_DOMAIN_NET_TYPE_HOSTDEV:
+        case VIR_DOMAIN_NET_TYPE_LAST:
+        default:
+            return false;
+        }
+
+        if (net->hostIP.nips || net->hostIP.nroutes ||
+            net->guestIP.nips || net->guestIP.nroutes)
+            return false;
+    }
+
+    for (i = 0; i < def->nhostdevs; i++) {
+        virDomainHostdevDefPtr hostdev = def->hostdevs[i];
+
+        if (hostdev->mode != VIR_DOMAIN_HOSTDEV_MODE_SUBSYS ||
+            hostdev->parent.type != VIR_DOMAIN_DEVICE_NONE ||
+            (hostdev->source.subsys.type != VIR_DOMAIN_HOSTDEV_SUBSYS_TYPE_PCI &&
+             hostdev->source.subsys.type != VIR_DOMAIN_HOSTDEV_SUBSYS_TYPE_USB))
+            return false;
+    }
+
+    return true;
+}
+
+
+static int
+virDomainDefCopyNativeInfo(virDomainDeviceInfoPtr dst,
+                           virDomainDeviceInfoPtr src,
+                           virDomainXMLOptionPtr xmlopt)
+{
+    if (virDomainDeviceInfoCopy(dst, src) < 0)
+        return -1;
+
+    /* only user aliases survive an inactive parse */
+    if (dst->alias &&
+        !(xmlopt &&
+          xmlopt->config.features & VIR_DOMAIN_DEF_FEATURE_USER_ALIAS &&
+          virDomainDeviceAliasIsUserAlias(dst->alias) &&
+          strspn(dst->alias, USER_ALIAS_CHARS) == strlen(dst->alias)))
+        VIR_FREE(dst->alias);
+
+    return 0;
+}
+
+
+static int
+virDomainDefCopyNativeVirtio(virDomainVirtioOptionsPtr *dst,
+                             virDomainVirtioOptionsPtr src)
+{
+    if (!src)
+        return 0;
+
+    if (VIR_ALLOC(*dst) < 0)
+        return -1;
+
+    **dst = *src;
+    return 0;
+}
+
+
+static int
+virDomainDefCopyNativeDeviceSeclabels(virSecurityDeviceLabelDefPtr **dst,
+                                      size_t *ndst,
+                                      virSecurityDeviceLabelDefPtr *src,
+                                      size_t nsrc)
+{
+    size_t i;
+
+    if (nsrc == 0)
+        return 0;
+
+    if (VIR_ALLOC_N(*dst, nsrc) < 0)
+        return -1;
+    *ndst = nsrc;
+
+    for (i = 0; i < nsrc; i++) {
+        if (!((*dst)[i] = virSecurityDeviceLabelDefCopy(src[i])))
+            return -1;
+
+        /* labelskip is only parsed on live images */
+        (*dst)[i]->labelskip = false;
+    }
+
+    return 0;
+}
+
+
+static void
+virDomainDefCopyNativeStorageSanitize(virStorageSourcePtr dst,
+                                      virStorageSourcePtr src)
+{
+    virStorageSourcePtr d;
+    virStorageSourcePtr s;
+    size_t i;
+
+    for (d = dst, s = src; d && s; d = d->backingStore, s = s->backingStore) {
+        bool backing = d != dst;
+
+        d->authInherited = s->authInherited;
+        d->encryptionInherited = s->encryptionInherited;
+
+        /* state which is not part of the domain XML */
+        d->id = 0;
+        d->tlsFromConfig = false;
+        d->detected = false;
+        d->capacity = 0;
+        d->allocation = 0;
+        d->physical = 0;
+        d->has_allocation = false;
+        d->debug = false;
+        d->debugLevel = 0;
+        d->iomode = 0;
+        d->cachemode = 0;
+        d->discard = 0;
+        d->detect_zeroes = 0;
+        d->floppyimg = false;
+        d->hostcdrom = false;
+        VIR_FREE(d->relPath);
+        VIR_FREE(d->backingStoreRaw);
+        VIR_FREE(d->nodeformat);
+        VIR_FREE(d->nodestorage);
+        VIR_FREE(d->tlsAlias);
+        VIR_FREE(d->tlsCertdir);
+        VIR_FREE(d->compat);
+        virBitmapFree(d->features);
+        d->features = NULL;
+        if (d->perms)
+            VIR_FREE(d->perms->label);
+        VIR_FREE(d->perms);
+        VIR_FREE(d->timestamps);
+        if (d->pr)
+            VIR_FREE(d->pr->mgralias);
+
+        if (d->type != VIR_STORAGE_TYPE_NETWORK)
+            VIR_FREE(d->configFile);
+
+        for (i = 0; i < d->nseclabels; i++)
+            d->seclabels[i]->labelskip = false;
+
+        if (backing || d->type == VIR_STORAGE_TYPE_NETWORK) {
+            for (i = 0; i < d->nseclabels; i++)
+                virSecurityDeviceLabelDefFree(d->seclabels[i]);
+            VIR_FREE(d->seclabels);
+            d->nseclabels = 0;
+        }
+
+        if (backing) {
+            /* backing store is always read-only */
+            d->readonly = true;
+            d->shared = false;
+
+            if (!d->authInherited) {
+                virStorageAuthDefFree(d->auth);
+                d->auth = NULL;
+            }
+            if (!d->encryptionInherited) {
+                virStorageEncryptionFree(d->encryption);
+                d->encryption = NULL;
+            }
+        }
+    }
+}
+
+
+static virDomainDiskDefPtr
+virDomainDefCopyNativeDisk(virDomainDiskDefPtr src,
+                           virDomainXMLOptionPtr xmlopt)
+{
+    virDomainDiskDefPtr ret;
+    virStorageSourcePtr newsrc;
+
+    if (!(ret = virDomainDiskDefNew(xmlopt)))
+        return NULL;
+
+    if (!(newsrc = virStorageSourceCopy(src->src, true)))
+        goto error;
+    virStorageSourceFree(ret->src);
+    ret->src = newsrc;
+    virDomainDefCopyNativeStorageSanitize(ret->src, src->src);
+
+    ret->device = src->device;
+    ret->bus = src->bus;
+    ret->tray_status = src->tray_status;
+    ret->removable = src->removable;
+    ret->geometry = src->geometry;
+    ret->blockio = src->blockio;
+    ret->blkdeviotune = src->blkdeviotune;
+    ret->blkdeviotune.group_name = NULL;
+    ret->cachemode = src->cachemode;
+    ret->error_policy = src->error_policy;
+    ret->rerror_policy = src->rerror_policy;
+    ret->iomode = src->iomode;
+    ret->ioeventfd = src->ioeventfd;
+    ret->event_idx = src->event_idx;
+    ret->copy_on_read = src->copy_on_read;
+    ret->snapshot = src->snapshot;
+    ret->startupPolicy = src->startupPolicy;
+    ret->transient = src->transient;
+    ret->rawio = src->rawio;
+    ret->sgio = src->sgio;
+    ret->discard = src->discard;
+    ret->iothread = src->iothread;
+    ret->detect_zeroes = src->detect_zeroes;
+    ret->queues = src->queues;
+
+    /* block job state (mirror) is never part of the inactive config */
+
+    if (VIR_STRDUP(ret->dst, src->dst) < 0 ||
+        VIR_STRDUP(ret->blkdeviotune.group_name,
+                   src->blkdeviotune.group_name) < 0 ||
+        VIR_STRDUP(ret->driverName, src->driverName) < 0 ||
+        VIR_STRDUP(ret->serial, src->serial) < 0 ||
+        VIR_STRDUP(ret->wwn, src->wwn) < 0 ||
+        VIR_STRDUP(ret->vendor, src->vendor) < 0 ||
+        VIR_STRDUP(ret->product, src->product) < 0 ||
+        VIR_STRDUP(ret->domain_name, src->domain_name) < 0)
+        goto error;
+
+    if (virDomainDefCopyNativeInfo(&ret->info, &src->info, xmlopt) < 0 ||
+        virDomainDefCopyNativeVirtio(&ret->virtio, src->virtio) < 0)
+        goto error;
+
+    return ret;
+
+ error:
+    virDomainDiskDefFree(ret);
+    return NULL;
+}
+
+
+static virDomainControllerDefPtr
+virDomainDefCopyNativeController(virDomainControllerDefPtr src,
+                                 virDomainXMLOptionPtr xmlopt)
+{
+    virDomainControllerDefPtr ret;
+
+    if (!(ret = virDomainControllerDefNew(src->type)))
+        return NULL;
+
+    ret->idx = src->idx;
+    ret->model = src->model;
+    ret->queues = src->queues;
+    ret->cmd_per_lun = src->cmd_per_lun;
+    ret->max_sectors = src->max_sectors;
+    ret->ioeventfd = src->ioeventfd;
+    ret->iothread = src->iothread;
+    ret->opts = src->opts;
+
+    if (virDomainDefCopyNativeInfo(&ret->info, &src->info, xmlopt) < 0 ||
+        virDomainDefCopyNativeVirtio(&ret->virtio, src->virtio) < 0)
+        goto error;
+
+    return ret;
+
+ error:
+    virDomainControllerDefFree(ret);
+    return NULL;
+}
+
+
+static virDomainNetDefPtr
+virDomainDefCopyNativeNet(virDomainNetDefPtr src,
+                          virCapsPtr caps,
+                          virDomainXMLOptionPtr xmlopt)
+{
+    virDomainNetDefPtr ret;
+    const char *prefix = caps ? caps->host.netprefix : NULL;
+
+    if (VIR_ALLOC(ret) < 0)
+        return NULL;
+
+    ret->type = src->type;
+    ret->mac = src->mac;
+    ret->driver = src->driver;
+    ret->tune = src->tune;
+    ret->trustGuestRxFilters = src->trustGuestRxFilters;
+    ret->linkstate = src->linkstate;
+    ret->mtu = src->mtu;
+
+    switch (src->type) {
+    case VIR_DOMAIN_NET_TYPE_NETWORK:
+        if (VIR_STRDUP(ret->data.network.name, src->data.network.name) < 0 ||
+            VIR_STRDUP(ret->data.network.portgroup,
+                       src->data.network.portgroup) < 0)
+            goto error;
+        break;
+
+    case VIR_DOMAIN_NET_TYPE_BRIDGE:
+        if (VIR_STRDUP(ret->data.bridge.brname, src->data.bridge.brname) < 0)
+            goto error;
+        break;
+
+    case VIR_DOMAIN_NET_TYPE_INTERNAL:
+        if (VIR_STRDUP(ret->data.internal.name, src->data.internal.name) < 0)
+            goto error;
+        break;
+
+    case VIR_DOMAIN_NET_TYPE_DIRECT:
+        ret->data.direct.mode = src->data.direct.mode;
+        if (VIR_STRDUP(ret->data.direct.linkdev, src->data.direct.linkdev) < 0)
+            goto error;
+        break;
+
+    default:
+        break;
+    }
+
+    if (VIR_STRDUP(ret->model, src->model) < 0 ||
+        VIR_STRDUP(ret->backend.tap, src->backend.tap) < 0 ||
+        VIR_STRDUP(ret->backend.vhost, src->backend.vhost) < 0 ||
+        VIR_STRDUP(ret->script, src->script) < 0 ||
+        VIR_STRDUP(ret->domain_name, src->domain_name) < 0 ||
+        VIR_STRDUP(ret->ifname_guest, src->ifname_guest) < 0 ||
+        VIR_STRDUP(ret->ifname_guest_actual, src->ifname_guest_actual) < 0 ||
+        VIR_STRDUP(ret->filter, src->filter) < 0)
+        goto error;
+
+    /* auto-generated host side names are blanked out */
+    if (src->ifname &&
+        !STRPREFIX(src->ifname, VIR_NET_GENERATED_TAP_PREFIX) &&
+        !(prefix && STRPREFIX(src->ifname, prefix)) &&
+        !(src->type == VIR_DOMAIN_NET_TYPE_DIRECT &&
+          (STRPREFIX(src->ifname, VIR_NET_GENERATED_MACVTAP_PREFIX) ||
+           STRPREFIX(src->ifname, VIR_NET_GENERATED_MACVLAN_PREFIX))) &&
+        VIR_STRDUP(ret->ifname, src->ifname) < 0)
+        goto error;
+
+    if (src->virtPortProfile) {
+        if (VIR_ALLOC(ret->virtPortProfile) < 0)
+            goto error;
+        *ret->virtPortProfile = *src->virtPortProfile;
+    }
+
+    if (src->coalesce) {
+        if (VIR_ALLOC(ret->coalesce) < 0)
+            goto error;
+        *ret->coalesce = *src->coalesce;
+    }
+
+    if (src->filterparams &&
+        (!(ret->filterparams = virNWFilterHashTableCreate(0)) ||
+         virNWFilterHashTablePutAll(src->filterparams, ret->filterparams) < 0))
+        goto error;
+
+    if (virNetDevBandwidthCopy(&ret->bandwidth, src->bandwidth) < 0 ||
+        virNetDevVlanCopy(&ret->vlan, &src->vlan) < 0 ||
+        virDomainDefCopyNativeInfo(&ret->info, &src->info, xmlopt) < 0 ||
+        virDomainDefCopyNativeVirtio(&ret->virtio, src->virtio) < 0)
+        goto error;
+
+    return ret;
+
+ error:
+    virDomainNetDefFree(ret);
+    return NULL;
+}
+
+
+static virDomainChrSourceDefPtr
+virDomainDefCopyNativeChrSource(virDomainChrSourceDefPtr src,
+                                virDomainXMLOptionPtr xmlopt)
+{
+    virDomainChrSourceDefPtr ret;
+
+    if (!(ret = virDomainChrSourceDefNew(xmlopt)))
+        return NULL;
+
+    if (virDomainChrSourceDefCopy(ret, src) < 0)
+        goto error;
+
+    switch ((virDomainChrType) src->type) {
+    case VIR_DOMAIN_CHR_TYPE_PTY:
+        /* PTY path is only parsed from live xml */
+        VIR_FREE(ret->data.file.path);
+        break;
+
+    case VIR_DOMAIN_CHR_TYPE_TCP:
+        ret->data.tcp.listen = src->data.tcp.listen;
+        ret->data.tcp.protocol = src->data.tcp.protocol;
+        ret->data.tcp.tlsFromConfig = false;
+        break;
+
+    case VIR_DOMAIN_CHR_TYPE_UNIX:
+        ret->data.nix.listen = src->data.nix.listen;
+        break;
+
+    case VIR_DOMAIN_CHR_TYPE_SPICEVMC:
+        ret->data.spicevmc = src->data.spicevmc;
+        break;
+
+    case VIR_DOMAIN_CHR_TYPE_SPICEPORT:
+        if (VIR_STRDUP(ret->data.spiceport.channel,
+                       src->data.spiceport.channel) < 0)
+            goto error;
+        break;
+
+    case VIR_DOMAIN_CHR_TYPE_NULL:
+    case VIR_DOMAIN_CHR_TYPE_VC:
+    case VIR_DOMAIN_CHR_TYPE_FILE:
+    case VIR_DOMAIN_CHR_TYPE_DEV:
+    case VIR_DOMAIN_CHR_TYPE_PIPE:
+    case VIR_DOMAIN_CHR_TYPE_STDIO:
+    case VIR_DOMAIN_CHR_TYPE_UDP:
+    case VIR_DOMAIN_CHR_TYPE_NMDM:
+    case VIR_DOMAIN_CHR_TYPE_LAST:
+        break;
+    }
+
+    ret->logappend = src->logappend;
+    if (VIR_STRDUP(ret->logfile, src->logfile) < 0)
+        goto error;
+
+    if (virDomainDefCopyNativeDeviceSeclabels(&ret->seclabels,
+                                              &ret->nseclabels,
+                                              src->seclabels,
+                                              src->nseclabels) < 0)
+        goto error;
+
+    return ret;
+
+ error:
+    virObjectUnref(ret);
+    return NULL;
+}
+
+
+static virDomainChrDefPtr
+virDomainDefCopyNativeChr(virDomainChrDefPtr src,
+                          virDomainXMLOptionPtr xmlopt)
+{
+    virDomainChrDefPtr ret;
+
+    if (VIR_ALLOC(ret) < 0)
+        return NULL;
+
+    ret->deviceType = src->deviceType;
+    ret->targetType = src->targetType;
+    ret->targetModel = src->targetModel;
+
+    /* channel state is only parsed from live xml */
+    ret->state = VIR_DOMAIN_CHR_DEVICE_STATE_DEFAULT;
+
+    if (src->deviceType == VIR_DOMAIN_CHR_DEVICE_TYPE_CHANNEL &&
+        src->targetType == VIR_DOMAIN_CHR_CHANNEL_TARGET_TYPE_GUESTFWD) {
+        if (src->target.addr) {
+            if (VIR_ALLOC(ret->target.addr) < 0)
+                goto error;
+            *ret->target.addr = *src->target.addr;
+        }
+    } else if (src->deviceType == VIR_DOMAIN_CHR_DEVICE_TYPE_CHANNEL &&
+               (src->targetType == VIR_DOMAIN_CHR_CHANNEL_TARGET_TYPE_XEN ||
+                src->targetType == VIR_DOMAIN_CHR_CHANNEL_TARGET_TYPE_VIRTIO)) {
+        if (VIR_STRDUP(ret->target.name, src->target.name) < 0)
+            goto error;
+    } else {
+        ret->target.port = src->target.port;
+    }
+
+    if (!(ret->source = virDomainDefCopyNativeChrSource(src->source, xmlopt)) ||
+        virDomainDefCopyNativeInfo(&ret->info, &src->info, xmlopt) < 0)
+        goto error;
+
+    return ret;
+
+ error:
+    virDomainChrDefFree(ret);
+    return NULL;
+}
+
+
+static int
+virDomainDefCopyNativeChrs(virDomainChrDefPtr **dst,
+                           size_t *ndst,
+                           virDomainChrDefPtr *src,
+                           size_t nsrc,
+                           virDomainXMLOptionPtr xmlopt)
+{
+    size_t i;
+
+    if (nsrc == 0)
+        return 0;
+
+    if (VIR_ALLOC_N(*dst, nsrc) < 0)
+        return -1;
+
+    for (i = 0; i < nsrc; i++) {
+        if (!((*dst)[i] = virDomainDefCopyNativeChr(src[i], xmlopt)))
+            return -1;
+        (*ndst)++;
+    }
+
+    return 0;
+}
+
+
+static int
+virDomainDefCopyNativeGraphicsAuth(virDomainGraphicsAuthDefPtr dst,
+                                   virDomainGraphicsAuthDefPtr src)
+{
+    /* the other attributes are only formatted along with a password */
+    if (!src->passwd)
+        return 0;
+
+    *dst = *src;
+    dst->passwd = NULL;
+
+    return VIR_STRDUP(dst->passwd, src->passwd);
+}
+
+
+static virDomainGraphicsDefPtr
+virDomainDefCopyNativeGraphics(virDomainGraphicsDefPtr src,
+                               virDomainXMLOptionPtr xmlopt ATTRIBUTE_UNUSED)
+{
+    virDomainGraphicsDefPtr ret;
+    size_t i;
+
+    if (VIR_ALLOC(ret) < 0)
+        return NULL;
+
+    ret->type = src->type;
+
+    switch (src->type) {
+    case VIR_DOMAIN_GRAPHICS_TYPE_VNC:
+        ret->data.vnc.port = src->data.vnc.port;
+        ret->data.vnc.websocket = src->data.vnc.websocket;
+        ret->data.vnc.autoport = src->data.vnc.autoport;
+        ret->data.vnc.sharePolicy = src->data.vnc.sharePolicy;
+        if (ret->data.vnc.autoport)
+            ret->data.vnc.port = 0;
+        if (VIR_STRDUP(ret->data.vnc.keymap, src->data.vnc.keymap) < 0 ||
+            virDomainDefCopyNativeGraphicsAuth(&ret->data.vnc.auth,
+                                               &src->data.vnc.auth) < 0)
+            goto error;
+        break;
+
+    case VIR_DOMAIN_GRAPHICS_TYPE_SDL:
+        ret->data.sdl.fullscreen = src->data.sdl.fullscreen;
+        ret->data.sdl.gl = src->data.sdl.gl;
+        if (VIR_STRDUP(ret->data.sdl.display, src->data.sdl.display) < 0 ||
+            VIR_STRDUP(ret->data.sdl.xauth, src->data.sdl.xauth) < 0)
+            goto error;
+        break;
+
+    case VIR_DOMAIN_GRAPHICS_TYPE_RDP:
+        ret->data.rdp = src->data.rdp;
+        if (ret->data.rdp.autoport)
+            ret->data.rdp.port = 0;
+        break;
+
+    case VIR_DOMAIN_GRAPHICS_TYPE_DESKTOP:
+        ret->data.desktop.fullscreen = src->data.desktop.fullscreen;
+        if (VIR_STRDUP(ret->data.desktop.display,
+                       src->data.desktop.display) < 0)
+            goto error;
+        break;
+
+    case VIR_DOMAIN_GRAPHICS_TYPE_SPICE:
+        ret->data.spice = src->data.spice;
+        ret->data.spice.keymap = NULL;
+        ret->data.spice.rendernode = NULL;
+        ret->data.spice.auth.passwd = NULL;
+        ret->data.spice.portReserved = false;
+        ret->data.spice.tlsPortReserved = false;
+        if (ret->data.spice.autoport) {
+            ret->data.spice.port = 0;
+            ret->data.spice.tlsPort = 0;
+        }
+        if (VIR_STRDUP(ret->data.spice.keymap, src->data.spice.keymap) < 0 ||
+            VIR_STRDUP(ret->data.spice.rendernode,
+                       src->data.spice.rendernode) < 0 ||
+            virDomainDefCopyNativeGraphicsAuth(&ret->data.spice.auth,
+                                               &src->data.spice.auth) < 0)
+            goto error;
+        break;
+
+    case VIR_DOMAIN_GRAPHICS_TYPE_EGL_HEADLESS:
+        if (VIR_STRDUP(ret->data.egl_headless.rendernode,
+                       src->data.egl_headless.rendernode) < 0)
+            goto error;
+        break;
+
+    case VIR_DOMAIN_GRAPHICS_TYPE_LAST:
+        break;
+    }
+
+    if (src->nListens) {
+        if (VIR_ALLOC_N(ret->listens, src->nListens) < 0)
+            goto error;
+        ret->nListens = src->nListens;
+    }
+
+    for (i = 0; i < src->nListens; i++) {
+        virDomainGraphicsListenDefPtr srclisten = &src->listens[i];
+        virDomainGraphicsListenDefPtr dstlisten = &ret->listens[i];
+
+        dstlisten->type = srclisten->type;
+
+        /* the address resolved from a network is live-only */
+        if (srclisten->type == VIR_DOMAIN_GRAPHICS_LISTEN_TYPE_ADDRESS &&
+            srclisten->address && srclisten->address[0] &&
+            VIR_STRDUP(dstlisten->address, srclisten->address) < 0)
+            goto error;
+
+        if (VIR_STRDUP(dstlisten->network, srclisten->network) < 0 ||
+            VIR_STRDUP(dstlisten->socket, srclisten->socket) < 0)
+            goto error;
+    }
+
+    return ret;
+
+ error:
+    virDomainGraphicsDefFree(ret);
+    return NULL;
+}
+
+
+static virDomainInputDefPtr
+virDomainDefCopyNativeInput(virDomainInputDefPtr src,
+                            virDomainXMLOptionPtr xmlopt)
+{
+    virDomainInputDefPtr ret;
+
+    if (VIR_ALLOC(ret) < 0)
+        return NULL;
+
+    ret->type = src->type;
+    ret->bus = src->bus;
+
+    if (VIR_STRDUP(ret->source.evdev, src->source.evdev) < 0 ||
+        virDomainDefCopyNativeInfo(&ret->info, &src->info, xmlopt) < 0 ||
+        virDomainDefCopyNativeVirtio(&ret->virtio, src->virtio) < 0)
+        goto error;
+
+    return ret;
+
+ error:
+    virDomainInputDefFree(ret);
+    return NULL;
+}
+
+
+static virDomainSoundDefPtr
+virDomainDefCopyNativeSound(virDomainSoundDefPtr src,
+                            virDomainXMLOptionPtr xmlopt)
+{
+    virDomainSoundDefPtr ret;
+    size_t i;
+
+    if (VIR_ALLOC(ret) < 0)
+        return NULL;
+
+    ret->model = src->model;
+
+    if (virDomainDefCopyNativeInfo(&ret->info, &src->info, xmlopt) < 0)
+        goto error;
+
+    if (src->ncodecs) {
+        if (VIR_ALLOC_N(ret->codecs, src->ncodecs) < 0)
+            goto error;
+
+        for (i = 0; i < src->ncodecs; i++) {
+            if (VIR_ALLOC(ret->codecs[i]) < 0)
+                goto error;
+            *ret->codecs[i] = *src->codecs[i];
+            ret->ncodecs++;
+        }
+    }
+
+    return ret;
+
+ error:
+    virDomainSoundDefFree(ret);
+    return NULL;
+}
+
+
+static virDomainVideoDefPtr
+virDomainDefCopyNativeVideo(virDomainVideoDefPtr src,
+                            virDomainXMLOptionPtr xmlopt)
+{
+    virDomainVideoDefPtr ret;
+
+    if (!(ret = virDomainVideoDefNew()))
+        return NULL;
+
+    ret->type = src->type;
+    ret->ram = src->ram;
+    ret->vram = src->vram;
+    ret->vram64 = src->vram64;
+    ret->vgamem = src->vgamem;
+    ret->heads = src->heads;
+    ret->primary = src->primary;
+
+    if (src->accel) {
+        if (VIR_ALLOC(ret->accel) < 0)
+            goto error;
+        *ret->accel = *src->accel;
+    }
+
+    if (src->driver) {
+        if (VIR_ALLOC(ret->driver) < 0)
+            goto error;
+        *ret->driver = *src->driver;
+    }
+
+    if (virDomainDefCopyNativeInfo(&ret->info, &src->info, xmlopt) < 0 ||
+        virDomainDefCopyNativeVirtio(&ret->virtio, src->virtio) < 0)
+        goto error;
+
+    return ret;
+
+ error:
+    virDomainVideoDefFree(ret);
+    return NULL;
+}
+
+
+static virDomainHostdevDefPtr
+virDomainDefCopyNativeHostdev(virDomainHostdevDefPtr src,
+                              virDomainXMLOptionPtr xmlopt)
+{
+    virDomainHostdevDefPtr ret;
+
+    if (!(ret = virDomainHostdevDefNew()))
+        return NULL;
+
+    ret->mode = src->mode;
+    ret->startupPolicy = src->startupPolicy;
+    ret->managed = src->managed;
+    ret->readonly = src->readonly;
+    ret->shareable = src->shareable;
+    ret->source.subsys = src->source.subsys;
+
+    /* neither of these survive formatting without extra flags */
+    if (ret->source.subsys.type == VIR_DOMAIN_HOSTDEV_SUBSYS_TYPE_USB)
+        ret->source.subsys.u.usb.autoAddress = false;
+
+    if (virDomainDefCopyNativeInfo(ret->info, src->info, xmlopt) < 0)
+        goto error;
+
+    return ret;
+
+ error:
+    virDomainHostdevDefFree(ret);
+    return NULL;
+}
+
+
+static virDomainRNGDefPtr
+virDomainDefCopyNativeRNG(virDomainRNGDefPtr src,
+                          virDomainXMLOptionPtr xmlopt)
+{
+    virDomainRNGDefPtr ret;
+
+    if (VIR_ALLOC(ret) < 0)
+        return NULL;
+
+    ret->model = src->model;
+    ret->backend = src->backend;
+    ret->rate = src->rate;
+    ret->period = src->period;
+
+    switch ((virDomainRNGBackend) src->backend) {
+    case VIR_DOMAIN_RNG_BACKEND_RANDOM:
+        if (VIR_STRDUP(ret->source.file, src->source.file) < 0)
+            goto error;
+        break;
+
+    case VIR_DOMAIN_RNG_BACKEND_EGD:
+        if (!(ret->source.chardev =
+              virDomainDefCopyNativeChrSource(src->source.chardev, xmlopt)))
+            goto error;
+        break;
+
+    case VIR_DOMAIN_RNG_BACKEND_LAST:
+        break;
+    }
+
+    if (virDomainDefCopyNativeInfo(&ret->info, &src->info, xmlopt) < 0 ||
+        virDomainDefCopyNativeVirtio(&ret->virtio, src->virtio) < 0)
+        goto error;
+
+    return ret;
+
+ error:
+    virDomainRNGDefFree(ret);
+    return NULL;
+}
+
+
+static int
+virDomainDefCopyNativeSeclabels(virDomainDefPtr dst,
+                                virDomainDefPtr src)
+{
+    size_t i;
+
+    if (src->nseclabels &&
+        VIR_ALLOC_N(dst->seclabels, src->nseclabels) < 0)
+        return -1;
+
+    for (i = 0; i < src->nseclabels; i++) {
+        virSecurityLabelDefPtr srclabel = src->seclabels[i];
+        virSecurityLabelDefPtr seclabel;
+
+        /* not formatted at all */
+        if (srclabel->type == VIR_DOMAIN_SECLABEL_DEFAULT)
+            continue;
+
+        if (!(seclabel = virSecurityLabelDefNew(srclabel->model)))
+            return -1;
+        dst->seclabels[dst->nseclabels++] = seclabel;
+
+        seclabel->type = srclabel->type;
+        seclabel->relabel = srclabel->relabel;
+
+        if (STREQ(srclabel->model, "none") ||
+            srclabel->type == VIR_DOMAIN_SECLABEL_NONE) {
+            if (STREQ(srclabel->model, "none"))
+                seclabel->type = VIR_DOMAIN_SECLABEL_NONE;
+            seclabel->relabel = false;
+            continue;
+        }
+
+        /* imagelabel and dynamic labels are live-only */
+        if (srclabel->type == VIR_DOMAIN_SECLABEL_STATIC &&
+            VIR_STRDUP(seclabel->label, srclabel->label) < 0)
+            return -1;
+
+        if (srclabel->type == VIR_DOMAIN_SECLABEL_DYNAMIC &&
+            VIR_STRDUP(seclabel->baselabel, srclabel->baselabel) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+virDomainDefCopyNativeOS(virDomainOSDefPtr dst,
+                         virDomainOSDefPtr src)
+{
+    size_t i;
+
+    dst->type = src->type;
+    dst->arch = src->arch;
+    dst->nBootDevs = src->nBootDevs;
+    memcpy(dst->bootDevs, src->bootDevs, sizeof(src->bootDevs));
+    dst->bootmenu = src->bootmenu;
+    dst->bm_timeout = src->bm_timeout;
+    dst->bm_timeout_set = src->bm_timeout_set;
+    dst->smbios_mode = src->smbios_mode;
+    dst->bios = src->bios;
+
+    if (VIR_STRDUP(dst->machine, src->machine) < 0 ||
+        VIR_STRDUP(dst->init, src->init) < 0 ||
+        VIR_STRDUP(dst->initdir, src->initdir) < 0 ||
+        VIR_STRDUP(dst->inituser, src->inituser) < 0 ||
+        VIR_STRDUP(dst->initgroup, src->initgroup) < 0 ||
+        VIR_STRDUP(dst->kernel, src->kernel) < 0 ||
+        VIR_STRDUP(dst->initrd, src->initrd) < 0 ||
+        VIR_STRDUP(dst->cmdline, src->cmdline) < 0 ||
+        VIR_STRDUP(dst->dtb, src->dtb) < 0 ||
+        VIR_STRDUP(dst->root, src->root) < 0 ||
+        VIR_STRDUP(dst->slic_table, src->slic_table) < 0 ||
+        VIR_STRDUP(dst->bootloader, src->bootloader) < 0 ||
+        VIR_STRDUP(dst->bootloaderArgs, src->bootloaderArgs) < 0)
+        return -1;
+
+    if (src->initargv &&
+        virStringListCopy(&dst->initargv, (const char **)src->initargv) < 0)
+        return -1;
+
+    if (src->initenv) {
+        size_t n = 0;
+
+        while (src->initenv[n])
+            n++;
+
+        if (VIR_ALLOC_N(dst->initenv, n + 1) < 0)
+            return -1;
+
+        for (i = 0; i < n; i++) {
+            if (VIR_ALLOC(dst->initenv[i]) < 0 ||
+                VIR_STRDUP(dst->initenv[i]->name, src->initenv[i]->name) < 0 ||
+                VIR_STRDUP(dst->initenv[i]->value, src->initenv[i]->value) < 0)
+                return -1;
+        }
+    }
+
+    if (src->loader) {
+        if (VIR_ALLOC(dst->loader) < 0)
+            return -1;
+
+        dst->loader->readonly = src->loader->readonly;
+        dst->loader->type = src->loader->type;
+        dst->loader->secure = src->loader->secure;
+
+        if (VIR_STRDUP(dst->loader->path, src->loader->path) < 0 ||
+            VIR_STRDUP(dst->loader->nvram, src->loader->nvram) < 0 ||
+            VIR_STRDUP(dst->loader->templt, src->loader->templt) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+virDomainDefCopyNativeTuning(virDomainDefPtr dst,
+                             virDomainDefPtr src,
+                             virDomainXMLOptionPtr xmlopt)
+{
+    size_t i;
+
+    dst->blkio.weight = src->blkio.weight;
+    if (src->blkio.ndevices) {
+        if (VIR_ALLOC_N(dst->blkio.devices, src->blkio.ndevices) < 0)
+            return -1;
+
+        for (i = 0; i < src->blkio.ndevices; i++) {
+            dst->blkio.devices[i] = src->blkio.devices[i];
+            dst->blkio.devices[i].path = NULL;
+            dst->blkio.ndevices++;
+            if (VIR_STRDUP(dst->blkio.devices[i].path,
+                           src->blkio.devices[i].path) < 0)
+                return -1;
+        }
+    }
+
+    dst->mem = src->mem;
+    dst->mem.hugepages = NULL;
+    dst->mem.nhugepages = 0;
+    if (src->mem.nhugepages) {
+        if (VIR_ALLOC_N(dst->mem.hugepages, src->mem.nhugepages) < 0)
+            return -1;
+
+        for (i = 0; i < src->mem.nhugepages; i++) {
+            dst->mem.hugepages[i].size = src->mem.hugepages[i].size;
+            dst->mem.nhugepages++;
+            if (src->mem.hugepages[i].nodemask &&
+                !(dst->mem.hugepages[i].nodemask =
+                  virBitmapNewCopy(src->mem.hugepages[i].nodemask)))
+                return -1;
+        }
+    }
+
+    if (virDomainDefSetVcpusMax(dst, src->maxvcpus, xmlopt) < 0)
+        return -1;
+
+    for (i = 0; i < src->maxvcpus; i++) {
+        virDomainVcpuDefPtr srcvcpu = src->vcpus[i];
+        virDomainVcpuDefPtr dstvcpu = dst->vcpus[i];
+
+        dstvcpu->online = srcvcpu->online;
+        dstvcpu->hotpluggable = srcvcpu->hotpluggable;
+        dstvcpu->order = srcvcpu->order;
+        dstvcpu->sched = srcvcpu->sched;
+
+        if (srcvcpu->cpumask &&
+            !(dstvcpu->cpumask = virBitmapNewCopy(srcvcpu->cpumask)))
+            return -1;
+    }
+
+    dst->individualvcpus = src->individualvcpus;
+    dst->placement_mode = src->placement_mode;
+    if (src->cpumask &&
+        !(dst->cpumask = virBitmapNewCopy(src->cpumask)))
+        return -1;
+
+    if (src->niothreadids) {
+        if (VIR_ALLOC_N(dst->iothreadids, src->niothreadids) < 0)
+            return -1;
+
+        for (i = 0; i < src->niothreadids; i++) {
+            virDomainIOThreadIDDefPtr iothrid;
+
+            if (VIR_ALLOC(iothrid) < 0)
+                return -1;
+            dst->iothreadids[dst->niothreadids++] = iothrid;
+
+            iothrid->autofill = src->iothreadids[i]->autofill;
+            iothrid->iothread_id = src->iothreadids[i]->iothread_id;
+            iothrid->sched = src->iothreadids[i]->sched;
+
+            if (src->iothreadids[i]->cpumask &&
+                !(iothrid->cpumask =
+                  virBitmapNewCopy(src->iothreadids[i]->cpumask)))
+                return -1;
+        }
+    }
+
+    dst->cputune = src->cputune;
+    dst->cputune.emulatorpin = NULL;
+    if (src->cputune.emulatorpin &&
+        !(dst->cputune.emulatorpin = virBitmapNewCopy(src->cputune.emulatorpin)))
+        return -1;
+
+    virDomainNumaFree(dst->numa);
+    if (!(dst->numa = virDomainNumaCopy(src->numa)))
+        return -1;
+
+    if (src->resource) {
+        if (VIR_ALLOC(dst->resource) < 0 ||
+            VIR_STRDUP(dst->resource->partition,
+                       src->resource->partition) < 0)
+            return -1;
+    }
+
+    if (src->idmap.nuidmap) {
+        if (VIR_ALLOC_N(dst->idmap.uidmap, src->idmap.nuidmap) < 0)
+            return -1;
+        memcpy(dst->idmap.uidmap, src->idmap.uidmap,
+               sizeof(*src->idmap.uidmap) * src->idmap.nuidmap);
+        dst->idmap.nuidmap = src->idmap.nuidmap;
+    }
+
+    if (src->idmap.ngidmap) {
+        if (VIR_ALLOC_N(dst->idmap.gidmap, src->idmap.ngidmap) < 0)
+            return -1;
+        memcpy(dst->idmap.gidmap, src->idmap.gidmap,
+               sizeof(*src->idmap.gidmap) * src->idmap.ngidmap);
+        dst->idmap.ngidmap = src->idmap.ngidmap;
+    }
+
+    return 0;
+}
+
+
+static int
+virDomainDefCopyNativeClock(virDomainClockDefPtr dst,
+                            virDomainClockDefPtr src)
+{
+    size_t i;
+
+    dst->offset = src->offset;
+
+    if (src->offset == VIR_DOMAIN_CLOCK_OFFSET_TIMEZONE) {
+        if (VIR_STRDUP(dst->data.timezone, src->data.timezone) < 0)
+            return -1;
+    } else {
+        dst->data = src->data;
+        /* only formatted with VIR_DOMAIN_DEF_FORMAT_CLOCK_ADJUST */
+        if (src->offset == VIR_DOMAIN_CLOCK_OFFSET_VARIABLE)
+            dst->data.variable.adjustment0 = 0;
+    }
+
+    if (src->ntimers) {
+        if (VIR_ALLOC_N(dst->timers, src->ntimers) < 0)
+            return -1;
+
+        for (i = 0; i < src->ntimers; i++) {
+            if (VIR_ALLOC(dst->timers[i]) < 0)
+                return -1;
+            *dst->timers[i] = *src->timers[i];
+            dst->ntimers++;
+        }
+    }
+
+    return 0;
+}
+
+
+#define COPY_DEVICES(name, nname, func, ...) \
+    do { \
+        if (src->nname) { \
+            if (VIR_ALLOC_N(ret->name, src->nname) < 0) \
+                goto error; \
+            for (i = 0; i < src->nname; i++) { \
+                if (!(ret->name[i] = func(src->name[i], __VA_ARGS__))) \
+                    goto error; \
+                ret->nname++; \
+            } \
+        } \
+    } while (0)
+
+#define COPY_SIMPLE_DEVICES(name, nname) \
+    do { \
+        if (src->nname) { \
+            if (VIR_ALLOC_N(ret->name, src->nname) < 0) \
+                goto error; \
+            for (i = 0; i < src->nname; i++) { \
+                if (VIR_ALLOC(ret->name[i]) < 0) \
+                    goto error; \
+                ret->nname++; \
+                *ret->name[i] = *src->name[i]; \
+                memset(&ret->name[i]->info, 0, sizeof(ret->name[i]->info)); \
+                if (virDomainDefCopyNativeInfo(&ret->name[i]->info, \
+                                               &src->name[i]->info, \
+                                               xmlopt) < 0) \
+                    goto error; \
+            } \
+        } \
+    } while (0)
+
+/**
+ * virDomainDefCopyNative:
+ * @src: definition to copy
+ * @caps: driver capabilities
+ * @xmlopt: XML parser configuration
+ * @copy: filled with the copy
+ *
+ * Deep copies @src without formatting it to XML. The result is what
+ * formatting @src with VIR_DOMAIN_DEF_FORMAT_SECURE and parsing it
+ * back with VIR_DOMAIN_DEF_PARSE_INACTIVE would yield, i.e. live-only
+ * state such as generated aliases, dynamic security labels or
+ * allocated ports is dropped.
+ *
+ * Returns 1 if @src was copied, 0 if @src contains configuration
+ * which can only be copied through XML or @xmlopt has post parse
+ * callbacks (@copy is left NULL) and -1 on error.
+ */
+int
+virDomainDefCopyNative(virDomainDefPtr src,
+                       virCapsPtr caps,
+                       virDomainXMLOptionPtr xmlopt,
+                       virDomainDefPtr *copy)
+{
+    virDomainDefPtr ret = NULL;
+    size_t i;
+
+    *copy = NULL;
+
+    if (!virDomainDefCopyNativeSupported(src, xmlopt))
+        return 0;
+
+    if (!(ret = virDomainDefNew()))
+        return -1;
+
+    ret->virtType = src->virtType;
+    ret->id = -1;
+    memcpy(ret->uuid, src->uuid, VIR_UUID_BUFLEN);
+    memcpy(ret->genid, src->genid, VIR_UUID_BUFLEN);
+    ret->genidRequested = src->genidRequested;
+
+    if (VIR_STRDUP(ret->name, src->name) < 0 ||
+        VIR_STRDUP(ret->title, src->title) < 0 ||
+        VIR_STRDUP(ret->description, src->description) < 0 ||
+        VIR_STRDUP(ret->emulator, src->emulator) < 0 ||
+        VIR_STRDUP(ret->hyperv_vendor_id, src->hyperv_vendor_id) < 0)
+        goto error;
+
+    if (virDomainDefCopyNativeTuning(ret, src, xmlopt) < 0)
+        goto error;
+
+    ret->onReboot = src->onReboot;
+    ret->onPoweroff = src->onPoweroff;
+    ret->onCrash = src->onCrash;
+    ret->onLockFailure = src->onLockFailure;
+    ret->pm = src->pm;
+    ret->perf = src->perf;
+
+    if (virDomainDefCopyNativeOS(&ret->os, &src->os) < 0)
+        goto error;
+
+    memcpy(ret->features, src->features, sizeof(src->features));
+    memcpy(ret->caps_features, src->caps_features, sizeof(src->caps_features));
+    memcpy(ret->hyperv_features, src->hyperv_features,
+           sizeof(src->hyperv_features));
+    memcpy(ret->kvm_features, src->kvm_features, sizeof(src->kvm_features));
+    ret->hyperv_spinlocks = src->hyperv_spinlocks;
+    ret->gic_version = src->gic_version;
+    ret->hpt_resizing = src->hpt_resizing;
+    ret->hpt_maxpagesize = src->hpt_maxpagesize;
+    ret->apic_eoi = src->apic_eoi;
+    ret->tseg_specified = src->tseg_specified;
+    ret->tseg_size = src->tseg_size;
+
+    if (virDomainDefCopyNativeClock(&ret->clock, &src->clock) < 0)
+        goto error;
+
+    COPY_DEVICES(graphics, ngraphics, virDomainDefCopyNativeGraphics, xmlopt);
+    COPY_DEVICES(disks, ndisks, virDomainDefCopyNativeDisk, xmlopt);
+    COPY_DEVICES(controllers, ncontrollers,
+                 virDomainDefCopyNativeController, xmlopt);
+    COPY_DEVICES(nets, nnets, virDomainDefCopyNativeNet, caps, xmlopt);
+    COPY_DEVICES(inputs, ninputs, virDomainDefCopyNativeInput, xmlopt);
+    COPY_DEVICES(sounds, nsounds, virDomainDefCopyNativeSound, xmlopt);
+    COPY_DEVICES(videos, nvideos, virDomainDefCopyNativeVideo, xmlopt);
+    COPY_DEVICES(hostdevs, nhostdevs, virDomainDefCopyNativeHostdev, xmlopt);
+    COPY_DEVICES(rngs, nrngs, virDomainDefCopyNativeRNG, xmlopt);
+    COPY_SIMPLE_DEVICES(hubs, nhubs);
+    COPY_SIMPLE_DEVICES(panics, npanics);
+
+    if (virDomainDefCopyNativeChrs(&ret->serials, &ret->nserials,
+                                   src->serials, src->nserials, xmlopt) < 0 ||
+        virDomainDefCopyNativeChrs(&ret->parallels, &ret->nparallels,
+                                   src->parallels, src->nparallels, xmlopt) < 0 ||
+        virDomainDefCopyNativeChrs(&ret->channels, &ret->nchannels,
+                                   src->channels, src->nchannels, xmlopt) < 0 ||
+        virDomainDefCopyNativeChrs(&ret->consoles, &ret->nconsoles,
+                                   src->consoles, src->nconsoles, xmlopt) < 0)
+        goto error;
+
+    if (src->watchdog) {
+        if (VIR_ALLOC(ret->watchdog) < 0)
+            goto error;
+        ret->watchdog->model = src->watchdog->model;
+        ret->watchdog->action = src->watchdog->action;
+        if (virDomainDefCopyNativeInfo(&ret->watchdog->info,
+                                       &src->watchdog->info, xmlopt) < 0)
+            goto error;
+    }
+
+    if (src->memballoon) {
+        if (VIR_ALLOC(ret->memballoon) < 0)
+            goto error;
+        ret->memballoon->model = src->memballoon->model;
+        ret->memballoon->period = src->memballoon->period;
+        ret->memballoon->autodeflate = src->memballoon->autodeflate;
+        if (virDomainDefCopyNativeInfo(&ret->memballoon->info,
+                                       &src->memballoon->info, xmlopt) < 0 ||
+            virDomainDefCopyNativeVirtio(&ret->memballoon->virtio,
+                                         src->memballoon->virtio) < 0)
+            goto error;
+    }
+
+    if (src->iommu) {
+        if (VIR_ALLOC(ret->iommu) < 0)
+            goto error;
+        *ret->iommu = *src->iommu;
+    }
+
+    if (src->vsock) {
+        if (!(ret->vsock = virDomainVsockDefNew(xmlopt)))
+            goto error;
+        ret->vsock->model = src->vsock->model;
+        ret->vsock->guest_cid = src->vsock->guest_cid;
+        ret->vsock->auto_cid = src->vsock->auto_cid;
+        if (virDomainDefCopyNativeInfo(&ret->vsock->info,
+                                       &src->vsock->info, xmlopt) < 0)
+            goto error;
+    }
+
+    if (src->cpu && !(ret->cpu = virCPUDefCopy(src->cpu)))
+        goto error;
+
+    if (virDomainDefCopyNativeSeclabels(ret, src) < 0)
+        goto error;
+
+    if (src->keywrap) {
+        if (VIR_ALLOC(ret->keywrap) < 0)
+            goto error;
+        *ret->keywrap = *src->keywrap;
+    }
+
+    if (src->sev) {
+        if (VIR_ALLOC(ret->sev) < 0)
+            goto error;
+        *ret->sev = *src->sev;
+        ret->sev->dh_cert = NULL;
+        ret->sev->session = NULL;
+        if (VIR_STRDUP(ret->sev->dh_cert, src->sev->dh_cert) < 0 ||
+            VIR_STRDUP(ret->sev->session, src->sev->session) < 0)
+            goto error;
+    }
+
+    if (src->metadata &&
+        !(ret->metadata = xmlCopyNode(src->metadata, 1))) {
+        virReportOOMError();
+        goto error;
+    }
+
+    if (xmlopt)
+        ret->ns = xmlopt->ns;
+
+    VIR_STEAL_PTR(*copy, ret);
+    return 1;
+
+ error:
+    virDomainDefFree(ret);
+    return -1;
+}
+
+#undef COPY_DEVICES
+#undef COPY_SIMPLE_DEVICES
+
+
+
+/* Copy src into a new definition; with the quality of the copy
+ * depending on the migratable flag (false for transitions between
+ * persistent and active, true for transitions across save files or
+ * snapshots).  */
+virDomainDefPtr
+virDomainDefCopy(virDomainDefPtr src,
+                 virCapsPtr caps,
+                 virDomainXMLOptionPtr xmlopt,
+                 void *parseOpaque,
+                 bool migratable)
+{
+    char *xml;
+    virDomainDefPtr ret;
+    unsigned int format_flags = VIR_DOMAIN_DEF_FORMAT_SECURE;
+    unsigned int parse_flags = VIR_DOMAIN_DEF_PARSE_INACTIVE |
+                               VIR_DOMAIN_DEF_PARSE_SKIP_VALIDATE;
+    int rc;
+
+    if (migratable) {
+        format_flags |= VIR_DOMAIN_DEF_FORMAT_INACTIVE | VIR_DOMAIN_DEF_FORMAT_MIGRATABLE;
+    } else if (!parseOpaque) {
+        /* @parseOpaque is only meaningful to the post parse callbacks
+         * run by the XML round trip */
+        if ((rc = virDomainDefCopyNative(src, caps, xmlopt, &ret)) < 0)
+            return NULL;
+        if (rc > 0)
+            return ret;
+    }
 
-    /* Easiest to clone via a round-trip through XML.  */
+    /* Fall back to a round-trip through XML.  */
     if (!(xml = virDomainDefFormat(src, caps, format_flags)))
         return NULL;
 
@@ -2987,6 +2987,11 @@ virDomainDefPtr virDomainDefCopy(virDomainDefPtr src,
                                  virDomainXMLOptionPtr xmlopt,
                                  void *parseOpaque,
                                  bool migratable);
+int virDomainDefCopyNative(virDomainDefPtr src,
+                           virCapsPtr caps,
+                           virDomainXMLOptionPtr xmlopt,
+                           virDomainDefPtr *copy)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(4);
 virDomainDefPtr virDomainObjCopyPersistentDef(virDomainObjPtr dom,
                                               virCapsPtr caps,
                                               virDomainXMLOptionPtr xmlopt);
@@ -3050,6 +3055,9 @@ typedef enum {
     /* Set when domain lock must be released and there exists the possibility
      * that some external action could alter the value, such as cur_balloon. */
     VIR_DOMAIN_DEF_ABI_CHECK_SKIP_VOLATILE = 1 << 0,
+    /* Set when the target is meant to be a distinct domain running from the
+     * same guest state, so its name and UUID are allowed to differ. */
+    VIR_DOMAIN_DEF_ABI_CHECK_SKIP_IDENTITY = 1 << 1,
 } virDomainDefABICheckFlags;
 
 virDomainDeviceDefPtr virDomainDeviceDefParse(const char *xmlStr,
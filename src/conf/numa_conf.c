@@ -1086,6 +1086,74 @@ virDomainNumaNew(void)
 }
 
 
+/**
+ * virDomainNumaCopy:
+ * @src: NUMA definition to copy
+ *
+ * Creates a deep copy of @src. The memory nodeset is copied only for
+ * static placement as that is the only case it is part of the
+ * configuration.
+ *
+ * Returns the copy on success, NULL on error.
+ */
+virDomainNumaPtr
+virDomainNumaCopy(virDomainNumaPtr src)
+{
+    virDomainNumaPtr ret = NULL;
+    size_t i;
+
+    if (!(ret = virDomainNumaNew()))
+        return NULL;
+
+    ret->memory.specified = src->memory.specified;
+    ret->memory.mode = src->memory.mode;
+    ret->memory.placement = src->memory.placement;
+
+    if (src->memory.nodeset &&
+        src->memory.placement == VIR_DOMAIN_NUMATUNE_PLACEMENT_STATIC &&
+        !(ret->memory.nodeset = virBitmapNewCopy(src->memory.nodeset)))
+        goto error;
+
+    if (src->nmem_nodes) {
+        if (VIR_ALLOC_N(ret->mem_nodes, src->nmem_nodes) < 0)
+            goto error;
+        ret->nmem_nodes = src->nmem_nodes;
+    }
+
+    for (i = 0; i < src->nmem_nodes; i++) {
+        virDomainNumaNodePtr srcnode = &src->mem_nodes[i];
+        virDomainNumaNodePtr dstnode = &ret->mem_nodes[i];
+
+        dstnode->mem = srcnode->mem;
+        dstnode->mode = srcnode->mode;
+        dstnode->memAccess = srcnode->memAccess;
+        dstnode->discard = srcnode->discard;
+
+        if (srcnode->cpumask &&
+            !(dstnode->cpumask = virBitmapNewCopy(srcnode->cpumask)))
+            goto error;
+
+        if (srcnode->nodeset &&
+            !(dstnode->nodeset = virBitmapNewCopy(srcnode->nodeset)))
+            goto error;
+
+        if (srcnode->ndistances) {
+            if (VIR_ALLOC_N(dstnode->distances, srcnode->ndistances) < 0)
+                goto error;
+            memcpy(dstnode->distances, srcnode->distances,
+                   sizeof(*srcnode->distances) * srcnode->ndistances);
+            dstnode->ndistances = srcnode->ndistances;
+        }
+    }
+
+    return ret;
+
+ error:
+    virDomainNumaFree(ret);
+    return NULL;
+}
+
+
 bool
 virDomainNumaCheckABIStability(virDomainNumaPtr src,
                                virDomainNumaPtr tgt)
@@ -54,6 +54,7 @@ VIR_ENUM_DECL(virDomainMemoryAccess)
 
 
 virDomainNumaPtr virDomainNumaNew(void);
+virDomainNumaPtr virDomainNumaCopy(virDomainNumaPtr src);
 void virDomainNumaFree(virDomainNumaPtr numa);
 
 /*
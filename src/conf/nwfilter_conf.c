@@ -3056,6 +3056,8 @@ virNWFilterDefFormat(const virNWFilterDef *def)
     char uuid[VIR_UUID_STRING_BUFLEN];
     size_t i;
 
+    virBufferReserve(&buf, 256 + 192 * def->nentries);
+
     virBufferAsprintf(&buf, "<filter name='%s' chain='%s'",
                       def->name,
                       def->chainsuffix);
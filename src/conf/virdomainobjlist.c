@@ -27,9 +27,16 @@
 #include "virdomainobjlist.h"
 #include "snapshot_conf.h"
 #include "viralloc.h"
+#include "viratomic.h"
 #include "virfile.h"
 #include "virlog.h"
 #include "virstring.h"
+#include "virhostcpu.h"
+#include "virrcu.h"
+#include "virthreadpool.h"
+#include "virtime.h"
+#include "stat-time.h"
+#include "intprops.h"
 
 #define VIR_FROM_THIS VIR_FROM_DOMAIN
 
@@ -39,6 +46,36 @@ static virClassPtr virDomainObjListClass;
 static void virDomainObjListDispose(void *obj);
 
 
+/* Read-only copy of the lookup tables, each holding a reference on
+ * the domain objects. It is dropped whenever the tables change, built
+ * again by the next lookup and freed once no lockless reader can see
+ * it anymore. */
+typedef struct _virDomainObjListSnapshot virDomainObjListSnapshot;
+typedef virDomainObjListSnapshot *virDomainObjListSnapshotPtr;
+struct _virDomainObjListSnapshot {
+    virHashTablePtr objs;
+    virHashTablePtr objsName;
+    virHashTablePtr objsID;
+
+    virDomainObjListSnapshotPtr next;   /* in the retired list */
+};
+
+/* Identifies the contents of a config or status file without reading it */
+typedef struct _virDomainObjListLoadStamp virDomainObjListLoadStamp;
+typedef virDomainObjListLoadStamp *virDomainObjListLoadStampPtr;
+struct _virDomainObjListLoadStamp {
+    char *name;     /* domain name */
+
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+
+    /* a config parsed by a different parser may differ, see
+     * @loadGeneration of the list */
+    unsigned long long generation;
+};
+
 struct _virDomainObjList {
     virObjectRWLockable parent;
 
@@ -49,9 +86,61 @@ struct _virDomainObjList {
     /* name -> virDomainObj mapping for O(1),
      * lockless lookup-by-name */
     virHashTable *objsName;
+
+    /* copy of @objs, @objsName and @objsID published for lookups which
+     * don't take the list lock at all, see virDomainObjListPublish */
+    virDomainObjListSnapshotPtr snapshot;
+    virMutex publishLock;
+
+    /* replaced snapshots waiting to be freed by virDomainObjListReclaim,
+     * protected by @publishLock */
+    virDomainObjListSnapshotPtr retired;
+
+    /* domain ID -> virDomainObj cache for lookup-by-ID, changed under
+     * @idLock. Drivers change IDs without telling the list, so entries
+     * are verified on use and filled in on a miss. */
+    virHashTable *objsID;
+    virMutex idLock;
+
+    /* file path -> virDomainObjListLoadStamp of the config or status
+     * file each domain was last loaded from, used to skip parsing
+     * unchanged files when they are loaded again */
+    virHashTable *loadStamps;
+
+    /* Parser the files were last loaded with. The references keep the
+     * pointers from being reused by a different parser, and
+     * @loadGeneration is bumped whenever either of them changes. */
+    virCapsPtr loadCaps;
+    virDomainXMLOptionPtr loadXMLOpt;
+    unsigned long long loadGeneration;
 };
 
 
+static void
+virDomainObjListLoadStampFree(void *payload,
+                              const void *name ATTRIBUTE_UNUSED)
+{
+    virDomainObjListLoadStampPtr stamp = payload;
+
+    if (!stamp)
+        return;
+
+    VIR_FREE(stamp->name);
+    VIR_FREE(stamp);
+}
+
+
+static int
+virDomainObjListLoadStampMatchName(const void *payload,
+                                   const void *name ATTRIBUTE_UNUSED,
+                                   const void *opaque)
+{
+    const virDomainObjListLoadStamp *stamp = payload;
+
+    return STREQ(stamp->name, opaque);
+}
+
+
 static int virDomainObjListOnceInit(void)
 {
     if (!VIR_CLASS_NEW(virDomainObjList, virClassForObjectRWLockable()))
@@ -72,8 +161,18 @@ virDomainObjListPtr virDomainObjListNew(void)
     if (!(doms = virObjectRWLockableNew(virDomainObjListClass)))
         return NULL;
 
+    if (virMutexInit(&doms->publishLock) < 0 ||
+        virMutexInit(&doms->idLock) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("cannot initialize mutex"));
+        virObjectUnref(doms);
+        return NULL;
+    }
+
     if (!(doms->objs = virHashCreate(50, virObjectFreeHashData)) ||
-        !(doms->objsName = virHashCreate(50, virObjectFreeHashData))) {
+        !(doms->objsName = virHashCreate(50, virObjectFreeHashData)) ||
+        !(doms->objsID = virHashCreate(50, virObjectFreeHashData)) ||
+        !(doms->loadStamps = virHashCreate(50, virDomainObjListLoadStampFree))) {
         virObjectUnref(doms);
         return NULL;
     }
@@ -82,12 +181,245 @@ virDomainObjListPtr virDomainObjListNew(void)
 }
 
 
+static void
+virDomainObjListSnapshotFree(virDomainObjListSnapshotPtr snapshot)
+{
+    if (!snapshot)
+        return;
+
+    virHashFree(snapshot->objs);
+    virHashFree(snapshot->objsName);
+    virHashFree(snapshot->objsID);
+    VIR_FREE(snapshot);
+}
+
+
 static void virDomainObjListDispose(void *obj)
 {
     virDomainObjListPtr doms = obj;
 
+    /* nobody can look anything up in a list without a reference */
+    while (doms->retired) {
+        virDomainObjListSnapshotPtr next = doms->retired->next;
+
+        virDomainObjListSnapshotFree(doms->retired);
+        doms->retired = next;
+    }
+    virDomainObjListSnapshotFree(doms->snapshot);
     virHashFree(doms->objs);
     virHashFree(doms->objsName);
+    virHashFree(doms->objsID);
+    virHashFree(doms->loadStamps);
+    virObjectUnref(doms->loadCaps);
+    virObjectUnref(doms->loadXMLOpt);
+    virMutexDestroy(&doms->publishLock);
+    virMutexDestroy(&doms->idLock);
+}
+
+
+static int
+virDomainObjListSnapshotCopy(void *payload,
+                             const void *name,
+                             void *opaque)
+{
+    virHashTablePtr table = opaque;
+
+    if (virHashAddEntry(table, name, payload) < 0)
+        return -1;
+    virObjectRef(payload);
+
+    return 0;
+}
+
+
+static virHashTablePtr
+virDomainObjListSnapshotTable(virHashTablePtr table)
+{
+    virHashTablePtr copy;
+
+    if (!(copy = virHashCreate(virHashSize(table), virObjectFreeHashData)))
+        return NULL;
+
+    if (virHashForEach(table, virDomainObjListSnapshotCopy, copy) < 0) {
+        virHashFree(copy);
+        return NULL;
+    }
+
+    return copy;
+}
+
+
+/**
+ * virDomainObjListPublish:
+ * @doms: Domain object list
+ *
+ * Publishes a copy of the current tables for lockless lookups unless
+ * there is one already. The caller must hold the list lock, at least
+ * for reading. Lookups call this when they find no snapshot, so that a
+ * batch of changes, such as loading all configs, costs a single copy
+ * rather than one for every domain added.
+ */
+static void
+virDomainObjListPublish(virDomainObjListPtr doms)
+{
+    virDomainObjListSnapshotPtr snapshot = NULL;
+
+    virMutexLock(&doms->publishLock);
+
+    if (doms->snapshot)
+        goto cleanup;
+
+    virMutexLock(&doms->idLock);
+    if (VIR_ALLOC(snapshot) < 0 ||
+        !(snapshot->objs = virDomainObjListSnapshotTable(doms->objs)) ||
+        !(snapshot->objsName = virDomainObjListSnapshotTable(doms->objsName)) ||
+        !(snapshot->objsID = virDomainObjListSnapshotTable(doms->objsID))) {
+        /* The next lookup will try again */
+        VIR_WARN("Unable to publish domain list snapshot");
+        virResetLastError();
+        virDomainObjListSnapshotFree(snapshot);
+        snapshot = NULL;
+    }
+    virMutexUnlock(&doms->idLock);
+
+    virAtomicPointerSet(&doms->snapshot, snapshot);
+
+ cleanup:
+    virMutexUnlock(&doms->publishLock);
+}
+
+
+/**
+ * virDomainObjListUnpublish:
+ * @doms: Domain object list
+ *
+ * Sends lookups back to the locked tables until the next one publishes
+ * them again. Must be called after every change of @doms->objs,
+ * @doms->objsName or @doms->objsID. The dropped snapshot is retired
+ * rather than freed, as lockless readers may still use it; the caller
+ * should call virDomainObjListReclaim once it has unlocked the list.
+ */
+static void
+virDomainObjListUnpublish(virDomainObjListPtr doms)
+{
+    virDomainObjListSnapshotPtr old;
+
+    virMutexLock(&doms->publishLock);
+
+    if ((old = doms->snapshot)) {
+        old->next = doms->retired;
+        doms->retired = old;
+        virAtomicPointerSet(&doms->snapshot, NULL);
+    }
+
+    virMutexUnlock(&doms->publishLock);
+}
+
+
+/**
+ * virDomainObjListReclaim:
+ * @doms: Domain object list
+ *
+ * Frees the snapshots retired by virDomainObjListUnpublish once no
+ * lockless lookup can see them anymore. Waiting for the readers may
+ * take a while, so this must be called without the list lock held.
+ */
+static void
+virDomainObjListReclaim(virDomainObjListPtr doms)
+{
+    virDomainObjListSnapshotPtr retired;
+
+    virMutexLock(&doms->publishLock);
+    retired = doms->retired;
+    doms->retired = NULL;
+    virMutexUnlock(&doms->publishLock);
+
+    if (!retired)
+        return;
+
+    virRCUSynchronize();
+
+    while (retired) {
+        virDomainObjListSnapshotPtr next = retired->next;
+
+        virDomainObjListSnapshotFree(retired);
+        retired = next;
+    }
+}
+
+
+typedef enum {
+    VIR_DOMAIN_OBJ_LIST_LOOKUP_UUID,
+    VIR_DOMAIN_OBJ_LIST_LOOKUP_NAME,
+    VIR_DOMAIN_OBJ_LIST_LOOKUP_ID,
+} virDomainObjListLookup;
+
+
+/**
+ * virDomainObjListLookupLockless:
+ * @doms: Domain object list
+ * @lookup: which table to look @key up in
+ * @key: the key to look up
+ * @obj: filled with the ref counted, unlocked domain object or NULL
+ *
+ * Looks @key up in the published snapshot without taking any lock
+ * which would be shared with other readers.
+ *
+ * Returns 0 on success, -1 if the caller has to use the locked
+ * tables instead.
+ */
+static int
+virDomainObjListLookupLockless(virDomainObjListPtr doms,
+                               virDomainObjListLookup lookup,
+                               const char *key,
+                               virDomainObjPtr *obj)
+{
+    virDomainObjListSnapshotPtr snapshot;
+    virHashTablePtr table = NULL;
+    int ret = -1;
+
+    if (virRCUReadLock() < 0) {
+        virResetLastError();
+        return -1;
+    }
+
+    if ((snapshot = virAtomicPointerGet(&doms->snapshot))) {
+        switch (lookup) {
+        case VIR_DOMAIN_OBJ_LIST_LOOKUP_UUID:
+            table = snapshot->objs;
+            break;
+        case VIR_DOMAIN_OBJ_LIST_LOOKUP_NAME:
+            table = snapshot->objsName;
+            break;
+        case VIR_DOMAIN_OBJ_LIST_LOOKUP_ID:
+            table = snapshot->objsID;
+            break;
+        }
+
+        *obj = virHashLookup(table, key);
+        virObjectRef(*obj);
+        ret = 0;
+    }
+
+    virRCUReadUnlock();
+    return ret;
+}
+
+
+/* Locks @obj found by a lookup unless it is being removed. */
+static virDomainObjPtr
+virDomainObjListLockFound(virDomainObjPtr obj)
+{
+    if (obj) {
+        virObjectLock(obj);
+        if (obj->removing) {
+            virObjectUnlock(obj);
+            virObjectUnref(obj);
+            obj = NULL;
+        }
+    }
+
+    return obj;
 }
 
 
@@ -108,26 +440,71 @@ static int virDomainObjListSearchID(const void *payload,
 }
 
 
+static int
+virDomainObjListMatchObj(const void *payload,
+                         const void *name ATTRIBUTE_UNUSED,
+                         const void *opaque)
+{
+    return payload == opaque;
+}
+
+
+/* The caller must hold the list lock, at least for reading */
+static void
+virDomainObjListRememberID(virDomainObjListPtr doms,
+                           virDomainObjPtr obj,
+                           const char *idstr)
+{
+    virMutexLock(&doms->idLock);
+
+    /* A domain has a single ID at a time, drop any stale one */
+    virHashRemoveSet(doms->objsID, virDomainObjListMatchObj, obj);
+
+    virObjectRef(obj);
+    if (virHashUpdateEntry(doms->objsID, idstr, obj) < 0) {
+        virObjectUnref(obj);
+        virResetLastError();
+    }
+
+    virMutexUnlock(&doms->idLock);
+
+    virDomainObjListUnpublish(doms);
+}
+
+
 virDomainObjPtr
 virDomainObjListFindByID(virDomainObjListPtr doms,
                          int id)
 {
-    virDomainObjPtr obj;
+    char idstr[INT_BUFSIZE_BOUND(id)];
+    virDomainObjPtr obj = NULL;
+
+    snprintf(idstr, sizeof(idstr), "%d", id);
 
+    if (virDomainObjListLookupLockless(doms, VIR_DOMAIN_OBJ_LIST_LOOKUP_ID,
+                                       idstr, &obj) == 0 && obj) {
+        virObjectLock(obj);
+        if (!obj->removing &&
+            virDomainObjIsActive(obj) &&
+            obj->def->id == id)
+            return obj;
+
+        virObjectUnlock(obj);
+        virObjectUnref(obj);
+    }
+
+    /* Not cached, the ID has changed meanwhile or nothing published */
     virObjectRWLockRead(doms);
     obj = virHashSearch(doms->objs, virDomainObjListSearchID, &id, NULL);
+    if (obj)
+        virDomainObjListRememberID(doms, obj, idstr);
+    /* publish the remembered ID so that the next lookup finds it */
+    virDomainObjListPublish(doms);
     virObjectRef(obj);
     virObjectRWUnlock(doms);
-    if (obj) {
-        virObjectLock(obj);
-        if (obj->removing) {
-            virObjectUnlock(obj);
-            virObjectUnref(obj);
-            obj = NULL;
-        }
-    }
+    virDomainObjListReclaim(doms);
 
-    return obj;
+    return virDomainObjListLockFound(obj);
 }
 
 
@@ -141,15 +518,8 @@ virDomainObjListFindByUUIDLocked(virDomainObjListPtr doms,
     virUUIDFormat(uuid, uuidstr);
     obj = virHashLookup(doms->objs, uuidstr);
     virObjectRef(obj);
-    if (obj) {
-        virObjectLock(obj);
-        if (obj->removing) {
-            virObjectUnlock(obj);
-            virObjectUnref(obj);
-            obj = NULL;
-        }
-    }
-    return obj;
+
+    return virDomainObjListLockFound(obj);
 }
 
 
@@ -160,18 +530,27 @@ virDomainObjListFindByUUIDLocked(virDomainObjListPtr doms,
  * Lookup the @uuid in the doms->objs hash table and return a
  * locked and ref counted domain object if found. Caller is
  * expected to use the virDomainObjEndAPI when done with the object.
+ * The list lock is not taken unless the published snapshot of the
+ * table is unavailable.
  */
 virDomainObjPtr
 virDomainObjListFindByUUID(virDomainObjListPtr doms,
                            const unsigned char *uuid)
 {
-    virDomainObjPtr obj;
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+    virDomainObjPtr obj = NULL;
 
-    virObjectRWLockRead(doms);
-    obj = virDomainObjListFindByUUIDLocked(doms, uuid);
-    virObjectRWUnlock(doms);
+    virUUIDFormat(uuid, uuidstr);
+    if (virDomainObjListLookupLockless(doms, VIR_DOMAIN_OBJ_LIST_LOOKUP_UUID,
+                                       uuidstr, &obj) < 0) {
+        virObjectRWLockRead(doms);
+        virDomainObjListPublish(doms);
+        obj = virDomainObjListFindByUUIDLocked(doms, uuid);
+        virObjectRWUnlock(doms);
+        return obj;
+    }
 
-    return obj;
+    return virDomainObjListLockFound(obj);
 }
 
 
@@ -183,15 +562,8 @@ virDomainObjListFindByNameLocked(virDomainObjListPtr doms,
 
     obj = virHashLookup(doms->objsName, name);
     virObjectRef(obj);
-    if (obj) {
-        virObjectLock(obj);
-        if (obj->removing) {
-            virObjectUnlock(obj);
-            virObjectUnref(obj);
-            obj = NULL;
-        }
-    }
-    return obj;
+
+    return virDomainObjListLockFound(obj);
 }
 
 
@@ -201,19 +573,26 @@ virDomainObjListFindByNameLocked(virDomainObjListPtr doms,
  *
  * Lookup the @name in the doms->objsName hash table and return a
  * locked and ref counted domain object if found. Caller is expected
- * to use the virDomainObjEndAPI when done with the object.
+ * to use the virDomainObjEndAPI when done with the object. The list
+ * lock is not taken unless the published snapshot of the table is
+ * unavailable.
  */
 virDomainObjPtr
 virDomainObjListFindByName(virDomainObjListPtr doms,
                            const char *name)
 {
-    virDomainObjPtr obj;
+    virDomainObjPtr obj = NULL;
 
-    virObjectRWLockRead(doms);
-    obj = virDomainObjListFindByNameLocked(doms, name);
-    virObjectRWUnlock(doms);
+    if (virDomainObjListLookupLockless(doms, VIR_DOMAIN_OBJ_LIST_LOOKUP_NAME,
+                                       name, &obj) < 0) {
+        virObjectRWLockRead(doms);
+        virDomainObjListPublish(doms);
+        obj = virDomainObjListFindByNameLocked(doms, name);
+        virObjectRWUnlock(doms);
+        return obj;
+    }
 
-    return obj;
+    return virDomainObjListLockFound(obj);
 }
 
 
@@ -250,6 +629,8 @@ virDomainObjListAddObjLocked(virDomainObjListPtr doms,
     }
     virObjectRef(vm);
 
+    virDomainObjListUnpublish(doms);
+
     return 0;
 }
 
@@ -352,6 +733,7 @@ virDomainObjPtr virDomainObjListAdd(virDomainObjListPtr doms,
     virObjectRWLockWrite(doms);
     ret = virDomainObjListAddLocked(doms, def, xmlopt, flags, oldDef);
     virObjectRWUnlock(doms);
+    virDomainObjListReclaim(doms);
     return ret;
 }
 
@@ -372,6 +754,15 @@ virDomainObjListRemoveLocked(virDomainObjListPtr doms,
 
     virHashRemoveEntry(doms->objs, uuidstr);
     virHashRemoveEntry(doms->objsName, dom->def->name);
+
+    virMutexLock(&doms->idLock);
+    virHashRemoveSet(doms->objsID, virDomainObjListMatchObj, dom);
+    virMutexUnlock(&doms->idLock);
+
+    virHashRemoveSet(doms->loadStamps, virDomainObjListLoadStampMatchName,
+                     dom->def->name);
+
+    virDomainObjListUnpublish(doms);
 }
 
 
@@ -400,6 +791,7 @@ virDomainObjListRemove(virDomainObjListPtr doms,
     virDomainObjListRemoveLocked(doms, dom);
     virObjectUnref(dom);
     virObjectRWUnlock(doms);
+    virDomainObjListReclaim(doms);
 }
 
 
@@ -464,29 +856,151 @@ virDomainObjListRename(virDomainObjListPtr doms,
     if (rc < 0)
         goto cleanup;
 
+    /* the files of @old_name are gone, don't trust their stamps */
+    virHashRemoveSet(doms->loadStamps, virDomainObjListLoadStampMatchName,
+                     old_name);
+
+    virDomainObjListUnpublish(doms);
+
     ret = 0;
  cleanup:
     virObjectRWUnlock(doms);
+    virDomainObjListReclaim(doms);
     VIR_FREE(old_name);
     return ret;
 }
 
 
-static virDomainObjPtr
-virDomainObjListLoadConfig(virDomainObjListPtr doms,
-                           virCapsPtr caps,
-                           virDomainXMLOptionPtr xmlopt,
-                           const char *configDir,
-                           const char *autostartDir,
-                           const char *name,
-                           virDomainLoadConfigNotify notify,
-                           void *opaque)
+/* Upper bound of threads parsing config files at daemon start */
+#define VIR_DOMAIN_OBJ_LIST_LOAD_WORKERS 16
+
+typedef struct _virDomainObjListLoadJob virDomainObjListLoadJob;
+typedef virDomainObjListLoadJob *virDomainObjListLoadJobPtr;
+struct _virDomainObjListLoadJob {
+    char *name;
+    char *path;
+    virDomainObjListLoadStamp stamp;
+    bool haveStamp;
+    bool unchanged;     /* matches the stamp of the loaded file */
+
+    /* filled in by the worker */
+    virDomainDefPtr def;    /* persistent config */
+    virDomainObjPtr obj;    /* live status */
+    int autostart;
+    virErrorPtr err;
+};
+
+struct virDomainObjListLoadData {
+    const char *configDir;
+    const char *autostartDir;
+    bool liveStatus;
+    virCapsPtr caps;
+    virDomainXMLOptionPtr xmlopt;
+    virDomainObjListLoadJobPtr jobs;
+};
+
+
+static void
+virDomainObjListLoadJobClear(virDomainObjListLoadJobPtr job)
+{
+    VIR_FREE(job->name);
+    VIR_FREE(job->path);
+    virDomainDefFree(job->def);
+    virObjectUnref(job->obj);
+    virFreeError(job->err);
+}
+
+
+static int
+virDomainObjListLoadStampGet(const char *path,
+                             virDomainObjListLoadStampPtr stamp)
+{
+    struct stat sb;
+
+    if (stat(path, &sb) < 0)
+        return -1;
+
+    memset(stamp, 0, sizeof(*stamp));
+    stamp->dev = sb.st_dev;
+    stamp->ino = sb.st_ino;
+    stamp->size = sb.st_size;
+    stamp->mtime = get_stat_mtime(&sb);
+
+    return 0;
+}
+
+
+static bool
+virDomainObjListLoadStampEqual(const virDomainObjListLoadStamp *a,
+                               const virDomainObjListLoadStamp *b)
+{
+    return a->dev == b->dev &&
+        a->ino == b->ino &&
+        a->size == b->size &&
+        a->mtime.tv_sec == b->mtime.tv_sec &&
+        a->mtime.tv_nsec == b->mtime.tv_nsec &&
+        a->generation == b->generation;
+}
+
+
+/* The caller must hold the write lock on @doms */
+static void
+virDomainObjListLoadStampSave(virDomainObjListPtr doms,
+                              virDomainObjListLoadJobPtr job)
+{
+    virDomainObjListLoadStampPtr stamp = NULL;
+
+    if (!job->haveStamp)
+        return;
+
+    if (VIR_ALLOC(stamp) < 0)
+        goto error;
+
+    *stamp = job->stamp;
+
+    if (VIR_STRDUP(stamp->name, job->name) < 0 ||
+        virHashUpdateEntry(doms->loadStamps, job->path, stamp) < 0)
+        goto error;
+
+    return;
+
+ error:
+    virDomainObjListLoadStampFree(stamp, NULL);
+    virResetLastError();
+}
+
+
+static int
+virDomainObjListParseAutostart(const char *configDir,
+                               const char *autostartDir,
+                               const char *name)
 {
     char *configFile = NULL, *autostartLink = NULL;
+    int ret = -1;
+
+    if ((configFile = virDomainConfigFile(configDir, name)) == NULL ||
+        (autostartLink = virDomainConfigFile(autostartDir, name)) == NULL)
+        goto cleanup;
+
+    ret = virFileLinkPointsTo(autostartLink, configFile);
+
+ cleanup:
+    VIR_FREE(configFile);
+    VIR_FREE(autostartLink);
+    return ret;
+}
+
+
+static virDomainDefPtr
+virDomainObjListParseConfig(virCapsPtr caps,
+                            virDomainXMLOptionPtr xmlopt,
+                            const char *configDir,
+                            const char *autostartDir,
+                            const char *name,
+                            int *autostart)
+{
+    char *configFile = NULL;
     virDomainDefPtr def = NULL;
-    virDomainObjPtr dom;
-    int autostart;
-    virDomainDefPtr oldDef = NULL;
 
     if ((configFile = virDomainConfigFile(configDir, name)) == NULL)
         goto error;
@@ -496,57 +1010,214 @@ virDomainObjListLoadConfig(virDomainObjListPtr doms,
                                       VIR_DOMAIN_DEF_PARSE_ALLOW_POST_PARSE_FAIL)))
         goto error;
 
-    if ((autostartLink = virDomainConfigFile(autostartDir, name)) == NULL)
+    if ((*autostart = virDomainObjListParseAutostart(configDir, autostartDir,
+                                                     name)) < 0)
         goto error;
 
-    if ((autostart = virFileLinkPointsTo(autostartLink, configFile)) < 0)
-        goto error;
+    VIR_FREE(configFile);
+    return def;
 
-    if (!(dom = virDomainObjListAddLocked(doms, def, xmlopt, 0, &oldDef)))
-        goto error;
+ error:
+    VIR_FREE(configFile);
+    virDomainDefFree(def);
+    return NULL;
+}
 
-    dom->autostart = autostart;
+
+static virDomainObjPtr
+virDomainObjListParseStatus(const char *statusDir,
+                            const char *name,
+                            virCapsPtr caps,
+                            virDomainXMLOptionPtr xmlopt)
+{
+    char *statusFile = NULL;
+    virDomainObjPtr obj = NULL;
+
+    if ((statusFile = virDomainConfigFile(statusDir, name)) == NULL)
+        return NULL;
+
+    obj = virDomainObjParseFile(statusFile, caps, xmlopt,
+                                VIR_DOMAIN_DEF_PARSE_STATUS |
+                                VIR_DOMAIN_DEF_PARSE_ACTUAL_NET |
+                                VIR_DOMAIN_DEF_PARSE_PCI_ORIG_STATES |
+                                VIR_DOMAIN_DEF_PARSE_SKIP_VALIDATE |
+                                VIR_DOMAIN_DEF_PARSE_ALLOW_POST_PARSE_FAIL);
+
+    VIR_FREE(statusFile);
+    return obj;
+}
+
+
+/* Runs in a worker thread, must not touch the domain list */
+static void
+virDomainObjListLoadWorker(size_t idx,
+                           void *opaque)
+{
+    struct virDomainObjListLoadData *data = opaque;
+    virDomainObjListLoadJobPtr job = &data->jobs[idx];
+
+    if (job->unchanged) {
+        if (data->liveStatus)
+            return;
+
+        /* the autostart link may have changed nevertheless */
+        job->autostart = virDomainObjListParseAutostart(data->configDir,
+                                                        data->autostartDir,
+                                                        job->name);
+        virResetLastError();
+        return;
+    }
+
+    VIR_INFO("Loading config file '%s.xml'", job->name);
+
+    if (data->liveStatus) {
+        job->obj = virDomainObjListParseStatus(data->configDir, job->name,
+                                               data->caps, data->xmlopt);
+        if (job->obj)
+            virObjectUnlock(job->obj);
+    } else {
+        job->def = virDomainObjListParseConfig(data->caps, data->xmlopt,
+                                               data->configDir,
+                                               data->autostartDir,
+                                               job->name, &job->autostart);
+    }
+
+    if (!job->obj && !job->def) {
+        job->err = virSaveLastError();
+        virResetLastError();
+    }
+}
+
+
+static virDomainObjPtr
+virDomainObjListLoadConfig(virDomainObjListPtr doms,
+                           virDomainXMLOptionPtr xmlopt,
+                           virDomainObjListLoadJobPtr job,
+                           virDomainLoadConfigNotify notify,
+                           void *opaque)
+{
+    virDomainObjPtr dom;
+    virDomainDefPtr oldDef = NULL;
+
+    if (!(dom = virDomainObjListAddLocked(doms, job->def, xmlopt, 0, &oldDef)))
+        return NULL;
+    job->def = NULL;
+
+    dom->autostart = job->autostart;
+
+    virDomainObjListLoadStampSave(doms, job);
 
     if (notify)
         (*notify)(dom, oldDef == NULL, opaque);
 
     virDomainDefFree(oldDef);
-    VIR_FREE(configFile);
-    VIR_FREE(autostartLink);
     return dom;
+}
 
- error:
-    VIR_FREE(configFile);
-    VIR_FREE(autostartLink);
-    virDomainDefFree(def);
-    return NULL;
+
+/* Whether @dom still holds what was loaded from its config or status */
+static bool
+virDomainObjListLoadIsCurrent(virDomainObjPtr dom,
+                              bool liveStatus)
+{
+    if (liveStatus)
+        return virDomainObjIsActive(dom);
+
+    return dom->persistent;
+}
+
+
+/* Reuses the already loaded domain of an unchanged config or status */
+static virDomainObjPtr
+virDomainObjListLoadUnchanged(virDomainObjListPtr doms,
+                              bool liveStatus,
+                              virDomainObjListLoadJobPtr job,
+                              virDomainLoadConfigNotify notify,
+                              void *opaque)
+{
+    virDomainObjPtr dom;
+
+    if (!(dom = virDomainObjListFindByNameLocked(doms, job->name)))
+        return NULL;
+
+    if (!virDomainObjListLoadIsCurrent(dom, liveStatus)) {
+        virDomainObjEndAPI(&dom);
+        return NULL;
+    }
+
+    if (!liveStatus && job->autostart >= 0)
+        dom->autostart = job->autostart;
+
+    if (notify)
+        (*notify)(dom, 0, opaque);
+
+    return dom;
+}
+
+
+/* Marks jobs whose file did not change since it was last loaded */
+static size_t
+virDomainObjListLoadCheckStamps(virDomainObjListPtr doms,
+                                struct virDomainObjListLoadData *data,
+                                size_t njobs)
+{
+    size_t nunchanged = 0;
+    size_t i;
+
+    /* Don't keep the list locked while waiting for the disk */
+    for (i = 0; i < njobs; i++) {
+        virDomainObjListLoadJobPtr job = &data->jobs[i];
+
+        if (virDomainObjListLoadStampGet(job->path, &job->stamp) == 0)
+            job->haveStamp = true;
+    }
+
+    virObjectRWLockWrite(doms);
+
+    if (data->caps != doms->loadCaps || data->xmlopt != doms->loadXMLOpt) {
+        virObjectUnref(doms->loadCaps);
+        virObjectUnref(doms->loadXMLOpt);
+        doms->loadCaps = virObjectRef(data->caps);
+        doms->loadXMLOpt = virObjectRef(data->xmlopt);
+        doms->loadGeneration++;
+    }
+
+    for (i = 0; i < njobs; i++) {
+        virDomainObjListLoadJobPtr job = &data->jobs[i];
+        virDomainObjListLoadStampPtr cached;
+        virDomainObjPtr dom;
+
+        if (!job->haveStamp)
+            continue;
+        job->stamp.generation = doms->loadGeneration;
+
+        if (!(cached = virHashLookup(doms->loadStamps, job->path)) ||
+            !virDomainObjListLoadStampEqual(cached, &job->stamp) ||
+            !(dom = virDomainObjListFindByNameLocked(doms, job->name)))
+            continue;
+
+        if (virDomainObjListLoadIsCurrent(dom, data->liveStatus)) {
+            job->unchanged = true;
+            nunchanged++;
+        }
+        virDomainObjEndAPI(&dom);
+    }
+
+    virObjectRWUnlock(doms);
+    return nunchanged;
 }
 
 
 static virDomainObjPtr
 virDomainObjListLoadStatus(virDomainObjListPtr doms,
-                           const char *statusDir,
-                           const char *name,
-                           virCapsPtr caps,
-                           virDomainXMLOptionPtr xmlopt,
+                           virDomainObjListLoadJobPtr job,
                            virDomainLoadConfigNotify notify,
                            void *opaque)
 {
-    char *statusFile = NULL;
-    virDomainObjPtr obj = NULL;
+    virDomainObjPtr obj = job->obj;
     char uuidstr[VIR_UUID_STRING_BUFLEN];
 
-    if ((statusFile = virDomainConfigFile(statusDir, name)) == NULL)
-        goto error;
-
-    if (!(obj = virDomainObjParseFile(statusFile, caps, xmlopt,
-                                      VIR_DOMAIN_DEF_PARSE_STATUS |
-                                      VIR_DOMAIN_DEF_PARSE_ACTUAL_NET |
-                                      VIR_DOMAIN_DEF_PARSE_PCI_ORIG_STATES |
-                                      VIR_DOMAIN_DEF_PARSE_SKIP_VALIDATE |
-                                      VIR_DOMAIN_DEF_PARSE_ALLOW_POST_PARSE_FAIL)))
-        goto error;
-
+    virObjectLock(obj);
     virUUIDFormat(obj->def->uuid, uuidstr);
 
     if (virHashLookup(doms->objs, uuidstr) != NULL) {
@@ -558,20 +1229,47 @@ virDomainObjListLoadStatus(virDomainObjListPtr doms,
 
     if (virDomainObjListAddObjLocked(doms, obj) < 0)
         goto error;
+    job->obj = NULL;
+
+    virDomainObjListLoadStampSave(doms, job);
 
     if (notify)
         (*notify)(obj, 1, opaque);
 
-    VIR_FREE(statusFile);
     return obj;
 
  error:
-    virDomainObjEndAPI(&obj);
-    VIR_FREE(statusFile);
+    virObjectUnlock(obj);
     return NULL;
 }
 
 
+static int
+virDomainObjListLoadJobCompare(const void *a,
+                               const void *b)
+{
+    const virDomainObjListLoadJob *ja = a;
+    const virDomainObjListLoadJob *jb = b;
+
+    return strcmp(ja->name, jb->name);
+}
+
+
+/**
+ * virDomainObjListLoadAllConfigs:
+ *
+ * Loads all domain configs (or status files if @liveStatus is true)
+ * from @configDir. The files are parsed on a bounded pool of worker
+ * threads and then added to @doms in one batch, in the order of their
+ * file names, so that errors and @notify callbacks are reported in a
+ * deterministic order. A config which fails to load is reported and
+ * skipped rather than failing the whole operation.
+ *
+ * Configs and status files whose file (device, inode, size and mtime)
+ * did not change since they were last loaded into @doms by the same
+ * @caps and @xmlopt are not parsed again, which makes reloading the
+ * driver cheap.
+ */
 int
 virDomainObjListLoadAllConfigs(virDomainObjListPtr doms,
                                const char *configDir,
@@ -584,53 +1282,112 @@ virDomainObjListLoadAllConfigs(virDomainObjListPtr doms,
 {
     DIR *dir;
     struct dirent *entry;
+    struct virDomainObjListLoadData data = {
+        .configDir = configDir, .autostartDir = autostartDir,
+        .liveStatus = liveStatus, .caps = caps, .xmlopt = xmlopt,
+    };
+    virDomainObjListLoadJobPtr jobs = NULL;
+    size_t njobs = 0;
+    size_t nloaded = 0;
+    size_t nunchanged = 0;
+    size_t workers;
+    unsigned long long then = 0;
+    unsigned long long now = 0;
+    int ncpus;
     int ret = -1;
     int rc;
+    size_t i;
 
     VIR_INFO("Scanning for configs in %s", configDir);
 
     if ((rc = virDirOpenIfExists(&dir, configDir)) <= 0)
         return rc;
 
-    virObjectRWLockWrite(doms);
+    ignore_value(virTimeMillisNow(&then));
 
-    while ((ret = virDirRead(dir, &entry, configDir)) > 0) {
-        virDomainObjPtr dom;
+    while ((rc = virDirRead(dir, &entry, configDir)) > 0) {
+        virDomainObjListLoadJob job = { 0 };
 
         if (!virFileStripSuffix(entry->d_name, ".xml"))
             continue;
 
+        if (VIR_STRDUP(job.name, entry->d_name) < 0 ||
+            !(job.path = virDomainConfigFile(configDir, job.name)) ||
+            VIR_APPEND_ELEMENT(jobs, njobs, job) < 0) {
+            VIR_FREE(job.name);
+            VIR_FREE(job.path);
+            goto cleanup;
+        }
+    }
+    if (rc < 0)
+        goto cleanup;
+
+    if (njobs)
+        qsort(jobs, njobs, sizeof(*jobs), virDomainObjListLoadJobCompare);
+
+    if ((ncpus = virHostCPUGetCount()) < 1) {
+        virResetLastError();
+        ncpus = 1;
+    }
+    workers = MIN(ncpus, VIR_DOMAIN_OBJ_LIST_LOAD_WORKERS);
+
+    data.jobs = jobs;
+    nunchanged = virDomainObjListLoadCheckStamps(doms, &data, njobs);
+
+    virThreadPoolRunBatch(workers, njobs, virDomainObjListLoadWorker, &data);
+
+    virObjectRWLockWrite(doms);
+
+    for (i = 0; i < njobs; i++) {
+        virDomainObjListLoadJobPtr job = &jobs[i];
+        virDomainObjPtr dom = NULL;
+
+        if (job->unchanged &&
+            !(dom = virDomainObjListLoadUnchanged(doms, liveStatus, job,
+                                                  notify, opaque))) {
+            /* the domain went away meanwhile, parse it after all */
+            job->unchanged = false;
+            nunchanged--;
+            virDomainObjListLoadWorker(i, &data);
+        }
+
+        if (!dom && job->def)
+            dom = virDomainObjListLoadConfig(doms, xmlopt, job,
+                                             notify, opaque);
+        else if (!dom && job->obj)
+            dom = virDomainObjListLoadStatus(doms, job, notify, opaque);
+
         /* NB: ignoring errors, so one malformed config doesn't
            kill the whole process */
-        VIR_INFO("Loading config file '%s.xml'", entry->d_name);
-        if (liveStatus)
-            dom = virDomainObjListLoadStatus(doms,
-                                             configDir,
-                                             entry->d_name,
-                                             caps,
-                                             xmlopt,
-                                             notify,
-                                             opaque);
-        else
-            dom = virDomainObjListLoadConfig(doms,
-                                             caps,
-                                             xmlopt,
-                                             configDir,
-                                             autostartDir,
-                                             entry->d_name,
-                                             notify,
-                                             opaque);
         if (dom) {
             if (!liveStatus)
                 dom->persistent = 1;
             virDomainObjEndAPI(&dom);
+            nloaded++;
         } else {
-            VIR_ERROR(_("Failed to load config for domain '%s'"), entry->d_name);
+            virErrorPtr err = job->err ? job->err : virGetLastError();
+
+            VIR_ERROR(_("Failed to load config for domain '%s': %s"),
+                      job->name, err && err->message ? err->message : "");
+            virResetLastError();
         }
     }
 
-    VIR_DIR_CLOSE(dir);
     virObjectRWUnlock(doms);
+    virDomainObjListReclaim(doms);
+
+    ignore_value(virTimeMillisNow(&now));
+    VIR_INFO("Loaded %zu of %zu configs (%zu unchanged) from %s in %llu ms "
+             "using %zu workers", nloaded, njobs, nunchanged, configDir,
+             now - then, MIN(workers, njobs));
+
+    ret = 0;
+
+ cleanup:
+    for (i = 0; i < njobs; i++)
+        virDomainObjListLoadJobClear(&jobs[i]);
+    VIR_FREE(jobs);
+    VIR_DIR_CLOSE(dir);
     return ret;
 }
 
@@ -816,6 +1573,9 @@ virDomainObjListForEach(virDomainObjListPtr doms,
     virObjectRWLockRead(doms);
     virHashForEach(doms->objs, virDomainObjListHelper, &data);
     virObjectRWUnlock(doms);
+
+    /* @callback may have removed domains */
+    virDomainObjListReclaim(doms);
     return data.ret;
 }
 
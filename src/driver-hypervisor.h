@@ -73,6 +73,12 @@ typedef int
 typedef char *
 (*virDrvConnectGetCapabilities)(virConnectPtr conn);
 
+typedef int
+(*virDrvConnectGetCapabilitiesIfChanged)(virConnectPtr conn,
+                                         unsigned long long *generation,
+                                         char **capabilities,
+                                         unsigned int flags);
+
 typedef char *
 (*virDrvConnectGetDomainCapabilities)(virConnectPtr conn,
                                       const char *emulatorbin,
@@ -1580,6 +1586,7 @@ struct _virHypervisorDriver {
     virDrvConnectBaselineHypervisorCPU connectBaselineHypervisorCPU;
     virDrvNodeGetSEVInfo nodeGetSEVInfo;
     virDrvDomainGetLaunchSecurityInfo domainGetLaunchSecurityInfo;
+    virDrvConnectGetCapabilitiesIfChanged connectGetCapabilitiesIfChanged;
 };
 
 
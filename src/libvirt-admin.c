@@ -1093,6 +1093,78 @@ virAdmServerSetClientLimits(virAdmServerPtr srv,
     return ret;
 }
 
+/**
+ * virAdmServerGetProcStats:
+ * @srv: a valid server object reference
+ * @params: pointer to statistics object
+ *          (return value, allocated automatically)
+ * @nparams: pointer to number of parameters returned in @params
+ * @flags: bitwise-OR of virAdmServerProcStatsFlags
+ *
+ * Retrieve per procedure RPC statistics collected by server @srv since
+ * it started or since they were last reset. Only procedures which were
+ * called at least once are reported. @params contains
+ * VIR_SERVER_PROC_STATS_COUNT, the number of reported procedures,
+ * VIR_SERVER_PROC_STATS_HIST_BUCKETS, the number of histogram buckets,
+ * and for each procedure the following fields, where <num> counts
+ * from 0:
+ *
+ *  "proc.<num>.program" - RPC program number as unsigned int
+ *  "proc.<num>.procedure" - procedure number within the program as
+ *                           unsigned int
+ *  "proc.<num>.name" - name of the procedure as string, if known
+ *  "proc.<num>.calls" - number of calls as unsigned long long
+ *  "proc.<num>.errors" - number of calls which failed as
+ *                        unsigned long long
+ *  "proc.<num>.bytes_in" - total size of the calls received as
+ *                          unsigned long long
+ *  "proc.<num>.bytes_out" - total size of the successful replies sent
+ *                           as unsigned long long
+ *  "proc.<num>.wait_time" - total time in microseconds calls spent
+ *                           queued waiting for a worker thread as
+ *                           unsigned long long
+ *  "proc.<num>.exec_time" - total time in microseconds spent executing
+ *                           calls as unsigned long long
+ *  "proc.<num>.wait_hist.<bucket>",
+ *  "proc.<num>.exec_hist.<bucket>" - histograms of the wait and
+ *                           execution times as unsigned long long.
+ *                           Bucket 0 counts calls below 1 microsecond,
+ *                           bucket N counts calls taking from 2^(N-1)
+ *                           up to 2^N microseconds, and the last bucket
+ *                           everything slower. Empty buckets are
+ *                           omitted.
+ *
+ * If @flags contains VIR_ADMIN_SERVER_PROC_STATS_RESET, the counters
+ * are reset after they were read.
+ *
+ * Returns 0 on success, allocating @params to size returned in @nparams, or
+ * -1 in case of an error. Caller is responsible for deallocating @params.
+ */
+int
+virAdmServerGetProcStats(virAdmServerPtr srv,
+                         virTypedParameterPtr *params,
+                         int *nparams,
+                         unsigned int flags)
+{
+    int ret = -1;
+
+    VIR_DEBUG("srv=%p, flags=0x%x", srv, flags);
+    virResetLastError();
+
+    virCheckAdmServerGoto(srv, error);
+    virCheckNonNullArgGoto(params, error);
+    virCheckNonNullArgGoto(nparams, error);
+
+    if ((ret = remoteAdminServerGetProcStats(srv, params,
+                                             nparams, flags)) < 0)
+        goto error;
+
+    return ret;
+ error:
+    virDispatchError(NULL);
+    return -1;
+}
+
 /**
  * virAdmConnectGetLoggingOutputs:
  * @conn: pointer to an active admin connection
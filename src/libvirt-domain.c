@@ -1014,6 +1014,16 @@ virDomainRestore(virConnectPtr conn, const char *from)
  * @flags will override the default read from the file.  These two
  * flags are mutually exclusive.
  *
+ * If @flags includes VIR_DOMAIN_SAVE_CLONE, the saved state is used as a
+ * template and restored into a new domain described by @dxml, which must
+ * be given and may only differ from the saved XML in host-specific parts,
+ * the domain name and UUID. The file is left untouched, so any number of
+ * clones can be started from it. Where supported, writable disks whose
+ * image does not exist yet are created as copy-on-write overlays of the
+ * corresponding disk of the saved domain, which must not be modified
+ * while clones use it. The clones keep the guest visible hardware of the
+ * saved domain, including MAC addresses.
+ *
  * Returns 0 in case of success and -1 in case of failure.
  */
 int
@@ -1033,6 +1043,12 @@ virDomainRestoreFlags(virConnectPtr conn, const char *from, const char *dxml,
                              VIR_DOMAIN_SAVE_PAUSED,
                              error);
 
+    if ((flags & VIR_DOMAIN_SAVE_CLONE) && !dxml) {
+        virReportInvalidArg(dxml, "%s",
+                            _("cloning a saved domain requires new XML"));
+        goto error;
+    }
+
     if (conn->driver->domainRestoreFlags) {
         int ret;
         char *absolute_from;
@@ -11648,6 +11664,16 @@ virConnectGetDomainCapabilities(virConnectPtr conn,
  * is returned for the domain.  That subset being statistics that
  * don't involve querying the underlying hypervisor.
  *
+ * If statistics which involve querying the underlying hypervisor were
+ * requested but had to be skipped for a domain, for example because it
+ * was busy with another job, its record contains the boolean field
+ * "partial" set to true.
+ *
+ * Passing VIR_CONNECT_GET_ALL_DOMAINS_STATS_CACHED in @flags allows the
+ * hypervisor driver to return statistics it gathered recently for an
+ * earlier request instead of querying the hypervisor again. How old such
+ * statistics may be is up to the driver configuration.
+ *
  * Similarly to virConnectListAllDomains, @flags can contain various flags to
  * filter the list of domains to provide stats for.
  *
@@ -11738,6 +11764,16 @@ virConnectGetAllDomainStats(virConnectPtr conn,
  * is returned for the domain.  That subset being statistics that
  * don't involve querying the underlying hypervisor.
  *
+ * If statistics which involve querying the underlying hypervisor were
+ * requested but had to be skipped for a domain, for example because it
+ * was busy with another job, its record contains the boolean field
+ * "partial" set to true.
+ *
+ * Passing VIR_CONNECT_GET_ALL_DOMAINS_STATS_CACHED in @flags allows the
+ * hypervisor driver to return statistics it gathered recently for an
+ * earlier request instead of querying the hypervisor again. How old such
+ * statistics may be is up to the driver configuration.
+ *
  * Note that any of the domain list filtering flags in @flags may be rejected
  * by this function.
  *
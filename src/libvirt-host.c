@@ -415,6 +415,65 @@ virConnectGetCapabilities(virConnectPtr conn)
 }
 
 
+/**
+ * virConnectGetCapabilitiesIfChanged:
+ * @conn: pointer to the hypervisor connection
+ * @generation: pointer to the generation of the caller's copy
+ * @capabilities: pointer to be filled with the capabilities XML
+ * @flags: extra flags; not used yet, so callers should always pass 0
+ *
+ * Variant of virConnectGetCapabilities() for callers which keep a copy
+ * of the capabilities document around. On input @generation holds
+ * the generation number returned by a previous call, or 0 if the
+ * caller has no copy yet. If the hypervisor capabilities did not
+ * change since, nothing is transferred and @capabilities is set to
+ * NULL. Otherwise @capabilities is filled with the current document
+ * and @generation is updated to its generation number.
+ *
+ * Generation numbers are opaque; the only meaningful operation on
+ * them is passing them back to this function on the same connection
+ * URI.
+ *
+ * Returns 1 if @capabilities was filled in, 0 if the caller's copy is
+ * still current, -1 in case of error. The caller must free the
+ * returned string after use.
+ */
+int
+virConnectGetCapabilitiesIfChanged(virConnectPtr conn,
+                                   unsigned long long *generation,
+                                   char **capabilities,
+                                   unsigned int flags)
+{
+    VIR_DEBUG("conn=%p, generation=%p, capabilities=%p, flags=0x%x",
+              conn, generation, capabilities, flags);
+
+    virResetLastError();
+
+    virCheckConnectReturn(conn, -1);
+    virCheckNonNullArgGoto(generation, error);
+    virCheckNonNullArgGoto(capabilities, error);
+
+    *capabilities = NULL;
+
+    if (conn->driver->connectGetCapabilitiesIfChanged) {
+        int ret;
+        ret = conn->driver->connectGetCapabilitiesIfChanged(conn, generation,
+                                                             capabilities,
+                                                             flags);
+        if (ret < 0)
+            goto error;
+        VIR_DEBUG("conn=%p ret=%d generation=%llu", conn, ret, *generation);
+        return ret;
+    }
+
+    virReportUnsupportedError();
+
+ error:
+    virDispatchError(conn);
+    return -1;
+}
+
+
 /**
  * virNodeGetCPUStats:
  * @conn: pointer to the hypervisor connection.
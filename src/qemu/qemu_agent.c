@@ -92,6 +92,41 @@ struct _qemuAgentMessage {
     /* id of the issued sync comand */
     unsigned long long id;
     bool first;
+
+    /* Set for a batch of commands, whose replies are collected in
+     * rxObjects in the order the agent sends them */
+    size_t nrxObjects;
+    size_t nrxReceived;
+    virJSONValuePtr *rxObjects;
+};
+
+
+/* Side effect free queries whose replies are cached, see
+ * qemuAgentQueryCached */
+typedef enum {
+    QEMU_AGENT_QUERY_HOSTNAME,
+    QEMU_AGENT_QUERY_FSINFO,
+    QEMU_AGENT_QUERY_INTERFACES,
+
+    QEMU_AGENT_QUERY_LAST
+} qemuAgentQuery;
+
+VIR_ENUM_DECL(qemuAgentQuery);
+VIR_ENUM_IMPL(qemuAgentQuery, QEMU_AGENT_QUERY_LAST,
+              "guest-get-host-name",
+              "guest-get-fsinfo",
+              "guest-network-get-interfaces");
+
+/* Queries asked for within this many milliseconds are refreshed
+ * together with any other one */
+#define QEMU_AGENT_CACHE_POLLED (60 * 1000)
+
+typedef struct _qemuAgentQueryCache qemuAgentQueryCache;
+typedef qemuAgentQueryCache *qemuAgentQueryCachePtr;
+struct _qemuAgentQueryCache {
+    virJSONValuePtr reply; /* last successful reply, or NULL */
+    unsigned long long fetched; /* when @reply was received */
+    unsigned long long requested; /* when the query was last asked for */
 };
 
 
@@ -127,11 +162,28 @@ struct _qemuAgent {
      * but fire up an event on qemu monitor instead.
      * Take that as indication of successful completion */
     qemuAgentEvent await_event;
+
+    /* How long a cached reply is used, in milliseconds. Zero
+     * disables the cache */
+    unsigned int cacheMaxAge;
+    qemuAgentQueryCache cache[QEMU_AGENT_QUERY_LAST];
 };
 
 static virClassPtr qemuAgentClass;
 static void qemuAgentDispose(void *obj);
 
+
+static void
+qemuAgentInvalidateCacheLocked(qemuAgentPtr mon)
+{
+    size_t i;
+
+    for (i = 0; i < QEMU_AGENT_QUERY_LAST; i++) {
+        virJSONValueFree(mon->cache[i].reply);
+        mon->cache[i].reply = NULL;
+    }
+}
+
 static int qemuAgentOnceInit(void)
 {
     if (!VIR_CLASS_NEW(qemuAgent, virClassForObjectLockable()))
@@ -173,6 +225,7 @@ static void qemuAgentDispose(void *obj)
     virCondDestroy(&mon->notify);
     VIR_FREE(mon->buffer);
     virResetError(&mon->lastError);
+    qemuAgentInvalidateCacheLocked(mon);
 }
 
 static int
@@ -329,8 +382,21 @@ qemuAgentIOProcessLine(qemuAgentPtr mon,
                     goto cleanup;
                 }
             }
-            msg->rxObject = obj;
-            msg->finished = 1;
+            if (msg->nrxObjects) {
+                /* the agent executes commands one by one, so replies
+                 * arrive in the order the batch was written */
+                if (msg->nrxReceived == msg->nrxObjects) {
+                    VIR_DEBUG("Ignoring surplus reply to batch");
+                    ret = 0;
+                    goto cleanup;
+                }
+                msg->rxObjects[msg->nrxReceived++] = obj;
+                if (msg->nrxReceived == msg->nrxObjects)
+                    msg->finished = 1;
+            } else {
+                msg->rxObject = obj;
+                msg->finished = 1;
+            }
             obj = NULL;
         } else {
             /* we are out of sync */
@@ -394,9 +460,11 @@ qemuAgentIOProcess(qemuAgentPtr mon)
     qemuAgentMessagePtr msg = NULL;
 
     /* See if there's a message ready for reply; that is,
-     * one that has completed writing all its data.
+     * one that has completed writing all its data. Replies
+     * to a batch may arrive while the rest is still written.
      */
-    if (mon->msg && mon->msg->txOffset == mon->msg->txLength)
+    if (mon->msg &&
+        (mon->msg->txOffset == mon->msg->txLength || mon->msg->nrxObjects))
         msg = mon->msg;
 
 #if DEBUG_IO
@@ -1077,7 +1145,7 @@ qemuAgentCommand(qemuAgentPtr mon,
 {
     int ret = -1;
     qemuAgentMessage msg;
-    char *cmdstr = NULL;
+    virBuffer buf = VIR_BUFFER_INITIALIZER;
     int await_event = mon->await_event;
 
     *reply = NULL;
@@ -1088,18 +1156,24 @@ qemuAgentCommand(qemuAgentPtr mon,
         return -1;
     }
 
+    /* Any command may change what the cached queries return */
+    qemuAgentInvalidateCacheLocked(mon);
+
     if (qemuAgentGuestSync(mon) < 0)
         return -1;
 
     memset(&msg, 0, sizeof(msg));
 
-    if (!(cmdstr = virJSONValueToString(cmd, false)))
+    if (virJSONValueToBuffer(cmd, &buf) < 0)
         goto cleanup;
-    if (virAsprintf(&msg.txBuffer, "%s" LINE_ENDING, cmdstr) < 0)
+    virBufferAddLit(&buf, LINE_ENDING);
+    if (virBufferCheckError(&buf) < 0)
         goto cleanup;
-    msg.txLength = strlen(msg.txBuffer);
+    msg.txLength = virBufferUse(&buf);
+    msg.txBuffer = virBufferContentAndReset(&buf);
 
-    VIR_DEBUG("Send command '%s' for write, seconds = %d", cmdstr, seconds);
+    VIR_DEBUG("Send command '%.*s' for write, seconds = %d",
+              msg.txLength - (int) strlen(LINE_ENDING), msg.txBuffer, seconds);
 
     ret = qemuAgentSend(mon, &msg, seconds);
 
@@ -1128,12 +1202,13 @@ qemuAgentCommand(qemuAgentPtr mon,
     }
 
  cleanup:
-    VIR_FREE(cmdstr);
+    virBufferFreeAndReset(&buf);
     VIR_FREE(msg.txBuffer);
 
     return ret;
 }
 
+
 static virJSONValuePtr ATTRIBUTE_SENTINEL
 qemuAgentMakeCommand(const char *cmdname,
                      ...)
@@ -1168,6 +1243,255 @@ qemuAgentMakeCommand(const char *cmdname,
     return NULL;
 }
 
+
+/**
+ * qemuAgentCommandBatch:
+ * @mon: agent object
+ * @cmds: commands to execute
+ * @ncmds: number of entries in @cmds
+ * @replies: filled with the reply to each command
+ * @seconds: timeout, see qemuAgentSend
+ *
+ * Write all of @cmds to the agent after a single guest-sync and wait
+ * for all of their replies, instead of paying a sync and a round trip
+ * per command. The commands must not depend on each other's outcome
+ * and must all send a reply. Callers must check each reply for errors.
+ * @replies must have room for @ncmds entries which the caller frees.
+ *
+ * Returns 0 once every reply was received, -2 on timeout, -1 on other
+ * errors (in both cases @replies is cleared).
+ */
+static int
+qemuAgentCommandBatch(qemuAgentPtr mon,
+                      virJSONValuePtr *cmds,
+                      size_t ncmds,
+                      virJSONValuePtr *replies,
+                      int seconds)
+{
+    int ret = -1;
+    qemuAgentMessage msg;
+    virBuffer buf = VIR_BUFFER_INITIALIZER;
+    size_t i;
+
+    memset(&msg, 0, sizeof(msg));
+    memset(replies, 0, sizeof(*replies) * ncmds);
+
+    if (ncmds == 0)
+        return 0;
+
+    if (!mon->running) {
+        virReportError(VIR_ERR_AGENT_UNRESPONSIVE, "%s",
+                       _("Guest agent disappeared while executing command"));
+        return -1;
+    }
+
+    if (qemuAgentGuestSync(mon) < 0)
+        return -1;
+
+    if (VIR_ALLOC_N(msg.rxObjects, ncmds) < 0)
+        goto cleanup;
+    msg.nrxObjects = ncmds;
+
+    for (i = 0; i < ncmds; i++) {
+        if (virJSONValueToBuffer(cmds[i], &buf) < 0)
+            goto cleanup;
+        virBufferAddLit(&buf, LINE_ENDING);
+    }
+
+    if (virBufferCheckError(&buf) < 0)
+        goto cleanup;
+    msg.txLength = virBufferUse(&buf);
+    msg.txBuffer = virBufferContentAndReset(&buf);
+
+    VIR_DEBUG("Send batch of %zu commands '%.*s', seconds = %d",
+              ncmds, msg.txLength - (int) strlen(LINE_ENDING), msg.txBuffer,
+              seconds);
+
+    if ((ret = qemuAgentSend(mon, &msg, seconds)) < 0)
+        goto cleanup;
+
+    VIR_DEBUG("Received %zu of %zu replies", msg.nrxReceived, ncmds);
+
+    if (msg.nrxReceived != ncmds) {
+        if (mon->running)
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("Missing monitor reply object"));
+        else
+            virReportError(VIR_ERR_AGENT_UNRESPONSIVE, "%s",
+                           _("Guest agent disappeared while executing command"));
+        ret = -1;
+        goto cleanup;
+    }
+
+    for (i = 0; i < ncmds; i++)
+        VIR_STEAL_PTR(replies[i], msg.rxObjects[i]);
+
+    ret = 0;
+
+ cleanup:
+    for (i = 0; i < msg.nrxObjects; i++)
+        virJSONValueFree(msg.rxObjects[i]);
+    VIR_FREE(msg.rxObjects);
+    virBufferFreeAndReset(&buf);
+    VIR_FREE(msg.txBuffer);
+
+    return ret;
+}
+
+
+static bool
+qemuAgentQueryIsFresh(qemuAgentPtr mon,
+                      qemuAgentQuery query,
+                      unsigned long long now)
+{
+    return mon->cache[query].reply &&
+           now - mon->cache[query].fetched < mon->cacheMaxAge;
+}
+
+
+/**
+ * qemuAgentQueryCached:
+ * @mon: agent object
+ * @query: query to run
+ * @reply: filled with a copy of the reply
+ *
+ * Run @query, or return its reply from the cache if it was received
+ * less than the configured max age ago. On a miss, every other query
+ * which was asked for recently and is stale is refreshed in the same
+ * batch, so a client polling several queries pays for one guest-sync.
+ * The cache is dropped on any other agent command and on guest
+ * lifecycle events, see qemuAgentInvalidateCache. Without a max age,
+ * see qemuAgentSetCacheMaxAge, @query is simply sent to the agent.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+static int
+qemuAgentQueryCached(qemuAgentPtr mon,
+                     qemuAgentQuery query,
+                     virJSONValuePtr *reply)
+{
+    virJSONValuePtr cmds[QEMU_AGENT_QUERY_LAST] = { NULL };
+    virJSONValuePtr replies[QEMU_AGENT_QUERY_LAST] = { NULL };
+    qemuAgentQuery queries[QEMU_AGENT_QUERY_LAST];
+    unsigned long long now;
+    size_t ncmds = 0;
+    size_t i;
+    int ret = -1;
+
+    *reply = NULL;
+
+    if (mon->cacheMaxAge == 0) {
+        if (!(cmds[0] = qemuAgentMakeCommand(qemuAgentQueryTypeToString(query),
+                                             NULL)))
+            return -1;
+
+        ret = qemuAgentCommand(mon, cmds[0], reply, true,
+                               VIR_DOMAIN_QEMU_AGENT_COMMAND_BLOCK);
+        virJSONValueFree(cmds[0]);
+        return ret;
+    }
+
+    if (virTimeMillisNow(&now) < 0)
+        return -1;
+
+    mon->cache[query].requested = now;
+
+    if (qemuAgentQueryIsFresh(mon, query, now)) {
+        VIR_DEBUG("Using cached reply to %s",
+                  qemuAgentQueryTypeToString(query));
+        if (!(*reply = virJSONValueCopy(mon->cache[query].reply)))
+            return -1;
+        return 0;
+    }
+
+    queries[ncmds++] = query;
+    for (i = 0; i < QEMU_AGENT_QUERY_LAST; i++) {
+        if (i == query ||
+            !mon->cache[i].requested ||
+            now - mon->cache[i].requested >= QEMU_AGENT_CACHE_POLLED ||
+            qemuAgentQueryIsFresh(mon, i, now))
+            continue;
+        queries[ncmds++] = i;
+    }
+
+    for (i = 0; i < ncmds; i++) {
+        if (!(cmds[i] = qemuAgentMakeCommand(qemuAgentQueryTypeToString(queries[i]),
+                                             NULL)))
+            goto cleanup;
+    }
+
+    if (qemuAgentCommandBatch(mon, cmds, ncmds, replies,
+                              VIR_DOMAIN_QEMU_AGENT_COMMAND_BLOCK) < 0)
+        goto cleanup;
+
+    /* Errors of the queries refreshed along are not the caller's
+     * business, they are simply not cached */
+    for (i = 1; i < ncmds; i++) {
+        qemuAgentQueryCachePtr entry = &mon->cache[queries[i]];
+
+        if (virJSONValueObjectHasKey(replies[i], "return") != 1)
+            continue;
+
+        virJSONValueFree(entry->reply);
+        VIR_STEAL_PTR(entry->reply, replies[i]);
+        entry->fetched = now;
+    }
+
+    if (qemuAgentCheckError(cmds[0], replies[0]) < 0)
+        goto cleanup;
+
+    virJSONValueFree(mon->cache[query].reply);
+    if (!(mon->cache[query].reply = virJSONValueCopy(replies[0])))
+        goto cleanup;
+    mon->cache[query].fetched = now;
+
+    VIR_STEAL_PTR(*reply, replies[0]);
+    ret = 0;
+
+ cleanup:
+    for (i = 0; i < ncmds; i++) {
+        virJSONValueFree(cmds[i]);
+        virJSONValueFree(replies[i]);
+    }
+    return ret;
+}
+
+
+/**
+ * qemuAgentSetCacheMaxAge:
+ * @mon: agent object
+ * @maxAge: milliseconds a cached query reply is used for
+ *
+ * Enable caching of the replies to side effect free queries, see
+ * qemuAgentQueryCached. Zero disables the cache, which is the default.
+ */
+void
+qemuAgentSetCacheMaxAge(qemuAgentPtr mon,
+                        unsigned int maxAge)
+{
+    virObjectLock(mon);
+    mon->cacheMaxAge = maxAge;
+    qemuAgentInvalidateCacheLocked(mon);
+    virObjectUnlock(mon);
+}
+
+
+/**
+ * qemuAgentInvalidateCache:
+ * @mon: agent object
+ *
+ * Drop the cached query replies, because something outside of the
+ * agent's view changed the guest, e.g. a device was hotplugged.
+ */
+void
+qemuAgentInvalidateCache(qemuAgentPtr mon)
+{
+    virObjectLock(mon);
+    qemuAgentInvalidateCacheLocked(mon);
+    virObjectUnlock(mon);
+}
+
+
 static virJSONValuePtr
 qemuAgentMakeStringsArray(const char **strings, unsigned int len)
 {
@@ -1200,6 +1524,7 @@ void qemuAgentNotifyEvent(qemuAgentPtr mon,
     virObjectLock(mon);
 
     VIR_DEBUG("mon=%p event=%d await_event=%d", mon, event, mon->await_event);
+    qemuAgentInvalidateCacheLocked(mon);
     if (mon->await_event == event) {
         mon->await_event = QEMU_AGENT_EVENT_NONE;
         /* somebody waiting for this event, wake him up. */
@@ -1693,19 +2018,11 @@ qemuAgentGetHostname(qemuAgentPtr mon,
                      char **hostname)
 {
     int ret = -1;
-    virJSONValuePtr cmd;
     virJSONValuePtr reply = NULL;
     virJSONValuePtr data = NULL;
     const char *result = NULL;
 
-    cmd = qemuAgentMakeCommand("guest-get-host-name",
-                               NULL);
-
-    if (!cmd)
-        return ret;
-
-    if (qemuAgentCommand(mon, cmd, &reply, true,
-                         VIR_DOMAIN_QEMU_AGENT_COMMAND_BLOCK) < 0)
+    if (qemuAgentQueryCached(mon, QEMU_AGENT_QUERY_HOSTNAME, &reply) < 0)
         goto cleanup;
 
     if (!(data = virJSONValueObjectGet(reply, "return"))) {
@@ -1726,7 +2043,6 @@ qemuAgentGetHostname(qemuAgentPtr mon,
     ret = 0;
 
  cleanup:
-    virJSONValueFree(cmd);
     virJSONValueFree(reply);
     return ret;
 }
@@ -1833,19 +2149,13 @@ qemuAgentGetFSInfo(qemuAgentPtr mon, virDomainFSInfoPtr **info,
     int ret = -1;
     size_t ndata = 0, ndisk;
     char **alias;
-    virJSONValuePtr cmd;
     virJSONValuePtr reply = NULL;
     virJSONValuePtr data;
     virDomainFSInfoPtr *info_ret = NULL;
     virPCIDeviceAddress pci_address;
     const char *result = NULL;
 
-    cmd = qemuAgentMakeCommand("guest-get-fsinfo", NULL);
-    if (!cmd)
-        return ret;
-
-    if (qemuAgentCommand(mon, cmd, &reply, true,
-                         VIR_DOMAIN_QEMU_AGENT_COMMAND_BLOCK) < 0)
+    if (qemuAgentQueryCached(mon, QEMU_AGENT_QUERY_FSINFO, &reply) < 0)
         goto cleanup;
 
     if (!(data = virJSONValueObjectGet(reply, "return"))) {
@@ -2003,7 +2313,6 @@ qemuAgentGetFSInfo(qemuAgentPtr mon, virDomainFSInfoPtr **info,
             virDomainFSInfoFree(info_ret[i]);
         VIR_FREE(info_ret);
     }
-    virJSONValueFree(cmd);
     virJSONValueFree(reply);
     return ret;
 }
@@ -2025,7 +2334,6 @@ qemuAgentGetInterfaces(qemuAgentPtr mon,
 {
     int ret = -1;
     size_t i, j;
-    virJSONValuePtr cmd = NULL;
     virJSONValuePtr reply = NULL;
     virJSONValuePtr ret_array = NULL;
     size_t ifaces_count = 0;
@@ -2040,11 +2348,7 @@ qemuAgentGetInterfaces(qemuAgentPtr mon,
         return -1;
     }
 
-    if (!(cmd = qemuAgentMakeCommand("guest-network-get-interfaces", NULL)))
-        goto cleanup;
-
-    if (qemuAgentCommand(mon, cmd, &reply, true,
-                         VIR_DOMAIN_QEMU_AGENT_COMMAND_BLOCK) < 0)
+    if (qemuAgentQueryCached(mon, QEMU_AGENT_QUERY_INTERFACES, &reply) < 0)
         goto cleanup;
 
     if (!(ret_array = virJSONValueObjectGet(reply, "return"))) {
@@ -2186,7 +2490,6 @@ qemuAgentGetInterfaces(qemuAgentPtr mon,
     ret = ifaces_count;
 
  cleanup:
-    virJSONValueFree(cmd);
     virJSONValueFree(reply);
     virHashFree(ifaces_store);
     return ret;
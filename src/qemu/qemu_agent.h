@@ -58,6 +58,10 @@ typedef enum {
 void qemuAgentNotifyEvent(qemuAgentPtr mon,
                           qemuAgentEvent event);
 
+void qemuAgentSetCacheMaxAge(qemuAgentPtr mon,
+                             unsigned int maxAge);
+void qemuAgentInvalidateCache(qemuAgentPtr mon);
+
 typedef enum {
     QEMU_AGENT_SHUTDOWN_POWERDOWN,
     QEMU_AGENT_SHUTDOWN_REBOOT,
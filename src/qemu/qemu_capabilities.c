@@ -40,6 +40,8 @@
 #include "virhostcpu.h"
 #include "qemu_monitor.h"
 #include "virstring.h"
+#include "virthreadpool.h"
+#include "viratomic.h"
 #include "qemu_hostdev.h"
 #include "qemu_domain.h"
 #define LIBVIRT_QEMU_CAPSPRIV_H_ALLOW
@@ -55,6 +57,9 @@
 
 #define VIR_FROM_THIS VIR_FROM_QEMU
 
+/* Upper bound on QEMU binaries probed concurrently */
+#define VIR_QEMU_CAPS_PROBE_WORKERS 8
+
 VIR_LOG_INIT("qemu.qemu_capabilities");
 
 /* While not public, these strings must not change. They
@@ -755,43 +760,89 @@ virQEMUCapsFindBinaryForArch(virArch hostarch,
 }
 
 static int
-virQEMUCapsInitGuest(virCapsPtr caps,
-                     virFileCachePtr cache,
-                     virArch hostarch,
-                     virArch guestarch)
+virQEMUCapsFindGuestBinary(virArch hostarch,
+                           virArch guestarch,
+                           char **binary)
 {
-    char *binary = NULL;
-    virQEMUCapsPtr qemuCaps = NULL;
-    int ret = -1;
-
     /* Check for existence of base emulator, or alternate base
      * which can be used with magic cpu choice
      */
-    binary = virQEMUCapsFindBinaryForArch(hostarch, guestarch);
+    *binary = virQEMUCapsFindBinaryForArch(hostarch, guestarch);
 
     /* RHEL doesn't follow the usual naming for QEMU binaries and ships
      * a single binary named qemu-kvm outside of $PATH instead */
-    if (virQEMUCapsGuestIsNative(hostarch, guestarch) && !binary) {
-        if (VIR_STRDUP(binary, "/usr/libexec/qemu-kvm") < 0)
+    if (virQEMUCapsGuestIsNative(hostarch, guestarch) && !*binary) {
+        if (VIR_STRDUP(*binary, "/usr/libexec/qemu-kvm") < 0)
             return -1;
     }
 
+    return 0;
+}
+
+
+struct virQEMUCapsInitGuestData {
+    virFileCachePtr cache;
+    size_t n;
+    virArch arch[VIR_ARCH_LAST];
+    char *binary[VIR_ARCH_LAST];
+    virQEMUCapsPtr qemuCaps[VIR_ARCH_LAST];
+};
+
+
+static void
+virQEMUCapsInitGuestWorker(size_t idx,
+                           void *opaque)
+{
+    struct virQEMUCapsInitGuestData *data = opaque;
+
     /* Ignore binary if extracting version info fails */
-    if (binary) {
-        if (!(qemuCaps = virQEMUCapsCacheLookup(cache, binary))) {
-            virResetLastError();
-            VIR_FREE(binary);
-        }
+    if (!(data->qemuCaps[idx] = virQEMUCapsCacheLookup(data->cache,
+                                                       data->binary[idx]))) {
+        virResetLastError();
+        VIR_FREE(data->binary[idx]);
     }
+}
 
-    ret = virQEMUCapsInitGuestFromBinary(caps,
-                                         binary, qemuCaps,
-                                         guestarch);
 
-    VIR_FREE(binary);
-    virObjectUnref(qemuCaps);
+/* Finds the emulator binaries for all guest architectures and looks
+ * up their capabilities in the cache */
+static int
+virQEMUCapsInitGuestLookup(struct virQEMUCapsInitGuestData *data,
+                           virArch hostarch)
+{
+    size_t i;
 
-    return ret;
+    /* QEMU can support pretty much every arch that exists,
+     * so just probe for them all - we gracefully fail
+     * if a qemu-system-$ARCH binary can't be found
+     */
+    for (i = 0; i < VIR_ARCH_LAST; i++) {
+        if (virQEMUCapsFindGuestBinary(hostarch, i, &data->binary[data->n]) < 0)
+            return -1;
+        if (data->binary[data->n])
+            data->arch[data->n++] = i;
+    }
+
+    /* Probing a binary that is not in the cache yet means running it,
+     * which takes a while; do all of them concurrently. The cache makes
+     * sure a binary shared by several architectures is probed once. */
+    virThreadPoolRunBatch(MIN(data->n, VIR_QEMU_CAPS_PROBE_WORKERS), data->n,
+                          virQEMUCapsInitGuestWorker, data);
+
+    return 0;
+}
+
+
+static void
+virQEMUCapsInitGuestClear(struct virQEMUCapsInitGuestData *data)
+{
+    size_t i;
+
+    for (i = 0; i < data->n; i++) {
+        VIR_FREE(data->binary[i]);
+        virObjectUnref(data->qemuCaps[i]);
+    }
+    data->n = 0;
 }
 
 int
@@ -899,6 +950,7 @@ virCapsPtr
 virQEMUCapsInit(virFileCachePtr cache)
 {
     virCapsPtr caps;
+    struct virQEMUCapsInitGuestData data = { .cache = cache };
     size_t i;
     virArch hostarch = virArchFromHost();
 
@@ -936,21 +988,71 @@ virQEMUCapsInit(virFileCachePtr cache)
     virCapabilitiesAddHostMigrateTransport(caps, "tcp");
     virCapabilitiesAddHostMigrateTransport(caps, "rdma");
 
-    /* QEMU can support pretty much every arch that exists,
-     * so just probe for them all - we gracefully fail
-     * if a qemu-system-$ARCH binary can't be found
-     */
-    for (i = 0; i < VIR_ARCH_LAST; i++)
-        if (virQEMUCapsInitGuest(caps, cache,
-                                 hostarch,
-                                 i) < 0)
+    if (virQEMUCapsInitGuestLookup(&data, hostarch) < 0)
+        goto error;
+
+    for (i = 0; i < data.n; i++) {
+        if (!data.binary[i])
+            continue;
+
+        if (virQEMUCapsInitGuestFromBinary(caps,
+                                           data.binary[i], data.qemuCaps[i],
+                                           data.arch[i]) < 0)
             goto error;
+    }
 
+ cleanup:
+    virQEMUCapsInitGuestClear(&data);
     return caps;
 
  error:
     virObjectUnref(caps);
-    return NULL;
+    caps = NULL;
+    goto cleanup;
+}
+
+
+/**
+ * virQEMUCapsGetInitStamp:
+ * @cache: QEMU capabilities cache
+ *
+ * Looks up the capabilities of all emulator binaries virQEMUCapsInit
+ * would use. This revalidates the cached data and probes binaries
+ * which are new or changed, but builds no virCaps.
+ *
+ * Returns a string which changes whenever the guests reported by
+ * virQEMUCapsInit may have changed, NULL on error.
+ */
+char *
+virQEMUCapsGetInitStamp(virFileCachePtr cache)
+{
+    struct virQEMUCapsInitGuestData data = { .cache = cache };
+    virBuffer buf = VIR_BUFFER_INITIALIZER;
+    char *ret = NULL;
+    size_t i;
+
+    if (virQEMUCapsInitGuestLookup(&data, virArchFromHost()) < 0)
+        goto cleanup;
+
+    for (i = 0; i < data.n; i++) {
+        if (data.binary[i])
+            virBufferAsprintf(&buf, "%s=%s\n",
+                              virArchToString(data.arch[i]), data.binary[i]);
+    }
+
+    /* Changes whenever any binary was (re)probed or dropped */
+    virBufferAsprintf(&buf, "generation=%llu\n",
+                      virFileCacheGetGeneration(cache));
+
+    if (virBufferCheckError(&buf) < 0)
+        goto cleanup;
+
+    ret = virBufferContentAndReset(&buf);
+
+ cleanup:
+    virBufferFreeAndReset(&buf);
+    virQEMUCapsInitGuestClear(&data);
+    return ret;
 }
 
 
@@ -1270,8 +1372,10 @@ struct _virQEMUCapsObjectTypeProps {
 };
 
 typedef int (*virQEMUCapsObjectTypePropsCB)(qemuMonitorPtr mon,
-                                            const char *type,
-                                            char ***props);
+                                            const char **types,
+                                            size_t ntypes,
+                                            char ***props,
+                                            int *nprops);
 
 static virQEMUCapsObjectTypeProps virQEMUCapsDeviceProps[] = {
     { "virtio-blk-pci", virQEMUCapsDevicePropsVirtioBlk,
@@ -2146,27 +2250,59 @@ virQEMUCapsProbeQMPGenericProps(virQEMUCapsPtr qemuCaps,
                                 size_t nprops,
                                 virQEMUCapsObjectTypePropsCB propsGetCB)
 {
-    int nvalues;
-    char **values;
+    virQEMUCapsObjectTypeProps **wanted = NULL;
+    const char **types = NULL;
+    char ***values = NULL;
+    int *nvalues = NULL;
+    size_t ntypes = 0;
     size_t i;
+    int ret = -1;
+
+    if (VIR_ALLOC_N(wanted, nprops) < 0 ||
+        VIR_ALLOC_N(types, nprops) < 0)
+        goto cleanup;
 
     for (i = 0; i < nprops; i++) {
-        const char *type = props[i].type;
         int cap = props[i].capsCondition;
 
         if (cap >= 0 && !virQEMUCapsGet(qemuCaps, cap))
             continue;
 
-        if ((nvalues = propsGetCB(mon, type, &values)) < 0)
-            return -1;
+        wanted[ntypes] = &props[i];
+        types[ntypes++] = props[i].type;
+    }
+
+    if (ntypes == 0) {
+        ret = 0;
+        goto cleanup;
+    }
+
+    /* None of the queried types depend on the flags the others set, so
+     * all the queries go to the monitor in a single batch */
+    if (VIR_ALLOC_N(values, ntypes) < 0 ||
+        VIR_ALLOC_N(nvalues, ntypes) < 0)
+        goto cleanup;
+
+    if (propsGetCB(mon, types, ntypes, values, nvalues) < 0)
+        goto cleanup;
+
+    for (i = 0; i < ntypes; i++) {
         virQEMUCapsProcessStringFlags(qemuCaps,
-                                      props[i].nprops,
-                                      props[i].props,
-                                      nvalues, values);
-        virStringListFreeCount(values, nvalues);
+                                      wanted[i]->nprops,
+                                      wanted[i]->props,
+                                      nvalues[i], values[i]);
     }
 
-    return 0;
+    ret = 0;
+
+ cleanup:
+    for (i = 0; values && i < ntypes; i++)
+        virStringListFreeCount(values[i], nvalues[i]);
+    VIR_FREE(values);
+    VIR_FREE(nvalues);
+    VIR_FREE(types);
+    VIR_FREE(wanted);
+    return ret;
 }
 
 static int
@@ -2188,7 +2324,7 @@ virQEMUCapsProbeQMPDevices(virQEMUCapsPtr qemuCaps,
                                         mon,
                                         virQEMUCapsDeviceProps,
                                         ARRAY_CARDINALITY(virQEMUCapsDeviceProps),
-                                        qemuMonitorGetDeviceProps) < 0)
+                                        qemuMonitorGetDevicePropsBatch) < 0)
         return -1;
 
     if (virQEMUCapsGet(qemuCaps, QEMU_CAPS_QOM_LIST_PROPERTIES) &&
@@ -2196,7 +2332,7 @@ virQEMUCapsProbeQMPDevices(virQEMUCapsPtr qemuCaps,
                                         mon,
                                         virQEMUCapsObjectProps,
                                         ARRAY_CARDINALITY(virQEMUCapsObjectProps),
-                                        qemuMonitorGetObjectProps) < 0)
+                                        qemuMonitorGetObjectPropsBatch) < 0)
         return -1;
 
     return 0;
@@ -3279,8 +3415,10 @@ struct _virQEMUCapsCachePriv {
     unsigned int microcodeVersion;
     char *kernelVersion;
 
-    /* cache whether /dev/kvm is usable as runUid:runGuid */
+    /* cache whether /dev/kvm is usable as runUid:runGuid and whether
+     * nesting is enabled; reloading the kvm module changes kvmCtime */
     virTristateBool kvmUsable;
+    virTristateBool kvmSupportsNesting;
     time_t kvmCtime;
 };
 typedef struct _virQEMUCapsCachePriv virQEMUCapsCachePriv;
@@ -3933,6 +4071,7 @@ virQEMUCapsKVMUsable(virQEMUCapsCachePrivPtr priv)
         VIR_DEBUG("%s has changed (%lld vs %lld)", kvm_device,
                   (long long)kvm_ctime, (long long)cached_kvm_ctime);
         cached_value = VIR_TRISTATE_BOOL_ABSENT;
+        priv->kvmSupportsNesting = VIR_TRISTATE_BOOL_ABSENT;
     }
 
     if (cached_value != VIR_TRISTATE_BOOL_ABSENT)
@@ -4043,7 +4182,13 @@ virQEMUCapsIsValid(void *data,
             return false;
         }
 
-        kvmSupportsNesting = virQEMUCapsKVMSupportsNesting();
+        /* reading the module parameters is left for when /dev/kvm
+         * changed, otherwise the value from the last check is used */
+        if (priv->kvmSupportsNesting == VIR_TRISTATE_BOOL_ABSENT) {
+            priv->kvmSupportsNesting =
+                virTristateBoolFromBool(virQEMUCapsKVMSupportsNesting());
+        }
+        kvmSupportsNesting = priv->kvmSupportsNesting == VIR_TRISTATE_BOOL_YES;
         if (kvmSupportsNesting != qemuCaps->kvmSupportsNesting) {
             VIR_DEBUG("Outdated capabilities for '%s': kvm kernel nested "
                       "value changed from %d",
@@ -4430,6 +4575,8 @@ virQEMUCapsInitQMPCommandFree(virQEMUCapsInitQMPCommandPtr cmd)
 }
 
 
+static int virQEMUCapsProbeCounter;
+
 static virQEMUCapsInitQMPCommandPtr
 virQEMUCapsInitQMPCommandNew(char *binary,
                              const char *libDir,
@@ -4438,6 +4585,7 @@ virQEMUCapsInitQMPCommandNew(char *binary,
                              char **qmperr)
 {
     virQEMUCapsInitQMPCommandPtr cmd = NULL;
+    unsigned int probe;
 
     if (VIR_ALLOC(cmd) < 0)
         goto error;
@@ -4449,11 +4597,15 @@ virQEMUCapsInitQMPCommandNew(char *binary,
     cmd->runGid = runGid;
     cmd->qmperr = qmperr;
 
+    /* Several binaries may be probed at the same time, each needs its
+     * own monitor socket and pidfile. */
+    probe = virAtomicIntInc(&virQEMUCapsProbeCounter) - 1;
+
     /* the ".sock" sufix is important to avoid a possible clash with a qemu
      * domain called "capabilities"
      */
-    if (virAsprintf(&cmd->monpath, "%s/%s", libDir,
-                    "capabilities.monitor.sock") < 0)
+    if (virAsprintf(&cmd->monpath, "%s/capabilities.%u.monitor.sock",
+                    libDir, probe) < 0)
         goto error;
     if (virAsprintf(&cmd->monarg, "unix:%s,server,nowait", cmd->monpath) < 0)
         goto error;
@@ -4464,7 +4616,8 @@ virQEMUCapsInitQMPCommandNew(char *binary,
      * -daemonize we need QEMU to be allowed to create them, rather
      * than libvirtd. So we're using libDir which QEMU can write to
      */
-    if (virAsprintf(&cmd->pidfile, "%s/%s", libDir, "capabilities.pidfile") < 0)
+    if (virAsprintf(&cmd->pidfile, "%s/capabilities.%u.pidfile",
+                    libDir, probe) < 0)
         goto error;
 
     virPidFileForceCleanupPath(cmd->pidfile);
@@ -4829,6 +4982,7 @@ virQEMUCapsCacheNew(const char *libDir,
     priv->runGid = runGid;
     priv->microcodeVersion = microcodeVersion;
     priv->kvmUsable = VIR_TRISTATE_BOOL_ABSENT;
+    priv->kvmSupportsNesting = VIR_TRISTATE_BOOL_ABSENT;
 
     if (uname(&uts) == 0 &&
         virAsprintf(&priv->kernelVersion, "%s %s", uts.release, uts.version) < 0)
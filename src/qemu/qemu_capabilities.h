@@ -605,6 +605,7 @@ virQEMUCapsPtr virQEMUCapsCacheLookupDefault(virFileCachePtr cache,
                                              const char **retMachine);
 
 virCapsPtr virQEMUCapsInit(virFileCachePtr cache);
+char *virQEMUCapsGetInitStamp(virFileCachePtr cache);
 
 int virQEMUCapsGetDefaultVersion(virCapsPtr caps,
                                  virFileCachePtr capsCache,
@@ -46,6 +46,9 @@
 #include "virsocketaddr.h"
 #include "virstring.h"
 #include "viratomic.h"
+#include "virhostcpu.h"
+#include "virnuma.h"
+#include "virhostmem.h"
 #include "storage_conf.h"
 #include "configmake.h"
 
@@ -334,6 +337,10 @@ virQEMUDriverConfigPtr virQEMUDriverConfigNew(bool privileged)
     cfg->securityDefaultConfined = true;
     cfg->securityRequireConfined = false;
 
+    cfg->statsWorkers = 8;
+    cfg->statsCacheMaxAge = 1000;
+    cfg->reconnectWorkers = 8;
+
     cfg->keepAliveInterval = 5;
     cfg->keepAliveCount = 5;
     cfg->seccompSandbox = -1;
@@ -855,6 +862,31 @@ int virQEMUDriverConfigLoadFile(virQEMUDriverConfigPtr cfg,
     if (virConfGetValueUInt(conf, "max_queued", &cfg->maxQueuedJobs) < 0)
         goto cleanup;
 
+    if (virConfGetValueUInt(conf, "stats_workers", &cfg->statsWorkers) < 0)
+        goto cleanup;
+    if (cfg->statsWorkers == 0) {
+        virReportError(VIR_ERR_CONF_SYNTAX, "%s",
+                       _("stats_workers must be greater than 0"));
+        goto cleanup;
+    }
+    if (virConfGetValueUInt(conf, "stats_timeout", &cfg->statsTimeout) < 0)
+        goto cleanup;
+    if (virConfGetValueUInt(conf, "stats_cache_max_age",
+                            &cfg->statsCacheMaxAge) < 0)
+        goto cleanup;
+    if (virConfGetValueUInt(conf, "agent_cache_max_age",
+                            &cfg->agentCacheMaxAge) < 0)
+        goto cleanup;
+
+    if (virConfGetValueUInt(conf, "reconnect_workers",
+                            &cfg->reconnectWorkers) < 0)
+        goto cleanup;
+    if (cfg->reconnectWorkers == 0) {
+        virReportError(VIR_ERR_CONF_SYNTAX, "%s",
+                       _("reconnect_workers must be greater than 0"));
+        goto cleanup;
+    }
+
     if (virConfGetValueInt(conf, "keepalive_interval", &cfg->keepAliveInterval) < 0)
         goto cleanup;
     if (virConfGetValueUInt(conf, "keepalive_count", &cfg->keepAliveCount) < 0)
@@ -1148,12 +1180,124 @@ virCapsPtr virQEMUDriverCreateCapabilities(virQEMUDriverPtr driver)
 }
 
 
+/*
+ * Add the memory and the huge page pools of host NUMA node @node, or
+ * of the whole host if @node is -1, to the caps stamp. Both are
+ * reported in the capabilities and change at runtime, e.g. when the
+ * admin resizes a huge page pool or memory is hot plugged.
+ */
+static void
+virQEMUDriverFormatMemoryStamp(virBufferPtr buf,
+                               int node)
+{
+    unsigned long long memory = 0;
+    unsigned int *pages_size = NULL;
+    unsigned long long *pages_avail = NULL;
+    size_t npages = 0;
+    size_t i;
+
+    /* Like in virCapabilitiesInitNUMA, failing to read either is not
+     * fatal; the stamp simply lacks the value */
+    if (node < 0) {
+        if (virHostMemGetInfo(&memory, NULL) < 0)
+            virResetLastError();
+    } else {
+        if (virNumaGetNodeMemory(node, &memory, NULL) < 0)
+            virResetLastError();
+    }
+
+    if (virNumaGetPages(node, &pages_size, &pages_avail, NULL, &npages) < 0) {
+        virResetLastError();
+        npages = 0;
+    }
+
+    virBufferAsprintf(buf, "node=%d memory=%llu pages=", node, memory);
+    for (i = 0; i < npages; i++)
+        virBufferAsprintf(buf, "%s%u:%llu", i ? "," : "",
+                          pages_size[i], pages_avail[i]);
+    virBufferAddLit(buf, "\n");
+
+    VIR_FREE(pages_size);
+    VIR_FREE(pages_avail);
+}
+
+
+/*
+ * Returns a string which changes whenever the capabilities built by
+ * virQEMUDriverCreateCapabilities may change: the online host CPUs,
+ * the NUMA nodes, their memory or huge page pools differ, or an
+ * emulator binary was added, removed or (re)probed. Computing it is
+ * much cheaper than building the capabilities. NULL on error.
+ */
+static char *
+virQEMUDriverGetCapsStamp(virQEMUDriverPtr driver)
+{
+    virBuffer buf = VIR_BUFFER_INITIALIZER;
+    virBitmapPtr online = NULL;
+    char *onlinestr = NULL;
+    char *emulators = NULL;
+    char *ret = NULL;
+    int maxnode;
+    int node;
+
+    /* Not knowing is no reason to fail, the emulators still count */
+    if (!(online = virHostCPUGetOnlineBitmap()) ||
+        !(onlinestr = virBitmapFormat(online)))
+        virResetLastError();
+
+    virBufferAsprintf(&buf, "cpus=%s\n", NULLSTR(onlinestr));
+    if (virNumaIsAvailable() && (maxnode = virNumaGetMaxNode()) >= 0) {
+        virBufferAsprintf(&buf, "nodes=%d\n", maxnode);
+        for (node = 0; node <= maxnode; node++) {
+            if (virNumaNodeIsAvailable(node))
+                virQEMUDriverFormatMemoryStamp(&buf, node);
+        }
+    } else {
+        virResetLastError();
+        virQEMUDriverFormatMemoryStamp(&buf, -1);
+    }
+
+    if (!(emulators = virQEMUCapsGetInitStamp(driver->qemuCapsCache)))
+        goto cleanup;
+
+    virBufferAdd(&buf, emulators, -1);
+
+    if (virBufferCheckError(&buf) < 0)
+        goto cleanup;
+
+    ret = virBufferContentAndReset(&buf);
+
+ cleanup:
+    virBufferFreeAndReset(&buf);
+    virBitmapFree(online);
+    VIR_FREE(onlinestr);
+    VIR_FREE(emulators);
+    return ret;
+}
+
+
+/**
+ * virQEMUDriverInvalidateCapabilities:
+ *
+ * Make the next refresh of the capabilities rebuild them, for host
+ * changes virQEMUDriverGetCapsStamp does not notice
+ */
+void
+virQEMUDriverInvalidateCapabilities(virQEMUDriverPtr driver)
+{
+    qemuDriverLock(driver);
+    VIR_FREE(driver->capsStamp);
+    qemuDriverUnlock(driver);
+}
+
+
 /**
  * virQEMUDriverGetCapabilities:
  *
  * Get a reference to the virCapsPtr instance for the
  * driver. If @refresh is true, the capabilities will be
- * rebuilt first
+ * rebuilt first unless neither the host nor the emulators
+ * changed since they were last built
  *
  * The caller must release the reference with virObjetUnref
  *
@@ -1165,12 +1309,54 @@ virCapsPtr virQEMUDriverGetCapabilities(virQEMUDriverPtr driver,
     virCapsPtr ret = NULL;
     if (refresh) {
         virCapsPtr caps = NULL;
-        if ((caps = virQEMUDriverCreateCapabilities(driver)) == NULL)
+        virCapsPtr oldcaps = NULL;
+        char *stamp = NULL;
+        int same = 0;
+
+        if (!(stamp = virQEMUDriverGetCapsStamp(driver)))
             return NULL;
 
+        /* Nothing changed, so keep the current object along with
+         * its generation and formatted XML */
         qemuDriverLock(driver);
-        virObjectUnref(driver->caps);
-        driver->caps = caps;
+        if (driver->caps && driver->caps->nguests > 0 &&
+            STREQ_NULLABLE(driver->capsStamp, stamp)) {
+            ret = virObjectRef(driver->caps);
+            qemuDriverUnlock(driver);
+            VIR_FREE(stamp);
+            return ret;
+        }
+        qemuDriverUnlock(driver);
+
+        if ((caps = virQEMUDriverCreateCapabilities(driver)) == NULL) {
+            VIR_FREE(stamp);
+            return NULL;
+        }
+
+        qemuDriverLock(driver);
+        oldcaps = virObjectRef(driver->caps);
+        qemuDriverUnlock(driver);
+
+        /* Even after a rebuild keep the old object if the result is
+         * the same, so that its generation stays stable. */
+        if (oldcaps && oldcaps->nguests > 0 &&
+            (same = virCapabilitiesIsEqual(oldcaps, caps)) < 0) {
+            virObjectUnref(oldcaps);
+            virObjectUnref(caps);
+            VIR_FREE(stamp);
+            return NULL;
+        }
+
+        qemuDriverLock(driver);
+        if (same && driver->caps == oldcaps) {
+            virObjectUnref(caps);
+        } else {
+            virObjectUnref(driver->caps);
+            driver->caps = caps;
+        }
+        VIR_FREE(driver->capsStamp);
+        VIR_STEAL_PTR(driver->capsStamp, stamp);
+        virObjectUnref(oldcaps);
     } else {
         qemuDriverLock(driver);
     }
@@ -1187,6 +1373,154 @@ virCapsPtr virQEMUDriverGetCapabilities(virQEMUDriverPtr driver,
     return ret;
 }
 
+
+typedef struct _virQEMUDomainCapsCacheEntry virQEMUDomainCapsCacheEntry;
+typedef virQEMUDomainCapsCacheEntry *virQEMUDomainCapsCacheEntryPtr;
+struct _virQEMUDomainCapsCacheEntry {
+    virQEMUCapsPtr qemuCaps;
+    unsigned long long capsGeneration;
+    char *xml;
+};
+
+
+static void
+virQEMUDomainCapsCacheEntryFree(void *payload,
+                                const void *name ATTRIBUTE_UNUSED)
+{
+    virQEMUDomainCapsCacheEntryPtr entry = payload;
+
+    if (!entry)
+        return;
+
+    virObjectUnref(entry->qemuCaps);
+    VIR_FREE(entry->xml);
+    VIR_FREE(entry);
+}
+
+
+virHashTablePtr
+virQEMUDomainCapsCacheNew(void)
+{
+    return virHashCreate(10, virQEMUDomainCapsCacheEntryFree);
+}
+
+
+static char *
+virQEMUDomainCapsCacheKey(virQEMUCapsPtr qemuCaps,
+                          const char *machine,
+                          virArch arch,
+                          virDomainVirtType virttype)
+{
+    char *key;
+
+    ignore_value(virAsprintf(&key, "%s:%s:%s:%s",
+                             virQEMUCapsGetBinary(qemuCaps),
+                             NULLSTR(machine),
+                             virArchToString(arch),
+                             virDomainVirtTypeToString(virttype)));
+    return key;
+}
+
+
+/**
+ * virQEMUDriverGetDomainCapsCached:
+ * @driver: the QEMU driver
+ * @caps: host capabilities the domain capabilities were based on
+ * @qemuCaps: capabilities of the emulator binary
+ * @machine: machine type
+ * @arch: guest architecture
+ * @virttype: virtualization type
+ *
+ * Looks up a domain capabilities document stored by
+ * virQEMUDriverSetDomainCapsCached. Entries are only valid as long as
+ * neither @caps nor @qemuCaps were replaced, which happens whenever
+ * the host or the emulator binary change.
+ *
+ * Returns a copy of the cached XML, or NULL if there is no valid
+ * entry; no error is reported in that case.
+ */
+char *
+virQEMUDriverGetDomainCapsCached(virQEMUDriverPtr driver,
+                                 virCapsPtr caps,
+                                 virQEMUCapsPtr qemuCaps,
+                                 const char *machine,
+                                 virArch arch,
+                                 virDomainVirtType virttype)
+{
+    virQEMUDomainCapsCacheEntryPtr entry;
+    char *key;
+    char *ret = NULL;
+
+    if (!(key = virQEMUDomainCapsCacheKey(qemuCaps, machine, arch, virttype))) {
+        virResetLastError();
+        return NULL;
+    }
+
+    qemuDriverLock(driver);
+    if ((entry = virHashLookup(driver->domCapsCache, key)) &&
+        entry->qemuCaps == qemuCaps &&
+        entry->capsGeneration == virCapabilitiesGetGeneration(caps) &&
+        VIR_STRDUP_QUIET(ret, entry->xml) < 0)
+        ret = NULL;
+    qemuDriverUnlock(driver);
+
+    VIR_FREE(key);
+    return ret;
+}
+
+
+/**
+ * virQEMUDriverSetDomainCapsCached:
+ * @driver: the QEMU driver
+ * @caps: host capabilities the domain capabilities were based on
+ * @qemuCaps: capabilities of the emulator binary
+ * @machine: machine type
+ * @arch: guest architecture
+ * @virttype: virtualization type
+ * @xml: formatted domain capabilities
+ *
+ * Remembers @xml for subsequent virQEMUDriverGetDomainCapsCached
+ * calls. Failing to store the document is not fatal for the caller,
+ * so errors are only logged.
+ */
+void
+virQEMUDriverSetDomainCapsCached(virQEMUDriverPtr driver,
+                                 virCapsPtr caps,
+                                 virQEMUCapsPtr qemuCaps,
+                                 const char *machine,
+                                 virArch arch,
+                                 virDomainVirtType virttype,
+                                 const char *xml)
+{
+    virQEMUDomainCapsCacheEntryPtr entry = NULL;
+    char *key = NULL;
+
+    if (!(key = virQEMUDomainCapsCacheKey(qemuCaps, machine, arch, virttype)) ||
+        VIR_ALLOC(entry) < 0 ||
+        VIR_STRDUP(entry->xml, xml) < 0)
+        goto error;
+
+    entry->qemuCaps = virObjectRef(qemuCaps);
+    entry->capsGeneration = virCapabilitiesGetGeneration(caps);
+
+    qemuDriverLock(driver);
+    if (virHashUpdateEntry(driver->domCapsCache, key, entry) < 0) {
+        qemuDriverUnlock(driver);
+        goto error;
+    }
+    qemuDriverUnlock(driver);
+
+    VIR_FREE(key);
+    return;
+
+ error:
+    VIR_WARN("Unable to cache domain capabilities: %s",
+             virGetLastErrorMessage());
+    virResetLastError();
+    virQEMUDomainCapsCacheEntryFree(entry, NULL);
+    VIR_FREE(key);
+}
+
 struct _qemuSharedDeviceEntry {
     size_t ref;
     char **domains; /* array of domain names */
@@ -172,6 +172,13 @@ struct _virQEMUDriverConfig {
 
     unsigned int maxQueuedJobs;
 
+    unsigned int statsWorkers;
+    unsigned int statsTimeout;
+    unsigned int statsCacheMaxAge;
+    unsigned int agentCacheMaxAge;
+
+    unsigned int reconnectWorkers;
+
     char **securityDriverNames;
     bool securityDefaultConfined;
     bool securityRequireConfined;
@@ -254,6 +261,15 @@ struct _virQEMUDriver {
      */
     virCapsPtr caps;
 
+    /* Require lock. Describes the host and emulators @caps was
+     * built for, see virQEMUDriverGetCapsStamp */
+    char *capsStamp;
+
+    /* Immutable pointer, require lock to access the contents.
+     * Formatted domain capabilities keyed by binary, machine,
+     * arch and virttype */
+    virHashTablePtr domCapsCache;
+
     /* Immutable pointer, Immutable object */
     virDomainXMLOptionPtr xmlopt;
 
@@ -321,9 +337,25 @@ virQEMUDriverConfigPtr virQEMUDriverGetConfig(virQEMUDriverPtr driver);
 bool virQEMUDriverIsPrivileged(virQEMUDriverPtr driver);
 
 virCapsPtr virQEMUDriverCreateCapabilities(virQEMUDriverPtr driver);
+void virQEMUDriverInvalidateCapabilities(virQEMUDriverPtr driver);
 virCapsPtr virQEMUDriverGetCapabilities(virQEMUDriverPtr driver,
                                         bool refresh);
 
+virHashTablePtr virQEMUDomainCapsCacheNew(void);
+char *virQEMUDriverGetDomainCapsCached(virQEMUDriverPtr driver,
+                                       virCapsPtr caps,
+                                       virQEMUCapsPtr qemuCaps,
+                                       const char *machine,
+                                       virArch arch,
+                                       virDomainVirtType virttype);
+void virQEMUDriverSetDomainCapsCached(virQEMUDriverPtr driver,
+                                      virCapsPtr caps,
+                                      virQEMUCapsPtr qemuCaps,
+                                      const char *machine,
+                                      virArch arch,
+                                      virDomainVirtType virttype,
+                                      const char *xml);
+
 typedef struct _qemuSharedDeviceEntry qemuSharedDeviceEntry;
 typedef qemuSharedDeviceEntry *qemuSharedDeviceEntryPtr;
 
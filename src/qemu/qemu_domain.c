@@ -107,6 +107,15 @@ VIR_ENUM_IMPL(qemuDomainAsyncJob, QEMU_ASYNC_JOB_LAST,
               "start",
 );
 
+VIR_ENUM_IMPL(qemuDomainStartPhase, QEMU_DOMAIN_START_PHASE_LAST,
+              "prepare",
+              "host",
+              "spawn",
+              "monitor",
+              "setup",
+              "finish",
+);
+
 VIR_ENUM_IMPL(qemuDomainNamespace, QEMU_DOMAIN_NS_LAST,
               "mount",
 );
@@ -1974,6 +1983,9 @@ qemuDomainObjPrivateDataClear(qemuDomainObjPrivatePtr priv)
     virBitmapFree(priv->migrationCaps);
     priv->migrationCaps = NULL;
 
+    virTypedParamsFree(priv->statsCache.params, priv->statsCache.nparams);
+    memset(&priv->statsCache, 0, sizeof(priv->statsCache));
+
     qemuDomainObjResetJob(priv);
     qemuDomainObjResetAsyncJob(priv);
 }
@@ -6883,10 +6895,12 @@ qemuDomainObjCanSetJob(qemuDomainObjPrivatePtr priv,
  * @job: qemuDomainJob to start
  * @asyncJob: qemuDomainAsyncJob to start
  * @nowait: don't wait trying to acquire @job
+ * @deadline: absolute time in milliseconds to give up waiting at,
+ *            0 for the default
  *
  * Acquires job for a domain object which must be locked before
- * calling. If there's already a job running waits up to
- * QEMU_JOB_WAIT_TIME after which the functions fails reporting
+ * calling. If there's already a job running waits until @deadline or
+ * up to QEMU_JOB_WAIT_TIME after which the functions fails reporting
  * an error unless @nowait is set.
  *
  * If @nowait is true this function tries to acquire job and if
@@ -6904,7 +6918,8 @@ qemuDomainObjBeginJobInternal(virQEMUDriverPtr driver,
                               qemuDomainJob job,
                               qemuDomainAgentJob agentJob,
                               qemuDomainAsyncJob asyncJob,
-                              bool nowait)
+                              bool nowait,
+                              unsigned long long deadline)
 {
     qemuDomainObjPrivatePtr priv = obj->privateData;
     unsigned long long now;
@@ -6935,7 +6950,7 @@ qemuDomainObjBeginJobInternal(virQEMUDriverPtr driver,
     }
 
     priv->jobs_queued++;
-    then = now + QEMU_JOB_WAIT_TIME;
+    then = deadline ? deadline : now + QEMU_JOB_WAIT_TIME;
 
  retry:
     if ((!async && job != QEMU_JOB_DESTROY) &&
@@ -7124,7 +7139,7 @@ int qemuDomainObjBeginJob(virQEMUDriverPtr driver,
 {
     if (qemuDomainObjBeginJobInternal(driver, obj, job,
                                       QEMU_AGENT_JOB_NONE,
-                                      QEMU_ASYNC_JOB_NONE, false) < 0)
+                                      QEMU_ASYNC_JOB_NONE, false, 0) < 0)
         return -1;
     else
         return 0;
@@ -7144,7 +7159,7 @@ qemuDomainObjBeginAgentJob(virQEMUDriverPtr driver,
 {
     return qemuDomainObjBeginJobInternal(driver, obj, QEMU_JOB_NONE,
                                          agentJob,
-                                         QEMU_ASYNC_JOB_NONE, false);
+                                         QEMU_ASYNC_JOB_NONE, false, 0);
 }
 
 /**
@@ -7164,7 +7179,7 @@ qemuDomainObjBeginJobWithAgent(virQEMUDriverPtr driver,
                                qemuDomainAgentJob agentJob)
 {
     return qemuDomainObjBeginJobInternal(driver, obj, job, agentJob,
-                                         QEMU_ASYNC_JOB_NONE, false);
+                                         QEMU_ASYNC_JOB_NONE, false, 0);
 }
 
 int qemuDomainObjBeginAsyncJob(virQEMUDriverPtr driver,
@@ -7177,7 +7192,7 @@ int qemuDomainObjBeginAsyncJob(virQEMUDriverPtr driver,
 
     if (qemuDomainObjBeginJobInternal(driver, obj, QEMU_JOB_ASYNC,
                                       QEMU_AGENT_JOB_NONE,
-                                      asyncJob, false) < 0)
+                                      asyncJob, false, 0) < 0)
         return -1;
 
     priv = obj->privateData;
@@ -7209,7 +7224,7 @@ qemuDomainObjBeginNestedJob(virQEMUDriverPtr driver,
                                          QEMU_JOB_ASYNC_NESTED,
                                          QEMU_AGENT_JOB_NONE,
                                          QEMU_ASYNC_JOB_NONE,
-                                         false);
+                                         false, 0);
 }
 
 /**
@@ -7232,7 +7247,33 @@ qemuDomainObjBeginJobNowait(virQEMUDriverPtr driver,
 {
     return qemuDomainObjBeginJobInternal(driver, obj, job,
                                          QEMU_AGENT_JOB_NONE,
-                                         QEMU_ASYNC_JOB_NONE, true);
+                                         QEMU_ASYNC_JOB_NONE, true, 0);
+}
+
+
+/**
+ * qemuDomainObjBeginJobDeadline:
+ *
+ * @driver: qemu driver
+ * @obj: domain object
+ * @job: qemuDomainJob to start
+ * @deadline: absolute time in milliseconds to give up waiting at
+ *
+ * Like qemuDomainObjBeginJob, but waits for a running job to finish
+ * only until @deadline instead of QEMU_JOB_WAIT_TIME.
+ *
+ * Returns: see qemuDomainObjBeginJobInternal
+ */
+int
+qemuDomainObjBeginJobDeadline(virQEMUDriverPtr driver,
+                              virDomainObjPtr obj,
+                              qemuDomainJob job,
+                              unsigned long long deadline)
+{
+    return qemuDomainObjBeginJobInternal(driver, obj, job,
+                                         QEMU_AGENT_JOB_NONE,
+                                         QEMU_ASYNC_JOB_NONE, false,
+                                         deadline);
 }
 
 /*
@@ -7257,6 +7298,9 @@ qemuDomainObjEndJob(virQEMUDriverPtr driver, virDomainObjPtr obj)
     qemuDomainObjResetJob(priv);
     if (qemuDomainTrackJob(job))
         qemuDomainObjSaveJob(driver, obj);
+    /* Anything but a query may have changed what the stats report */
+    if (job != QEMU_JOB_QUERY)
+        qemuDomainStatsCacheInvalidate(obj);
     /* We indeed need to wake up ALL threads waiting because
      * grabbing a job requires checking more variables. */
     virCondBroadcast(&priv->job.cond);
@@ -7319,6 +7363,7 @@ qemuDomainObjEndAsyncJob(virQEMUDriverPtr driver, virDomainObjPtr obj)
 
     qemuDomainObjResetAsyncJob(priv);
     qemuDomainObjSaveJob(driver, obj);
+    qemuDomainStatsCacheInvalidate(obj);
     virCondBroadcast(&priv->job.asyncCond);
 }
 
@@ -13716,3 +13761,104 @@ qemuDomainDiskIsMissingLocalOptional(virDomainDiskDefPtr disk)
            virStorageSourceIsLocalStorage(disk->src) && disk->src->path &&
            !virFileExists(disk->src->path);
 }
+
+
+/**
+ * qemuDomainStatsCacheInvalidate:
+ * @vm: domain object, locked
+ *
+ * Drops the cached statistics of @vm. To be called whenever something
+ * they report may have changed, e.g. on events from QEMU.
+ */
+void
+qemuDomainStatsCacheInvalidate(virDomainObjPtr vm)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+
+    if (!priv->statsCache.params)
+        return;
+
+    virTypedParamsFree(priv->statsCache.params, priv->statsCache.nparams);
+    memset(&priv->statsCache, 0, sizeof(priv->statsCache));
+}
+
+
+/**
+ * qemuDomainStatsCacheStore:
+ * @vm: domain object, locked
+ * @stats: stats groups @params were gathered for
+ * @flags: driver private flags @params were gathered with
+ * @params: the complete statistics
+ * @nparams: number of items in @params
+ *
+ * Remembers a copy of @params as the current statistics of @vm.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+qemuDomainStatsCacheStore(virDomainObjPtr vm,
+                          unsigned int stats,
+                          unsigned int flags,
+                          virTypedParameterPtr params,
+                          int nparams)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    virTypedParameterPtr copy = NULL;
+    unsigned long long now;
+
+    if (virTimeMillisNow(&now) < 0 ||
+        virTypedParamsCopy(&copy, params, nparams) < 0)
+        return -1;
+
+    qemuDomainStatsCacheInvalidate(vm);
+
+    priv->statsCache.params = copy;
+    priv->statsCache.nparams = nparams;
+    priv->statsCache.stats = stats;
+    priv->statsCache.flags = flags;
+    priv->statsCache.stamp = now;
+    return 0;
+}
+
+
+/**
+ * qemuDomainStatsCacheLookup:
+ * @vm: domain object, locked
+ * @stats: requested stats groups
+ * @flags: requested driver private flags
+ * @maxAge: maximum age of the cached statistics in milliseconds
+ * @params: filled with a copy of the cached statistics
+ * @nparams: filled with the number of items in @params
+ *
+ * Returns 1 if statistics gathered for the same @stats and @flags
+ * no longer than @maxAge ago were found, 0 if not, -1 on error.
+ */
+int
+qemuDomainStatsCacheLookup(virDomainObjPtr vm,
+                           unsigned int stats,
+                           unsigned int flags,
+                           unsigned long long maxAge,
+                           virTypedParameterPtr *params,
+                           int *nparams)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    qemuDomainStatsCachePtr cache = &priv->statsCache;
+    unsigned long long now;
+
+    if (!cache->params ||
+        cache->stats != stats ||
+        cache->flags != flags)
+        return 0;
+
+    if (virTimeMillisNow(&now) < 0)
+        return -1;
+
+    if (now - cache->stamp > maxAge)
+        return 0;
+
+    if (virTypedParamsCopy(params, cache->params, cache->nparams) < 0)
+        return -1;
+
+    *nparams = cache->nparams;
+    return 1;
+}
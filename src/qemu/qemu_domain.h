@@ -106,6 +106,19 @@ typedef enum {
 } qemuDomainAsyncJob;
 VIR_ENUM_DECL(qemuDomainAsyncJob)
 
+/* Phases of starting a domain whose duration is recorded */
+typedef enum {
+    QEMU_DOMAIN_START_PHASE_PREPARE = 0, /* checks, live XML preparation */
+    QEMU_DOMAIN_START_PHASE_HOST,        /* host resources, disk chains */
+    QEMU_DOMAIN_START_PHASE_SPAWN,       /* command line, fork, cgroups, labels */
+    QEMU_DOMAIN_START_PHASE_MONITOR,     /* waiting for the QMP monitor */
+    QEMU_DOMAIN_START_PHASE_SETUP,       /* QMP setup before running */
+    QEMU_DOMAIN_START_PHASE_FINISH,      /* starting CPUs, refreshing state */
+
+    QEMU_DOMAIN_START_PHASE_LAST
+} qemuDomainStartPhase;
+VIR_ENUM_DECL(qemuDomainStartPhase)
+
 typedef enum {
     QEMU_DOMAIN_JOB_STATUS_NONE = 0,
     QEMU_DOMAIN_JOB_STATUS_ACTIVE,
@@ -266,6 +279,17 @@ struct _qemuDomainSecretInfo {
     } s;
 };
 
+/* Last complete result of qemuDomainGetStats */
+typedef struct _qemuDomainStatsCache qemuDomainStatsCache;
+typedef qemuDomainStatsCache *qemuDomainStatsCachePtr;
+struct _qemuDomainStatsCache {
+    virTypedParameterPtr params;
+    int nparams;
+    unsigned int stats;         /* requested stats groups */
+    unsigned int flags;         /* driver private stats flags */
+    unsigned long long stamp;   /* time of gathering in ms */
+};
+
 typedef struct _qemuDomainObjPrivate qemuDomainObjPrivate;
 typedef qemuDomainObjPrivate *qemuDomainObjPrivatePtr;
 struct _qemuDomainObjPrivate {
@@ -373,6 +397,12 @@ struct _qemuDomainObjPrivate {
 
     /* true if global -mem-prealloc appears on cmd line */
     bool memPrealloc;
+
+    qemuDomainStatsCache statsCache;
+
+    /* milliseconds spent in each phase of the last start */
+    unsigned long long startPhaseTime[QEMU_DOMAIN_START_PHASE_LAST];
+    unsigned long long startPhaseStamp;
 };
 
 # define QEMU_DOMAIN_PRIVATE(vm) \
@@ -555,6 +585,11 @@ int qemuDomainObjBeginJobNowait(virQEMUDriverPtr driver,
                                 virDomainObjPtr obj,
                                 qemuDomainJob job)
     ATTRIBUTE_RETURN_CHECK;
+int qemuDomainObjBeginJobDeadline(virQEMUDriverPtr driver,
+                                  virDomainObjPtr obj,
+                                  qemuDomainJob job,
+                                  unsigned long long deadline)
+    ATTRIBUTE_RETURN_CHECK;
 
 void qemuDomainObjEndJob(virQEMUDriverPtr driver,
                          virDomainObjPtr obj);
@@ -1099,4 +1134,17 @@ qemuDomainIsUsingNoShutdown(qemuDomainObjPrivatePtr priv);
 bool
 qemuDomainDiskIsMissingLocalOptional(virDomainDiskDefPtr disk);
 
+void qemuDomainStatsCacheInvalidate(virDomainObjPtr vm);
+int qemuDomainStatsCacheStore(virDomainObjPtr vm,
+                              unsigned int stats,
+                              unsigned int flags,
+                              virTypedParameterPtr params,
+                              int nparams);
+int qemuDomainStatsCacheLookup(virDomainObjPtr vm,
+                               unsigned int stats,
+                               unsigned int flags,
+                               unsigned long long maxAge,
+                               virTypedParameterPtr *params,
+                               int *nparams);
+
 #endif /* LIBVIRT_QEMU_DOMAIN_H */
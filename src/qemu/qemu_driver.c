@@ -726,6 +726,9 @@ qemuStateInitialize(bool privileged,
     if (!(qemu_driver->sharedDevices = virHashCreate(30, qemuSharedDeviceEntryFree)))
         goto error;
 
+    if (!(qemu_driver->domCapsCache = virQEMUDomainCapsCacheNew()))
+        goto error;
+
     if (qemuMigrationDstErrorInit(qemu_driver) < 0)
         goto error;
 
@@ -963,6 +966,9 @@ qemuStateReload(void)
     if (!qemu_driver)
         return 0;
 
+    /* Pick up host changes on the next capabilities refresh */
+    virQEMUDriverInvalidateCapabilities(qemu_driver);
+
     if (!(caps = virQEMUDriverGetCapabilities(qemu_driver, false)))
         goto cleanup;
 
@@ -1054,7 +1060,9 @@ qemuStateCleanup(void)
     virObjectUnref(qemu_driver->config);
     virObjectUnref(qemu_driver->hostdevMgr);
     virHashFree(qemu_driver->sharedDevices);
+    virHashFree(qemu_driver->domCapsCache);
     virObjectUnref(qemu_driver->caps);
+    VIR_FREE(qemu_driver->capsStamp);
     virObjectUnref(qemu_driver->qemuCapsCache);
 
     virObjectUnref(qemu_driver->domains);
@@ -1277,7 +1285,7 @@ static char *qemuConnectGetCapabilities(virConnectPtr conn) {
     if (!(caps = virQEMUDriverGetCapabilities(driver, true)))
         goto cleanup;
 
-    xml = virCapabilitiesFormatXML(caps);
+    xml = virCapabilitiesFormatXMLCached(caps);
     virObjectUnref(caps);
 
  cleanup:
@@ -1286,6 +1294,30 @@ static char *qemuConnectGetCapabilities(virConnectPtr conn) {
 }
 
 
+static int
+qemuConnectGetCapabilitiesIfChanged(virConnectPtr conn,
+                                    unsigned long long *generation,
+                                    char **capabilities,
+                                    unsigned int flags)
+{
+    virQEMUDriverPtr driver = conn->privateData;
+    virCapsPtr caps = NULL;
+    int ret;
+
+    virCheckFlags(0, -1);
+
+    if (virConnectGetCapabilitiesIfChangedEnsureACL(conn) < 0)
+        return -1;
+
+    if (!(caps = virQEMUDriverGetCapabilities(driver, true)))
+        return -1;
+
+    ret = virCapabilitiesFormatXMLIfChanged(caps, generation, capabilities);
+    virObjectUnref(caps);
+    return ret;
+}
+
+
 static int
 qemuGetSchedInfo(unsigned long long *cpuWait,
                  pid_t pid, pid_t tid)
@@ -2737,6 +2769,7 @@ typedef enum {
      */
     QEMU_SAVE_FORMAT_XZ = 3,
     QEMU_SAVE_FORMAT_LZOP = 4,
+    QEMU_SAVE_FORMAT_ZSTD = 5,
     /* Note: add new members only at the end.
        These values are used in the on-disk format.
        Do not change or re-use numbers. */
@@ -2750,7 +2783,8 @@ VIR_ENUM_IMPL(qemuSaveCompression, QEMU_SAVE_FORMAT_LAST,
               "gzip",
               "bzip2",
               "xz",
-              "lzop")
+              "lzop",
+              "zstd")
 
 VIR_ENUM_DECL(qemuDumpFormat)
 VIR_ENUM_IMPL(qemuDumpFormat, VIR_DOMAIN_CORE_DUMP_FORMAT_LAST,
@@ -2965,6 +2999,29 @@ qemuCompressGetCommand(virQEMUSaveFormat compression)
     return ret;
 }
 
+
+/**
+ * qemuCompressGetSaveCommand:
+ * @compression: format of the image
+ * @compressedpath: path of the compression program
+ *
+ * Returns the command compressing the stream written to an image in
+ * @compression format, or NULL on error. Programs which are able to
+ * compress in parallel are told to use all host CPUs, so that
+ * compression is not limited to one core for large guests.
+ */
+static virCommandPtr
+qemuCompressGetSaveCommand(virQEMUSaveFormat compression,
+                           const char *compressedpath)
+{
+    virCommandPtr ret = virCommandNewArgList(compressedpath, "-c", NULL);
+
+    if (compression == QEMU_SAVE_FORMAT_ZSTD)
+        virCommandAddArg(ret, "-T0");
+
+    return ret;
+}
+
 /**
  * qemuOpenFile:
  * @driver: driver object
@@ -3180,6 +3237,7 @@ qemuDomainSaveMemory(virQEMUDriverPtr driver,
     int directFlag = 0;
     virFileWrapperFdPtr wrapperFd = NULL;
     unsigned int wrapperFlags = VIR_FILE_WRAPPER_NON_BLOCKING;
+    virCommandPtr compressor = NULL;
 
     /* Obtain the file handle.  */
     if ((flags & VIR_DOMAIN_SAVE_BYPASS_CACHE)) {
@@ -3207,8 +3265,13 @@ qemuDomainSaveMemory(virQEMUDriverPtr driver,
     if (virQEMUSaveDataWrite(data, fd, path) < 0)
         goto cleanup;
 
+    if (compressedpath &&
+        !(compressor = qemuCompressGetSaveCommand(data->header.compressed,
+                                                  compressedpath)))
+        goto cleanup;
+
     /* Perform the migration */
-    if (qemuMigrationSrcToFile(driver, vm, fd, compressedpath, asyncJob) < 0)
+    if (qemuMigrationSrcToFile(driver, vm, fd, compressor, asyncJob) < 0)
         goto cleanup;
 
     /* Touch up file header to mark image complete. */
@@ -3762,14 +3825,16 @@ doCoreDump(virQEMUDriverPtr driver,
     const char *memory_dump_format = NULL;
     virQEMUDriverConfigPtr cfg = virQEMUDriverGetConfig(driver);
     char *compressedpath = NULL;
+    virCommandPtr compressor = NULL;
+    int compressed;
 
     /* We reuse "save" flag for "dump" here. Then, we can support the same
      * format in "save" and "dump". This path doesn't need the compression
-     * program to exist and can ignore the return value - it only cares to
-     * get the compressedpath */
-    ignore_value(qemuGetCompressionProgram(cfg->dumpImageFormat,
+     * program to exist and falls back to raw - it only cares to get the
+     * compressedpath */
+    compressed = qemuGetCompressionProgram(cfg->dumpImageFormat,
                                            &compressedpath,
-                                           "dump", true));
+                                           "dump", true);
 
     /* Create an empty file with appropriate ownership.  */
     if (dump_flags & VIR_DUMP_BYPASS_CACHE) {
@@ -3816,7 +3881,12 @@ doCoreDump(virQEMUDriverPtr driver,
         if (!qemuMigrationSrcIsAllowed(driver, vm, false, 0))
             goto cleanup;
 
-        ret = qemuMigrationSrcToFile(driver, vm, fd, compressedpath,
+        if (compressedpath &&
+            !(compressor = qemuCompressGetSaveCommand(compressed,
+                                                      compressedpath)))
+            goto cleanup;
+
+        ret = qemuMigrationSrcToFile(driver, vm, fd, compressor,
                                      QEMU_ASYNC_JOB_DUMP);
     }
 
@@ -6596,15 +6666,18 @@ static int qemuNodeGetSecurityModel(virConnectPtr conn,
  * @driver: qemu driver data
  * @def: def of the domain from the save image
  * @newxml: user provided replacement XML
+ * @clone: @newxml describes a new domain started from the image
  *
  * Returns the new domain definition in case @newxml is ABI compatible with the
- * guest.
+ * guest. When cloning, the name and UUID may differ.
  */
 static virDomainDefPtr
 qemuDomainSaveImageUpdateDef(virQEMUDriverPtr driver,
                              virDomainDefPtr def,
-                             const char *newxml)
+                             const char *newxml,
+                             bool clone)
 {
+    unsigned int abiflags = clone ? VIR_DOMAIN_DEF_ABI_CHECK_SKIP_IDENTITY : 0;
     virDomainDefPtr ret = NULL;
     virDomainDefPtr newdef_migr = NULL;
     virDomainDefPtr newdef = NULL;
@@ -6623,7 +6696,8 @@ qemuDomainSaveImageUpdateDef(virQEMUDriverPtr driver,
                                           VIR_DOMAIN_XML_MIGRATABLE)))
         goto cleanup;
 
-    if (!virDomainDefCheckABIStability(def, newdef_migr, driver->xmlopt)) {
+    if (!virDomainDefCheckABIStabilityFlags(def, newdef_migr, driver->xmlopt,
+                                            abiflags)) {
         virErrorPtr err = virSaveLastError();
 
         /* Due to a bug in older version of external snapshot creation
@@ -6632,7 +6706,8 @@ qemuDomainSaveImageUpdateDef(virQEMUDriverPtr driver,
          * saved XML type, we need to check the ABI compatibility against
          * the user provided XML if the check against the migratable XML
          * fails. Snapshots created prior to v1.1.3 have this issue. */
-        if (!virDomainDefCheckABIStability(def, newdef, driver->xmlopt)) {
+        if (!virDomainDefCheckABIStabilityFlags(def, newdef, driver->xmlopt,
+                                                abiflags)) {
             virSetError(err);
             virFreeError(err);
             goto cleanup;
@@ -6656,6 +6731,102 @@ qemuDomainSaveImageUpdateDef(virQEMUDriverPtr driver,
 }
 
 
+/**
+ * qemuDomainSaveImageCloneDisks:
+ * @driver: qemu driver data
+ * @def: def of the domain from the save image
+ * @clonedef: def of the clone, ABI compatible with @def
+ * @overlays: list the created images are appended to
+ *
+ * The guest state in the image expects the disk contents of @def, so
+ * writable disks of the clone must not use the images of @def. Local
+ * images of the clone which do not exist yet are created as qcow2
+ * overlays backed by the corresponding image of @def, so the clone
+ * disks must either not specify a format or use qcow2.
+ *
+ * Returns 0 on success, -1 on error. Images created before a failure
+ * are still listed in @overlays.
+ */
+static int
+qemuDomainSaveImageCloneDisks(virQEMUDriverPtr driver,
+                              virDomainDefPtr def,
+                              virDomainDefPtr clonedef,
+                              char ***overlays)
+{
+    virCommandPtr cmd = NULL;
+    const char *qemuImgPath = NULL;
+    size_t i;
+    int ret = -1;
+
+    for (i = 0; i < clonedef->ndisks; i++) {
+        virStorageSourcePtr src = def->disks[i]->src;
+        virStorageSourcePtr clonesrc = clonedef->disks[i]->src;
+
+        if (clonesrc->readonly || clonesrc->shared ||
+            virStorageSourceIsEmpty(clonesrc))
+            continue;
+
+        if (virStorageSourceIsSameLocation(src, clonesrc)) {
+            virReportError(VIR_ERR_CONFIG_UNSUPPORTED,
+                           _("writable disk '%s' of the clone must not use "
+                             "the image of the saved domain"),
+                           clonedef->disks[i]->dst);
+            goto cleanup;
+        }
+
+        if (virStorageSourceGetActualType(src) != VIR_STORAGE_TYPE_FILE ||
+            virStorageSourceGetActualType(clonesrc) != VIR_STORAGE_TYPE_FILE ||
+            virFileExists(clonesrc->path))
+            continue;
+
+        if (clonesrc->format > VIR_STORAGE_FILE_NONE &&
+            clonesrc->format != VIR_STORAGE_FILE_QCOW2) {
+            virReportError(VIR_ERR_CONFIG_UNSUPPORTED,
+                           _("disk '%s' of the clone must use the qcow2 "
+                             "format to be created as overlay, not '%s'"),
+                           clonedef->disks[i]->dst,
+                           virStorageFileFormatTypeToString(clonesrc->format));
+            goto cleanup;
+        }
+
+        if (!qemuImgPath &&
+            !(qemuImgPath = qemuFindQemuImgBinary(driver)))
+            goto cleanup;
+
+        cmd = virCommandNewArgList(qemuImgPath, "create", "-f", "qcow2",
+                                   "-o", NULL);
+        if (src->format > VIR_STORAGE_FILE_NONE)
+            virCommandAddArgFormat(cmd, "backing_file=%s,backing_fmt=%s",
+                                   src->path,
+                                   virStorageFileFormatTypeToString(src->format));
+        else
+            virCommandAddArgFormat(cmd, "backing_file=%s", src->path);
+        virCommandAddArg(cmd, clonesrc->path);
+
+        if (virCommandRun(cmd, NULL) < 0)
+            goto cleanup;
+
+        virCommandFree(cmd);
+        cmd = NULL;
+
+        if (virStringListAdd(overlays, clonesrc->path) < 0) {
+            if (unlink(clonesrc->path) < 0)
+                VIR_WARN("Failed to remove clone image '%s'", clonesrc->path);
+            goto cleanup;
+        }
+
+        if (clonesrc->format <= VIR_STORAGE_FILE_NONE)
+            clonesrc->format = VIR_STORAGE_FILE_QCOW2;
+    }
+
+    ret = 0;
+
+ cleanup:
+    virCommandFree(cmd);
+    return ret;
+}
+
+
 /**
  * qemuDomainSaveImageOpen:
  * @driver: qemu driver data
@@ -6972,10 +7143,14 @@ qemuDomainRestoreFlags(virConnectPtr conn,
     virQEMUSaveDataPtr data = NULL;
     virFileWrapperFdPtr wrapperFd = NULL;
     bool hook_taint = false;
+    bool clone = (flags & VIR_DOMAIN_SAVE_CLONE) != 0;
+    char **overlays = NULL;
+    size_t i;
 
     virCheckFlags(VIR_DOMAIN_SAVE_BYPASS_CACHE |
                   VIR_DOMAIN_SAVE_RUNNING |
-                  VIR_DOMAIN_SAVE_PAUSED, -1);
+                  VIR_DOMAIN_SAVE_PAUSED |
+                  VIR_DOMAIN_SAVE_CLONE, -1);
 
 
     virNWFilterReadLockFilterUpdates();
@@ -7009,9 +7184,16 @@ qemuDomainRestoreFlags(virConnectPtr conn,
 
     if (newxml) {
         virDomainDefPtr tmp;
-        if (!(tmp = qemuDomainSaveImageUpdateDef(driver, def, newxml)))
+        if (!(tmp = qemuDomainSaveImageUpdateDef(driver, def, newxml, clone)))
             goto cleanup;
 
+        if (clone &&
+            (virDomainRestoreFlagsEnsureACL(conn, tmp) < 0 ||
+             qemuDomainSaveImageCloneDisks(driver, def, tmp, &overlays) < 0)) {
+            virDomainDefFree(tmp);
+            goto cleanup;
+        }
+
         virDomainDefFree(def);
         def = tmp;
     }
@@ -7053,6 +7235,11 @@ qemuDomainRestoreFlags(virConnectPtr conn,
     virFileWrapperFdFree(wrapperFd);
     if (vm && ret < 0)
         qemuDomainRemoveInactiveJob(driver, vm);
+    for (i = 0; ret < 0 && overlays && overlays[i]; i++) {
+        if (unlink(overlays[i]) < 0)
+            VIR_WARN("Failed to remove clone image '%s'", overlays[i]);
+    }
+    virStringListFree(overlays);
     virDomainObjEndAPI(&vm);
     virNWFilterUnlockFilterUpdates();
     return ret;
@@ -7135,7 +7322,7 @@ qemuDomainSaveImageDefineXML(virConnectPtr conn, const char *path,
     if (state >= 0)
         data->header.was_running = state;
 
-    if (!(newdef = qemuDomainSaveImageUpdateDef(driver, def, dxml)))
+    if (!(newdef = qemuDomainSaveImageUpdateDef(driver, def, dxml, false)))
         goto cleanup;
 
     VIR_FREE(data->xml);
@@ -7287,7 +7474,7 @@ qemuDomainObjRestore(virConnectPtr conn,
 
             VIR_DEBUG("Using hook-filtered domain XML: %s", xmlout);
 
-            if (!(tmp = qemuDomainSaveImageUpdateDef(driver, def, xmlout)))
+            if (!(tmp = qemuDomainSaveImageUpdateDef(driver, def, xmlout, false)))
                 goto cleanup;
 
             virDomainDefFree(def);
@@ -7880,6 +8067,7 @@ qemuDomainAttachDeviceLive(virDomainObjPtr vm,
                            virDomainDeviceDefPtr dev,
                            virQEMUDriverPtr driver)
 {
+    qemuDomainObjPrivatePtr priv = vm->privateData;
     int ret = -1;
     const char *alias = NULL;
 
@@ -8024,6 +8212,10 @@ qemuDomainAttachDeviceLive(virDomainObjPtr vm,
         virObjectEventStateQueue(driver->domainEventState, event);
     }
 
+    /* the guest sees new hardware, so agent queries need a refresh */
+    if (ret == 0 && priv->agent)
+        qemuAgentInvalidateCache(priv->agent);
+
     if (ret == 0)
         ret = qemuDomainUpdateDeviceList(driver, vm, QEMU_ASYNC_JOB_NONE);
 
@@ -19936,6 +20128,10 @@ qemuConnectGetDomainCapabilities(virConnectPtr conn,
     if (!qemuCaps)
         goto cleanup;
 
+    if ((ret = virQEMUDriverGetDomainCapsCached(driver, caps, qemuCaps,
+                                                machine, arch, virttype)))
+        goto cleanup;
+
     if (!(domCaps = virDomainCapsNew(virQEMUCapsGetBinary(qemuCaps), machine,
                                      arch, virttype)))
         goto cleanup;
@@ -19944,7 +20140,9 @@ qemuConnectGetDomainCapabilities(virConnectPtr conn,
                                   cfg->firmwares, cfg->nfirmwares) < 0)
         goto cleanup;
 
-    ret = virDomainCapsFormat(domCaps);
+    if ((ret = virDomainCapsFormat(domCaps)))
+        virQEMUDriverSetDomainCapsCached(driver, caps, qemuCaps,
+                                         machine, arch, virttype, ret);
  cleanup:
     virObjectUnref(cfg);
     virObjectUnref(caps);
@@ -21144,6 +21342,13 @@ qemuDomainGetStats(virConnectPtr conn,
         }
     }
 
+    /* Flag records lacking the stats which need the monitor because the
+     * job couldn't be acquired (in time) */
+    if (qemuDomainGetStatsNeedMonitor(stats) && !HAVE_JOB(flags) &&
+        virTypedParamsAddBoolean(&tmp->params, &tmp->nparams, &maxparams,
+                                 "partial", true) < 0)
+        goto cleanup;
+
     if (!(tmp->dom = virGetDomain(conn, dom->def->name,
                                   dom->def->uuid, dom->def->id)))
         goto cleanup;
@@ -21162,6 +21367,125 @@ qemuDomainGetStats(virConnectPtr conn,
 }
 
 
+static int
+qemuDomainGetStatsCached(virConnectPtr conn,
+                         virDomainObjPtr dom,
+                         unsigned int stats,
+                         unsigned int flags,
+                         unsigned long long maxAge,
+                         virDomainStatsRecordPtr *record)
+{
+    virDomainStatsRecordPtr tmp;
+    int ret;
+
+    if (VIR_ALLOC(tmp) < 0)
+        return -1;
+
+    if ((ret = qemuDomainStatsCacheLookup(dom, stats, flags, maxAge,
+                                          &tmp->params, &tmp->nparams)) <= 0)
+        goto cleanup;
+
+    if (!(tmp->dom = virGetDomain(conn, dom->def->name,
+                                  dom->def->uuid, dom->def->id))) {
+        ret = -1;
+        goto cleanup;
+    }
+
+    *record = tmp;
+    tmp = NULL;
+
+ cleanup:
+    if (tmp) {
+        virTypedParamsFree(tmp->params, tmp->nparams);
+        VIR_FREE(tmp);
+    }
+
+    return ret;
+}
+
+
+struct qemuConnectGetAllDomainStatsData {
+    virConnectPtr conn;
+    virDomainObjPtr *vms;
+    virDomainStatsRecordPtr *records;
+    virErrorPtr *errors;
+    unsigned int stats;
+    unsigned int flags;
+    unsigned int privflags;
+    unsigned long long deadline;
+    unsigned long long cacheMaxAge;
+};
+
+
+/* Runs in a worker thread, one call per domain */
+static void
+qemuConnectGetAllDomainStatsWorker(size_t idx,
+                                   void *opaque)
+{
+    struct qemuConnectGetAllDomainStatsData *data = opaque;
+    virQEMUDriverPtr driver = data->conn->privateData;
+    virDomainObjPtr vm = data->vms[idx];
+    unsigned int domflags = 0;
+    int rc;
+
+    if (data->flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_BACKING)
+        domflags |= QEMU_DOMAIN_STATS_BACKING;
+
+    virObjectLock(vm);
+
+    if (data->cacheMaxAge &&
+        (data->flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_CACHED)) {
+        if ((rc = qemuDomainGetStatsCached(data->conn, vm, data->stats,
+                                           domflags, data->cacheMaxAge,
+                                           &data->records[idx])) < 0) {
+            data->errors[idx] = virSaveLastError();
+            virResetLastError();
+        }
+
+        if (rc != 0) {
+            virObjectUnlock(vm);
+            return;
+        }
+    }
+
+    if (HAVE_JOB(data->privflags)) {
+        int rv;
+
+        if (data->flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT)
+            rv = qemuDomainObjBeginJobNowait(driver, vm, QEMU_JOB_QUERY);
+        else
+            rv = qemuDomainObjBeginJobDeadline(driver, vm, QEMU_JOB_QUERY,
+                                               data->deadline);
+
+        if (rv == 0)
+            domflags |= QEMU_DOMAIN_STATS_HAVE_JOB;
+        else
+            virResetLastError();
+    }
+    /* else: without a job it's still possible to gather some data */
+
+    if (qemuDomainGetStats(data->conn, vm, data->stats,
+                           &data->records[idx], domflags) < 0) {
+        data->errors[idx] = virSaveLastError();
+        virResetLastError();
+    } else if (data->cacheMaxAge &&
+               HAVE_JOB(domflags) == HAVE_JOB(data->privflags)) {
+        /* Only complete records are worth serving to others */
+        virDomainStatsRecordPtr record = data->records[idx];
+
+        if (qemuDomainStatsCacheStore(vm, data->stats,
+                                      domflags & ~QEMU_DOMAIN_STATS_HAVE_JOB,
+                                      record->params, record->nparams) < 0)
+            virResetLastError();
+    }
+
+    if (HAVE_JOB(domflags))
+        qemuDomainObjEndJob(driver, vm);
+
+    virObjectUnlock(vm);
+}
+
+
 static int
 qemuConnectGetAllDomainStats(virConnectPtr conn,
                              virDomainPtr *doms,
@@ -21171,17 +21495,18 @@ qemuConnectGetAllDomainStats(virConnectPtr conn,
                              unsigned int flags)
 {
     virQEMUDriverPtr driver = conn->privateData;
+    virQEMUDriverConfigPtr cfg = NULL;
+    struct qemuConnectGetAllDomainStatsData data = { 0 };
     virErrorPtr orig_err = NULL;
     virDomainObjPtr *vms = NULL;
-    virDomainObjPtr vm;
-    size_t nvms;
+    size_t nvms = 0;
     virDomainStatsRecordPtr *tmpstats = NULL;
+    virErrorPtr *errors = NULL;
     bool enforce = !!(flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_ENFORCE_STATS);
     int nstats = 0;
     size_t i;
     int ret = -1;
     unsigned int privflags = 0;
-    unsigned int domflags = 0;
     unsigned int lflags = flags & (VIR_CONNECT_LIST_DOMAINS_FILTERS_ACTIVE |
                                    VIR_CONNECT_LIST_DOMAINS_FILTERS_PERSISTENT |
                                    VIR_CONNECT_LIST_DOMAINS_FILTERS_STATE);
@@ -21189,6 +21514,7 @@ qemuConnectGetAllDomainStats(virConnectPtr conn,
     virCheckFlags(VIR_CONNECT_LIST_DOMAINS_FILTERS_ACTIVE |
                   VIR_CONNECT_LIST_DOMAINS_FILTERS_PERSISTENT |
                   VIR_CONNECT_LIST_DOMAINS_FILTERS_STATE |
+                  VIR_CONNECT_GET_ALL_DOMAINS_STATS_CACHED |
                   VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT |
                   VIR_CONNECT_GET_ALL_DOMAINS_STATS_BACKING |
                   VIR_CONNECT_GET_ALL_DOMAINS_STATS_ENFORCE_STATS, -1);
@@ -21211,49 +21537,48 @@ qemuConnectGetAllDomainStats(virConnectPtr conn,
             return -1;
     }
 
-    if (VIR_ALLOC_N(tmpstats, nvms + 1) < 0)
+    cfg = virQEMUDriverGetConfig(driver);
+
+    if (VIR_ALLOC_N(tmpstats, nvms + 1) < 0 ||
+        VIR_ALLOC_N(errors, nvms) < 0)
         goto cleanup;
 
     if (qemuDomainGetStatsNeedMonitor(stats))
         privflags |= QEMU_DOMAIN_STATS_HAVE_JOB;
 
-    for (i = 0; i < nvms; i++) {
-        virDomainStatsRecordPtr tmp = NULL;
-        domflags = 0;
-        vm = vms[i];
-
-        virObjectLock(vm);
-
-        if (HAVE_JOB(privflags)) {
-            int rv;
+    if (cfg->statsTimeout) {
+        if (virTimeMillisNow(&data.deadline) < 0)
+            goto cleanup;
+        data.deadline += cfg->statsTimeout;
+    }
 
-            if (flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT)
-                rv = qemuDomainObjBeginJobNowait(driver, vm, QEMU_JOB_QUERY);
-            else
-                rv = qemuDomainObjBeginJob(driver, vm, QEMU_JOB_QUERY);
+    data.conn = conn;
+    data.vms = vms;
+    data.records = tmpstats;
+    data.errors = errors;
+    data.stats = stats;
+    data.flags = flags;
+    data.privflags = privflags;
+    data.cacheMaxAge = cfg->statsCacheMaxAge;
 
-            if (rv == 0)
-                domflags |= QEMU_DOMAIN_STATS_HAVE_JOB;
-        }
-        /* else: without a job it's still possible to gather some data */
+    /* A slow or busy monitor of one domain must not hold up the others */
+    virThreadPoolRunBatch(MIN(nvms, cfg->statsWorkers), nvms,
+                          qemuConnectGetAllDomainStatsWorker, &data);
 
-        if (flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_BACKING)
-            domflags |= QEMU_DOMAIN_STATS_BACKING;
-        if (qemuDomainGetStats(conn, vm, stats, &tmp, domflags) < 0) {
-            if (HAVE_JOB(domflags) && vm)
-                qemuDomainObjEndJob(driver, vm);
-
-            virObjectUnlock(vm);
-            goto cleanup;
-        }
+    /* Keep the records in the order of the domain list */
+    for (i = 0; i < nvms; i++) {
+        virDomainStatsRecordPtr tmp = tmpstats[i];
 
+        tmpstats[i] = NULL;
         if (tmp)
             tmpstats[nstats++] = tmp;
+    }
 
-        if (HAVE_JOB(domflags))
-            qemuDomainObjEndJob(driver, vm);
-
-        virObjectUnlock(vm);
+    for (i = 0; i < nvms; i++) {
+        if (errors[i]) {
+            virSetError(errors[i]);
+            goto cleanup;
+        }
     }
 
     *retStats = tmpstats;
@@ -21264,7 +21589,11 @@ qemuConnectGetAllDomainStats(virConnectPtr conn,
  cleanup:
     virErrorPreserveLast(&orig_err);
     virDomainStatsRecordListFree(tmpstats);
+    for (i = 0; errors && i < nvms; i++)
+        virFreeError(errors[i]);
+    VIR_FREE(errors);
     virObjectListFreeCount(vms, nvms);
+    virObjectUnref(cfg);
     virErrorRestore(&orig_err);
 
     return ret;
@@ -22377,6 +22706,7 @@ static virHypervisorDriver qemuHypervisorDriver = {
     .connectGetMaxVcpus = qemuConnectGetMaxVcpus, /* 0.2.1 */
     .nodeGetInfo = qemuNodeGetInfo, /* 0.2.0 */
     .connectGetCapabilities = qemuConnectGetCapabilities, /* 0.2.1 */
+    .connectGetCapabilitiesIfChanged = qemuConnectGetCapabilitiesIfChanged, /* 5.1.0 */
     .connectListDomains = qemuConnectListDomains, /* 0.2.0 */
     .connectNumOfDomains = qemuConnectNumOfDomains, /* 0.2.0 */
     .connectListAllDomains = qemuConnectListAllDomains, /* 0.9.13 */
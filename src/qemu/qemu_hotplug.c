@@ -5056,6 +5056,7 @@ qemuDomainRemoveDevice(virQEMUDriverPtr driver,
                        virDomainObjPtr vm,
                        virDomainDeviceDefPtr dev)
 {
+    qemuDomainObjPrivatePtr priv = vm->privateData;
     int ret = -1;
     switch ((virDomainDeviceType)dev->type) {
     case VIR_DOMAIN_DEVICE_DISK:
@@ -5121,6 +5122,11 @@ qemuDomainRemoveDevice(virQEMUDriverPtr driver,
                        virDomainDeviceTypeToString(dev->type));
         break;
     }
+
+    /* the guest lost hardware, so agent queries need a refresh */
+    if (ret == 0 && priv->agent)
+        qemuAgentInvalidateCache(priv->agent);
+
     return ret;
 }
 
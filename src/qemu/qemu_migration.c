@@ -5200,17 +5200,18 @@ qemuMigrationDstFinish(virQEMUDriverPtr driver,
 }
 
 
-/* Helper function called while vm is active.  */
+/* Helper function called while vm is active. The stream is piped
+ * through @compressor, if given, which is consumed.  */
 int
 qemuMigrationSrcToFile(virQEMUDriverPtr driver, virDomainObjPtr vm,
                        int fd,
-                       const char *compressor,
+                       virCommandPtr compressor,
                        qemuDomainAsyncJob asyncJob)
 {
     qemuDomainObjPrivatePtr priv = vm->privateData;
     int rc;
     int ret = -1;
-    virCommandPtr cmd = NULL;
+    virCommandPtr cmd = compressor;
     int pipeFD[2] = { -1, -1 };
     unsigned long saveMigBandwidth = priv->migMaxBandwidth;
     char *errbuf = NULL;
@@ -5223,20 +5224,19 @@ qemuMigrationSrcToFile(virQEMUDriverPtr driver, virDomainObjPtr vm,
                                      QEMU_DOMAIN_MIG_BANDWIDTH_MAX);
         priv->migMaxBandwidth = QEMU_DOMAIN_MIG_BANDWIDTH_MAX;
         if (qemuDomainObjExitMonitor(driver, vm) < 0)
-            return -1;
+            goto cleanup;
     }
 
     if (!virDomainObjIsActive(vm)) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                        _("guest unexpectedly quit"));
-        /* nothing to tear down */
-        return -1;
+        goto cleanup;
     }
 
-    if (compressor && pipe(pipeFD) < 0) {
+    if (cmd && pipe(pipeFD) < 0) {
         virReportSystemError(errno, "%s",
                              _("Failed to create pipe for migration"));
-        return -1;
+        goto cleanup;
     }
 
     /* All right! We can use fd migration, which means that qemu
@@ -5244,25 +5244,17 @@ qemuMigrationSrcToFile(virQEMUDriverPtr driver, virDomainObjPtr vm,
      * grant SELinux access, we can do it on fd and avoid cleanup
      * later, as well as skip futzing with cgroup.  */
     if (qemuSecuritySetImageFDLabel(driver->securityManager, vm->def,
-                                    compressor ? pipeFD[1] : fd) < 0)
+                                    cmd ? pipeFD[1] : fd) < 0)
         goto cleanup;
 
     if (qemuDomainObjEnterMonitorAsync(driver, vm, asyncJob) < 0)
         goto cleanup;
 
-    if (!compressor) {
+    if (!cmd) {
         rc = qemuMonitorMigrateToFd(priv->mon,
                                     QEMU_MONITOR_MIGRATE_BACKGROUND,
                                     fd);
     } else {
-        const char *prog = compressor;
-        const char *args[] = {
-            prog,
-            "-c",
-            NULL
-        };
-
-        cmd = virCommandNewArgs(args);
         virCommandSetInputFD(cmd, pipeFD[0]);
         virCommandSetOutputFD(cmd, &fd);
         virCommandSetErrorBuffer(cmd, &errbuf);
@@ -430,6 +430,11 @@ qemuMonitorIOProcess(qemuMonitorPtr mon)
     if (mon->msg && mon->msg->txOffset == mon->msg->txLength)
         msg = mon->msg;
 
+    /* Replies to a batch are matched by id, so the first ones may be
+     * consumed while the tail of the batch is still being written */
+    if (mon->msg && mon->msg->nrxObjects)
+        msg = mon->msg;
+
 #if DEBUG_IO
 # if DEBUG_RAW_IO
     char *str1 = qemuMonitorEscapeNonPrintable(msg ? msg->txBuffer : "");
@@ -3850,6 +3855,58 @@ qemuMonitorGetObjectProps(qemuMonitorPtr mon,
 }
 
 
+/**
+ * qemuMonitorGetDevicePropsBatch:
+ * @mon: monitor object
+ * @devices: device types to query
+ * @ndevices: number of entries in @devices
+ * @props: filled with a property list per device type
+ * @nprops: filled with the length of each list in @props
+ *
+ * Like qemuMonitorGetDeviceProps, but sends all the queries to the
+ * monitor at once instead of waiting for each reply in turn. Both
+ * @props and @nprops must have room for @ndevices entries. Unknown
+ * device types yield an empty list.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+qemuMonitorGetDevicePropsBatch(qemuMonitorPtr mon,
+                               const char **devices,
+                               size_t ndevices,
+                               char ***props,
+                               int *nprops)
+{
+    VIR_DEBUG("ndevices=%zu props=%p", ndevices, props);
+
+    QEMU_CHECK_MONITOR(mon);
+
+    return qemuMonitorJSONGetDevicePropsBatch(mon, devices, ndevices,
+                                              props, nprops);
+}
+
+
+/**
+ * qemuMonitorGetObjectPropsBatch:
+ *
+ * Like qemuMonitorGetDevicePropsBatch, for QOM object types.
+ */
+int
+qemuMonitorGetObjectPropsBatch(qemuMonitorPtr mon,
+                               const char **objects,
+                               size_t nobjects,
+                               char ***props,
+                               int *nprops)
+{
+    VIR_DEBUG("nobjects=%zu props=%p", nobjects, props);
+
+    QEMU_CHECK_MONITOR(mon);
+
+    return qemuMonitorJSONGetObjectPropsBatch(mon, objects, nobjects,
+                                              props, nprops);
+}
+
+
 char *
 qemuMonitorGetTargetArch(qemuMonitorPtr mon)
 {
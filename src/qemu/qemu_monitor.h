@@ -57,6 +57,12 @@ struct _qemuMonitorMessage {
     int rxLength;
     /* Used by the JSON monitor to hold reply / error */
     void *rxObject;
+    /* Used by the JSON monitor when several commands are written in
+     * one go: the reply carrying rxIds[i] is stored in rxObjects[i] */
+    size_t nrxObjects;
+    size_t nrxReceived;
+    void **rxObjects;
+    char **rxIds;
 
     /* True if rxBuffer / rxObject are ready, or a
      * fatal error occurred on the monitor channel
@@ -1091,6 +1097,16 @@ int qemuMonitorGetDeviceProps(qemuMonitorPtr mon,
 int qemuMonitorGetObjectProps(qemuMonitorPtr mon,
                               const char *object,
                               char ***props);
+int qemuMonitorGetDevicePropsBatch(qemuMonitorPtr mon,
+                                   const char **devices,
+                                   size_t ndevices,
+                                   char ***props,
+                                   int *nprops);
+int qemuMonitorGetObjectPropsBatch(qemuMonitorPtr mon,
+                                   const char **objects,
+                                   size_t nobjects,
+                                   char ***props,
+                                   int *nprops);
 char *qemuMonitorGetTargetArch(qemuMonitorPtr mon);
 
 int qemuMonitorNBDServerStart(qemuMonitorPtr mon,
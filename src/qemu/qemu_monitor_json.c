@@ -185,6 +185,38 @@ qemuMonitorJSONIOProcessEvent(qemuMonitorPtr mon,
     return 0;
 }
 
+static int
+qemuMonitorJSONIOProcessBatchReply(qemuMonitorMessagePtr msg,
+                                   virJSONValuePtr obj,
+                                   const char *line)
+{
+    const char *id = virJSONValueObjectGetString(obj, "id");
+    size_t i;
+
+    /* QEMU answers in order and only omits the id when it could not
+     * parse the command at all, so such a reply belongs to the oldest
+     * command still waiting for one */
+    for (i = 0; i < msg->nrxObjects; i++) {
+        if (msg->rxObjects[i])
+            continue;
+        if (!id || STREQ_NULLABLE(msg->rxIds[i], id))
+            break;
+    }
+
+    if (i == msg->nrxObjects) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Unexpected JSON reply '%s'"), line);
+        return -1;
+    }
+
+    msg->rxObjects[i] = obj;
+    if (++msg->nrxReceived == msg->nrxObjects)
+        msg->finished = 1;
+
+    return 0;
+}
+
+
 int
 qemuMonitorJSONIOProcessLine(qemuMonitorPtr mon,
                              const char *line,
@@ -214,7 +246,10 @@ qemuMonitorJSONIOProcessLine(qemuMonitorPtr mon,
                virJSONValueObjectHasKey(obj, "return") == 1) {
         PROBE(QEMU_MONITOR_RECV_REPLY,
               "mon=%p reply=%s", mon, line);
-        if (msg) {
+        if (msg && msg->nrxObjects) {
+            if ((ret = qemuMonitorJSONIOProcessBatchReply(msg, obj, line)) == 0)
+                obj = NULL;
+        } else if (msg) {
             msg->rxObject = obj;
             msg->finished = 1;
             obj = NULL;
@@ -269,6 +304,54 @@ int qemuMonitorJSONIOProcess(qemuMonitorPtr mon,
     return used;
 }
 
+static int
+qemuMonitorJSONFormatCommandMember(const char *key,
+                                   virJSONValuePtr value,
+                                   void *opaque)
+{
+    virJSONWriterPtr writer = opaque;
+
+    virJSONWriterKey(writer, key);
+    virJSONWriterValue(writer, value);
+    return 0;
+}
+
+
+/*
+ * Formats @cmd followed by the line terminator into @buf. If @id is
+ * given it is written as the last member of the command, so that @cmd
+ * does not have to be modified to carry it.
+ */
+static int
+qemuMonitorJSONFormatCommand(virJSONValuePtr cmd,
+                             const char *id,
+                             virBufferPtr buf)
+{
+    virJSONWriter writer;
+
+    virJSONWriterInit(&writer, buf);
+
+    if (id) {
+        virJSONWriterObjectStart(&writer);
+        if (virJSONValueObjectForeachKeyValue(cmd,
+                                              qemuMonitorJSONFormatCommandMember,
+                                              &writer) < 0)
+            return -1;
+        virJSONWriterKey(&writer, "id");
+        virJSONWriterString(&writer, id);
+        virJSONWriterObjectEnd(&writer);
+    } else {
+        virJSONWriterValue(&writer, cmd);
+    }
+
+    if (virJSONWriterCheckError(&writer) < 0)
+        return -1;
+
+    virBufferAddLit(buf, "\r\n");
+    return 0;
+}
+
+
 static int
 qemuMonitorJSONCommandWithFd(qemuMonitorPtr mon,
                              virJSONValuePtr cmd,
@@ -277,31 +360,26 @@ qemuMonitorJSONCommandWithFd(qemuMonitorPtr mon,
 {
     int ret = -1;
     qemuMonitorMessage msg;
-    char *cmdstr = NULL;
+    virBuffer buf = VIR_BUFFER_INITIALIZER;
     char *id = NULL;
 
     *reply = NULL;
 
     memset(&msg, 0, sizeof(msg));
 
-    if (virJSONValueObjectHasKey(cmd, "execute") == 1) {
-        if (!(id = qemuMonitorNextCommandID(mon)))
-            goto cleanup;
-        if (virJSONValueObjectAppendString(cmd, "id", id) < 0) {
-            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                           _("Unable to append command 'id' string"));
-            goto cleanup;
-        }
-    }
-
-    if (!(cmdstr = virJSONValueToString(cmd, false)))
+    if (virJSONValueObjectHasKey(cmd, "execute") == 1 &&
+        !(id = qemuMonitorNextCommandID(mon)))
         goto cleanup;
-    if (virAsprintf(&msg.txBuffer, "%s\r\n", cmdstr) < 0)
+
+    /* format straight into the transmit buffer */
+    if (qemuMonitorJSONFormatCommand(cmd, id, &buf) < 0)
         goto cleanup;
-    msg.txLength = strlen(msg.txBuffer);
+    msg.txLength = virBufferUse(&buf);
+    msg.txBuffer = virBufferContentAndReset(&buf);
     msg.txFD = scm_fd;
 
-    VIR_DEBUG("Send command '%s' for write with FD %d", cmdstr, scm_fd);
+    VIR_DEBUG("Send command '%.*s' for write with FD %d",
+              msg.txLength - 2, msg.txBuffer, scm_fd);
 
     ret = qemuMonitorSend(mon, &msg);
 
@@ -321,7 +399,7 @@ qemuMonitorJSONCommandWithFd(qemuMonitorPtr mon,
 
  cleanup:
     VIR_FREE(id);
-    VIR_FREE(cmdstr);
+    virBufferFreeAndReset(&buf);
     VIR_FREE(msg.txBuffer);
 
     return ret;
@@ -336,6 +414,96 @@ qemuMonitorJSONCommand(qemuMonitorPtr mon,
     return qemuMonitorJSONCommandWithFd(mon, cmd, -1, reply);
 }
 
+
+/**
+ * qemuMonitorJSONCommandBatch:
+ * @mon: monitor object
+ * @cmds: commands to execute
+ * @ncmds: number of entries in @cmds
+ * @replies: filled with the reply to each command
+ *
+ * Write all of @cmds to the monitor back to back and wait for all of
+ * their replies, instead of paying a round trip per command. The
+ * commands must not depend on each other's outcome. QEMU still executes
+ * them in order, and a command failing does not stop the ones after it;
+ * callers must check each reply. @replies must have room for @ncmds
+ * entries which the caller frees.
+ *
+ * Returns 0 once every reply was received, -1 on error (in which case
+ * @replies is cleared).
+ */
+int
+qemuMonitorJSONCommandBatch(qemuMonitorPtr mon,
+                            virJSONValuePtr *cmds,
+                            size_t ncmds,
+                            virJSONValuePtr *replies)
+{
+    int ret = -1;
+    qemuMonitorMessage msg;
+    virBuffer buf = VIR_BUFFER_INITIALIZER;
+    size_t i;
+
+    memset(&msg, 0, sizeof(msg));
+    memset(replies, 0, sizeof(*replies) * ncmds);
+
+    if (ncmds == 0)
+        return 0;
+
+    if (VIR_ALLOC_N(msg.rxIds, ncmds) < 0 ||
+        VIR_ALLOC_N(msg.rxObjects, ncmds) < 0)
+        goto cleanup;
+    msg.nrxObjects = ncmds;
+
+    for (i = 0; i < ncmds; i++) {
+        if (virJSONValueObjectHasKey(cmds[i], "execute") != 1) {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("Batched monitor command is missing 'execute'"));
+            goto cleanup;
+        }
+
+        if (!(msg.rxIds[i] = qemuMonitorNextCommandID(mon)) ||
+            qemuMonitorJSONFormatCommand(cmds[i], msg.rxIds[i], &buf) < 0)
+            goto cleanup;
+    }
+
+    if (virBufferCheckError(&buf) < 0)
+        goto cleanup;
+    msg.txLength = virBufferUse(&buf);
+    msg.txBuffer = virBufferContentAndReset(&buf);
+    msg.txFD = -1;
+
+    VIR_DEBUG("Send batch of %zu commands '%.*s'",
+              ncmds, msg.txLength - 2, msg.txBuffer);
+
+    if (qemuMonitorSend(mon, &msg) < 0)
+        goto cleanup;
+
+    VIR_DEBUG("Received %zu of %zu replies", msg.nrxReceived, ncmds);
+
+    if (msg.nrxReceived != ncmds) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Missing monitor reply object"));
+        goto cleanup;
+    }
+
+    for (i = 0; i < ncmds; i++)
+        VIR_STEAL_PTR(replies[i], msg.rxObjects[i]);
+
+    ret = 0;
+
+ cleanup:
+    for (i = 0; i < msg.nrxObjects; i++) {
+        virJSONValueFree(msg.rxObjects[i]);
+        VIR_FREE(msg.rxIds[i]);
+    }
+    VIR_FREE(msg.rxObjects);
+    VIR_FREE(msg.rxIds);
+    virBufferFreeAndReset(&buf);
+    VIR_FREE(msg.txBuffer);
+
+    return ret;
+}
+
 /* Ignoring OOM in this method, since we're already reporting
  * a more important error
  *
@@ -6345,6 +6513,91 @@ qemuMonitorJSONGetObjectProps(qemuMonitorPtr mon,
 }
 
 
+static int
+qemuMonitorJSONGetPropsBatch(qemuMonitorPtr mon,
+                             const char *cmdname,
+                             const char **types,
+                             size_t ntypes,
+                             char ***props,
+                             int *nprops)
+{
+    int ret = -1;
+    virJSONValuePtr *cmds = NULL;
+    virJSONValuePtr *replies = NULL;
+    size_t i;
+
+    for (i = 0; i < ntypes; i++) {
+        props[i] = NULL;
+        nprops[i] = 0;
+    }
+
+    if (VIR_ALLOC_N(cmds, ntypes) < 0 ||
+        VIR_ALLOC_N(replies, ntypes) < 0)
+        goto cleanup;
+
+    for (i = 0; i < ntypes; i++) {
+        if (!(cmds[i] = qemuMonitorJSONMakeCommand(cmdname,
+                                                   "s:typename", types[i],
+                                                   NULL)))
+            goto cleanup;
+    }
+
+    if (qemuMonitorJSONCommandBatch(mon, cmds, ntypes, replies) < 0)
+        goto cleanup;
+
+    for (i = 0; i < ntypes; i++) {
+        if (qemuMonitorJSONHasError(replies[i], "DeviceNotFound"))
+            continue;
+
+        if ((nprops[i] = qemuMonitorJSONParsePropsList(cmds[i], replies[i],
+                                                       &props[i])) < 0)
+            goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    for (i = 0; i < ntypes; i++) {
+        if (ret < 0) {
+            virStringListFree(props[i]);
+            props[i] = NULL;
+            nprops[i] = 0;
+        }
+        if (cmds)
+            virJSONValueFree(cmds[i]);
+        if (replies)
+            virJSONValueFree(replies[i]);
+    }
+    VIR_FREE(cmds);
+    VIR_FREE(replies);
+    return ret;
+}
+
+
+int
+qemuMonitorJSONGetDevicePropsBatch(qemuMonitorPtr mon,
+                                   const char **devices,
+                                   size_t ndevices,
+                                   char ***props,
+                                   int *nprops)
+{
+    return qemuMonitorJSONGetPropsBatch(mon, "device-list-properties",
+                                        devices, ndevices, props, nprops);
+}
+
+
+int
+qemuMonitorJSONGetObjectPropsBatch(qemuMonitorPtr mon,
+                                   const char **objects,
+                                   size_t nobjects,
+                                   char ***props,
+                                   int *nprops)
+{
+    return qemuMonitorJSONGetPropsBatch(mon, "qom-list-properties",
+                                        objects, nobjects, props, nprops);
+}
+
+
 char *
 qemuMonitorJSONGetTargetArch(qemuMonitorPtr mon)
 {
@@ -42,6 +42,12 @@ int qemuMonitorJSONIOProcess(qemuMonitorPtr mon,
                              size_t len,
                              qemuMonitorMessagePtr msg);
 
+int qemuMonitorJSONCommandBatch(qemuMonitorPtr mon,
+                                virJSONValuePtr *cmds,
+                                size_t ncmds,
+                                virJSONValuePtr *replies)
+    ATTRIBUTE_NONNULL(2) ATTRIBUTE_NONNULL(4);
+
 int qemuMonitorJSONHumanCommandWithFd(qemuMonitorPtr mon,
                                       const char *cmd,
                                       int scm_fd,
@@ -457,6 +463,18 @@ int qemuMonitorJSONGetObjectProps(qemuMonitorPtr mon,
                                   const char *object,
                                   char ***props)
     ATTRIBUTE_NONNULL(2) ATTRIBUTE_NONNULL(3);
+int qemuMonitorJSONGetDevicePropsBatch(qemuMonitorPtr mon,
+                                       const char **devices,
+                                       size_t ndevices,
+                                       char ***props,
+                                       int *nprops)
+    ATTRIBUTE_NONNULL(2) ATTRIBUTE_NONNULL(4) ATTRIBUTE_NONNULL(5);
+int qemuMonitorJSONGetObjectPropsBatch(qemuMonitorPtr mon,
+                                       const char **objects,
+                                       size_t nobjects,
+                                       char ***props,
+                                       int *nprops)
+    ATTRIBUTE_NONNULL(2) ATTRIBUTE_NONNULL(4) ATTRIBUTE_NONNULL(5);
 char *qemuMonitorJSONGetTargetArch(qemuMonitorPtr mon);
 
 int qemuMonitorJSONNBDServerStart(qemuMonitorPtr mon,
@@ -73,6 +73,7 @@
 #include "virnetdevmidonet.h"
 #include "virbitmap.h"
 #include "viratomic.h"
+#include "virthreadpool.h"
 #include "virnuma.h"
 #include "virstring.h"
 #include "virhostdev.h"
@@ -88,6 +89,9 @@
 
 VIR_LOG_INIT("qemu.qemu_process");
 
+/* Upper bound on disks whose backing chain is probed concurrently */
+#define QEMU_PROCESS_PREPARE_STORAGE_WORKERS 8
+
 /**
  * qemuProcessRemoveDomainStatus
  *
@@ -261,8 +265,14 @@ qemuConnectAgent(virQEMUDriverPtr driver, virDomainObjPtr vm)
     }
 
     priv->agent = agent;
-    if (!priv->agent)
+    if (!priv->agent) {
         VIR_INFO("Failed to connect agent for %s", vm->def->name);
+    } else {
+        virQEMUDriverConfigPtr cfg = virQEMUDriverGetConfig(driver);
+
+        qemuAgentSetCacheMaxAge(priv->agent, cfg->agentCacheMaxAge);
+        virObjectUnref(cfg);
+    }
 
  cleanup:
     if (!priv->agent) {
@@ -577,6 +587,7 @@ qemuProcessHandleShutdown(qemuMonitorPtr mon ATTRIBUTE_UNUSED,
     VIR_DEBUG("vm=%p", vm);
 
     virObjectLock(vm);
+    qemuDomainStatsCacheInvalidate(vm);
 
     priv = vm->privateData;
     if (virDomainObjGetState(vm, NULL) == VIR_DOMAIN_SHUTDOWN) {
@@ -646,6 +657,7 @@ qemuProcessHandleStop(qemuMonitorPtr mon ATTRIBUTE_UNUSED,
     virQEMUDriverConfigPtr cfg = virQEMUDriverGetConfig(driver);
 
     virObjectLock(vm);
+    qemuDomainStatsCacheInvalidate(vm);
     if (virDomainObjGetState(vm, NULL) == VIR_DOMAIN_RUNNING) {
         qemuDomainObjPrivatePtr priv = vm->privateData;
 
@@ -706,6 +718,7 @@ qemuProcessHandleResume(qemuMonitorPtr mon ATTRIBUTE_UNUSED,
     virDomainEventResumedDetailType eventDetail;
 
     virObjectLock(vm);
+    qemuDomainStatsCacheInvalidate(vm);
 
     priv = vm->privateData;
     if (priv->runningReason != VIR_DOMAIN_RUNNING_UNKNOWN) {
@@ -863,6 +876,7 @@ qemuProcessHandleIOError(qemuMonitorPtr mon ATTRIBUTE_UNUSED,
     virQEMUDriverConfigPtr cfg = virQEMUDriverGetConfig(driver);
 
     virObjectLock(vm);
+    qemuDomainStatsCacheInvalidate(vm);
 
     if (*diskAlias == '\0')
         diskAlias = NULL;
@@ -931,6 +945,7 @@ qemuProcessHandleBlockJob(qemuMonitorPtr mon ATTRIBUTE_UNUSED,
     char *data = NULL;
 
     virObjectLock(vm);
+    qemuDomainStatsCacheInvalidate(vm);
 
     VIR_DEBUG("Block job for device %s (domain: %p,%s) type %d status %d",
               diskAlias, vm, vm->def->name, type, status);
@@ -1074,6 +1089,7 @@ qemuProcessHandleTrayChange(qemuMonitorPtr mon ATTRIBUTE_UNUSED,
     virQEMUDriverConfigPtr cfg = virQEMUDriverGetConfig(driver);
 
     virObjectLock(vm);
+    qemuDomainStatsCacheInvalidate(vm);
     disk = qemuProcessFindDomainDiskByAliasOrQOM(vm, devAlias, devid);
 
     if (disk) {
@@ -1109,6 +1125,7 @@ qemuProcessHandlePMWakeup(qemuMonitorPtr mon ATTRIBUTE_UNUSED,
     virQEMUDriverConfigPtr cfg = virQEMUDriverGetConfig(driver);
 
     virObjectLock(vm);
+    qemuDomainStatsCacheInvalidate(vm);
     event = virDomainEventPMWakeupNewFromObj(vm);
 
     /* Don't set domain status back to running if it wasn't paused
@@ -1148,6 +1165,7 @@ qemuProcessHandlePMSuspend(qemuMonitorPtr mon ATTRIBUTE_UNUSED,
     virQEMUDriverConfigPtr cfg = virQEMUDriverGetConfig(driver);
 
     virObjectLock(vm);
+    qemuDomainStatsCacheInvalidate(vm);
     event = virDomainEventPMSuspendNewFromObj(vm);
 
     if (virDomainObjGetState(vm, NULL) == VIR_DOMAIN_RUNNING) {
@@ -1190,6 +1208,7 @@ qemuProcessHandleBalloonChange(qemuMonitorPtr mon ATTRIBUTE_UNUSED,
     virQEMUDriverConfigPtr cfg = virQEMUDriverGetConfig(driver);
 
     virObjectLock(vm);
+    qemuDomainStatsCacheInvalidate(vm);
     event = virDomainEventBalloonChangeNewFromObj(vm, actual);
 
     VIR_DEBUG("Updating balloon from %lld to %lld kb",
@@ -1217,6 +1236,7 @@ qemuProcessHandlePMSuspendDisk(qemuMonitorPtr mon ATTRIBUTE_UNUSED,
     virQEMUDriverConfigPtr cfg = virQEMUDriverGetConfig(driver);
 
     virObjectLock(vm);
+    qemuDomainStatsCacheInvalidate(vm);
     event = virDomainEventPMSuspendDiskNewFromObj(vm);
 
     if (virDomainObjGetState(vm, NULL) == VIR_DOMAIN_RUNNING) {
@@ -1260,6 +1280,7 @@ qemuProcessHandleGuestPanic(qemuMonitorPtr mon ATTRIBUTE_UNUSED,
     struct qemuProcessEvent *processEvent;
 
     virObjectLock(vm);
+    qemuDomainStatsCacheInvalidate(vm);
     if (VIR_ALLOC(processEvent) < 0)
         goto cleanup;
 
@@ -1296,6 +1317,7 @@ qemuProcessHandleDeviceDeleted(qemuMonitorPtr mon ATTRIBUTE_UNUSED,
     char *data;
 
     virObjectLock(vm);
+    qemuDomainStatsCacheInvalidate(vm);
 
     VIR_DEBUG("Device %s removed from domain %p %s",
               devAlias, vm, vm->def->name);
@@ -1412,6 +1434,7 @@ qemuProcessHandleBlockThreshold(qemuMonitorPtr mon ATTRIBUTE_UNUSED,
     const char *path = NULL;
 
     virObjectLock(vm);
+    qemuDomainStatsCacheInvalidate(vm);
 
     VIR_DEBUG("BLOCK_WRITE_THRESHOLD event for block node '%s' in domain %p %s:"
               "threshold '%llu' exceeded by '%llu'",
@@ -2667,6 +2690,7 @@ qemuProcessResctrlCreate(virQEMUDriverPtr driver,
 
     /* Force capability refresh since resctrl info can change
      * XXX: move cache info into virresctrl so caps are not needed */
+    virQEMUDriverInvalidateCapabilities(driver);
     caps = virQEMUDriverGetCapabilities(driver, true);
     if (!caps)
         return -1;
@@ -5306,6 +5330,72 @@ qemuProcessStartValidate(virQEMUDriverPtr driver,
 }
 
 
+/**
+ * qemuProcessStartPhaseDone:
+ * @vm: domain object
+ * @phase: phase of the start which just finished
+ *
+ * Record the time elapsed since the previous phase finished (or since
+ * qemuProcessInit) as the duration of @phase.
+ */
+static void
+qemuProcessStartPhaseDone(virDomainObjPtr vm,
+                          qemuDomainStartPhase phase)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    unsigned long long now;
+
+    if (virTimeMillisNow(&now) < 0) {
+        virResetLastError();
+        return;
+    }
+
+    if (priv->startPhaseStamp)
+        priv->startPhaseTime[phase] = now - priv->startPhaseStamp;
+    priv->startPhaseStamp = now;
+
+    VIR_DEBUG("vm=%p name=%s phase=%s took %llu ms",
+              vm, vm->def->name, qemuDomainStartPhaseTypeToString(phase),
+              priv->startPhaseTime[phase]);
+}
+
+
+/* Append the phase durations of the last start to the domain log */
+static void
+qemuProcessStartPhaseLog(virQEMUDriverPtr driver,
+                         virDomainObjPtr vm)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    virBuffer buf = VIR_BUFFER_INITIALIZER;
+    unsigned long long total = 0;
+    char *timestamp = NULL;
+    size_t i;
+
+    for (i = 0; i < QEMU_DOMAIN_START_PHASE_LAST; i++) {
+        virBufferAsprintf(&buf, " %s=%llu",
+                          qemuDomainStartPhaseTypeToString(i),
+                          priv->startPhaseTime[i]);
+        total += priv->startPhaseTime[i];
+    }
+
+    if (virBufferCheckError(&buf) < 0 ||
+        !(timestamp = virTimeStringNow())) {
+        virResetLastError();
+        goto cleanup;
+    }
+
+    VIR_INFO("Domain %s started in %llu ms:%s",
+             vm->def->name, total, virBufferCurrentContent(&buf));
+    qemuDomainLogAppendMessage(driver, vm, "%s: started in %llu ms:%s\n",
+                               timestamp, total,
+                               virBufferCurrentContent(&buf));
+
+ cleanup:
+    virBufferFreeAndReset(&buf);
+    VIR_FREE(timestamp);
+}
+
+
 /**
  * qemuProcessInit:
  *
@@ -5343,6 +5433,12 @@ qemuProcessInit(virQEMUDriverPtr driver,
         goto cleanup;
     }
 
+    memset(priv->startPhaseTime, 0, sizeof(priv->startPhaseTime));
+    if (virTimeMillisNow(&priv->startPhaseStamp) < 0) {
+        priv->startPhaseStamp = 0;
+        virResetLastError();
+    }
+
     if (!(caps = virQEMUDriverGetCapabilities(driver, false)))
         goto cleanup;
 
@@ -6152,45 +6248,104 @@ qemuProcessPrepareSEVGuestInput(virDomainObjPtr vm)
 }
 
 
+struct qemuProcessPrepareHostStorageData {
+    virQEMUDriverPtr driver;
+    virDomainObjPtr vm;
+    bool cold_boot;
+    bool blockdev;
+    bool *failed;
+    virErrorPtr *errors;
+};
+
+
+static void
+qemuProcessPrepareHostStorageWorker(size_t idx,
+                                    void *opaque)
+{
+    struct qemuProcessPrepareHostStorageData *data = opaque;
+    virDomainDiskDefPtr disk = data->vm->def->disks[idx];
+
+    if (virStorageSourceIsEmpty(disk->src))
+        return;
+
+    /* backing chain needs to be redetected if we aren't using blockdev */
+    if (!data->blockdev)
+        virStorageSourceBackingStoreClear(disk->src);
+
+    /*
+     * Go to applying startup policy for optional disk with nonexistent
+     * source file immediately as determining chain will surely fail
+     * and we don't want noisy error notice in logs for this case.
+     */
+    if (qemuDomainDiskIsMissingLocalOptional(disk) && data->cold_boot) {
+        VIR_INFO("optional disk '%s' source file is missing, "
+                 "skip checking disk chain", disk->dst);
+        data->failed[idx] = true;
+        return;
+    }
+
+    if (qemuDomainDetermineDiskChain(data->driver, data->vm, disk, true) >= 0)
+        return;
+
+    data->failed[idx] = true;
+    data->errors[idx] = virSaveLastError();
+    virResetLastError();
+}
+
+
 static int
 qemuProcessPrepareHostStorage(virQEMUDriverPtr driver,
                               virDomainObjPtr vm,
                               unsigned int flags)
 {
     qemuDomainObjPrivatePtr priv = vm->privateData;
+    struct qemuProcessPrepareHostStorageData data = {
+        .driver = driver,
+        .vm = vm,
+        .cold_boot = flags & VIR_QEMU_PROCESS_START_COLD,
+        .blockdev = virQEMUCapsGet(priv->qemuCaps, QEMU_CAPS_BLOCKDEV),
+    };
+    size_t ndisks = vm->def->ndisks;
+    size_t workers = QEMU_PROCESS_PREPARE_STORAGE_WORKERS;
     size_t i;
-    bool cold_boot = flags & VIR_QEMU_PROCESS_START_COLD;
-    bool blockdev = virQEMUCapsGet(priv->qemuCaps, QEMU_CAPS_BLOCKDEV);
+    int ret = -1;
 
-    for (i = vm->def->ndisks; i > 0; i--) {
-        size_t idx = i - 1;
-        virDomainDiskDefPtr disk = vm->def->disks[idx];
+    if (VIR_ALLOC_N(data.failed, ndisks) < 0 ||
+        VIR_ALLOC_N(data.errors, ndisks) < 0)
+        goto cleanup;
 
-        if (virStorageSourceIsEmpty(disk->src))
-            continue;
+    /* Probing the backing chains is I/O bound and every disk has its own
+     * chain, so look at the disks concurrently. With blockdev node names
+     * are allocated while doing so and must not depend on timing. */
+    if (data.blockdev)
+        workers = 1;
 
-        /* backing chain needs to be redetected if we aren't using blockdev */
-        if (!blockdev)
-            virStorageSourceBackingStoreClear(disk->src);
+    virThreadPoolRunBatch(workers, ndisks,
+                          qemuProcessPrepareHostStorageWorker, &data);
 
-        /*
-         * Go to applying startup policy for optional disk with nonexistent
-         * source file immediately as determining chain will surely fail
-         * and we don't want noisy error notice in logs for this case.
-         */
-        if (qemuDomainDiskIsMissingLocalOptional(disk) && cold_boot)
-            VIR_INFO("optional disk '%s' source file is missing, "
-                     "skip checking disk chain", disk->dst);
-        else if (qemuDomainDetermineDiskChain(driver, vm, disk, true) >= 0)
-            continue;
+    /* Startup policy may drop disks, so go from the last one */
+    for (i = ndisks; i > 0; i--) {
+        size_t idx = i - 1;
 
-        if (qemuDomainCheckDiskStartupPolicy(driver, vm, idx, cold_boot) >= 0)
+        if (!data.failed[idx])
             continue;
 
-        return -1;
+        if (data.errors[idx])
+            virSetError(data.errors[idx]);
+
+        if (qemuDomainCheckDiskStartupPolicy(driver, vm, idx,
+                                             data.cold_boot) < 0)
+            goto cleanup;
     }
 
-    return 0;
+    ret = 0;
+
+ cleanup:
+    for (i = 0; data.errors && i < ndisks; i++)
+        virFreeError(data.errors[i]);
+    VIR_FREE(data.errors);
+    VIR_FREE(data.failed);
+    return ret;
 }
 
 
@@ -6661,6 +6816,7 @@ qemuProcessLaunch(virConnectPtr conn,
     if (virCommandHandshakeNotify(cmd) < 0)
         goto cleanup;
     VIR_DEBUG("Handshake complete, child running");
+    qemuProcessStartPhaseDone(vm, QEMU_DOMAIN_START_PHASE_SPAWN);
 
     if (rv == -1) /* The VM failed to start; tear filters before taps */
         virDomainConfVMNWFilterTeardown(vm);
@@ -6674,6 +6830,7 @@ qemuProcessLaunch(virConnectPtr conn,
 
     if (qemuConnectAgent(driver, vm) < 0)
         goto cleanup;
+    qemuProcessStartPhaseDone(vm, QEMU_DOMAIN_START_PHASE_MONITOR);
 
     VIR_DEBUG("Verifying and updating provided guest CPU");
     if (qemuProcessUpdateAndVerifyCPU(driver, vm, asyncJob) < 0)
@@ -6749,6 +6906,8 @@ qemuProcessLaunch(virConnectPtr conn,
         qemuProcessAutoDestroyAdd(driver, vm, conn) < 0)
         goto cleanup;
 
+    qemuProcessStartPhaseDone(vm, QEMU_DOMAIN_START_PHASE_SETUP);
+
     ret = 0;
 
  cleanup:
@@ -6894,9 +7053,11 @@ qemuProcessStart(virConnectPtr conn,
 
     if (qemuProcessPrepareDomain(driver, vm, flags) < 0)
         goto stop;
+    qemuProcessStartPhaseDone(vm, QEMU_DOMAIN_START_PHASE_PREPARE);
 
     if (qemuProcessPrepareHost(driver, vm, flags) < 0)
         goto stop;
+    qemuProcessStartPhaseDone(vm, QEMU_DOMAIN_START_PHASE_HOST);
 
     if ((rv = qemuProcessLaunch(conn, driver, vm, asyncJob, incoming,
                                 snapshot, vmop, flags)) < 0) {
@@ -6929,6 +7090,9 @@ qemuProcessStart(virConnectPtr conn,
             goto stop;
     }
 
+    qemuProcessStartPhaseDone(vm, QEMU_DOMAIN_START_PHASE_FINISH);
+    qemuProcessStartPhaseLog(driver, vm);
+
     ret = 0;
 
  cleanup:
@@ -7821,15 +7985,18 @@ struct qemuProcessReconnectData {
     virQEMUDriverPtr driver;
     virDomainObjPtr obj;
     virIdentityPtr identity;
+    qemuDomainJobObj oldjob;
+    bool jobStarted;
 };
 /*
  * Open an existing VM's monitor, re-detect VCPU threads
  * and re-reserve the security labels in use
  *
- * This function also inherits a locked and ref'd domain object.
+ * This function also inherits a locked and ref'd domain object, with
+ * the job already entered by qemuProcessReconnectHelper unless
+ * data->jobStarted is false.
  *
  * This function needs to:
- * 1. Enter job
  * 1. just before monitor reconnect do lightweight MonitorEnter
  *    (increase VM refcount and unlock VM)
  * 2. reconnect to monitor
@@ -7853,28 +8020,29 @@ qemuProcessReconnect(void *opaque)
     virQEMUDriverConfigPtr cfg;
     size_t i;
     unsigned int stopFlags = 0;
-    bool jobStarted = false;
+    bool jobStarted;
     virCapsPtr caps = NULL;
     bool retry = true;
     bool tryMonReconn = false;
 
     virIdentitySetCurrent(data->identity);
     virObjectUnref(data->identity);
+    oldjob = data->oldjob;
+    jobStarted = data->jobStarted;
     VIR_FREE(data);
 
-    qemuDomainObjRestoreJob(obj, &oldjob);
     if (oldjob.asyncJob == QEMU_ASYNC_JOB_MIGRATION_IN)
         stopFlags |= VIR_QEMU_PROCESS_STOP_MIGRATED;
 
     cfg = virQEMUDriverGetConfig(driver);
     priv = obj->privateData;
 
-    if (!(caps = virQEMUDriverGetCapabilities(driver, false)))
+    /* The helper could not enter the job */
+    if (!jobStarted)
         goto error;
 
-    if (qemuDomainObjBeginJob(driver, obj, QEMU_JOB_MODIFY) < 0)
+    if (!(caps = virQEMUDriverGetCapabilities(driver, false)))
         goto error;
-    jobStarted = true;
 
     /* XXX If we ever gonna change pid file pattern, come up with
      * some intelligence here to deal with old paths. */
@@ -8128,12 +8296,28 @@ qemuProcessReconnect(void *opaque)
     goto cleanup;
 }
 
+struct qemuProcessReconnectList {
+    virQEMUDriverPtr driver;
+    struct qemuProcessReconnectData **data;
+    size_t ndata;
+    int done;
+    unsigned long long started;
+};
+
+
+static void
+qemuProcessReconnectListFree(struct qemuProcessReconnectList *list)
+{
+    VIR_FREE(list->data);
+    VIR_FREE(list);
+}
+
+
 static int
 qemuProcessReconnectHelper(virDomainObjPtr obj,
                            void *opaque)
 {
-    virThread thread;
-    struct qemuProcessReconnectData *src = opaque;
+    struct qemuProcessReconnectList *list = opaque;
     struct qemuProcessReconnectData *data;
 
     /* If the VM was inactive, we don't need to reconnect */
@@ -8143,32 +8327,33 @@ qemuProcessReconnectHelper(virDomainObjPtr obj,
     if (VIR_ALLOC(data) < 0)
         return -1;
 
-    memcpy(data, src, sizeof(*data));
-    data->obj = obj;
+    data->driver = list->driver;
     data->identity = virIdentityGetCurrent();
 
-    virNWFilterReadLockFilterUpdates();
-
-    /* this lock and reference will be eventually transferred to the thread
+    /* this reference will be eventually transferred to the worker
      * that handles the reconnect */
     virObjectLock(obj);
-    virObjectRef(obj);
-
-    if (virThreadCreate(&thread, false, qemuProcessReconnect, data) < 0) {
-        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                       _("Could not create thread. QEMU initialization "
-                         "might be incomplete"));
-        /* We can't spawn a thread and thus connect to monitor. Kill qemu.
-         * It's safe to call qemuProcessStop without a job here since there
-         * is no thread that could be doing anything else with the same domain
-         * object.
-         */
-        qemuProcessStop(src->driver, obj, VIR_DOMAIN_SHUTOFF_FAILED,
+    data->obj = virObjectRef(obj);
+
+    /* Enter the job right away so that nobody can use the domain before
+     * its monitor is back, but don't keep the domain locked while it
+     * waits for a worker: APIs which don't need a job, and listing
+     * domains, keep working meanwhile. */
+    qemuDomainObjRestoreJob(obj, &data->oldjob);
+    if (qemuDomainObjBeginJob(list->driver, obj, QEMU_JOB_MODIFY) == 0)
+        data->jobStarted = true;
+
+    virObjectUnlock(obj);
+
+    if (VIR_APPEND_ELEMENT(list->data, list->ndata, data) < 0) {
+        /* We can't reconnect to the monitor. Kill qemu. */
+        virObjectLock(obj);
+        qemuProcessStop(list->driver, obj, VIR_DOMAIN_SHUTOFF_FAILED,
                         QEMU_ASYNC_JOB_NONE, 0);
-        qemuDomainRemoveInactiveJobLocked(src->driver, obj);
-
+        if (data->jobStarted)
+            qemuDomainObjEndJob(list->driver, obj);
+        qemuDomainRemoveInactiveJobLocked(list->driver, obj);
         virDomainObjEndAPI(&obj);
-        virNWFilterUnlockFilterUpdates();
         virObjectUnref(data->identity);
         VIR_FREE(data);
         return -1;
@@ -8177,15 +8362,108 @@ qemuProcessReconnectHelper(virDomainObjPtr obj,
     return 0;
 }
 
+
+/* Domains which were in the middle of a job when the daemon stopped
+ * go first, their recovery is what other API calls wait for. */
+static int
+qemuProcessReconnectCompare(const void *a,
+                            const void *b)
+{
+    const struct qemuProcessReconnectData *da = *(void * const *)a;
+    const struct qemuProcessReconnectData *db = *(void * const *)b;
+    bool busyA = da->oldjob.active != QEMU_JOB_NONE ||
+                 da->oldjob.asyncJob != QEMU_ASYNC_JOB_NONE;
+    bool busyB = db->oldjob.active != QEMU_JOB_NONE ||
+                 db->oldjob.asyncJob != QEMU_ASYNC_JOB_NONE;
+
+    if (busyA != busyB)
+        return busyA ? -1 : 1;
+
+    return strcmp(da->obj->def->name, db->obj->def->name);
+}
+
+
+static void
+qemuProcessReconnectWorker(size_t idx,
+                           void *opaque)
+{
+    struct qemuProcessReconnectList *list = opaque;
+    struct qemuProcessReconnectData *data = list->data[idx];
+    size_t done;
+
+    VIR_DEBUG("Reconnecting to domain %s (%zu/%zu)",
+              data->obj->def->name, idx + 1, list->ndata);
+
+    /* qemuProcessReconnect releases both the lock and the filter
+     * updates lock when it's done */
+    virNWFilterReadLockFilterUpdates();
+    virObjectLock(data->obj);
+
+    qemuProcessReconnect(data);
+
+    done = virAtomicIntInc(&list->done);
+    if (done == list->ndata || done % MAX(list->ndata / 10, 1) == 0) {
+        unsigned long long now;
+
+        if (virTimeMillisNow(&now) < 0)
+            now = list->started;
+
+        VIR_INFO("Reconnected to %zu of %zu domains in %llu ms",
+                 done, list->ndata, now - list->started);
+    }
+}
+
+
+static void
+qemuProcessReconnectRun(void *opaque)
+{
+    struct qemuProcessReconnectList *list = opaque;
+    virQEMUDriverConfigPtr cfg = virQEMUDriverGetConfig(list->driver);
+
+    virThreadPoolRunBatch(cfg->reconnectWorkers, list->ndata,
+                          qemuProcessReconnectWorker, list);
+
+    virObjectUnref(cfg);
+    qemuProcessReconnectListFree(list);
+}
+
+
 /**
  * qemuProcessReconnectAll
  *
  * Try to re-open the resources for live VMs that we care
- * about.
+ * about. This only enters a job for every running domain and returns,
+ * the reconnects themselves run in the background on a bounded number
+ * of threads.
  */
 void
 qemuProcessReconnectAll(virQEMUDriverPtr driver)
 {
-    struct qemuProcessReconnectData data = {.driver = driver};
-    virDomainObjListForEach(driver->domains, qemuProcessReconnectHelper, &data);
+    struct qemuProcessReconnectList *list;
+    virThread thread;
+
+    if (VIR_ALLOC(list) < 0)
+        return;
+
+    list->driver = driver;
+    if (virTimeMillisNow(&list->started) < 0)
+        list->started = 0;
+
+    virDomainObjListForEach(driver->domains, qemuProcessReconnectHelper, list);
+
+    if (list->ndata == 0) {
+        qemuProcessReconnectListFree(list);
+        return;
+    }
+
+    qsort(list->data, list->ndata, sizeof(*list->data),
+          qemuProcessReconnectCompare);
+
+    VIR_DEBUG("Reconnecting to %zu domains", list->ndata);
+
+    if (virThreadCreate(&thread, false, qemuProcessReconnectRun, list) < 0) {
+        VIR_WARN("Could not create reconnect thread, reconnecting "
+                 "to domains synchronously");
+        qemuProcessReconnectRun(list);
+    }
 }
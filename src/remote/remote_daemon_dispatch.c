@@ -3452,6 +3452,75 @@ remoteDispatchDomainGetBlockIoTune(virNetServerPtr server ATTRIBUTE_UNUSED,
     return rv;
 }
 
+/*-------------------------------------------------------------*/
+
+static int
+remoteDispatchConnectSetCompression(virNetServerPtr server ATTRIBUTE_UNUSED,
+                                    virNetServerClientPtr client,
+                                    virNetMessagePtr msg ATTRIBUTE_UNUSED,
+                                    virNetMessageErrorPtr rerr,
+                                    remote_connect_set_compression_args *args)
+{
+    int rv = -1;
+
+    if (virNetServerClientSetCompression(client, args->compression,
+                                         args->threshold) < 0)
+        goto cleanup;
+
+    rv = 0;
+
+ cleanup:
+    if (rv < 0)
+        virNetMessageSaveError(rerr);
+    return rv;
+}
+
+
+static int
+remoteDispatchConnectGetCapabilitiesIfChanged(virNetServerPtr server ATTRIBUTE_UNUSED,
+                                              virNetServerClientPtr client,
+                                              virNetMessagePtr msg ATTRIBUTE_UNUSED,
+                                              virNetMessageErrorPtr rerr,
+                                              remote_connect_get_capabilities_if_changed_args *args,
+                                              remote_connect_get_capabilities_if_changed_ret *ret)
+{
+    int rv = -1;
+    int changed;
+    unsigned long long generation = args->generation;
+    char *capabilities = NULL;
+    struct daemonClientPrivate *priv =
+        virNetServerClientGetPrivateData(client);
+
+    if (!priv->conn) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s", _("connection not open"));
+        goto cleanup;
+    }
+
+    if ((changed = virConnectGetCapabilitiesIfChanged(priv->conn, &generation,
+                                                      &capabilities,
+                                                      args->flags)) < 0)
+        goto cleanup;
+
+    if (changed) {
+        if (VIR_ALLOC(ret->capabilities) < 0)
+            goto cleanup;
+        *ret->capabilities = capabilities;
+        capabilities = NULL;
+    }
+
+    ret->changed = changed;
+    ret->generation = generation;
+
+    rv = 0;
+
+ cleanup:
+    if (rv < 0)
+        virNetMessageSaveError(rerr);
+    VIR_FREE(capabilities);
+    return rv;
+}
+
+
 /*-------------------------------------------------------------*/
 
 static int
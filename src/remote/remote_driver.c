@@ -100,6 +100,9 @@ struct private_data {
     virConnectCloseCallbackDataPtr closeCallback;
 };
 
+/* Replies smaller than this are not worth compressing */
+#define REMOTE_COMPRESS_THRESHOLD_DEFAULT 4096
+
 enum {
     REMOTE_CALL_QEMU              = (1 << 0),
     REMOTE_CALL_LXC               = (1 << 1),
@@ -745,6 +748,50 @@ static char *remoteGetUNIXSocketRoot(unsigned int flags)
     return sockname;
 }
 
+/*
+ * Find out whether the server supports event filtering and close
+ * callbacks. Both probes are sent in a single round trip, a failure
+ * of either just means the feature is treated as unsupported.
+ */
+static void
+remoteConnectProbeFeatures(struct private_data *priv)
+{
+    remote_connect_supports_feature_args args[] = {
+        { VIR_DRV_FEATURE_REMOTE_EVENT_CALLBACK },
+        { VIR_DRV_FEATURE_REMOTE_CLOSE_CALLBACK },
+    };
+    remote_connect_supports_feature_ret ret[ARRAY_CARDINALITY(args)];
+    virNetClientProgramCallData calls[ARRAY_CARDINALITY(args)];
+    int counter = priv->counter;
+    size_t i;
+
+    memset(ret, 0, sizeof(ret));
+    memset(calls, 0, sizeof(calls));
+    for (i = 0; i < ARRAY_CARDINALITY(args); i++) {
+        calls[i].proc = REMOTE_PROC_CONNECT_SUPPORTS_FEATURE;
+        calls[i].args_filter = (xdrproc_t)xdr_remote_connect_supports_feature_args;
+        calls[i].args = &args[i];
+        calls[i].ret_filter = (xdrproc_t)xdr_remote_connect_supports_feature_ret;
+        calls[i].ret = &ret[i];
+    }
+
+    priv->counter += ARRAY_CARDINALITY(calls);
+    priv->localUses++;
+    remoteDriverUnlock(priv);
+    if (virNetClientProgramCallBatch(priv->remoteProgram, priv->client,
+                                     counter, calls,
+                                     ARRAY_CARDINALITY(calls)) < 0)
+        virResetLastError();
+    remoteDriverLock(priv);
+    priv->localUses--;
+
+    for (i = 0; i < ARRAY_CARDINALITY(calls); i++)
+        virFreeError(calls[i].error);
+
+    priv->serverEventFilter = calls[0].result == 0 && ret[0].supported;
+    priv->serverCloseCallback = calls[1].result == 0 && ret[1].supported;
+}
+
 /*
  * URIs that this driver needs to handle:
  *
@@ -855,6 +902,9 @@ doRemoteOpen(virConnectPtr conn,
     char *pkipath = NULL, *keyfile = NULL, *sshauth = NULL;
 
     char *knownHostsVerify = NULL,  *knownHosts = NULL;
+    char *compress = NULL, *compressThreshold = NULL;
+    int compression = VIR_NET_MESSAGE_COMPRESSION_NONE;
+    unsigned int threshold = REMOTE_COMPRESS_THRESHOLD_DEFAULT;
 
     /* Return code from this function, and the private data. */
     int retcode = VIR_DRV_OPEN_ERROR;
@@ -900,6 +950,8 @@ doRemoteOpen(virConnectPtr conn,
             EXTRACT_URI_ARG_STR("known_hosts", knownHosts);
             EXTRACT_URI_ARG_STR("known_hosts_verify", knownHostsVerify);
             EXTRACT_URI_ARG_STR("tls_priority", tls_priority);
+            EXTRACT_URI_ARG_STR("compress", compress);
+            EXTRACT_URI_ARG_STR("compress_threshold", compressThreshold);
 
             EXTRACT_URI_ARG_BOOL("no_sanity", sanity);
             EXTRACT_URI_ARG_BOOL("no_verify", verify);
@@ -947,6 +999,29 @@ doRemoteOpen(virConnectPtr conn,
 
     VIR_DEBUG("proceeding with name = %s", name);
 
+    if (compress) {
+        if ((compression = virNetMessageCompressionTypeFromString(compress)) < 0) {
+            virReportError(VIR_ERR_INVALID_ARG,
+                           _("unknown compression algorithm '%s'"), compress);
+            goto failed;
+        }
+
+        if (!virNetMessageCompressionIsSupported(compression)) {
+            virReportError(VIR_ERR_OPERATION_UNSUPPORTED,
+                           _("compression algorithm '%s' is not supported "
+                             "by this build"), compress);
+            goto failed;
+        }
+    }
+
+    if (compressThreshold &&
+        virStrToLong_ui(compressThreshold, NULL, 10, &threshold) < 0) {
+        virReportError(VIR_ERR_INVALID_ARG,
+                       _("Failed to parse value of URI component %s"),
+                       "compress_threshold");
+        goto failed;
+    }
+
     /* For ext transport, command is required. */
     if (transport == trans_ext && !command) {
         virReportError(VIR_ERR_INVALID_ARG, "%s",
@@ -1203,6 +1278,25 @@ doRemoteOpen(virConnectPtr conn,
         }
     }
 
+    if (compression != VIR_NET_MESSAGE_COMPRESSION_NONE) {
+        remote_connect_set_compression_args args = { compression, threshold };
+
+        /* Accept compressed replies before the server may send them */
+        virNetClientSetCompression(priv->client, compression);
+
+        VIR_DEBUG("Asking for compression %s with threshold %u",
+                  compress, threshold);
+        if (call(conn, priv, 0, REMOTE_PROC_CONNECT_SET_COMPRESSION,
+                 (xdrproc_t) xdr_remote_connect_set_compression_args, (char *) &args,
+                 (xdrproc_t) xdr_void, (char *) NULL) == -1) {
+            VIR_WARN("Disabling compression since the server refused it: %s",
+                     virGetLastErrorMessage());
+            virResetLastError();
+            virNetClientSetCompression(priv->client,
+                                       VIR_NET_MESSAGE_COMPRESSION_NONE);
+        }
+    }
+
     /* Finally we can call the remote side's open function. */
     {
         remote_connect_open_args args = { &name, flags };
@@ -1237,15 +1331,13 @@ doRemoteOpen(virConnectPtr conn,
     if (!(priv->eventState = virObjectEventStateNew()))
         goto failed;
 
-    priv->serverEventFilter = remoteConnectSupportsFeatureUnlocked(conn,
-                                priv, VIR_DRV_FEATURE_REMOTE_EVENT_CALLBACK);
+    remoteConnectProbeFeatures(priv);
+
     if (!priv->serverEventFilter) {
         VIR_INFO("Avoiding server event filtering since it is not "
                  "supported by the server");
     }
 
-    priv->serverCloseCallback = remoteConnectSupportsFeatureUnlocked(conn,
-                                    priv, VIR_DRV_FEATURE_REMOTE_CLOSE_CALLBACK);
     if (!priv->serverCloseCallback) {
         VIR_INFO("Close callback registering isn't supported "
                  "by the remote side.");
@@ -1269,6 +1361,8 @@ doRemoteOpen(virConnectPtr conn,
     VIR_FREE(tls_priority);
     VIR_FREE(knownHostsVerify);
     VIR_FREE(knownHosts);
+    VIR_FREE(compress);
+    VIR_FREE(compressThreshold);
 #ifndef WIN32
     VIR_FREE(daemonPath);
 #endif
@@ -6844,6 +6938,49 @@ remoteNodeGetSEVInfo(virConnectPtr conn,
 }
 
 
+static int
+remoteConnectGetCapabilitiesIfChanged(virConnectPtr conn,
+                                      unsigned long long *generation,
+                                      char **capabilities,
+                                      unsigned int flags)
+{
+    int rv = -1;
+    remote_connect_get_capabilities_if_changed_args args;
+    remote_connect_get_capabilities_if_changed_ret ret;
+    struct private_data *priv = conn->privateData;
+
+    remoteDriverLock(priv);
+
+    args.generation = *generation;
+    args.flags = flags;
+
+    memset(&ret, 0, sizeof(ret));
+    if (call(conn, priv, 0, REMOTE_PROC_CONNECT_GET_CAPABILITIES_IF_CHANGED,
+             (xdrproc_t) xdr_remote_connect_get_capabilities_if_changed_args, (char *) &args,
+             (xdrproc_t) xdr_remote_connect_get_capabilities_if_changed_ret, (char *) &ret) == -1)
+        goto done;
+
+    if (ret.changed) {
+        if (!ret.capabilities) {
+            virReportError(VIR_ERR_RPC, "%s",
+                           _("server did not send the changed capabilities"));
+            goto cleanup;
+        }
+        *capabilities = *ret.capabilities;
+        *ret.capabilities = NULL;
+        *generation = ret.generation;
+    }
+
+    rv = ret.changed ? 1 : 0;
+
+ cleanup:
+    xdr_free((xdrproc_t) xdr_remote_connect_get_capabilities_if_changed_ret, (char *) &ret);
+ done:
+    remoteDriverUnlock(priv);
+    return rv;
+}
+
+
 static int
 remoteNodeGetCPUMap(virConnectPtr conn,
                     unsigned char **cpumap,
@@ -8313,6 +8450,7 @@ static virHypervisorDriver hypervisor_driver = {
     .connectGetMaxVcpus = remoteConnectGetMaxVcpus, /* 0.3.0 */
     .nodeGetInfo = remoteNodeGetInfo, /* 0.3.0 */
     .connectGetCapabilities = remoteConnectGetCapabilities, /* 0.3.0 */
+    .connectGetCapabilitiesIfChanged = remoteConnectGetCapabilitiesIfChanged, /* 5.1.0 */
     .connectListDomains = remoteConnectListDomains, /* 0.3.0 */
     .connectNumOfDomains = remoteConnectNumOfDomains, /* 0.3.0 */
     .connectListAllDomains = remoteConnectListAllDomains, /* 0.9.13 */
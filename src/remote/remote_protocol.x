@@ -3565,6 +3565,22 @@ struct remote_connect_list_all_nwfilter_bindings_ret { /* insert@1 */
     unsigned int ret;
 };
 
+struct remote_connect_set_compression_args {
+    int compression;
+    unsigned int threshold;
+};
+
+struct remote_connect_get_capabilities_if_changed_args {
+    unsigned hyper generation;
+    unsigned int flags;
+};
+
+struct remote_connect_get_capabilities_if_changed_ret {
+    int changed;
+    unsigned hyper generation;
+    remote_string capabilities;
+};
+
 /*----- Protocol. -----*/
 
 /* Define the program number, protocol version and procedure numbers here. */
@@ -6328,6 +6344,19 @@ enum remote_procedure {
      * @acl: domain:save:!VIR_DOMAIN_AFFECT_CONFIG|VIR_DOMAIN_AFFECT_LIVE
      * @acl: domain:save:VIR_DOMAIN_AFFECT_CONFIG
      */
-    REMOTE_PROC_DOMAIN_SET_IOTHREAD_PARAMS = 402
+    REMOTE_PROC_DOMAIN_SET_IOTHREAD_PARAMS = 402,
+
+    /**
+     * @generate: none
+     * @priority: high
+     * @acl: none
+     */
+    REMOTE_PROC_CONNECT_SET_COMPRESSION = 403,
+
+    /**
+     * @generate: none
+     * @acl: connect:read
+     */
+    REMOTE_PROC_CONNECT_GET_CAPABILITIES_IF_CHANGED = 404
 
 };
@@ -57,6 +57,9 @@ struct _virNetClientCall {
     bool expectReply;
     bool nonBlock;
     bool haveThread;
+    /* Owned by a thread waiting for a batch of calls, which
+     * may currently be waiting on another call of the batch */
+    bool batch;
 
     virCond cond;
 
@@ -103,6 +106,11 @@ struct _virNetClient {
     virNetClientStreamPtr *streams;
 
     virKeepAlivePtr keepalive;
+
+    /* Compression of replies negotiated with the server */
+    int compression; /* virNetMessageCompression */
+    virNetMessageCompressStats compressStats;
+
     bool wantClose;
     int closeReason;
     virErrorPtr error;
@@ -793,6 +801,14 @@ virNetClientCloseLocked(virNetClientPtr client)
     if (!client->sock)
         return;
 
+    if (client->compressStats.messages)
+        VIR_DEBUG("client=%p decompressed %llu replies from %llu to %llu bytes "
+                  "in %llu ns", client,
+                  client->compressStats.messages,
+                  client->compressStats.wireBytes,
+                  client->compressStats.rawBytes,
+                  client->compressStats.cpuTime);
+
     virObjectUnref(client->sock);
     client->sock = NULL;
 #if WITH_GNUTLS
@@ -987,6 +1003,19 @@ int virNetClientSetTLSSession(virNetClientPtr client,
 }
 #endif
 
+/*
+ * Tell @client that the server was asked to compress replies using
+ * @compression, so that compressed replies are accepted from now on.
+ */
+void virNetClientSetCompression(virNetClientPtr client,
+                                int compression)
+{
+    virObjectLock(client);
+    client->compression = compression;
+    virObjectUnlock(client);
+}
+
+
 bool virNetClientIsEncrypted(virNetClientPtr client)
 {
     bool ret = false;
@@ -1284,6 +1313,7 @@ virNetClientCallDispatch(virNetClientPtr client)
 
     case VIR_NET_CALL:
     case VIR_NET_CALL_WITH_FDS:
+    case VIR_NET_REPLY_COMPRESSED: /* Decompressed already on input */
     default:
         virReportError(VIR_ERR_RPC,
                        _("got unexpected RPC call prog %d vers %d proc %d type %d"),
@@ -1422,6 +1452,11 @@ virNetClientIOHandleInput(virNetClientPtr client)
                 if (virNetMessageDecodeHeader(&client->msg) < 0)
                     return -1;
 
+                if (client->msg.header.type == VIR_NET_REPLY_COMPRESSED &&
+                    virNetMessageDecompress(&client->msg, client->compression,
+                                            &client->compressStats) < 0)
+                    return -1;
+
                 if (client->msg.header.type == VIR_NET_REPLY_WITH_FDS) {
                     size_t i;
 
@@ -1513,6 +1548,8 @@ static bool virNetClientIOEventLoopRemoveDone(virNetClientCallPtr call,
     if (call->haveThread) {
         VIR_DEBUG("Waking up sleep %p", call);
         virCondSignal(&call->cond);
+    } else if (call->batch) {
+        VIR_DEBUG("Leaving completed batch call %p to its owner", call);
     } else {
         VIR_DEBUG("Removing completed call %p", call);
         if (call->expectReply)
@@ -1543,6 +1580,12 @@ virNetClientIOEventLoopRemoveAll(virNetClientCallPtr call,
     if (call == thiscall)
         return false;
 
+    /* The thread owning the batch will notice the call was dropped */
+    if (call->batch) {
+        VIR_DEBUG("Dropping batch call %p", call);
+        return true;
+    }
+
     VIR_DEBUG("Removing call %p", call);
     virCondDestroy(&call->cond);
     VIR_FREE(call->msg);
@@ -1804,7 +1847,8 @@ static void virNetClientIOUpdateCallback(virNetClientPtr client,
 
 
 /*
- * This function sends a message to remote server and awaits a reply
+ * This function waits until an already queued message has been sent
+ * to the remote server and, if one is expected, its reply has arrived
  *
  * NB. This does not free the args structure (not desirable, since you
  * often want this allocated on the stack or else it contains strings
@@ -1860,23 +1904,11 @@ static void virNetClientIOUpdateCallback(virNetClientPtr client,
  * Returns 1 if the call was queued and will be completed later (only
  * for nonBlock == true), 0 if the call was completed and -1 on error.
  */
-static int virNetClientIO(virNetClientPtr client,
-                          virNetClientCallPtr thiscall)
+static int virNetClientIOWait(virNetClientPtr client,
+                              virNetClientCallPtr thiscall)
 {
     int rv = -1;
 
-    VIR_DEBUG("Outgoing message prog=%u version=%u serial=%u proc=%d type=%d length=%zu dispatch=%p",
-              thiscall->msg->header.prog,
-              thiscall->msg->header.vers,
-              thiscall->msg->header.serial,
-              thiscall->msg->header.proc,
-              thiscall->msg->header.type,
-              thiscall->msg->bufferLength,
-              client->waitDispatch);
-
-    /* Stick ourselves on the end of the wait queue */
-    virNetClientCallQueue(&client->waitDispatch, thiscall);
-
     /* Check to see if another thread is dispatching */
     if (client->haveTheBuck) {
         char ignore = 1;
@@ -1966,6 +1998,32 @@ static int virNetClientIO(virNetClientPtr client,
 }
 
 
+/*
+ * Queue @thiscall for sending and wait for it to complete. See
+ * virNetClientIOWait for the gory details.
+ *
+ * Returns 1 if the call was queued and will be completed later (only
+ * for nonBlock == true), 0 if the call was completed and -1 on error.
+ */
+static int virNetClientIO(virNetClientPtr client,
+                          virNetClientCallPtr thiscall)
+{
+    VIR_DEBUG("Outgoing message prog=%u version=%u serial=%u proc=%d type=%d length=%zu dispatch=%p",
+              thiscall->msg->header.prog,
+              thiscall->msg->header.vers,
+              thiscall->msg->header.serial,
+              thiscall->msg->header.proc,
+              thiscall->msg->header.type,
+              thiscall->msg->bufferLength,
+              client->waitDispatch);
+
+    /* Stick ourselves on the end of the wait queue */
+    virNetClientCallQueue(&client->waitDispatch, thiscall);
+
+    return virNetClientIOWait(client, thiscall);
+}
+
+
 void virNetClientIncomingEvent(virNetSocketPtr sock,
                                int events,
                                void *opaque)
@@ -2235,3 +2293,124 @@ int virNetClientSendWithReplyStream(virNetClientPtr client,
         return -1;
     return 0;
 }
+
+
+static bool
+virNetClientCallIsQueued(virNetClientCallPtr call,
+                         void *opaque)
+{
+    return call == opaque;
+}
+
+
+/*
+ * @msgs: array of messages allocated on heap or stack
+ * @nmsgs: number of messages in @msgs
+ *
+ * Send all messages back to back, without waiting for a reply in
+ * between, and then wait until the replies to all of them arrived.
+ * Replies are matched to their calls by serial number, so the server
+ * is free to complete the calls in any order. Each message must carry
+ * a distinct serial.
+ *
+ * On success each message holds its reply, which may still carry an
+ * error status from the server; checking that is up to the caller.
+ *
+ * The caller is responsible for free'ing @msgs and the messages in it
+ *
+ * Returns 0 on success, -1 if any of the replies was not received
+ */
+int virNetClientSendWithReplyBatch(virNetClientPtr client,
+                                   virNetMessagePtr *msgs,
+                                   size_t nmsgs)
+{
+    virNetClientCallPtr *calls = NULL;
+    virErrorPtr origerr = NULL;
+    size_t ncalls = 0;
+    size_t i;
+    int ret = -1;
+
+    if (nmsgs == 0)
+        return 0;
+
+    if (VIR_ALLOC_N(calls, nmsgs) < 0)
+        return -1;
+
+    virObjectLock(client);
+
+    if (!client->sock || client->wantClose) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("client socket is closed"));
+        goto cleanup;
+    }
+
+    for (ncalls = 0; ncalls < nmsgs; ncalls++) {
+        virNetMessagePtr msg = msgs[ncalls];
+
+        PROBE(RPC_CLIENT_MSG_TX_QUEUE,
+              "client=%p len=%zu prog=%u vers=%u proc=%u type=%u status=%u serial=%u",
+              client, msg->bufferLength,
+              msg->header.prog, msg->header.vers, msg->header.proc,
+              msg->header.type, msg->header.status, msg->header.serial);
+
+        if (!(calls[ncalls] = virNetClientCallNew(msg, true, false)))
+            goto cleanup;
+        calls[ncalls]->batch = true;
+    }
+
+    VIR_DEBUG("Outgoing batch of %zu messages dispatch=%p",
+              ncalls, client->waitDispatch);
+
+    /* Queue everything up front so that whoever holds the buck
+     * writes all the calls out without waiting for replies */
+    for (i = 0; i < ncalls; i++)
+        virNetClientCallQueue(&client->waitDispatch, calls[i]);
+
+    ret = 0;
+    for (i = 0; i < ncalls; i++) {
+        virNetClientCallPtr call = calls[i];
+
+        /* Replies for calls further down the batch may well have
+         * arrived while we were waiting for an earlier one */
+        if (call->mode == VIR_NET_CLIENT_MODE_COMPLETE)
+            continue;
+
+        if (!virNetClientCallMatchPredicate(client->waitDispatch,
+                                            virNetClientCallIsQueued,
+                                            call)) {
+            /* Dropped from the queue when the connection was closed */
+            if (!origerr) {
+                virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                               _("client socket is closed"));
+                origerr = virSaveLastError();
+            }
+            ret = -1;
+            continue;
+        }
+
+        /* Keep waiting for the rest of the batch even if one of the
+         * calls failed, so that no call we abandon is left behind
+         * with a reply still on its way */
+        call->haveThread = true;
+        if (virNetClientIOWait(client, call) < 0) {
+            if (!origerr)
+                origerr = virSaveLastError();
+            ret = -1;
+        }
+        call->haveThread = false;
+    }
+
+ cleanup:
+    for (i = 0; i < ncalls; i++) {
+        virNetClientCallRemove(&client->waitDispatch, calls[i]);
+        virCondDestroy(&calls[i]->cond);
+        VIR_FREE(calls[i]);
+    }
+    virObjectUnlock(client);
+    VIR_FREE(calls);
+    if (origerr) {
+        virSetError(origerr);
+        virFreeError(origerr);
+    }
+    return ret;
+}
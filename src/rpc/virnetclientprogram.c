@@ -263,6 +263,38 @@ int virNetClientProgramDispatch(virNetClientProgramPtr prog,
 }
 
 
+static int
+virNetClientProgramCheckReply(virNetMessagePtr msg,
+                              unsigned serial,
+                              int proc)
+{
+    /* None of these 3 should ever happen here, because
+     * virNetClientSend should have validated the reply,
+     * but it doesn't hurt to check again.
+     */
+    if (msg->header.type != VIR_NET_REPLY &&
+        msg->header.type != VIR_NET_REPLY_WITH_FDS) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Unexpected message type %d"), msg->header.type);
+        return -1;
+    }
+    if (msg->header.proc != proc) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Unexpected message proc %d != %d"),
+                       msg->header.proc, proc);
+        return -1;
+    }
+    if (msg->header.serial != serial) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Unexpected message serial %d != %d"),
+                       msg->header.serial, serial);
+        return -1;
+    }
+
+    return 0;
+}
+
+
 int virNetClientProgramCall(virNetClientProgramPtr prog,
                             virNetClientPtr client,
                             unsigned serial,
@@ -324,28 +356,8 @@ int virNetClientProgramCall(virNetClientProgramPtr prog,
     if (virNetClientSendWithReply(client, msg) < 0)
         goto error;
 
-    /* None of these 3 should ever happen here, because
-     * virNetClientSend should have validated the reply,
-     * but it doesn't hurt to check again.
-     */
-    if (msg->header.type != VIR_NET_REPLY &&
-        msg->header.type != VIR_NET_REPLY_WITH_FDS) {
-        virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("Unexpected message type %d"), msg->header.type);
+    if (virNetClientProgramCheckReply(msg, serial, proc) < 0)
         goto error;
-    }
-    if (msg->header.proc != proc) {
-        virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("Unexpected message proc %d != %d"),
-                       msg->header.proc, proc);
-        goto error;
-    }
-    if (msg->header.serial != serial) {
-        virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("Unexpected message serial %d != %d"),
-                       msg->header.serial, serial);
-        goto error;
-    }
 
     switch (msg->header.status) {
     case VIR_NET_OK:
@@ -398,3 +410,100 @@ int virNetClientProgramCall(virNetClientProgramPtr prog,
     }
     return -1;
 }
+
+
+/*
+ * @prog: program the procedures belong to
+ * @client: client to send the calls over
+ * @serial: serial number of the first call; the calls use
+ *          @serial .. @serial + @ncalls - 1
+ * @calls: array of calls to make
+ * @ncalls: number of elements in @calls
+ *
+ * Make all @calls at once over @client, with all of them in flight at
+ * the same time, so that the whole batch costs about one round trip
+ * instead of one per call. File descriptor passing is not supported.
+ *
+ * The outcome of each call is stored in its 'result' member, with the
+ * error that caused a failure saved in its 'error' member, which the
+ * caller has to free.
+ *
+ * Returns 0 if replies to all calls were received, regardless of
+ * whether they succeeded, and -1 if the batch could not be completed
+ */
+int virNetClientProgramCallBatch(virNetClientProgramPtr prog,
+                                 virNetClientPtr client,
+                                 unsigned serial,
+                                 virNetClientProgramCallDataPtr calls,
+                                 size_t ncalls)
+{
+    virNetMessagePtr *msgs = NULL;
+    size_t i;
+    int ret = -1;
+
+    if (VIR_ALLOC_N(msgs, ncalls) < 0)
+        return -1;
+
+    for (i = 0; i < ncalls; i++) {
+        virNetClientProgramCallDataPtr call = &calls[i];
+
+        call->result = -1;
+        call->error = NULL;
+
+        if (!(msgs[i] = virNetMessageNew(false)))
+            goto cleanup;
+
+        msgs[i]->header.prog = prog->program;
+        msgs[i]->header.vers = prog->version;
+        msgs[i]->header.status = VIR_NET_OK;
+        msgs[i]->header.type = VIR_NET_CALL;
+        msgs[i]->header.serial = serial + i;
+        msgs[i]->header.proc = call->proc;
+
+        if (virNetMessageEncodeHeader(msgs[i]) < 0 ||
+            virNetMessageEncodePayload(msgs[i], call->args_filter,
+                                       call->args) < 0)
+            goto cleanup;
+    }
+
+    if (virNetClientSendWithReplyBatch(client, msgs, ncalls) < 0)
+        goto cleanup;
+
+    for (i = 0; i < ncalls; i++) {
+        virNetClientProgramCallDataPtr call = &calls[i];
+        virNetMessagePtr msg = msgs[i];
+
+        if (virNetClientProgramCheckReply(msg, serial + i, call->proc) < 0)
+            goto cleanup;
+
+        switch (msg->header.status) {
+        case VIR_NET_OK:
+            if (virNetMessageDecodePayload(msg, call->ret_filter,
+                                           call->ret) < 0)
+                goto cleanup;
+            call->result = 0;
+            break;
+
+        case VIR_NET_ERROR:
+            /* A failure of one call does not fail the batch */
+            virNetClientProgramDispatchError(prog, msg);
+            call->error = virSaveLastError();
+            virResetLastError();
+            break;
+
+        case VIR_NET_CONTINUE:
+        default:
+            virReportError(VIR_ERR_RPC,
+                           _("Unexpected message status %d"), msg->header.status);
+            goto cleanup;
+        }
+    }
+
+    ret = 0;
+
+ cleanup:
+    for (i = 0; i < ncalls; i++)
+        virNetMessageFree(msgs[i]);
+    VIR_FREE(msgs);
+    return ret;
+}
@@ -36,6 +36,9 @@ typedef virNetClientProgram *virNetClientProgramPtr;
 typedef struct _virNetClientProgramEvent virNetClientProgramEvent;
 typedef virNetClientProgramEvent *virNetClientProgramEventPtr;
 
+typedef struct _virNetClientProgramCallData virNetClientProgramCallData;
+typedef virNetClientProgramCallData *virNetClientProgramCallDataPtr;
+
 typedef struct _virNetClientProgramErrorHandler virNetClientProgramErrorHander;
 typedef virNetClientProgramErrorHander *virNetClientProgramErrorHanderPtr;
 
@@ -79,6 +82,23 @@ int virNetClientProgramCall(virNetClientProgramPtr prog,
                             xdrproc_t args_filter, void *args,
                             xdrproc_t ret_filter, void *ret);
 
+struct _virNetClientProgramCallData {
+    int proc;
+    xdrproc_t args_filter;
+    void *args;
+    xdrproc_t ret_filter;
+    void *ret;
+
+    int result; /* 0 if the call succeeded, -1 otherwise */
+    virErrorPtr error; /* Why the call failed, if it did */
+};
+
+int virNetClientProgramCallBatch(virNetClientProgramPtr prog,
+                                 virNetClientPtr client,
+                                 unsigned serial,
+                                 virNetClientProgramCallDataPtr calls,
+                                 size_t ncalls);
+
 
 
 #endif /* LIBVIRT_VIRNETCLIENTPROGRAM_H */
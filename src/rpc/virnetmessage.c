@@ -21,6 +21,10 @@
 #include <config.h>
 
 #include <unistd.h>
+#include <time.h>
+#if WITH_LZ4
+# include <lz4.h>
+#endif
 
 #include "virnetmessage.h"
 #include "viralloc.h"
@@ -34,6 +38,18 @@
 
 VIR_LOG_INIT("rpc.netmessage");
 
+VIR_ENUM_IMPL(virNetMessageCompression, VIR_NET_MESSAGE_COMPRESSION_LAST,
+              "none",
+              "lz4");
+
+/* Offset of the payload, after the length word and the header */
+#define VIR_NET_MESSAGE_PAYLOAD_OFFSET \
+    (VIR_NET_MESSAGE_LEN_MAX + VIR_NET_MESSAGE_HEADER_MAX)
+
+/* Compressed data follows the length of the uncompressed payload */
+#define VIR_NET_MESSAGE_COMPRESSED_OFFSET \
+    (VIR_NET_MESSAGE_PAYLOAD_OFFSET + VIR_NET_MESSAGE_LEN_MAX)
+
 virNetMessagePtr virNetMessageNew(bool tracked)
 {
     virNetMessagePtr msg;
@@ -350,6 +366,26 @@ int virNetMessageEncodePayload(virNetMessagePtr msg,
 {
     XDR xdr;
     unsigned int msglen;
+#ifdef HAVE_XDR_SIZEOF
+    size_t needed;
+
+    /* Grow the buffer to the final size up front, so that large
+     * payloads are encoded just once rather than once per doubling
+     * of the buffer in the loop below */
+    needed = msg->bufferOffset + xdr_sizeof(filter, data);
+    if (needed > msg->bufferLength) {
+        if (needed - VIR_NET_MESSAGE_LEN_MAX > VIR_NET_MESSAGE_MAX) {
+            virReportError(VIR_ERR_RPC, "%s", _("Unable to encode message payload"));
+            return -1;
+        }
+
+        if (VIR_REALLOC_N(msg->buffer, needed) < 0)
+            return -1;
+        msg->bufferLength = needed;
+
+        VIR_DEBUG("Sized message buffer length = %zu", msg->bufferLength);
+    }
+#endif /* HAVE_XDR_SIZEOF */
 
     /* Serialise payload of the message. This assumes that
      * virNetMessageEncodeHeader has already been run, so
@@ -602,3 +638,238 @@ int virNetMessageAddFD(virNetMessagePtr msg,
     VIR_FORCE_CLOSE(newfd);
     return -1;
 }
+
+
+
+bool
+virNetMessageCompressionIsSupported(int compression)
+{
+    switch ((virNetMessageCompression) compression) {
+    case VIR_NET_MESSAGE_COMPRESSION_NONE:
+        return true;
+    case VIR_NET_MESSAGE_COMPRESSION_LZ4:
+#if WITH_LZ4
+        return true;
+#else
+        return false;
+#endif
+    case VIR_NET_MESSAGE_COMPRESSION_LAST:
+        break;
+    }
+
+    return false;
+}
+
+
+#if WITH_LZ4
+/* CPU time of the calling thread in nanoseconds, or 0 if unknown */
+static unsigned long long
+virNetMessageThreadCPUTime(void)
+{
+# ifdef CLOCK_THREAD_CPUTIME_ID
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) < 0)
+        return 0;
+
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+# else
+    return 0;
+# endif
+}
+
+
+/*
+ * @msg: an encoded VIR_NET_REPLY message ready to be sent
+ * @compression: the algorithm to use, one of virNetMessageCompression
+ * @threshold: payloads smaller than this are sent as they are
+ * @stats: counters to update
+ *
+ * Replaces the payload of @msg with its compressed form and turns the
+ * message into a VIR_NET_REPLY_COMPRESSED one. Messages of any other
+ * type, payloads under @threshold and payloads which do not shrink
+ * are left untouched.
+ *
+ * Returns 0 on success (whether compressed or not), -1 on error.
+ */
+int
+virNetMessageCompress(virNetMessagePtr msg,
+                      int compression,
+                      size_t threshold,
+                      virNetMessageCompressStatsPtr stats)
+{
+    unsigned long long start;
+    unsigned int rawlen;
+    unsigned int msglen;
+    char *buf = NULL;
+    int bound;
+    int len;
+    XDR xdr;
+
+    if (compression != VIR_NET_MESSAGE_COMPRESSION_LZ4 ||
+        msg->header.type != VIR_NET_REPLY ||
+        msg->bufferOffset != 0 ||
+        msg->bufferLength <= VIR_NET_MESSAGE_PAYLOAD_OFFSET)
+        return 0;
+
+    rawlen = msg->bufferLength - VIR_NET_MESSAGE_PAYLOAD_OFFSET;
+    if (rawlen < threshold)
+        return 0;
+
+    start = virNetMessageThreadCPUTime();
+
+    bound = LZ4_compressBound(rawlen);
+    if (VIR_ALLOC_N(buf, VIR_NET_MESSAGE_COMPRESSED_OFFSET + bound) < 0)
+        return -1;
+
+    len = LZ4_compress_default(msg->buffer + VIR_NET_MESSAGE_PAYLOAD_OFFSET,
+                               buf + VIR_NET_MESSAGE_COMPRESSED_OFFSET,
+                               rawlen, bound);
+
+    /* Not worth it, send the payload as it is */
+    if (len <= 0 ||
+        VIR_NET_MESSAGE_COMPRESSED_OFFSET + len >= msg->bufferLength) {
+        VIR_FREE(buf);
+        return 0;
+    }
+
+    msg->header.type = VIR_NET_REPLY_COMPRESSED;
+    msglen = VIR_NET_MESSAGE_COMPRESSED_OFFSET + len;
+
+    xdrmem_create(&xdr, buf, VIR_NET_MESSAGE_COMPRESSED_OFFSET, XDR_ENCODE);
+    if (!xdr_u_int(&xdr, &msglen) ||
+        !xdr_virNetMessageHeader(&xdr, &msg->header) ||
+        !xdr_u_int(&xdr, &rawlen)) {
+        virReportError(VIR_ERR_RPC, "%s", _("Unable to encode message header"));
+        xdr_destroy(&xdr);
+        msg->header.type = VIR_NET_REPLY;
+        VIR_FREE(buf);
+        return -1;
+    }
+    xdr_destroy(&xdr);
+
+    VIR_FREE(msg->buffer);
+    msg->buffer = buf;
+    msg->bufferLength = msglen;
+
+    stats->messages++;
+    stats->rawBytes += rawlen;
+    stats->wireBytes += len;
+    stats->cpuTime += virNetMessageThreadCPUTime() - start;
+
+    VIR_DEBUG("Compressed payload of msg=%p from %u to %d bytes",
+              msg, rawlen, len);
+    return 0;
+}
+
+
+/*
+ * @msg: a VIR_NET_REPLY_COMPRESSED message with decoded header
+ * @compression: the algorithm negotiated for the connection
+ * @stats: counters to update
+ *
+ * Decompresses the payload of @msg and turns the message into a plain
+ * VIR_NET_REPLY, positioned at the start of the payload just like
+ * virNetMessageDecodeHeader leaves it.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virNetMessageDecompress(virNetMessagePtr msg,
+                        int compression,
+                        virNetMessageCompressStatsPtr stats)
+{
+    unsigned long long start;
+    unsigned int rawlen;
+    size_t len;
+    char *buf = NULL;
+    XDR xdr;
+
+    if (compression != VIR_NET_MESSAGE_COMPRESSION_LZ4) {
+        virReportError(VIR_ERR_RPC, "%s",
+                       _("got compressed message without negotiating compression"));
+        return -1;
+    }
+
+    if (msg->bufferLength < VIR_NET_MESSAGE_COMPRESSED_OFFSET ||
+        msg->bufferOffset != VIR_NET_MESSAGE_PAYLOAD_OFFSET) {
+        virReportError(VIR_ERR_RPC, "%s",
+                       _("Unable to decode compressed message"));
+        return -1;
+    }
+
+    xdrmem_create(&xdr, msg->buffer + msg->bufferOffset,
+                  VIR_NET_MESSAGE_LEN_MAX, XDR_DECODE);
+    if (!xdr_u_int(&xdr, &rawlen)) {
+        virReportError(VIR_ERR_RPC, "%s",
+                       _("Unable to decode compressed message"));
+        xdr_destroy(&xdr);
+        return -1;
+    }
+    xdr_destroy(&xdr);
+
+    if (rawlen > VIR_NET_MESSAGE_PAYLOAD_MAX) {
+        virReportError(VIR_ERR_RPC,
+                       _("decompressed payload length %u exceeds maximum %d"),
+                       rawlen, VIR_NET_MESSAGE_PAYLOAD_MAX);
+        return -1;
+    }
+
+    start = virNetMessageThreadCPUTime();
+
+    len = msg->bufferLength - VIR_NET_MESSAGE_COMPRESSED_OFFSET;
+    if (VIR_ALLOC_N(buf, VIR_NET_MESSAGE_PAYLOAD_OFFSET + rawlen) < 0)
+        return -1;
+
+    if (LZ4_decompress_safe(msg->buffer + VIR_NET_MESSAGE_COMPRESSED_OFFSET,
+                            buf + VIR_NET_MESSAGE_PAYLOAD_OFFSET,
+                            len, rawlen) != (int) rawlen) {
+        virReportError(VIR_ERR_RPC, "%s",
+                       _("Unable to decompress message payload"));
+        VIR_FREE(buf);
+        return -1;
+    }
+
+    memcpy(buf, msg->buffer, VIR_NET_MESSAGE_PAYLOAD_OFFSET);
+    VIR_FREE(msg->buffer);
+    msg->buffer = buf;
+    msg->bufferLength = VIR_NET_MESSAGE_PAYLOAD_OFFSET + rawlen;
+    msg->bufferOffset = VIR_NET_MESSAGE_PAYLOAD_OFFSET;
+    msg->header.type = VIR_NET_REPLY;
+
+    stats->messages++;
+    stats->rawBytes += rawlen;
+    stats->wireBytes += len;
+    stats->cpuTime += virNetMessageThreadCPUTime() - start;
+
+    return 0;
+}
+
+#else /* !WITH_LZ4 */
+
+int
+virNetMessageCompress(virNetMessagePtr msg ATTRIBUTE_UNUSED,
+                      int compression,
+                      size_t threshold ATTRIBUTE_UNUSED,
+                      virNetMessageCompressStatsPtr stats ATTRIBUTE_UNUSED)
+{
+    if (compression != VIR_NET_MESSAGE_COMPRESSION_NONE) {
+        virReportError(VIR_ERR_OPERATION_UNSUPPORTED, "%s",
+                       _("message compression is not supported"));
+        return -1;
+    }
+
+    return 0;
+}
+
+
+int
+virNetMessageDecompress(virNetMessagePtr msg ATTRIBUTE_UNUSED,
+                        int compression ATTRIBUTE_UNUSED,
+                        virNetMessageCompressStatsPtr stats ATTRIBUTE_UNUSED)
+{
+    virReportError(VIR_ERR_OPERATION_UNSUPPORTED, "%s",
+                   _("message compression is not supported"));
+    return -1;
+}
+#endif /* !WITH_LZ4 */
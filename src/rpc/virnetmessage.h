@@ -22,6 +22,7 @@
 # define LIBVIRT_VIRNETMESSAGE_H
 
 # include "virnetprotocol.h"
+# include "virutil.h"
 
 typedef struct virNetMessageHeader *virNetMessageHeaderPtr;
 typedef struct virNetMessageError *virNetMessageErrorPtr;
@@ -31,6 +32,24 @@ typedef virNetMessage *virNetMessagePtr;
 
 typedef void (*virNetMessageFreeCallback)(virNetMessagePtr msg, void *opaque);
 
+typedef enum {
+    VIR_NET_MESSAGE_COMPRESSION_NONE = 0,
+    VIR_NET_MESSAGE_COMPRESSION_LZ4,
+
+    VIR_NET_MESSAGE_COMPRESSION_LAST
+} virNetMessageCompression;
+
+VIR_ENUM_DECL(virNetMessageCompression);
+
+typedef struct _virNetMessageCompressStats virNetMessageCompressStats;
+typedef virNetMessageCompressStats *virNetMessageCompressStatsPtr;
+struct _virNetMessageCompressStats {
+    unsigned long long messages;  /* Messages (de)compressed */
+    unsigned long long rawBytes;  /* Payload bytes before compression */
+    unsigned long long wireBytes; /* Payload bytes on the wire */
+    unsigned long long cpuTime;   /* CPU time spent, in nanoseconds */
+};
+
 struct _virNetMessage {
     bool tracked;
 
@@ -48,6 +67,10 @@ struct _virNetMessage {
     int *fds;
     size_t donefds;
 
+    /* Monotonic time in microseconds when the message was queued
+     * for dispatch, 0 if unknown */
+    unsigned long long queued;
+
     virNetMessagePtr next;
 };
 
@@ -95,6 +118,18 @@ int virNetMessageEncodePayloadEmpty(virNetMessagePtr msg)
 void virNetMessageSaveError(virNetMessageErrorPtr rerr)
     ATTRIBUTE_NONNULL(1);
 
+bool virNetMessageCompressionIsSupported(int compression);
+
+int virNetMessageCompress(virNetMessagePtr msg,
+                          int compression,
+                          size_t threshold,
+                          virNetMessageCompressStatsPtr stats)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(4) ATTRIBUTE_RETURN_CHECK;
+int virNetMessageDecompress(virNetMessagePtr msg,
+                            int compression,
+                            virNetMessageCompressStatsPtr stats)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(3) ATTRIBUTE_RETURN_CHECK;
+
 int virNetMessageDupFD(virNetMessagePtr msg,
                        size_t slot);
 
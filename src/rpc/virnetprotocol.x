@@ -149,6 +149,11 @@ const VIR_NET_MESSAGE_NUM_FDS_MAX = 32;
  *     * status == VIR_NET_OK
  *          <empty>
  *
+ *  - type == VIR_NET_REPLY_COMPRESSED
+ *          unsigned int - length of the decompressed payload
+ *          byte[]       - the VIR_NET_REPLY payload, compressed with the
+ *                         algorithm negotiated for the connection
+ *
  */
 enum virNetMessageType {
     /* client -> server. args from a method call */
@@ -164,7 +169,10 @@ enum virNetMessageType {
     /* server -> client. reply/error from a method call, with passed FDs */
     VIR_NET_REPLY_WITH_FDS = 5,
     /* either direction, stream hole data packet */
-    VIR_NET_STREAM_HOLE = 6
+    VIR_NET_STREAM_HOLE = 6,
+    /* server -> client. reply/error from a method call, compressed.
+     * Only sent to clients which asked for compression */
+    VIR_NET_REPLY_COMPRESSED = 7
 };
 
 enum virNetMessageStatus {
@@ -29,6 +29,7 @@
 #include "virthreadpool.h"
 #include "virnetservermdns.h"
 #include "virstring.h"
+#include "virtime.h"
 
 #define VIR_FROM_THIS VIR_FROM_RPC
 
@@ -212,6 +213,10 @@ virNetServerDispatchNewMessage(virNetServerClientPtr client,
         job->client = client;
         job->msg = msg;
 
+        /* Only used for statistics, so don't fail if there's no clock */
+        if (virTimeMonotonicMicrosNowRaw(&msg->queued) < 0)
+            msg->queued = 0;
+
         if (prog) {
             job->prog = virObjectRef(prog);
             priority = virNetServerProgramGetPriority(prog, msg->header.proc);
@@ -1038,6 +1043,35 @@ virNetServerGetClients(virNetServerPtr srv,
     return ret;
 }
 
+int
+virNetServerGetPrograms(virNetServerPtr srv,
+                        virNetServerProgramPtr **progs)
+{
+    int ret = -1;
+    size_t i;
+    size_t nprogs = 0;
+    virNetServerProgramPtr *list = NULL;
+
+    virObjectLock(srv);
+
+    for (i = 0; i < srv->nprograms; i++) {
+        virNetServerProgramPtr prog = virObjectRef(srv->programs[i]);
+        if (VIR_APPEND_ELEMENT(list, nprogs, prog) < 0) {
+            virObjectUnref(prog);
+            goto cleanup;
+        }
+    }
+
+    *progs = list;
+    list = NULL;
+    ret = nprogs;
+
+ cleanup:
+    virObjectListFreeCount(list, nprogs);
+    virObjectUnlock(srv);
+    return ret;
+}
+
 virNetServerClientPtr
 virNetServerGetClient(virNetServerPtr srv,
                       unsigned long long id)
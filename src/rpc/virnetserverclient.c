@@ -117,6 +117,11 @@ struct _virNetServerClient
     virNetServerClientCloseFunc privateDataCloseFunc;
 
     virKeepAlivePtr keepalive;
+
+    /* Compression of replies requested by the client */
+    int compression; /* virNetMessageCompression */
+    size_t compressThreshold;
+    virNetMessageCompressStats compressStats;
 };
 
 
@@ -680,6 +685,52 @@ virNetServerClientSetReadonly(virNetServerClientPtr client,
 }
 
 
+int
+virNetServerClientSetCompression(virNetServerClientPtr client,
+                                 int compression,
+                                 size_t threshold)
+{
+    if (compression < 0 ||
+        compression >= VIR_NET_MESSAGE_COMPRESSION_LAST ||
+        !virNetMessageCompressionIsSupported(compression)) {
+        virReportError(VIR_ERR_OPERATION_UNSUPPORTED,
+                       _("message compression algorithm %d is not supported"),
+                       compression);
+        return -1;
+    }
+
+    virObjectLock(client);
+    VIR_DEBUG("client=%p compression=%s threshold=%zu", client,
+              virNetMessageCompressionTypeToString(compression), threshold);
+    client->compression = compression;
+    client->compressThreshold = threshold;
+    virObjectUnlock(client);
+    return 0;
+}
+
+
+/**
+ * virNetServerClientGetCompression:
+ * @client: the client
+ * @stats: filled with the compression statistics of the client
+ *
+ * Returns the compression algorithm (virNetMessageCompression) of
+ * replies sent to @client.
+ */
+int
+virNetServerClientGetCompression(virNetServerClientPtr client,
+                                 virNetMessageCompressStatsPtr stats)
+{
+    int compression;
+
+    virObjectLock(client);
+    compression = client->compression;
+    *stats = client->compressStats;
+    virObjectUnlock(client);
+    return compression;
+}
+
+
 unsigned long long virNetServerClientGetID(virNetServerClientPtr client)
 {
     return client->id;
@@ -1007,6 +1058,14 @@ virNetServerClientCloseLocked(virNetServerClientPtr client)
     if (!client->sock)
         return;
 
+    if (client->compressStats.messages)
+        VIR_DEBUG("client=%p compressed %llu replies from %llu to %llu bytes "
+                  "in %llu ns", client,
+                  client->compressStats.messages,
+                  client->compressStats.rawBytes,
+                  client->compressStats.wireBytes,
+                  client->compressStats.cpuTime);
+
     if (client->keepalive) {
         virKeepAliveStop(client->keepalive);
         ka = client->keepalive;
@@ -1507,6 +1566,15 @@ virNetServerClientSendMessageLocked(virNetServerClientPtr client,
 
     msg->donefds = 0;
     if (client->sock && !client->wantClose) {
+        /* Failing to compress is no reason not to send the reply */
+        if (client->compression != VIR_NET_MESSAGE_COMPRESSION_NONE &&
+            virNetMessageCompress(msg, client->compression,
+                                  client->compressThreshold,
+                                  &client->compressStats) < 0) {
+            VIR_WARN("Unable to compress reply, sending it uncompressed");
+            virResetLastError();
+        }
+
         PROBE(RPC_SERVER_CLIENT_MSG_TX_QUEUE,
               "client=%p len=%zu prog=%u vers=%u proc=%u type=%u status=%u serial=%u",
               client, msg->bufferLength,
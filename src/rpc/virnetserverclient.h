@@ -96,6 +96,11 @@ int virNetServerClientGetAuth(virNetServerClientPtr client);
 void virNetServerClientSetAuthLocked(virNetServerClientPtr client, int auth);
 bool virNetServerClientGetReadonly(virNetServerClientPtr client);
 void virNetServerClientSetReadonly(virNetServerClientPtr client, bool readonly);
+int virNetServerClientSetCompression(virNetServerClientPtr client,
+                                     int compression,
+                                     size_t threshold);
+int virNetServerClientGetCompression(virNetServerClientPtr client,
+                                     virNetMessageCompressStatsPtr stats);
 unsigned long long virNetServerClientGetID(virNetServerClientPtr client);
 long long virNetServerClientGetTimestamp(virNetServerClientPtr client);
 
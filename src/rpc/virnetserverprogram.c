@@ -27,20 +27,26 @@
 #include "viralloc.h"
 #include "virerror.h"
 #include "virlog.h"
+#include "viratomic.h"
 #include "virfile.h"
 #include "virthread.h"
+#include "virtime.h"
 
 #define VIR_FROM_THIS VIR_FROM_RPC
 
 VIR_LOG_INIT("rpc.netserverprogram");
 
 struct _virNetServerProgram {
-    virObject parent;
+    virObjectLockable parent;
 
     unsigned program;
     unsigned version;
     virNetServerProgramProcPtr procs;
     size_t nprocs;
+
+    /* Indexed like @procs. The counters are updated atomically,
+     * the lock only serializes virNetServerProgramGetStats */
+    virNetServerProgramProcStatsPtr stats;
 };
 
 
@@ -49,7 +55,7 @@ static void virNetServerProgramDispose(void *obj);
 
 static int virNetServerProgramOnceInit(void)
 {
-    if (!VIR_CLASS_NEW(virNetServerProgram, virClassForObject()))
+    if (!VIR_CLASS_NEW(virNetServerProgram, virClassForObjectLockable()))
         return -1;
 
     return 0;
@@ -68,8 +74,13 @@ virNetServerProgramPtr virNetServerProgramNew(unsigned program,
     if (virNetServerProgramInitialize() < 0)
         return NULL;
 
-    if (!(prog = virObjectNew(virNetServerProgramClass)))
+    if (!(prog = virObjectLockableNew(virNetServerProgramClass)))
+        return NULL;
+
+    if (VIR_ALLOC_N(prog->stats, nprocs) < 0) {
+        virObjectUnref(prog);
         return NULL;
+    }
 
     prog->program = program;
     prog->version = version;
@@ -134,6 +145,134 @@ virNetServerProgramGetPriority(virNetServerProgramPtr prog,
     return proc->priority;
 }
 
+
+const char *
+virNetServerProgramGetProcName(virNetServerProgramPtr prog,
+                               int procedure)
+{
+    virNetServerProgramProcPtr proc = virNetServerProgramGetProc(prog, procedure);
+
+    if (!proc)
+        return NULL;
+
+    return proc->name;
+}
+
+
+/* Bucket 0 counts durations below 1us, bucket N (N > 0) counts
+ * durations in [2^(N-1), 2^N) us and the last bucket everything
+ * beyond that. */
+static size_t
+virNetServerProgramStatsBucket(unsigned long long usec)
+{
+    size_t bucket = 0;
+
+    while (usec && bucket < VIR_NET_SERVER_PROGRAM_STATS_BUCKETS - 1) {
+        usec >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+
+static void
+virNetServerProgramStatsRecord(virNetServerProgramPtr prog,
+                               int procedure,
+                               unsigned long long queued,
+                               unsigned long long start,
+                               size_t bytesIn,
+                               size_t bytesOut,
+                               bool error)
+{
+    virNetServerProgramProcStatsPtr stats;
+    unsigned long long end;
+    unsigned long long wait = 0;
+    unsigned long long exec = 0;
+
+    if (start && virTimeMonotonicMicrosNowRaw(&end) == 0 && end >= start)
+        exec = end - start;
+    if (queued && start >= queued)
+        wait = start - queued;
+
+    stats = &prog->stats[procedure];
+    virAtomicULLongAdd(&stats->calls, 1);
+    if (error)
+        virAtomicULLongAdd(&stats->errors, 1);
+    virAtomicULLongAdd(&stats->bytesIn, bytesIn);
+    virAtomicULLongAdd(&stats->bytesOut, bytesOut);
+    virAtomicULLongAdd(&stats->waitTime, wait);
+    virAtomicULLongAdd(&stats->execTime, exec);
+    virAtomicULLongAdd(&stats->waitHist[virNetServerProgramStatsBucket(wait)], 1);
+    virAtomicULLongAdd(&stats->execHist[virNetServerProgramStatsBucket(exec)], 1);
+}
+
+
+/* Copies the counter at @src to @dst. With @reset the copied value is
+ * subtracted from @src, so that calls finishing meanwhile are kept */
+static void
+virNetServerProgramStatsCopyCounter(unsigned long long *dst,
+                                    unsigned long long *src,
+                                    bool reset)
+{
+    *dst = virAtomicULLongGet(src);
+    if (reset)
+        virAtomicULLongAdd(src, -*dst);
+}
+
+
+/**
+ * virNetServerProgramGetStats:
+ * @prog: the program
+ * @stats: filled with a copy of the per procedure statistics
+ * @nstats: filled with the number of elements in @stats
+ * @reset: whether to reset the counters afterwards
+ *
+ * The elements of @stats are indexed by procedure number.
+ * The caller must free @stats.
+ *
+ * Returns 0 on success, -1 on error
+ */
+int
+virNetServerProgramGetStats(virNetServerProgramPtr prog,
+                            virNetServerProgramProcStatsPtr *stats,
+                            size_t *nstats,
+                            bool reset)
+{
+    int ret = -1;
+    size_t i;
+    size_t j;
+
+    virObjectLock(prog);
+
+    if (VIR_ALLOC_N(*stats, prog->nprocs) < 0)
+        goto cleanup;
+
+    for (i = 0; i < prog->nprocs; i++) {
+        virNetServerProgramProcStatsPtr src = &prog->stats[i];
+        virNetServerProgramProcStatsPtr dst = &(*stats)[i];
+
+        virNetServerProgramStatsCopyCounter(&dst->calls, &src->calls, reset);
+        virNetServerProgramStatsCopyCounter(&dst->errors, &src->errors, reset);
+        virNetServerProgramStatsCopyCounter(&dst->bytesIn, &src->bytesIn, reset);
+        virNetServerProgramStatsCopyCounter(&dst->bytesOut, &src->bytesOut, reset);
+        virNetServerProgramStatsCopyCounter(&dst->waitTime, &src->waitTime, reset);
+        virNetServerProgramStatsCopyCounter(&dst->execTime, &src->execTime, reset);
+        for (j = 0; j < VIR_NET_SERVER_PROGRAM_STATS_BUCKETS; j++) {
+            virNetServerProgramStatsCopyCounter(&dst->waitHist[j],
+                                                &src->waitHist[j], reset);
+            virNetServerProgramStatsCopyCounter(&dst->execHist[j],
+                                                &src->execHist[j], reset);
+        }
+    }
+    *nstats = prog->nprocs;
+
+    ret = 0;
+ cleanup:
+    virObjectUnlock(prog);
+    return ret;
+}
+
 static int
 virNetServerProgramSendError(unsigned program,
                              unsigned version,
@@ -323,6 +462,7 @@ int virNetServerProgramDispatch(virNetServerProgramPtr prog,
     case VIR_NET_REPLY_WITH_FDS:
     case VIR_NET_MESSAGE:
     case VIR_NET_STREAM_HOLE:
+    case VIR_NET_REPLY_COMPRESSED:
     default:
         virReportError(VIR_ERR_RPC,
                        _("Unexpected message type %u"),
@@ -373,13 +513,18 @@ virNetServerProgramDispatchCall(virNetServerProgramPtr prog,
     char *arg = NULL;
     char *ret = NULL;
     int rv = -1;
-    virNetServerProgramProcPtr dispatcher;
+    virNetServerProgramProcPtr dispatcher = NULL;
     virNetMessageError rerr;
     size_t i;
     virIdentityPtr identity = NULL;
+    unsigned long long start = 0;
+    size_t bytesIn = msg->bufferLength;
 
     memset(&rerr, 0, sizeof(rerr));
 
+    if (virTimeMonotonicMicrosNowRaw(&start) < 0)
+        start = 0;
+
     if (msg->header.status != VIR_NET_OK) {
         virReportError(VIR_ERR_RPC,
                        _("Unexpected message status %u"),
@@ -487,11 +632,20 @@ virNetServerProgramDispatchCall(virNetServerProgramPtr prog,
     VIR_FREE(arg);
     VIR_FREE(ret);
 
+    virNetServerProgramStatsRecord(prog, msg->header.proc, msg->queued, start,
+                                   bytesIn, msg->bufferLength, false);
+
     virObjectUnref(identity);
     /* Put reply on end of tx queue to send out  */
     return virNetServerClientSendMessage(client, msg);
 
  error:
+    /* The size of error replies is not accounted for as @msg
+     * is gone once the reply is queued */
+    if (dispatcher)
+        virNetServerProgramStatsRecord(prog, msg->header.proc, msg->queued,
+                                       start, bytesIn, 0, true);
+
     /* Bad stuff (de-)serializing message, but we have an
      * RPC error message we can send back to the client */
     rv = virNetServerProgramSendReplyError(prog, client, msg, &rerr, &msg->header);
@@ -581,6 +735,9 @@ int virNetServerProgramSendStreamHole(virNetServerProgramPtr prog,
 }
 
 
-void virNetServerProgramDispose(void *obj ATTRIBUTE_UNUSED)
+void virNetServerProgramDispose(void *obj)
 {
+    virNetServerProgramPtr prog = obj;
+
+    VIR_FREE(prog->stats);
 }
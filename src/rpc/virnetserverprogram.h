@@ -53,6 +53,25 @@ struct _virNetServerProgramProc {
     xdrproc_t ret_filter;
     bool needAuth;
     unsigned int priority;
+    const char *name;
+};
+
+# define VIR_NET_SERVER_PROGRAM_STATS_BUCKETS 24
+
+typedef struct _virNetServerProgramProcStats virNetServerProgramProcStats;
+typedef virNetServerProgramProcStats *virNetServerProgramProcStatsPtr;
+
+/* Times are in microseconds; the histograms are log2 bucketed,
+ * see virNetServerProgramStatsBucket */
+struct _virNetServerProgramProcStats {
+    unsigned long long calls;
+    unsigned long long errors;
+    unsigned long long bytesIn;
+    unsigned long long bytesOut;
+    unsigned long long waitTime;
+    unsigned long long execTime;
+    unsigned long long waitHist[VIR_NET_SERVER_PROGRAM_STATS_BUCKETS];
+    unsigned long long execHist[VIR_NET_SERVER_PROGRAM_STATS_BUCKETS];
 };
 
 virNetServerProgramPtr virNetServerProgramNew(unsigned program,
@@ -66,6 +85,14 @@ int virNetServerProgramGetVersion(virNetServerProgramPtr prog);
 unsigned int virNetServerProgramGetPriority(virNetServerProgramPtr prog,
                                             int procedure);
 
+const char *virNetServerProgramGetProcName(virNetServerProgramPtr prog,
+                                           int procedure);
+
+int virNetServerProgramGetStats(virNetServerProgramPtr prog,
+                                virNetServerProgramProcStatsPtr *stats,
+                                size_t *nstats,
+                                bool reset);
+
 int virNetServerProgramMatches(virNetServerProgramPtr prog,
                                virNetMessagePtr msg);
 
@@ -36,9 +36,42 @@
 #include "virrandom.h"
 #include "virstring.h"
 #include "virgettext.h"
+#include "virtime.h"
 
 #define VIR_FROM_THIS VIR_FROM_STORAGE
 
+#if HAVE_SPLICE
+/* Move everything from @fdin to @fdout without copying it through user
+ * space. One of the fds must be a pipe, which is always the case for
+ * the wrapper fds we are given. Returns 1 when all data was moved, 0 if
+ * the kernel can't splice these fds and nothing was moved yet, -1 on
+ * error. */
+static int
+runIOSplice(int fdin, const char *fdinname,
+            int fdout, const char *fdoutname,
+            unsigned long long *total)
+{
+    while (1) {
+        ssize_t got = splice(fdin, NULL, fdout, NULL, 1024 * 1024,
+                             SPLICE_F_MOVE | SPLICE_F_MORE);
+
+        if (got < 0) {
+            if (errno == EINTR)
+                continue;
+            if (*total == 0 && (errno == EINVAL || errno == ENOSYS))
+                return 0;
+            virReportSystemError(errno, _("Unable to move data from %s to %s"),
+                                 fdinname, fdoutname);
+            return -1;
+        }
+        if (got == 0)
+            return 1;
+
+        *total += got;
+    }
+}
+#endif
+
 static int
 runIO(const char *path, int fd, int oflags)
 {
@@ -52,6 +85,9 @@ runIO(const char *path, int fd, int oflags)
     unsigned long long total = 0;
     bool direct = O_DIRECT && ((oflags & O_DIRECT) != 0);
     off_t end = 0;
+    const char *mode = "copy";
+    unsigned long long start = 0;
+    unsigned long long now = 0;
 
 #if HAVE_POSIX_MEMALIGN
     if (posix_memalign(&base, alignMask + 1, buflen)) {
@@ -102,6 +138,23 @@ runIO(const char *path, int fd, int oflags)
         goto cleanup;
     }
 
+    if (virTimeMillisNow(&start) < 0)
+        goto cleanup;
+
+#if HAVE_SPLICE
+    /* O_DIRECT needs the aligned buffer below */
+    if (!direct) {
+        int rc = runIOSplice(fdin, fdinname, fdout, fdoutname, &total);
+
+        if (rc < 0)
+            goto cleanup;
+        if (rc > 0) {
+            mode = "splice";
+            goto done;
+        }
+    }
+#endif
+
     while (1) {
         ssize_t got;
 
@@ -153,6 +206,9 @@ runIO(const char *path, int fd, int oflags)
         }
     }
 
+#if HAVE_SPLICE
+ done:
+#endif
     /* Ensure all data is written */
     if (fdatasync(fdout) < 0) {
         if (errno != EINVAL && errno != EROFS) {
@@ -162,6 +218,16 @@ runIO(const char *path, int fd, int oflags)
         }
     }
 
+    /* Picked up by virFileWrapperFdFree, so operators can see how fast
+     * images are moved and whether the data stayed in the kernel */
+    if (virTimeMillisNow(&now) == 0) {
+        unsigned long long ms = MAX(now - start, 1);
+
+        fprintf(stderr, VIR_FILE_WRAPPER_STATS_PREFIX
+                "%llu bytes in %llu ms (%llu MiB/s) using %s\n",
+                total, ms, total * 1000 / ms / (1024 * 1024), mode);
+    }
+
     ret = 0;
 
  cleanup:
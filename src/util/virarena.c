@@ -0,0 +1,220 @@
+/*
+ * virarena.c: bump allocator for short lived temporaries
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "virarena.h"
+#include "viralloc.h"
+#include "virerror.h"
+#include "virutil.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+#define VIR_ARENA_ALIGN (2 * sizeof(void *))
+#define VIR_ARENA_CHUNK_SIZE 4096
+
+struct _virArenaChunk {
+    virArenaChunkPtr next;
+    size_t size;
+};
+
+
+/**
+ * virArenaInit:
+ * @arena: arena to initialize
+ * @buf: initial buffer, or NULL
+ * @size: size of @buf
+ *
+ * Set up @arena to serve allocations from @buf until it runs out.
+ * The buffer must outlive the arena.
+ */
+void
+virArenaInit(virArenaPtr arena,
+             char *buf,
+             size_t size)
+{
+    memset(arena, 0, sizeof(*arena));
+    arena->initial = arena->cur = buf;
+    arena->initialSize = arena->curSize = buf ? size : 0;
+}
+
+
+/**
+ * virArenaClear:
+ * @arena: arena to clear
+ *
+ * Release all memory handed out by @arena. Pointers obtained from the
+ * arena must not be used afterwards. The arena can be reused; the
+ * statistics are kept.
+ */
+void
+virArenaClear(virArenaPtr arena)
+{
+    if (!arena)
+        return;
+
+    while (arena->chunks) {
+        virArenaChunkPtr next = arena->chunks->next;
+        VIR_FREE(arena->chunks);
+        arena->chunks = next;
+    }
+
+    arena->cur = arena->initial;
+    arena->curSize = arena->initialSize;
+    arena->curUsed = 0;
+}
+
+
+static void *
+virArenaAllocInternal(virArenaPtr arena,
+                      size_t size,
+                      size_t align)
+{
+    size_t avail = arena->curSize - arena->curUsed;
+    size_t pad = 0;
+    char *ret;
+
+    if (arena->cur)
+        pad = -(uintptr_t)(arena->cur + arena->curUsed) & (align - 1);
+
+    if (!arena->cur || avail < pad || avail - pad < size) {
+        virArenaChunkPtr chunk;
+        size_t hdr = VIR_ROUND_UP(sizeof(*chunk), VIR_ARENA_ALIGN);
+        size_t want = MAX(VIR_ARENA_CHUNK_SIZE, size);
+
+        if (want > SIZE_MAX - hdr) {
+            virReportOOMError();
+            return NULL;
+        }
+
+        if (VIR_ALLOC_N(ret, hdr + want) < 0)
+            return NULL;
+
+        chunk = (virArenaChunkPtr) ret;
+        chunk->size = want;
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+        arena->nchunks++;
+
+        arena->cur = ret + hdr;
+        arena->curSize = want;
+        arena->curUsed = 0;
+        pad = 0;
+    }
+
+    ret = arena->cur + arena->curUsed + pad;
+    arena->curUsed += size + pad;
+    arena->nallocs++;
+    arena->nbytes += size;
+
+    return ret;
+}
+
+
+/**
+ * virArenaAlloc:
+ * @arena: arena to allocate from
+ * @size: number of bytes
+ *
+ * Returns zeroed memory suitably aligned for any type, which stays
+ * valid until virArenaClear, or NULL with an error reported.
+ */
+void *
+virArenaAlloc(virArenaPtr arena,
+              size_t size)
+{
+    void *ret;
+
+    if (!(ret = virArenaAllocInternal(arena, size, VIR_ARENA_ALIGN)))
+        return NULL;
+
+    memset(ret, 0, size);
+    return ret;
+}
+
+
+/**
+ * virArenaStrndup:
+ * @arena: arena to allocate from
+ * @str: string to copy, or NULL
+ * @len: maximum number of bytes to copy
+ *
+ * Returns a NUL terminated copy of at most @len bytes of @str owned by
+ * @arena, NULL if @str is NULL, or NULL with an error reported.
+ */
+char *
+virArenaStrndup(virArenaPtr arena,
+                const char *str,
+                size_t len)
+{
+    char *ret;
+
+    if (!str)
+        return NULL;
+
+    len = strnlen(str, len);
+    if (!(ret = virArenaAllocInternal(arena, len + 1, 1)))
+        return NULL;
+
+    memcpy(ret, str, len);
+    ret[len] = '\0';
+    return ret;
+}
+
+
+/**
+ * virArenaStrdup:
+ * @arena: arena to allocate from
+ * @str: string to copy, or NULL
+ *
+ * Like virArenaStrndup, for the whole of @str.
+ */
+char *
+virArenaStrdup(virArenaPtr arena,
+               const char *str)
+{
+    if (!str)
+        return NULL;
+
+    return virArenaStrndup(arena, str, strlen(str));
+}
+
+
+/**
+ * virArenaGetStats:
+ * @arena: arena to query
+ * @nallocs: filled with the number of allocations served
+ * @nbytes: filled with the number of bytes requested
+ * @nchunks: filled with the number of heap chunks allocated
+ *
+ * Each output is optional. A properly sized initial buffer keeps
+ * @nchunks at zero.
+ */
+void
+virArenaGetStats(virArenaPtr arena,
+                 size_t *nallocs,
+                 size_t *nbytes,
+                 size_t *nchunks)
+{
+    if (nallocs)
+        *nallocs = arena->nallocs;
+    if (nbytes)
+        *nbytes = arena->nbytes;
+    if (nchunks)
+        *nchunks = arena->nchunks;
+}
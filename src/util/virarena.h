@@ -0,0 +1,69 @@
+/*
+ * virarena.h: bump allocator for short lived temporaries
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBVIRT_VIRARENA_H
+# define LIBVIRT_VIRARENA_H
+
+# include "internal.h"
+
+typedef struct _virArenaChunk virArenaChunk;
+typedef virArenaChunk *virArenaChunkPtr;
+
+/*
+ * An arena hands out memory from a caller provided (usually stack)
+ * buffer and falls back to heap chunks once that is exhausted.
+ * Individual allocations are never freed; everything is released at
+ * once by virArenaClear. Do not access the members directly.
+ */
+typedef struct _virArena virArena;
+typedef virArena *virArenaPtr;
+struct _virArena {
+    char *initial;
+    size_t initialSize;
+
+    char *cur;
+    size_t curSize;
+    size_t curUsed;
+    virArenaChunkPtr chunks;
+
+    size_t nallocs;
+    size_t nbytes;
+    size_t nchunks;
+};
+
+# define VIR_ARENA_INITIALIZER(buffer) \
+    { (buffer), sizeof(buffer), (buffer), sizeof(buffer), 0, NULL, 0, 0, 0 }
+
+void virArenaInit(virArenaPtr arena, char *buf, size_t size)
+    ATTRIBUTE_NONNULL(1);
+void virArenaClear(virArenaPtr arena);
+
+void *virArenaAlloc(virArenaPtr arena, size_t size)
+    ATTRIBUTE_NONNULL(1);
+char *virArenaStrndup(virArenaPtr arena, const char *str, size_t len)
+    ATTRIBUTE_NONNULL(1);
+char *virArenaStrdup(virArenaPtr arena, const char *str)
+    ATTRIBUTE_NONNULL(1);
+
+void virArenaGetStats(virArenaPtr arena,
+                      size_t *nallocs,
+                      size_t *nbytes,
+                      size_t *nchunks)
+    ATTRIBUTE_NONNULL(1);
+
+#endif /* LIBVIRT_VIRARENA_H */
@@ -152,6 +152,50 @@ VIR_STATIC unsigned int virAtomicIntXor(volatile unsigned int *atomic,
                                         unsigned int val)
     ATTRIBUTE_NONNULL(1);
 
+/**
+ * virAtomicPointerGet:
+ * Gets the current value of the pointer stored at atomic.
+ *
+ * This call acts as a full compiler and hardware memory barrier
+ * (before the get)
+ */
+VIR_STATIC void *virAtomicPointerGet(void * volatile *atomic)
+    ATTRIBUTE_NONNULL(1);
+
+/**
+ * virAtomicPointerSet:
+ * Sets the pointer stored at atomic to newval.
+ *
+ * This call acts as a full compiler and hardware memory barrier
+ * (after the set)
+ */
+VIR_STATIC void virAtomicPointerSet(void * volatile *atomic,
+                                    void *newval)
+    ATTRIBUTE_NONNULL(1);
+
+/**
+ * virAtomicULLongGet:
+ * Gets the current value of the 64-bit counter stored at atomic.
+ *
+ * This call acts as a full compiler and hardware memory barrier
+ * (before the get)
+ */
+VIR_STATIC unsigned long long virAtomicULLongGet(volatile unsigned long long *atomic)
+    ATTRIBUTE_NONNULL(1);
+
+/**
+ * virAtomicULLongAdd:
+ * Atomically adds val to the 64-bit counter stored at atomic.
+ *
+ * Think of this operation as an atomic version of
+ * { tmp = *atomic; *atomic += val; return tmp; }
+ *
+ * This call acts as a full compiler and hardware memory barrier.
+ */
+VIR_STATIC unsigned long long virAtomicULLongAdd(volatile unsigned long long *atomic,
+                                                 unsigned long long val)
+    ATTRIBUTE_NONNULL(1);
+
 # undef VIR_STATIC
 
 # ifdef VIR_ATOMIC_OPS_GCC
@@ -213,6 +257,30 @@ VIR_STATIC unsigned int virAtomicIntXor(volatile unsigned int *atomic,
             (void) (0 ? *(atomic) ^ (val) : 0); \
             (unsigned int) __sync_fetch_and_xor((atomic), (val)); \
         }))
+#  define virAtomicPointerGet(atomic) \
+    (__extension__ ({ \
+            (void)verify_true(sizeof(*(atomic)) == sizeof(void *)); \
+            __sync_synchronize(); \
+            (void *)*(atomic); \
+        }))
+#  define virAtomicPointerSet(atomic, newval) \
+    (__extension__ ({ \
+            (void)verify_true(sizeof(*(atomic)) == sizeof(void *)); \
+            (void)(0 ? (void *) *(atomic) : (newval)); \
+            *(atomic) = (newval); \
+            __sync_synchronize(); \
+        }))
+#  define virAtomicULLongGet(atomic) \
+    (__extension__ ({ \
+            (void)verify_true(sizeof(*(atomic)) == sizeof(unsigned long long)); \
+            (unsigned long long) __sync_fetch_and_add((atomic), 0); \
+        }))
+#  define virAtomicULLongAdd(atomic, val) \
+    (__extension__ ({ \
+            (void)verify_true(sizeof(*(atomic)) == sizeof(unsigned long long)); \
+            (void)(0 ? *(atomic) ^ (val) : 0); \
+            (unsigned long long) __sync_fetch_and_add((atomic), (val)); \
+        }))
 
 
 # else
@@ -294,6 +362,34 @@ virAtomicIntXor(volatile unsigned int *atomic,
     return InterlockedXor((volatile LONG *)atomic, val);
 }
 
+static inline void *
+virAtomicPointerGet(void * volatile *atomic)
+{
+    MemoryBarrier();
+    return *atomic;
+}
+
+static inline void
+virAtomicPointerSet(void * volatile *atomic,
+                    void *newval)
+{
+    *atomic = newval;
+    MemoryBarrier();
+}
+
+static inline unsigned long long
+virAtomicULLongGet(volatile unsigned long long *atomic)
+{
+    return InterlockedCompareExchange64((volatile LONGLONG *)atomic, 0, 0);
+}
+
+static inline unsigned long long
+virAtomicULLongAdd(volatile unsigned long long *atomic,
+                   unsigned long long val)
+{
+    return InterlockedExchangeAdd64((volatile LONGLONG *)atomic, val);
+}
+
 
 #  else
 #   ifdef VIR_ATOMIC_OPS_PTHREAD
@@ -419,6 +515,53 @@ virAtomicIntXor(volatile unsigned int *atomic,
     return oldval;
 }
 
+static inline void *
+virAtomicPointerGet(void * volatile *atomic)
+{
+    void *value;
+
+    pthread_mutex_lock(&virAtomicLock);
+    value = *atomic;
+    pthread_mutex_unlock(&virAtomicLock);
+
+    return value;
+}
+
+static inline void
+virAtomicPointerSet(void * volatile *atomic,
+                    void *newval)
+{
+    pthread_mutex_lock(&virAtomicLock);
+    *atomic = newval;
+    pthread_mutex_unlock(&virAtomicLock);
+}
+
+static inline unsigned long long
+virAtomicULLongGet(volatile unsigned long long *atomic)
+{
+    unsigned long long value;
+
+    pthread_mutex_lock(&virAtomicLock);
+    value = *atomic;
+    pthread_mutex_unlock(&virAtomicLock);
+
+    return value;
+}
+
+static inline unsigned long long
+virAtomicULLongAdd(volatile unsigned long long *atomic,
+                   unsigned long long val)
+{
+    unsigned long long oldval;
+
+    pthread_mutex_lock(&virAtomicLock);
+    oldval = *atomic;
+    *atomic = oldval + val;
+    pthread_mutex_unlock(&virAtomicLock);
+
+    return oldval;
+}
+
 
 #   else
 #    error "No atomic integer impl for this platform"
@@ -448,6 +591,14 @@ virAtomicIntXor(volatile unsigned int *atomic,
     virAtomicIntOr((unsigned int *)atomic, val)
 #  define virAtomicIntXor(atomic, val) \
     virAtomicIntXor((unsigned int *)atomic, val)
+#  define virAtomicPointerGet(atomic) \
+    virAtomicPointerGet((void * volatile *)atomic)
+#  define virAtomicPointerSet(atomic, val) \
+    virAtomicPointerSet((void * volatile *)atomic, val)
+#  define virAtomicULLongGet(atomic) \
+    virAtomicULLongGet((unsigned long long *)atomic)
+#  define virAtomicULLongAdd(atomic, val) \
+    virAtomicULLongAdd((unsigned long long *)atomic, val)
 
 # endif
 
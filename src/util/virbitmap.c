@@ -26,6 +26,7 @@
 #include "virbitmap.h"
 #include "virbuffer.h"
 #include "c-ctype.h"
+#include "count-leading-zeros.h"
 #include "count-one-bits.h"
 #include "virstring.h"
 #include "virutil.h"
@@ -33,6 +34,10 @@
 
 #define VIR_FROM_THIS VIR_FROM_NONE
 
+/* Number of units stored inside the bitmap itself. Small bitmaps, such
+ * as CPU masks of most hosts, thus need no separate allocation. */
+#define VIR_BITMAP_INLINE_UNITS 1
+
 struct _virBitmap {
     size_t nbits;
     size_t map_len;
@@ -42,6 +47,9 @@ struct _virBitmap {
      * are not set. Any function decreasing the size of the map needs clear
      * bits which don't belong to the bitmap any more. */
     unsigned long *map;
+
+    /* @map points here unless the bitmap needs more units */
+    unsigned long inline_map[VIR_BITMAP_INLINE_UNITS];
 };
 
 
@@ -50,6 +58,12 @@ struct _virBitmap {
 #define VIR_BITMAP_BIT_OFFSET(b)  ((b) % VIR_BITMAP_BITS_PER_UNIT)
 #define VIR_BITMAP_BIT(b)         (1UL << VIR_BITMAP_BIT_OFFSET(b))
 
+/* Mask of bits @b and above within their unit */
+#define VIR_BITMAP_MASK_FROM(b)   (-1UL << VIR_BITMAP_BIT_OFFSET(b))
+/* Mask of bits @b and below within their unit */
+#define VIR_BITMAP_MASK_TO(b) \
+    (-1UL >> (VIR_BITMAP_BITS_PER_UNIT - 1 - VIR_BITMAP_BIT_OFFSET(b)))
+
 
 /**
  * virBitmapNewQuiet:
@@ -74,13 +88,16 @@ virBitmapNewQuiet(size_t size)
     if (VIR_ALLOC_QUIET(bitmap) < 0)
         return NULL;
 
-    if (VIR_ALLOC_N_QUIET(bitmap->map, sz) < 0) {
+    if (sz <= VIR_BITMAP_INLINE_UNITS) {
+        bitmap->map = bitmap->inline_map;
+        sz = VIR_BITMAP_INLINE_UNITS;
+    } else if (VIR_ALLOC_N_QUIET(bitmap->map, sz) < 0) {
         VIR_FREE(bitmap);
         return NULL;
     }
 
     bitmap->nbits = size;
-    bitmap->map_len = sz;
+    bitmap->map_len = VIR_DIV_UP(size, VIR_BITMAP_BITS_PER_UNIT);
     bitmap->map_alloc = sz;
     return bitmap;
 }
@@ -136,7 +153,8 @@ void
 virBitmapFree(virBitmapPtr bitmap)
 {
     if (bitmap) {
-        VIR_FREE(bitmap->map);
+        if (bitmap->map != bitmap->inline_map)
+            VIR_FREE(bitmap->map);
         VIR_FREE(bitmap);
     }
 }
@@ -202,6 +220,23 @@ virBitmapExpand(virBitmapPtr map,
 {
     size_t new_len = VIR_DIV_UP(b + 1, VIR_BITMAP_BITS_PER_UNIT);
 
+    if (!map->map && new_len <= VIR_BITMAP_INLINE_UNITS) {
+        map->map = map->inline_map;
+        map->map_alloc = VIR_BITMAP_INLINE_UNITS;
+    }
+
+    /* the inline storage can't be reallocated, move to the heap */
+    if (map->map == map->inline_map && new_len > map->map_alloc) {
+        unsigned long *heap;
+
+        if (VIR_ALLOC_N(heap, new_len) < 0)
+            return -1;
+
+        memcpy(heap, map->inline_map, sizeof(map->inline_map));
+        map->map = heap;
+        map->map_alloc = new_len;
+    }
+
     /* resize the memory if necessary */
     if (map->map_len < new_len) {
         if (VIR_RESIZE_N(map->map, map->map_alloc, map->map_len,
@@ -284,6 +319,30 @@ virBitmapClearBitExpand(virBitmapPtr bitmap,
 }
 
 
+/* Helper function. Sets bits @start to @last inclusive a unit at a time.
+ * Caller must ensure @start <= @last < bitmap->nbits */
+static void
+virBitmapSetRange(virBitmapPtr bitmap,
+                  size_t start,
+                  size_t last)
+{
+    size_t first_unit = VIR_BITMAP_UNIT_OFFSET(start);
+    size_t last_unit = VIR_BITMAP_UNIT_OFFSET(last);
+    size_t i;
+
+    if (first_unit == last_unit) {
+        bitmap->map[first_unit] |= VIR_BITMAP_MASK_FROM(start) &
+                                   VIR_BITMAP_MASK_TO(last);
+        return;
+    }
+
+    bitmap->map[first_unit] |= VIR_BITMAP_MASK_FROM(start);
+    for (i = first_unit + 1; i < last_unit; i++)
+        bitmap->map[i] = -1UL;
+    bitmap->map[last_unit] |= VIR_BITMAP_MASK_TO(last);
+}
+
+
 /* Helper function. caller must ensure b < bitmap->nbits */
 static bool
 virBitmapIsSet(virBitmapPtr bitmap, size_t b)
@@ -413,39 +472,31 @@ char *
 virBitmapFormat(virBitmapPtr bitmap)
 {
     virBuffer buf = VIR_BUFFER_INITIALIZER;
-    bool first = true;
-    int start, cur, prev;
+    ssize_t start, end;
 
-    if (!bitmap || (cur = virBitmapNextSetBit(bitmap, -1)) < 0) {
+    if (!bitmap || (start = virBitmapNextSetBit(bitmap, -1)) < 0) {
         char *ret;
         ignore_value(VIR_STRDUP(ret, ""));
         return ret;
     }
 
-    start = prev = cur;
-    while (prev >= 0) {
-        cur = virBitmapNextSetBit(bitmap, prev);
+    /* Each range ends right before the next clear bit, both of which
+     * are found a whole unit at a time. */
+    while (start >= 0) {
+        if ((end = virBitmapNextClearBit(bitmap, start)) < 0)
+            end = bitmap->nbits;
+        end--;
 
-        if (cur == prev + 1) {
-            prev = cur;
-            continue;
-        }
-
-        /* cur < 0 or cur > prev + 1 */
-
-        if (!first)
-            virBufferAddLit(&buf, ",");
+        if (end == start)
+            virBufferAsprintf(&buf, "%zd,", start);
         else
-            first = false;
+            virBufferAsprintf(&buf, "%zd-%zd,", start, end);
 
-        if (prev == start)
-            virBufferAsprintf(&buf, "%d", start);
-        else
-            virBufferAsprintf(&buf, "%d-%d", start, prev);
-
-        start = prev = cur;
+        start = virBitmapNextSetBit(bitmap, end);
     }
 
+    virBufferTrim(&buf, ",", -1);
+
     if (virBufferError(&buf)) {
         virBufferFreeAndReset(&buf);
         virReportOOMError();
@@ -487,7 +538,6 @@ virBitmapParseSeparator(const char *str,
     bool neg = false;
     const char *cur = str;
     char *tmp;
-    size_t i;
     int start, last;
 
     if (!(*bitmap = virBitmapNew(bitmapSize)))
@@ -547,10 +597,10 @@ virBitmapParseSeparator(const char *str,
 
             cur = tmp;
 
-            for (i = start; i <= last; i++) {
-                if (virBitmapSetBit(*bitmap, i) < 0)
-                    goto error;
-            }
+            if (last >= virBitmapSize(*bitmap))
+                goto error;
+
+            virBitmapSetRange(*bitmap, start, last);
 
             virSkipSpaces(&cur);
         }
@@ -623,7 +673,6 @@ virBitmapParseUnlimited(const char *str)
     bool neg = false;
     const char *cur = str;
     char *tmp;
-    size_t i;
     int start, last;
 
     if (!(bitmap = virBitmapNewEmpty()))
@@ -683,10 +732,11 @@ virBitmapParseUnlimited(const char *str)
 
             cur = tmp;
 
-            for (i = start; i <= last; i++) {
-                if (virBitmapSetBitExpand(bitmap, i) < 0)
-                    goto error;
-            }
+            if (bitmap->nbits <= last &&
+                virBitmapExpand(bitmap, last) < 0)
+                goto error;
+
+            virBitmapSetRange(bitmap, start, last);
 
             virSkipSpaces(&cur);
         }
@@ -1038,7 +1088,6 @@ virBitmapNextSetBit(virBitmapPtr bitmap,
 ssize_t
 virBitmapLastSetBit(virBitmapPtr bitmap)
 {
-    ssize_t i;
     int unusedBits;
     ssize_t sz;
     unsigned long bits;
@@ -1068,12 +1117,8 @@ virBitmapLastSetBit(virBitmapPtr bitmap)
     return -1;
 
  found:
-    for (i = VIR_BITMAP_BITS_PER_UNIT - 1; i >= 0; i--) {
-        if (bits & 1UL << i)
-            return i + sz * VIR_BITMAP_BITS_PER_UNIT;
-    }
-
-    return -1;
+    return VIR_BITMAP_BITS_PER_UNIT - 1 - count_leading_zeros_l(bits) +
+           sz * VIR_BITMAP_BITS_PER_UNIT;
 }
 
 
@@ -1255,6 +1300,34 @@ virBitmapIntersect(virBitmapPtr a,
 }
 
 
+/**
+ * virBitmapUnion:
+ * @a: bitmap, modified to contain result
+ * @b: other bitmap
+ *
+ * Performs union of two bitmaps: a = union(a, b). @a is expanded if
+ * @b is larger.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virBitmapUnion(virBitmapPtr a,
+               virBitmapPtr b)
+{
+    size_t i;
+
+    if (b->nbits > a->nbits &&
+        virBitmapExpand(a, b->nbits - 1) < 0)
+        return -1;
+
+    /* bits of @b beyond its size are clear */
+    for (i = 0; i < MIN(a->map_len, b->map_len); i++)
+        a->map[i] |= b->map[i];
+
+    return 0;
+}
+
+
 /**
  * virBitmapSubtract:
  * @a: minuend/result
@@ -1301,13 +1374,19 @@ virBitmapShrink(virBitmapPtr map,
 
     nl = map->nbits / VIR_BITMAP_BITS_PER_UNIT;
     nb = map->nbits % VIR_BITMAP_BITS_PER_UNIT;
-    map->map[nl] &= ((1UL << nb) - 1);
 
-    toremove = map->map_alloc - (nl + 1);
+    /* there's no partial unit to clear if the size is unit aligned */
+    if (nl < map->map_len)
+        map->map[nl] &= ((1UL << nb) - 1);
 
-    if (toremove == 0)
+    if (map->map_alloc <= nl + 1)
         return;
 
+    toremove = map->map_alloc - (nl + 1);
+
+    /* the inline storage is never larger than a single unit */
+    sa_assert(map->map != map->inline_map);
+
     VIR_SHRINK_N(map->map, map->map_alloc, toremove);
 
     /* length needs to be fixed as well */
@@ -125,14 +125,16 @@ virBufferGetIndent(const virBuffer *buf, bool dynamic)
  * @buf: the buffer
  * @len: the minimum free size to allocate on top of existing used space
  *
- * Grow the available space of a buffer to at least @len bytes.
+ * Grow the available space of a buffer to at least @len bytes. The
+ * allocation is at least doubled so that building a large document
+ * by many small appends copies it only a logarithmic number of times.
  *
  * Returns zero on success or -1 on error
  */
 static int
 virBufferGrow(virBufferPtr buf, unsigned int len)
 {
-    int size;
+    unsigned long long size;
 
     if (buf->error)
         return -1;
@@ -140,7 +142,17 @@ virBufferGrow(virBufferPtr buf, unsigned int len)
     if ((len + buf->use) < buf->size)
         return 0;
 
-    size = buf->use + len + 1000;
+    size = (unsigned long long)buf->use + len + 1000;
+    if (size < 2ULL * buf->size)
+        size = 2ULL * buf->size;
+
+    if (size > UINT_MAX) {
+        if ((unsigned long long)buf->use + len >= UINT_MAX) {
+            virBufferSetError(buf, ENOMEM);
+            return -1;
+        }
+        size = UINT_MAX;
+    }
 
     if (VIR_REALLOC_N_QUIET(buf->content, size) < 0) {
         virBufferSetError(buf, errno);
@@ -150,6 +162,33 @@ virBufferGrow(virBufferPtr buf, unsigned int len)
     return 0;
 }
 
+/**
+ * virBufferReserve:
+ * @buf: the buffer
+ * @len: number of bytes expected to be added
+ *
+ * Hint that about @len more bytes are going to be added to @buf, so
+ * that the space can be allocated in one go instead of growing the
+ * buffer repeatedly. Callers formatting large documents whose size
+ * can be estimated upfront should use this.
+ */
+void
+virBufferReserve(virBufferPtr buf, unsigned int len)
+{
+    if (!buf || buf->error)
+        return;
+
+    if ((unsigned long long)buf->use + len < buf->size)
+        return;
+
+    if (VIR_REALLOC_N_QUIET(buf->content,
+                            (size_t)buf->use + len + 1) < 0) {
+        virBufferSetError(buf, errno);
+        return;
+    }
+    buf->size = buf->use + len + 1;
+}
+
 /**
  * virBufferAdd:
  * @buf: the buffer to append to
@@ -163,7 +202,6 @@ virBufferGrow(virBufferPtr buf, unsigned int len)
 void
 virBufferAdd(virBufferPtr buf, const char *str, int len)
 {
-    unsigned int needSize;
     int indent;
 
     if (!str || !buf || (len == 0 && buf->indent == 0))
@@ -176,8 +214,7 @@ virBufferAdd(virBufferPtr buf, const char *str, int len)
     if (len < 0)
         len = strlen(str);
 
-    needSize = buf->use + indent + len + 2;
-    if (virBufferGrow(buf, needSize - buf->use) < 0)
+    if (virBufferGrow(buf, indent + len) < 0)
         return;
 
     memset(&buf->content[buf->use], ' ', indent);
@@ -193,7 +230,8 @@ virBufferAdd(virBufferPtr buf, const char *str, int len)
  *
  * Add a buffer into another buffer without need to go through:
  * virBufferContentAndReset(), virBufferAdd(). Auto indentation
- * is (intentionally) NOT applied!
+ * is (intentionally) NOT applied! If @buf is still empty, the
+ * content of @toadd is moved over without copying.
  *
  * The @toadd virBuffer is consumed and cleared.
  */
@@ -212,6 +250,15 @@ virBufferAddBuffer(virBufferPtr buf, virBufferPtr toadd)
         goto done;
     }
 
+    if (buf->use == 0 && toadd->use && toadd->size >= buf->size) {
+        VIR_FREE(buf->content);
+        buf->content = toadd->content;
+        buf->size = toadd->size;
+        buf->use = toadd->use;
+        memset(toadd, 0, sizeof(*toadd));
+        return;
+    }
+
     if (virBufferGrow(buf, toadd->use) < 0)
         goto done;
 
@@ -280,6 +327,12 @@ virBufferContentAndReset(virBufferPtr buf)
     }
 
     str = buf->content;
+
+    /* Don't hand out a mostly unused allocation left by the geometric
+     * growth, the string may be kept around for a long time */
+    if (str && buf->size - buf->use > 4096 && buf->size - buf->use > buf->use / 2)
+        ignore_value(VIR_REALLOC_N_QUIET(str, buf->use + 1));
+
     memset(buf, 0, sizeof(*buf));
     return str;
 }
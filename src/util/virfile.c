@@ -351,8 +351,20 @@ virFileWrapperFdFree(virFileWrapperFdPtr wfd)
     if (!wfd)
         return;
 
-    if (wfd->err_msg && *wfd->err_msg)
-        VIR_WARN("iohelper reports: %s", wfd->err_msg);
+    if (wfd->err_msg) {
+        char *stats = strstr(wfd->err_msg, VIR_FILE_WRAPPER_STATS_PREFIX);
+
+        /* The statistics line comes last and is not an error */
+        if (stats) {
+            *stats = '\0';
+            stats += strlen(VIR_FILE_WRAPPER_STATS_PREFIX);
+            virTrimSpaces(stats, NULL);
+            VIR_INFO("iohelper transferred %s", stats);
+        }
+
+        if (*wfd->err_msg)
+            VIR_WARN("iohelper reports: %s", wfd->err_msg);
+    }
 
     virCommandAbort(wfd->cmd);
 
@@ -105,6 +105,9 @@ typedef enum {
     VIR_FILE_WRAPPER_NON_BLOCKING   = (1 << 1),
 } virFileWrapperFdFlags;
 
+/* Prefix of the line the I/O helper reports its transfer statistics on */
+# define VIR_FILE_WRAPPER_STATS_PREFIX "iohelper stats: "
+
 virFileWrapperFdPtr virFileWrapperFdNew(int *fd,
                                         const char *name,
                                         unsigned int flags)
@@ -49,9 +49,16 @@ struct _virFileCache {
 
     virHashTablePtr table;
 
+    /* names whose data is being created with the lock dropped */
+    virHashTablePtr pending;
+    virCond pendingCond;
+
     char *dir;
     char *suffix;
 
+    /* bumped whenever data is added to or dropped from @table */
+    unsigned long long generation;
+
     void *priv;
 
     virFileCacheHandlers handlers;
@@ -78,6 +85,8 @@ virFileCacheDispose(void *obj)
     VIR_FREE(cache->suffix);
 
     virHashFree(cache->table);
+    virHashFree(cache->pending);
+    virCondDestroy(&cache->pendingCond);
 
     virFileCachePrivFree(cache);
 }
@@ -194,6 +203,13 @@ virFileCacheSave(virFileCachePtr cache,
 }
 
 
+/*
+ * Called with @cache locked. Creating new data may take long (for
+ * example it may involve running a process), so the lock is dropped
+ * meanwhile. Concurrent lookups of @name wait for the result instead
+ * of creating the data a second time, lookups of other names are not
+ * blocked at all.
+ */
 static void *
 virFileCacheNewData(virFileCachePtr cache,
                     const char *name)
@@ -201,19 +217,51 @@ virFileCacheNewData(virFileCachePtr cache,
     void *data = NULL;
     int rv;
 
+    while (virHashLookup(cache->pending, name)) {
+        VIR_DEBUG("Waiting for data for '%s' being created", name);
+        if (virCondWait(&cache->pendingCond, &cache->parent.lock) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("failed to wait on cache condition"));
+            return NULL;
+        }
+    }
+
+    /* Whoever we waited for may have created it already. If they
+     * failed, try ourselves. */
+    if ((data = virHashLookup(cache->table, name)))
+        return data;
+
     if ((rv = virFileCacheLoad(cache, name, &data)) < 0)
         return NULL;
 
     if (rv == 0) {
-        if (!(data = cache->handlers.newData(name, cache->priv)))
+        if (virHashAddEntry(cache->pending, name, cache) < 0)
             return NULL;
 
-        if (virFileCacheSave(cache, name, data) < 0) {
+        virObjectUnlock(cache);
+
+        if ((data = cache->handlers.newData(name, cache->priv)) &&
+            virFileCacheSave(cache, name, data) < 0) {
             virObjectUnref(data);
             data = NULL;
         }
+
+        virObjectLock(cache);
+
+        virHashRemoveEntry(cache->pending, name);
+        virCondBroadcast(&cache->pendingCond);
     }
 
+    if (!data)
+        return NULL;
+
+    VIR_DEBUG("Caching data '%p' for '%s'", data, name);
+    if (virHashAddEntry(cache->table, name, data) < 0) {
+        virObjectUnref(data);
+        return NULL;
+    }
+    cache->generation++;
+
     return data;
 }
 
@@ -242,9 +290,16 @@ virFileCacheNew(const char *dir,
     if (!(cache = virObjectNew(virFileCacheClass)))
         return NULL;
 
-    if (!(cache->table = virHashCreate(10, virObjectFreeHashData)))
+    if (!(cache->table = virHashCreate(10, virObjectFreeHashData)) ||
+        !(cache->pending = virHashCreate(10, NULL)))
         goto cleanup;
 
+    if (virCondInit(&cache->pendingCond) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("cannot initialize condition variable"));
+        goto cleanup;
+    }
+
     if (VIR_STRDUP(cache->dir, dir) < 0)
         goto cleanup;
 
@@ -271,19 +326,13 @@ virFileCacheValidate(virFileCachePtr cache,
                   *data, NULLSTR(name));
         if (name)
             virHashRemoveEntry(cache->table, name);
+        cache->generation++;
         *data = NULL;
     }
 
     if (!*data && name) {
         VIR_DEBUG("Creating data for '%s'", name);
         *data = virFileCacheNewData(cache, name);
-        if (*data) {
-            VIR_DEBUG("Caching data '%p' for '%s'", *data, name);
-            if (virHashAddEntry(cache->table, name, *data) < 0) {
-                virObjectUnref(*data);
-                *data = NULL;
-            }
-        }
     }
 }
 
@@ -295,7 +344,8 @@ virFileCacheValidate(virFileCachePtr cache,
  *
  * Lookup a data specified by name.  This tries to find a file with
  * cached data, if it doesn't exist or is no longer valid new data
- * is created.
+ * is created.  While that happens other lookups of @name wait for the
+ * result, lookups of different names can proceed.
  *
  * Returns data object or NULL on error.  The caller is responsible for
  * unrefing the data.
@@ -412,8 +462,32 @@ virFileCacheInsertData(virFileCachePtr cache,
 
     virObjectLock(cache);
 
-    ret = virHashUpdateEntry(cache->table, name, data);
+    if ((ret = virHashUpdateEntry(cache->table, name, data)) == 0)
+        cache->generation++;
+
+    virObjectUnlock(cache);
+
+    return ret;
+}
+
 
+/**
+ * virFileCacheGetGeneration:
+ * @cache: existing cache object
+ *
+ * The generation changes whenever data is added to the cache or
+ * dropped from it, for example because it was no longer valid when
+ * looked up.
+ *
+ * Returns the current generation of @cache.
+ */
+unsigned long long
+virFileCacheGetGeneration(virFileCachePtr cache)
+{
+    unsigned long long ret;
+
+    virObjectLock(cache);
+    ret = cache->generation;
     virObjectUnlock(cache);
 
     return ret;
@@ -50,7 +50,9 @@ typedef bool
  * @priv: private data created together with cache
  *
  * Creates a new data based on the @name.  The returned data must be
- * an instance of virObject.
+ * an instance of virObject.  This is called without the cache being
+ * locked and may run concurrently for different names, so it must only
+ * read @priv.  The same applies to virFileCacheSaveFilePtr.
  *
  * Returns data object or NULL on error.
  */
@@ -134,4 +136,7 @@ virFileCacheInsertData(virFileCachePtr cache,
                        const char *name,
                        void *data);
 
+unsigned long long
+virFileCacheGetGeneration(virFileCachePtr cache);
+
 #endif /* LIBVIRT_VIRFILECACHE_H */
@@ -1,5 +1,5 @@
 /*
- * virhash.c: chained hash tables
+ * virhash.c: open addressing hash tables
  *
  * Reference: Your favorite introductory book on algorithms
  *
@@ -31,29 +31,43 @@
 
 VIR_LOG_INIT("util.hash");
 
-#define MAX_HASH_LEN 8
+/* Default and minimal number of slots */
+#define VIR_HASH_DEFAULT_SIZE 32
+#define VIR_HASH_MIN_SIZE 8
 
 /* #define DEBUG_GROW */
 
+typedef enum {
+    VIR_HASH_SLOT_EMPTY = 0,
+    VIR_HASH_SLOT_USED,
+    VIR_HASH_SLOT_DELETED, /* tombstone, keeps probe sequences intact */
+} virHashSlotState;
+
 /*
- * A single entry in the hash table
+ * A single slot in the hash table. Entries live directly in the slot
+ * array and collisions are resolved by linear probing, so a lookup
+ * usually touches a single cache line. The hash code of the key is
+ * kept alongside so that probing rarely calls keyEqual and growing
+ * the table never has to hash the keys again.
  */
 typedef struct _virHashEntry virHashEntry;
 typedef virHashEntry *virHashEntryPtr;
 struct _virHashEntry {
-    struct _virHashEntry *next;
     void *name;
     void *payload;
+    uint32_t code;
+    unsigned char state; /* virHashSlotState */
 };
 
 /*
  * The entire hash table
  */
 struct _virHashTable {
-    virHashEntryPtr *table;
+    virHashEntryPtr table;
     uint32_t seed;
-    size_t size;
-    size_t nbElems;
+    size_t size;      /* number of slots, power of two */
+    size_t nbElems;   /* used slots */
+    size_t nbDeleted; /* tombstones */
     virHashDataFree dataFree;
     virHashKeyCode keyCode;
     virHashKeyEqual keyEqual;
@@ -111,10 +125,86 @@ virHashValueFree(void *value, const void *name ATTRIBUTE_UNUSED)
 
 
 static size_t
-virHashComputeKey(const virHashTable *table, const void *name)
+virHashRoundSize(size_t size)
 {
-    uint32_t value = table->keyCode(name, table->seed);
-    return value % table->size;
+    size_t ret = VIR_HASH_MIN_SIZE;
+
+    while (ret < size)
+        ret *= 2;
+
+    return ret;
+}
+
+
+/**
+ * virHashFindSlot:
+ * @table: the hash table
+ * @name: the key
+ * @code: hash code of @name
+ * @free_slot: filled with the first reusable slot, may be NULL
+ *
+ * Walks the probe sequence of @code.
+ *
+ * Returns the slot holding @name or NULL if there's none. In the
+ * latter case @free_slot points to the slot @name should be stored in.
+ */
+static virHashEntryPtr
+virHashFindSlot(const virHashTable *table,
+                const void *name,
+                uint32_t code,
+                virHashEntryPtr *free_slot)
+{
+    size_t mask = table->size - 1;
+    size_t idx = code & mask;
+    virHashEntryPtr tombstone = NULL;
+    size_t i;
+
+    for (i = 0; i < table->size; i++) {
+        virHashEntryPtr entry = &table->table[idx];
+
+        switch ((virHashSlotState) entry->state) {
+        case VIR_HASH_SLOT_EMPTY:
+            if (free_slot)
+                *free_slot = tombstone ? tombstone : entry;
+            return NULL;
+
+        case VIR_HASH_SLOT_DELETED:
+            if (!tombstone)
+                tombstone = entry;
+            break;
+
+        case VIR_HASH_SLOT_USED:
+            if (entry->code == code && table->keyEqual(entry->name, name))
+                return entry;
+            break;
+        }
+
+        idx = (idx + 1) & mask;
+    }
+
+    /* no empty slot at all, the table is full of tombstones */
+    if (free_slot)
+        *free_slot = tombstone;
+    return NULL;
+}
+
+
+static void
+virHashClearSlot(virHashTablePtr table,
+                 virHashEntryPtr entry)
+{
+    entry->name = NULL;
+    entry->payload = NULL;
+    entry->state = VIR_HASH_SLOT_DELETED;
+    table->nbElems--;
+    table->nbDeleted++;
+
+    /* An empty table needs no tombstones. This is safe even while
+     * iterating as no entry moves. */
+    if (table->nbElems == 0) {
+        memset(table->table, 0, sizeof(*table->table) * table->size);
+        table->nbDeleted = 0;
+    }
 }
 
 /**
@@ -140,21 +230,22 @@ virHashTablePtr virHashCreateFull(ssize_t size,
     virHashTablePtr table = NULL;
 
     if (size <= 0)
-        size = 256;
+        size = VIR_HASH_DEFAULT_SIZE;
 
     if (VIR_ALLOC(table) < 0)
         return NULL;
 
     table->seed = virRandomBits(32);
-    table->size = size;
+    table->size = virHashRoundSize(size);
     table->nbElems = 0;
+    table->nbDeleted = 0;
     table->dataFree = dataFree;
     table->keyCode = keyCode;
     table->keyEqual = keyEqual;
     table->keyCopy = keyCopy;
     table->keyFree = keyFree;
 
-    if (VIR_ALLOC_N(table->table, size) < 0) {
+    if (VIR_ALLOC_N(table->table, table->size) < 0) {
         VIR_FREE(table);
         return NULL;
     }
@@ -217,7 +308,9 @@ virHashAtomicDispose(void *obj)
  * @table: the hash table
  * @size: the new size of the hash table
  *
- * resize the hash table
+ * Rehashes all entries into a table of @size slots, dropping all
+ * tombstones. Entries are moved, so this must never be called while
+ * the table is being iterated.
  *
  * Returns 0 in case of success, -1 in case of failure
  */
@@ -225,17 +318,13 @@ static int
 virHashGrow(virHashTablePtr table, size_t size)
 {
     size_t oldsize, i;
-    virHashEntryPtr *oldtable;
-
-#ifdef DEBUG_GROW
-    size_t nbElem = 0;
-#endif
+    virHashEntryPtr oldtable;
 
     if (table == NULL)
         return -1;
-    if (size < 8)
-        return -1;
-    if (size > 8 * 2048)
+
+    size = virHashRoundSize(size);
+    if (size < table->nbElems)
         return -1;
 
     oldsize = table->size;
@@ -248,28 +337,26 @@ virHashGrow(virHashTablePtr table, size_t size)
         return -1;
     }
     table->size = size;
+    table->nbDeleted = 0;
 
     for (i = 0; i < oldsize; i++) {
-        virHashEntryPtr iter = oldtable[i];
-        while (iter) {
-            virHashEntryPtr next = iter->next;
-            size_t key = virHashComputeKey(table, iter->name);
+        size_t idx;
 
-            iter->next = table->table[key];
-            table->table[key] = iter;
+        if (oldtable[i].state != VIR_HASH_SLOT_USED)
+            continue;
 
-#ifdef DEBUG_GROW
-            nbElem++;
-#endif
-            iter = next;
-        }
+        idx = oldtable[i].code & (size - 1);
+        while (table->table[idx].state != VIR_HASH_SLOT_EMPTY)
+            idx = (idx + 1) & (size - 1);
+
+        table->table[idx] = oldtable[i];
     }
 
     VIR_FREE(oldtable);
 
 #ifdef DEBUG_GROW
-    VIR_DEBUG("virHashGrow : from %d to %d, %ld elems", oldsize,
-              size, nbElem);
+    VIR_DEBUG("virHashGrow : from %zu to %zu, %zu elems", oldsize,
+              size, table->nbElems);
 #endif
 
     return 0;
@@ -291,17 +378,15 @@ virHashFree(virHashTablePtr table)
         return;
 
     for (i = 0; i < table->size; i++) {
-        virHashEntryPtr iter = table->table[i];
-        while (iter) {
-            virHashEntryPtr next = iter->next;
+        virHashEntryPtr entry = &table->table[i];
 
-            if (table->dataFree)
-                table->dataFree(iter->payload, iter->name);
-            if (table->keyFree)
-                table->keyFree(iter->name);
-            VIR_FREE(iter);
-            iter = next;
-        }
+        if (entry->state != VIR_HASH_SLOT_USED)
+            continue;
+
+        if (table->dataFree)
+            table->dataFree(entry->payload, entry->name);
+        if (table->keyFree)
+            table->keyFree(entry->name);
     }
 
     VIR_FREE(table->table);
@@ -313,46 +398,60 @@ virHashAddOrUpdateEntry(virHashTablePtr table, const void *name,
                         void *userdata,
                         bool is_update)
 {
-    size_t key, len = 0;
     virHashEntryPtr entry;
+    virHashEntryPtr free_slot = NULL;
+    uint32_t code;
     void *new_name;
 
     if ((table == NULL) || (name == NULL))
         return -1;
 
-    key = virHashComputeKey(table, name);
+    code = table->keyCode(name, table->seed);
 
     /* Check for duplicate entry */
-    for (entry = table->table[key]; entry; entry = entry->next) {
-        if (table->keyEqual(entry->name, name)) {
-            if (is_update) {
-                if (table->dataFree)
-                    table->dataFree(entry->payload, entry->name);
-                entry->payload = userdata;
-                return 0;
-            } else {
-                virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                               _("Duplicate key"));
-                return -1;
-            }
+    if ((entry = virHashFindSlot(table, name, code, &free_slot))) {
+        if (is_update) {
+            if (table->dataFree)
+                table->dataFree(entry->payload, entry->name);
+            entry->payload = userdata;
+            return 0;
+        } else {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("Duplicate key"));
+            return -1;
         }
-        len++;
     }
 
-    if (VIR_ALLOC(entry) < 0 || !(new_name = table->keyCopy(name))) {
-        VIR_FREE(entry);
-        return -1;
+    /* Reusing a tombstone leaves the load unchanged. Otherwise keep the
+     * load including tombstones below 3/4 so that probe sequences stay
+     * short. Grow if at least half of the slots are really used,
+     * otherwise rehashing just drops the tombstones. */
+    if ((!free_slot || free_slot->state != VIR_HASH_SLOT_DELETED) &&
+        (table->nbElems + table->nbDeleted + 1) * 4 > table->size * 3) {
+        size_t size = table->size;
+
+        if ((table->nbElems + 1) * 2 > size)
+            size *= 2;
+
+        if (virHashGrow(table, size) < 0)
+            return -1;
+
+        free_slot = NULL;
+        ignore_value(virHashFindSlot(table, name, code, &free_slot));
     }
 
-    entry->name = new_name;
-    entry->payload = userdata;
-    entry->next = table->table[key];
-    table->table[key] = entry;
+    if (!free_slot || !(new_name = table->keyCopy(name)))
+        return -1;
 
-    table->nbElems++;
+    if (free_slot->state == VIR_HASH_SLOT_DELETED)
+        table->nbDeleted--;
 
-    if (len > MAX_HASH_LEN)
-        virHashGrow(table, MAX_HASH_LEN * table->size);
+    free_slot->name = new_name;
+    free_slot->payload = userdata;
+    free_slot->code = code;
+    free_slot->state = VIR_HASH_SLOT_USED;
+
+    table->nbElems++;
 
     return 0;
 }
@@ -420,18 +519,16 @@ virHashAtomicUpdate(virHashAtomicPtr table,
 void *
 virHashLookup(const virHashTable *table, const void *name)
 {
-    size_t key;
     virHashEntryPtr entry;
 
     if (!table || !name)
         return NULL;
 
-    key = virHashComputeKey(table, name);
-    for (entry = table->table[key]; entry; entry = entry->next) {
-        if (table->keyEqual(entry->name, name))
-            return entry->payload;
-    }
-    return NULL;
+    if (!(entry = virHashFindSlot(table, name,
+                                  table->keyCode(name, table->seed), NULL)))
+        return NULL;
+
+    return entry->payload;
 }
 
 
@@ -492,7 +589,7 @@ virHashSize(const virHashTable *table)
  * virHashTableSize:
  * @table: the hash table
  *
- * Query the size of the hash @table, i.e., number of buckets in the table.
+ * Query the size of the hash @table, i.e., number of slots in the table.
  *
  * Returns the number of keys in the hash table or
  * -1 in case of error
@@ -521,27 +618,21 @@ int
 virHashRemoveEntry(virHashTablePtr table, const void *name)
 {
     virHashEntryPtr entry;
-    virHashEntryPtr *nextptr;
 
     if (table == NULL || name == NULL)
         return -1;
 
-    nextptr = table->table + virHashComputeKey(table, name);
-    for (entry = *nextptr; entry; entry = entry->next) {
-        if (table->keyEqual(entry->name, name)) {
-            if (table->dataFree)
-                table->dataFree(entry->payload, entry->name);
-            if (table->keyFree)
-                table->keyFree(entry->name);
-            *nextptr = entry->next;
-            VIR_FREE(entry);
-            table->nbElems--;
-            return 0;
-        }
-        nextptr = &entry->next;
-    }
+    if (!(entry = virHashFindSlot(table, name,
+                                  table->keyCode(name, table->seed), NULL)))
+        return -1;
 
-    return -1;
+    if (table->dataFree)
+        table->dataFree(entry->payload, entry->name);
+    if (table->keyFree)
+        table->keyFree(entry->name);
+    virHashClearSlot(table, entry);
+
+    return 0;
 }
 
 
@@ -568,17 +659,18 @@ virHashForEach(virHashTablePtr table, virHashIterator iter, void *data)
     if (table == NULL || iter == NULL)
         return -1;
 
+    /* Removing entries only leaves tombstones behind and never moves
+     * other entries, so @iter may remove the current one. */
     for (i = 0; i < table->size; i++) {
-        virHashEntryPtr entry = table->table[i];
-        while (entry) {
-            virHashEntryPtr next = entry->next;
-            ret = iter(entry->payload, entry->name, data);
+        virHashEntryPtr entry = &table->table[i];
 
-            if (ret < 0)
-                goto cleanup;
+        if (entry->state != VIR_HASH_SLOT_USED)
+            continue;
 
-            entry = next;
-        }
+        ret = iter(entry->payload, entry->name, data);
+
+        if (ret < 0)
+            goto cleanup;
     }
 
     ret = 0;
@@ -611,23 +703,18 @@ virHashRemoveSet(virHashTablePtr table,
         return -1;
 
     for (i = 0; i < table->size; i++) {
-        virHashEntryPtr *nextptr = table->table + i;
-
-        while (*nextptr) {
-            virHashEntryPtr entry = *nextptr;
-            if (!iter(entry->payload, entry->name, data)) {
-                nextptr = &entry->next;
-            } else {
-                count++;
-                if (table->dataFree)
-                    table->dataFree(entry->payload, entry->name);
-                if (table->keyFree)
-                    table->keyFree(entry->name);
-                *nextptr = entry->next;
-                VIR_FREE(entry);
-                table->nbElems--;
-            }
-        }
+        virHashEntryPtr entry = &table->table[i];
+
+        if (entry->state != VIR_HASH_SLOT_USED ||
+            !iter(entry->payload, entry->name, data))
+            continue;
+
+        count++;
+        if (table->dataFree)
+            table->dataFree(entry->payload, entry->name);
+        if (table->keyFree)
+            table->keyFree(entry->name);
+        virHashClearSlot(table, entry);
     }
 
     return count;
@@ -685,13 +772,15 @@ void *virHashSearch(const virHashTable *ctable,
         return NULL;
 
     for (i = 0; i < table->size; i++) {
-        virHashEntryPtr entry;
-        for (entry = table->table[i]; entry; entry = entry->next) {
-            if (iter(entry->payload, entry->name, data)) {
-                if (name)
-                    *name = table->keyCopy(entry->name);
-                return entry->payload;
-            }
+        virHashEntryPtr entry = &table->table[i];
+
+        if (entry->state != VIR_HASH_SLOT_USED)
+            continue;
+
+        if (iter(entry->payload, entry->name, data)) {
+            if (name)
+                *name = table->keyCopy(entry->name);
+            return entry->payload;
         }
     }
 
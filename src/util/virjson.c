@@ -28,6 +28,8 @@
 #include "virlog.h"
 #include "virstring.h"
 #include "virutil.h"
+#include "virhashcode.h"
+#include "virrandom.h"
 
 #if WITH_YAJL
 # include <yajl/yajl_gen.h>
@@ -65,9 +67,18 @@ struct _virJSONObjectPair {
     virJSONValuePtr value;
 };
 
+/* Objects with at least this many members get a hash index on lookup */
+#define VIR_JSON_OBJECT_INDEX_MIN_PAIRS 16
+
 struct _virJSONObject {
     size_t npairs;
     virJSONObjectPairPtr pairs;
+
+    /* Lazily built open addressing index into @pairs. Each slot holds
+     * the position of a pair plus one, zero marks an empty slot. */
+    size_t *index;
+    size_t nindex; /* power of two, at least twice @npairs */
+    uint32_t seed;
 };
 
 struct _virJSONArray {
@@ -416,6 +427,7 @@ virJSONValueFree(virJSONValuePtr value)
             virJSONValueFree(value->data.object.pairs[i].value);
         }
         VIR_FREE(value->data.object.pairs);
+        VIR_FREE(value->data.object.index);
         break;
     case VIR_JSON_TYPE_ARRAY:
         for (i = 0; i < value->data.array.nvalues; i++)
@@ -613,6 +625,100 @@ virJSONValueNewObject(void)
 }
 
 
+static void
+virJSONObjectIndexInsert(virJSONObjectPtr obj,
+                         size_t pos)
+{
+    const char *key = obj->pairs[pos].key;
+    size_t mask = obj->nindex - 1;
+    size_t slot = virHashCodeGen(key, strlen(key), obj->seed) & mask;
+
+    while (obj->index[slot]) {
+        /* keep the first of duplicate keys */
+        if (STREQ(obj->pairs[obj->index[slot] - 1].key, key))
+            return;
+        slot = (slot + 1) & mask;
+    }
+
+    obj->index[slot] = pos + 1;
+}
+
+
+static void
+virJSONObjectIndexClear(virJSONObjectPtr obj)
+{
+    VIR_FREE(obj->index);
+    obj->nindex = 0;
+}
+
+
+static int
+virJSONObjectIndexBuild(virJSONObjectPtr obj)
+{
+    size_t nindex = 32;
+    size_t i;
+
+    while (nindex < obj->npairs * 2)
+        nindex *= 2;
+
+    if (VIR_ALLOC_N_QUIET(obj->index, nindex) < 0)
+        return -1;
+
+    obj->nindex = nindex;
+    obj->seed = virRandomBits(32);
+
+    for (i = 0; i < obj->npairs; i++)
+        virJSONObjectIndexInsert(obj, i);
+
+    return 0;
+}
+
+
+/**
+ * virJSONObjectFind:
+ * @obj: JSON object
+ * @key: member name
+ *
+ * Looks up the position of the first member called @key. Small
+ * objects are scanned linearly, larger ones get a hash index on first
+ * lookup which is kept up to date by virJSONValueObjectAppend and
+ * dropped whenever members are removed.
+ *
+ * Returns the position in @obj->pairs or -1 if @key is missing.
+ */
+static ssize_t
+virJSONObjectFind(virJSONObjectPtr obj,
+                  const char *key)
+{
+    size_t mask;
+    size_t slot;
+    size_t i;
+
+    if (!obj->index &&
+        (obj->npairs < VIR_JSON_OBJECT_INDEX_MIN_PAIRS ||
+         virJSONObjectIndexBuild(obj) < 0)) {
+        for (i = 0; i < obj->npairs; i++) {
+            if (STREQ(obj->pairs[i].key, key))
+                return i;
+        }
+        return -1;
+    }
+
+    mask = obj->nindex - 1;
+    slot = virHashCodeGen(key, strlen(key), obj->seed) & mask;
+
+    while (obj->index[slot]) {
+        size_t pos = obj->index[slot] - 1;
+
+        if (STREQ(obj->pairs[pos].key, key))
+            return pos;
+        slot = (slot + 1) & mask;
+    }
+
+    return -1;
+}
+
+
 int
 virJSONValueObjectAppend(virJSONValuePtr object,
                          const char *key,
@@ -639,6 +745,14 @@ virJSONValueObjectAppend(virJSONValuePtr object,
     object->data.object.pairs[object->data.object.npairs].value = value;
     object->data.object.npairs++;
 
+    if (object->data.object.index) {
+        if (object->data.object.npairs * 2 > object->data.object.nindex)
+            virJSONObjectIndexClear(&object->data.object);
+        else
+            virJSONObjectIndexInsert(&object->data.object,
+                                     object->data.object.npairs - 1);
+    }
+
     return 0;
 }
 
@@ -792,17 +906,10 @@ int
 virJSONValueObjectHasKey(virJSONValuePtr object,
                          const char *key)
 {
-    size_t i;
-
     if (object->type != VIR_JSON_TYPE_OBJECT)
         return -1;
 
-    for (i = 0; i < object->data.object.npairs; i++) {
-        if (STREQ(object->data.object.pairs[i].key, key))
-            return 1;
-    }
-
-    return 0;
+    return virJSONObjectFind(&object->data.object, key) >= 0;
 }
 
 
@@ -810,17 +917,15 @@ virJSONValuePtr
 virJSONValueObjectGet(virJSONValuePtr object,
                       const char *key)
 {
-    size_t i;
+    ssize_t i;
 
     if (object->type != VIR_JSON_TYPE_OBJECT)
         return NULL;
 
-    for (i = 0; i < object->data.object.npairs; i++) {
-        if (STREQ(object->data.object.pairs[i].key, key))
-            return object->data.object.pairs[i].value;
-    }
+    if ((i = virJSONObjectFind(&object->data.object, key)) < 0)
+        return NULL;
 
-    return NULL;
+    return object->data.object.pairs[i].value;
 }
 
 
@@ -828,21 +933,20 @@ static virJSONValuePtr
 virJSONValueObjectSteal(virJSONValuePtr object,
                         const char *key)
 {
-    size_t i;
+    ssize_t i;
     virJSONValuePtr obj = NULL;
 
     if (object->type != VIR_JSON_TYPE_OBJECT)
         return NULL;
 
-    for (i = 0; i < object->data.object.npairs; i++) {
-        if (STREQ(object->data.object.pairs[i].key, key)) {
-            VIR_STEAL_PTR(obj, object->data.object.pairs[i].value);
-            VIR_FREE(object->data.object.pairs[i].key);
-            VIR_DELETE_ELEMENT(object->data.object.pairs, i,
-                               object->data.object.npairs);
-            break;
-        }
-    }
+    if ((i = virJSONObjectFind(&object->data.object, key)) < 0)
+        return NULL;
+
+    VIR_STEAL_PTR(obj, object->data.object.pairs[i].value);
+    VIR_FREE(object->data.object.pairs[i].key);
+    VIR_DELETE_ELEMENT(object->data.object.pairs, i,
+                       object->data.object.npairs);
+    virJSONObjectIndexClear(&object->data.object);
 
     return obj;
 }
@@ -910,7 +1014,7 @@ virJSONValueObjectRemoveKey(virJSONValuePtr object,
                             const char *key,
                             virJSONValuePtr *value)
 {
-    size_t i;
+    ssize_t i;
 
     if (value)
         *value = NULL;
@@ -918,21 +1022,20 @@ virJSONValueObjectRemoveKey(virJSONValuePtr object,
     if (object->type != VIR_JSON_TYPE_OBJECT)
         return -1;
 
-    for (i = 0; i < object->data.object.npairs; i++) {
-        if (STREQ(object->data.object.pairs[i].key, key)) {
-            if (value) {
-                *value = object->data.object.pairs[i].value;
-                object->data.object.pairs[i].value = NULL;
-            }
-            VIR_FREE(object->data.object.pairs[i].key);
-            virJSONValueFree(object->data.object.pairs[i].value);
-            VIR_DELETE_ELEMENT(object->data.object.pairs, i,
-                               object->data.object.npairs);
-            return 1;
-        }
+    if ((i = virJSONObjectFind(&object->data.object, key)) < 0)
+        return 0;
+
+    if (value) {
+        *value = object->data.object.pairs[i].value;
+        object->data.object.pairs[i].value = NULL;
     }
+    VIR_FREE(object->data.object.pairs[i].key);
+    virJSONValueFree(object->data.object.pairs[i].value);
+    VIR_DELETE_ELEMENT(object->data.object.pairs, i,
+                       object->data.object.npairs);
+    virJSONObjectIndexClear(&object->data.object);
 
-    return 0;
+    return 1;
 }
 
 
@@ -1504,6 +1607,305 @@ virJSONValueCopy(const virJSONValue *in)
 }
 
 
+void
+virJSONWriterInit(virJSONWriterPtr writer,
+                  virBufferPtr buf)
+{
+    writer->buf = buf;
+    writer->needSep = false;
+    writer->invalid = false;
+}
+
+
+/**
+ * virJSONWriterCheckError:
+ * @writer: JSON writer
+ *
+ * Reports an error if any string passed to @writer was not valid UTF-8
+ * or if the underlying buffer ran out of memory.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virJSONWriterCheckError(virJSONWriterPtr writer)
+{
+    if (writer->invalid) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("cannot format JSON string which is not valid UTF-8"));
+        return -1;
+    }
+
+    return virBufferCheckError(writer->buf);
+}
+
+
+static void
+virJSONWriterSeparator(virJSONWriterPtr writer)
+{
+    if (writer->needSep)
+        virBufferAddChar(writer->buf, ',');
+    writer->needSep = false;
+}
+
+
+/* Same acceptance rules as the UTF-8 validation of yajl_gen */
+static bool
+virJSONStringIsValidUTF8(const unsigned char *str)
+{
+    while (*str) {
+        size_t ncont;
+
+        if (*str <= 0x7f)
+            ncont = 0;
+        else if ((*str >> 5) == 0x6)
+            ncont = 1;
+        else if ((*str >> 4) == 0xe)
+            ncont = 2;
+        else if ((*str >> 3) == 0x1e)
+            ncont = 3;
+        else
+            return false;
+
+        str++;
+        while (ncont--) {
+            if ((*str >> 6) != 0x2)
+                return false;
+            str++;
+        }
+    }
+
+    return true;
+}
+
+
+static void
+virJSONWriterEscape(virJSONWriterPtr writer,
+                    const char *str)
+{
+    static const char hex[] = "0123456789abcdef";
+    const char *start = str;
+    const char *cur;
+
+    if (!virJSONStringIsValidUTF8((const unsigned char *) str)) {
+        writer->invalid = true;
+        return;
+    }
+
+    virBufferAddChar(writer->buf, '"');
+
+    for (cur = str; *cur; cur++) {
+        unsigned char c = *cur;
+        char esc[7] = { '\\', 0 };
+
+        switch (c) {
+        case '"':
+        case '\\':
+            esc[1] = c;
+            break;
+        case '\b':
+            esc[1] = 'b';
+            break;
+        case '\f':
+            esc[1] = 'f';
+            break;
+        case '\n':
+            esc[1] = 'n';
+            break;
+        case '\r':
+            esc[1] = 'r';
+            break;
+        case '\t':
+            esc[1] = 't';
+            break;
+        default:
+            if (c >= 0x20)
+                continue;
+            esc[1] = 'u';
+            esc[2] = '0';
+            esc[3] = '0';
+            esc[4] = hex[c >> 4];
+            esc[5] = hex[c & 0xf];
+            break;
+        }
+
+        virBufferAdd(writer->buf, start, cur - start);
+        virBufferAdd(writer->buf, esc, -1);
+        start = cur + 1;
+    }
+
+    virBufferAdd(writer->buf, start, cur - start);
+    virBufferAddChar(writer->buf, '"');
+}
+
+
+void
+virJSONWriterObjectStart(virJSONWriterPtr writer)
+{
+    virJSONWriterSeparator(writer);
+    virBufferAddChar(writer->buf, '{');
+}
+
+
+void
+virJSONWriterObjectEnd(virJSONWriterPtr writer)
+{
+    virBufferAddChar(writer->buf, '}');
+    writer->needSep = true;
+}
+
+
+void
+virJSONWriterArrayStart(virJSONWriterPtr writer)
+{
+    virJSONWriterSeparator(writer);
+    virBufferAddChar(writer->buf, '[');
+}
+
+
+void
+virJSONWriterArrayEnd(virJSONWriterPtr writer)
+{
+    virBufferAddChar(writer->buf, ']');
+    writer->needSep = true;
+}
+
+
+void
+virJSONWriterKey(virJSONWriterPtr writer,
+                 const char *key)
+{
+    virJSONWriterSeparator(writer);
+    virJSONWriterEscape(writer, key);
+    virBufferAddChar(writer->buf, ':');
+}
+
+
+void
+virJSONWriterString(virJSONWriterPtr writer,
+                    const char *value)
+{
+    virJSONWriterSeparator(writer);
+    virJSONWriterEscape(writer, value);
+    writer->needSep = true;
+}
+
+
+/* @value must already be formatted as a JSON number */
+void
+virJSONWriterNumber(virJSONWriterPtr writer,
+                    const char *value)
+{
+    virJSONWriterSeparator(writer);
+    virBufferAdd(writer->buf, value, -1);
+    writer->needSep = true;
+}
+
+
+void
+virJSONWriterNumberLong(virJSONWriterPtr writer,
+                        long long value)
+{
+    virJSONWriterSeparator(writer);
+    virBufferAsprintf(writer->buf, "%lld", value);
+    writer->needSep = true;
+}
+
+
+void
+virJSONWriterNumberUlong(virJSONWriterPtr writer,
+                         unsigned long long value)
+{
+    virJSONWriterSeparator(writer);
+    virBufferAsprintf(writer->buf, "%llu", value);
+    writer->needSep = true;
+}
+
+
+void
+virJSONWriterBoolean(virJSONWriterPtr writer,
+                     bool value)
+{
+    virJSONWriterSeparator(writer);
+    virBufferAdd(writer->buf, value ? "true" : "false", -1);
+    writer->needSep = true;
+}
+
+
+void
+virJSONWriterNull(virJSONWriterPtr writer)
+{
+    virJSONWriterSeparator(writer);
+    virBufferAddLit(writer->buf, "null");
+    writer->needSep = true;
+}
+
+
+void
+virJSONWriterValue(virJSONWriterPtr writer,
+                   virJSONValuePtr value)
+{
+    size_t i;
+
+    switch ((virJSONType) value->type) {
+    case VIR_JSON_TYPE_OBJECT:
+        virJSONWriterObjectStart(writer);
+        for (i = 0; i < value->data.object.npairs; i++) {
+            virJSONWriterKey(writer, value->data.object.pairs[i].key);
+            virJSONWriterValue(writer, value->data.object.pairs[i].value);
+        }
+        virJSONWriterObjectEnd(writer);
+        break;
+
+    case VIR_JSON_TYPE_ARRAY:
+        virJSONWriterArrayStart(writer);
+        for (i = 0; i < value->data.array.nvalues; i++)
+            virJSONWriterValue(writer, value->data.array.values[i]);
+        virJSONWriterArrayEnd(writer);
+        break;
+
+    case VIR_JSON_TYPE_STRING:
+        virJSONWriterString(writer, value->data.string);
+        break;
+
+    case VIR_JSON_TYPE_NUMBER:
+        virJSONWriterNumber(writer, value->data.number);
+        break;
+
+    case VIR_JSON_TYPE_BOOLEAN:
+        virJSONWriterBoolean(writer, value->data.boolean);
+        break;
+
+    case VIR_JSON_TYPE_NULL:
+        virJSONWriterNull(writer);
+        break;
+    }
+}
+
+
+/**
+ * virJSONValueToBuffer:
+ * @object: JSON value
+ * @buf: buffer to append to
+ *
+ * Appends compact JSON representation of @object to @buf. This is
+ * identical to virJSONValueToString(@object, false) but avoids the
+ * intermediate string.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virJSONValueToBuffer(virJSONValuePtr object,
+                     virBufferPtr buf)
+{
+    virJSONWriter writer;
+
+    virJSONWriterInit(&writer, buf);
+    virJSONWriterValue(&writer, object);
+
+    return virJSONWriterCheckError(&writer);
+}
+
+
 #if WITH_YAJL
 static int
 virJSONParserInsertValue(virJSONParserPtr parser,
@@ -1947,16 +2349,15 @@ virJSONValueToStringOne(virJSONValuePtr object,
 }
 
 
-char *
-virJSONValueToString(virJSONValuePtr object,
-                     bool pretty)
+static char *
+virJSONValueToStringPretty(virJSONValuePtr object)
 {
     yajl_gen g;
     const unsigned char *str;
     char *ret = NULL;
     yajl_size_t len;
 # ifndef WITH_YAJL2
-    yajl_gen_config conf = { pretty ? 1 : 0, pretty ? "  " : " "};
+    yajl_gen_config conf = { 1, "  " };
 # endif
 
     VIR_DEBUG("object=%p", object);
@@ -1964,8 +2365,8 @@ virJSONValueToString(virJSONValuePtr object,
 # ifdef WITH_YAJL2
     g = yajl_gen_alloc(NULL);
     if (g) {
-        yajl_gen_config(g, yajl_gen_beautify, pretty ? 1 : 0);
-        yajl_gen_config(g, yajl_gen_indent_string, pretty ? "  " : " ");
+        yajl_gen_config(g, yajl_gen_beautify, 1);
+        yajl_gen_config(g, yajl_gen_indent_string, "  ");
         yajl_gen_config(g, yajl_gen_validate_utf8, 1);
     }
 # else
@@ -2008,9 +2409,8 @@ virJSONValueFromString(const char *jsonstring ATTRIBUTE_UNUSED)
 }
 
 
-char *
-virJSONValueToString(virJSONValuePtr object ATTRIBUTE_UNUSED,
-                     bool pretty ATTRIBUTE_UNUSED)
+static char *
+virJSONValueToStringPretty(virJSONValuePtr object ATTRIBUTE_UNUSED)
 {
     virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                    _("No JSON parser implementation is available"));
@@ -2019,6 +2419,24 @@ virJSONValueToString(virJSONValuePtr object ATTRIBUTE_UNUSED,
 #endif
 
 
+char *
+virJSONValueToString(virJSONValuePtr object,
+                     bool pretty)
+{
+    virBuffer buf = VIR_BUFFER_INITIALIZER;
+
+    if (pretty)
+        return virJSONValueToStringPretty(object);
+
+    if (virJSONValueToBuffer(object, &buf) < 0) {
+        virBufferFreeAndReset(&buf);
+        return NULL;
+    }
+
+    return virBufferContentAndReset(&buf);
+}
+
+
 /**
  * virJSONStringReformat:
  * @jsonstr: string to reformat
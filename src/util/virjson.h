@@ -26,6 +26,7 @@
 # include "internal.h"
 # include "virbitmap.h"
 # include "viralloc.h"
+# include "virbuffer.h"
 
 # include <stdarg.h>
 
@@ -141,6 +142,42 @@ int virJSONValueObjectRemoveKey(virJSONValuePtr object, const char *key,
 virJSONValuePtr virJSONValueFromString(const char *jsonstring);
 char *virJSONValueToString(virJSONValuePtr object,
                            bool pretty);
+int virJSONValueToBuffer(virJSONValuePtr object,
+                         virBufferPtr buf)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2) ATTRIBUTE_RETURN_CHECK;
+
+/*
+ * Streaming writer producing compact JSON directly into a virBuffer
+ * without building a virJSONValue tree first. Separators are inserted
+ * automatically; errors are collected and reported by
+ * virJSONWriterCheckError.
+ */
+typedef struct _virJSONWriter virJSONWriter;
+typedef virJSONWriter *virJSONWriterPtr;
+struct _virJSONWriter {
+    virBufferPtr buf;
+    bool needSep;
+    bool invalid;
+};
+
+void virJSONWriterInit(virJSONWriterPtr writer, virBufferPtr buf)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2);
+int virJSONWriterCheckError(virJSONWriterPtr writer)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_RETURN_CHECK;
+
+void virJSONWriterObjectStart(virJSONWriterPtr writer);
+void virJSONWriterObjectEnd(virJSONWriterPtr writer);
+void virJSONWriterArrayStart(virJSONWriterPtr writer);
+void virJSONWriterArrayEnd(virJSONWriterPtr writer);
+void virJSONWriterKey(virJSONWriterPtr writer, const char *key);
+void virJSONWriterString(virJSONWriterPtr writer, const char *value);
+void virJSONWriterNumber(virJSONWriterPtr writer, const char *value);
+void virJSONWriterNumberLong(virJSONWriterPtr writer, long long value);
+void virJSONWriterNumberUlong(virJSONWriterPtr writer,
+                              unsigned long long value);
+void virJSONWriterBoolean(virJSONWriterPtr writer, bool value);
+void virJSONWriterNull(virJSONWriterPtr writer);
+void virJSONWriterValue(virJSONWriterPtr writer, virJSONValuePtr value);
 
 typedef int (*virJSONValueObjectIteratorFunc)(const char *key,
                                               virJSONValuePtr value,
@@ -0,0 +1,207 @@
+/*
+ * virrcu.c: epoch based read-copy-update
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * Readers of a structure published with virAtomicPointerSet wrap
+ * their accesses in virRCUReadLock/virRCUReadUnlock. Those only
+ * write to a slot private to the calling thread, so concurrent
+ * readers never contend on a shared cache line. A writer publishes
+ * a new version of the structure and calls virRCUSynchronize before
+ * freeing the old one; it returns once every reader that could still
+ * see the old version has left its read side section.
+ */
+
+#include <config.h>
+
+#include <sched.h>
+
+#include "virrcu.h"
+#include "viralloc.h"
+#include "viratomic.h"
+#include "virerror.h"
+#include "virlog.h"
+#include "virthread.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+VIR_LOG_INIT("util.rcu");
+
+typedef struct _virRCUReader virRCUReader;
+typedef virRCUReader *virRCUReaderPtr;
+struct _virRCUReader {
+    /* epoch the reader entered its section in, 0 when outside */
+    volatile unsigned int epoch;
+    size_t nesting;
+
+    bool used; /* protected by virRCULock */
+    virRCUReaderPtr next;
+};
+
+static virMutex virRCULock = VIR_MUTEX_INITIALIZER;
+static virRCUReaderPtr virRCUReaders;
+static volatile unsigned int virRCUEpoch = 1;
+static virThreadLocal virRCUReaderLocal;
+
+
+static void
+virRCUReaderRelease(void *opaque)
+{
+    virRCUReaderPtr reader = opaque;
+
+    virAtomicIntSet(&reader->epoch, 0);
+
+    virMutexLock(&virRCULock);
+    reader->nesting = 0;
+    reader->used = false;
+    virMutexUnlock(&virRCULock);
+}
+
+
+static int
+virRCUOnceInit(void)
+{
+    if (virThreadLocalInit(&virRCUReaderLocal, virRCUReaderRelease) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to initialize thread local variable"));
+        return -1;
+    }
+
+    return 0;
+}
+
+VIR_ONCE_GLOBAL_INIT(virRCU)
+
+
+/* Slots of exited threads are reused, so the list is bounded by the
+ * largest number of threads that ever read at the same time. */
+static virRCUReaderPtr
+virRCUReaderGet(void)
+{
+    virRCUReaderPtr reader;
+
+    if (virRCUInitialize() < 0)
+        return NULL;
+
+    if ((reader = virThreadLocalGet(&virRCUReaderLocal)))
+        return reader;
+
+    virMutexLock(&virRCULock);
+    for (reader = virRCUReaders; reader; reader = reader->next) {
+        if (!reader->used)
+            break;
+    }
+
+    if (!reader) {
+        if (VIR_ALLOC(reader) < 0)
+            goto cleanup;
+        reader->next = virRCUReaders;
+        virRCUReaders = reader;
+    }
+
+    if (virThreadLocalSet(&virRCUReaderLocal, reader) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("cannot set up RCU reader"));
+        reader = NULL;
+        goto cleanup;
+    }
+    reader->used = true;
+
+ cleanup:
+    virMutexUnlock(&virRCULock);
+    return reader;
+}
+
+
+/**
+ * virRCUReadLock:
+ *
+ * Enters a read side section. Pointers loaded with virAtomicPointerGet
+ * afterwards stay valid until the matching virRCUReadUnlock. Sections
+ * may nest but must not call virRCUSynchronize.
+ *
+ * Returns 0 on success, -1 with error reported if the calling thread
+ * couldn't be registered as a reader.
+ */
+int
+virRCUReadLock(void)
+{
+    virRCUReaderPtr reader;
+
+    if (!(reader = virRCUReaderGet()))
+        return -1;
+
+    /* The full barrier in virAtomicIntSet orders the epoch store
+     * before any load of the protected pointers. */
+    if (reader->nesting++ == 0)
+        virAtomicIntSet(&reader->epoch, virAtomicIntGet(&virRCUEpoch));
+
+    return 0;
+}
+
+
+/**
+ * virRCUReadUnlock:
+ *
+ * Leaves a read side section entered by virRCUReadLock.
+ */
+void
+virRCUReadUnlock(void)
+{
+    virRCUReaderPtr reader = virThreadLocalGet(&virRCUReaderLocal);
+
+    if (!reader || reader->nesting == 0)
+        return;
+
+    /* The atomic 'and' is a full barrier, keeping all loads from the
+     * section before the epoch is cleared. */
+    if (--reader->nesting == 0)
+        virAtomicIntAnd(&reader->epoch, 0);
+}
+
+
+/**
+ * virRCUSynchronize:
+ *
+ * Waits until every read side section which was active when this
+ * function was called has finished. After a new version of a
+ * structure was published, the old one can be freed once this
+ * returns. Must not be called from within a read side section.
+ */
+void
+virRCUSynchronize(void)
+{
+    virRCUReaderPtr reader;
+    unsigned int epoch;
+
+    /* Readers store the current epoch, 0 means idle */
+    while ((epoch = virAtomicIntInc(&virRCUEpoch)) == 0)
+        ;
+
+    virMutexLock(&virRCULock);
+    for (reader = virRCUReaders; reader; reader = reader->next) {
+        unsigned int readerEpoch;
+
+        while ((readerEpoch = virAtomicIntGet(&reader->epoch)) != 0 &&
+               (int) (epoch - readerEpoch) > 0) {
+#ifdef WIN32
+            SleepEx(0, 0);
+#else
+            sched_yield();
+#endif
+        }
+    }
+    virMutexUnlock(&virRCULock);
+}
@@ -0,0 +1,29 @@
+/*
+ * virrcu.h: epoch based read-copy-update
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBVIRT_VIRRCU_H
+# define LIBVIRT_VIRRCU_H
+
+# include "internal.h"
+
+int virRCUReadLock(void) ATTRIBUTE_RETURN_CHECK;
+void virRCUReadUnlock(void);
+
+void virRCUSynchronize(void);
+
+#endif /* LIBVIRT_VIRRCU_H */
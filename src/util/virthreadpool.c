@@ -26,9 +26,13 @@
 #include "viralloc.h"
 #include "virthread.h"
 #include "virerror.h"
+#include "viratomic.h"
+#include "virlog.h"
 
 #define VIR_FROM_THIS VIR_FROM_NONE
 
+VIR_LOG_INIT("util.threadpool");
+
 typedef struct _virThreadPoolJob virThreadPoolJob;
 typedef virThreadPoolJob *virThreadPoolJobPtr;
 
@@ -477,3 +481,77 @@ virThreadPoolSetParameters(virThreadPoolPtr pool,
     virMutexUnlock(&pool->mutex);
     return -1;
 }
+
+
+struct virThreadPoolBatch {
+    virThreadPoolBatchFunc func;
+    void *opaque;
+    size_t njobs;
+    int next;
+};
+
+
+static void
+virThreadPoolBatchWorker(void *opaque)
+{
+    struct virThreadPoolBatch *batch = opaque;
+    int idx;
+
+    while ((idx = virAtomicIntInc(&batch->next) - 1) < (int) batch->njobs)
+        batch->func(idx, batch->opaque);
+}
+
+
+/**
+ * virThreadPoolRunBatchFull:
+ * @maxWorkers: upper bound of threads running @func concurrently
+ * @njobs: number of jobs
+ * @func: callback invoked once for every index in [0, @njobs)
+ * @funcName: name of @func used for the worker threads
+ * @opaque: data passed to @func
+ *
+ * Runs @func for every job index on up to @maxWorkers threads and
+ * waits until all of them are done. The calling thread is one of
+ * the workers, so all jobs are run even if no additional thread can
+ * be spawned. Jobs are handed out in increasing index order, but may
+ * complete in any order; @func is responsible for storing its result
+ * (and any error) in a per-index slot.
+ */
+void
+virThreadPoolRunBatchFull(size_t maxWorkers,
+                          size_t njobs,
+                          virThreadPoolBatchFunc func,
+                          const char *funcName,
+                          void *opaque)
+{
+    struct virThreadPoolBatch batch = {
+        .func = func, .opaque = opaque, .njobs = njobs, .next = 0,
+    };
+    virThreadPtr threads = NULL;
+    size_t nthreads = 0;
+    size_t i;
+
+    if (maxWorkers > njobs)
+        maxWorkers = njobs;
+
+    if (maxWorkers > 1 &&
+        VIR_ALLOC_N_QUIET(threads, maxWorkers - 1) == 0) {
+        for (i = 0; i < maxWorkers - 1; i++) {
+            if (virThreadCreateFull(&threads[nthreads], true,
+                                    virThreadPoolBatchWorker, funcName,
+                                    false, &batch) < 0) {
+                VIR_WARN("Failed to spawn worker thread for %s, using %zu",
+                         funcName, nthreads + 1);
+                break;
+            }
+            nthreads++;
+        }
+    }
+
+    virThreadPoolBatchWorker(&batch);
+
+    for (i = 0; i < nthreads; i++)
+        virThreadJoin(&threads[i]);
+
+    VIR_FREE(threads);
+}
@@ -58,4 +58,15 @@ int virThreadPoolSetParameters(virThreadPoolPtr pool,
                                long long int maxWorkers,
                                long long int prioWorkers);
 
+typedef void (*virThreadPoolBatchFunc)(size_t idx, void *opaque);
+
+# define virThreadPoolRunBatch(workers, njobs, func, opaque) \
+    virThreadPoolRunBatchFull(workers, njobs, func, #func, opaque)
+
+void virThreadPoolRunBatchFull(size_t maxWorkers,
+                               size_t njobs,
+                               virThreadPoolBatchFunc func,
+                               const char *funcName,
+                               void *opaque) ATTRIBUTE_NONNULL(3);
+
 #endif /* LIBVIRT_VIRTHREADPOOL_H */
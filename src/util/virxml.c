@@ -505,6 +505,45 @@ virXMLPropString(xmlNodePtr node,
 }
 
 
+/**
+ * virXMLPropStringArena:
+ * @node: XML dom node pointer
+ * @name: Name of the property (attribute) to get
+ * @arena: arena to allocate the copy from
+ *
+ * Like virXMLPropString, but the copy is owned by @arena and released
+ * with it. Plain text attribute values are copied straight out of the
+ * tree without an intermediate heap allocation.
+ *
+ * Returns the property (attribute) value as string or NULL in case of failure.
+ */
+char *
+virXMLPropStringArena(xmlNodePtr node,
+                      const char *name,
+                      virArenaPtr arena)
+{
+    xmlAttrPtr attr;
+    xmlChar *tmp;
+    char *ret;
+
+    if (!(attr = xmlHasProp(node, BAD_CAST name)))
+        return NULL;
+
+    if (attr->type == XML_ATTRIBUTE_NODE &&
+        attr->children &&
+        !attr->children->next &&
+        attr->children->type == XML_TEXT_NODE)
+        return virArenaStrdup(arena, (const char *)attr->children->content);
+
+    if (!(tmp = xmlGetProp(node, BAD_CAST name)))
+        return NULL;
+
+    ret = virArenaStrdup(arena, (const char *)tmp);
+    xmlFree(tmp);
+    return ret;
+}
+
+
 /**
  * virXMLPropStringLimit:
  * @node: XML dom node pointer
@@ -28,6 +28,7 @@
 # include <libxml/xpath.h>
 # include <libxml/relaxng.h>
 
+# include "virarena.h"
 # include "virbuffer.h"
 
 int              virXPathBoolean(const char *xpath,
@@ -71,6 +72,10 @@ int              virXPathNodeSet(const char *xpath,
                                  xmlNodePtr **list);
 char *          virXMLPropString(xmlNodePtr node,
                                  const char *name);
+char *     virXMLPropStringArena(xmlNodePtr node,
+                                 const char *name,
+                                 virArenaPtr arena)
+    ATTRIBUTE_NONNULL(3);
 char *     virXMLPropStringLimit(xmlNodePtr node,
                                  const char *name,
                                  size_t maxlen);
@@ -22,6 +22,7 @@
 #include "virerror.h"
 #include "viralloc.h"
 #include "virlog.h"
+#include "virstring.h"
 
 #include "domain_conf.h"
 
@@ -77,6 +78,159 @@ static int testGetFilesystem(const void *opaque)
     return ret;
 }
 
+
+struct testDefCopyData {
+    const char *filename;
+    bool postParse;
+    bool expectNative;
+};
+
+
+static int
+testDefCopyPostParse(virDomainDefPtr def ATTRIBUTE_UNUSED,
+                     virCapsPtr caps ATTRIBUTE_UNUSED,
+                     unsigned int parseFlags ATTRIBUTE_UNUSED,
+                     void *opaque ATTRIBUTE_UNUSED,
+                     void *parseOpaque ATTRIBUTE_UNUSED)
+{
+    return 0;
+}
+
+
+static virDomainDefParserConfig testDefCopyPostParseConfig = {
+    .domainPostParseCallback = testDefCopyPostParse,
+    .features = VIR_DOMAIN_DEF_FEATURE_INDIVIDUAL_VCPUS,
+};
+
+static int testDefCopy(const void *opaque)
+{
+    int ret = -1;
+    const struct testDefCopyData *data = opaque;
+    virDomainXMLOptionPtr copyxmlopt = NULL;
+    virDomainDefPtr def = NULL;
+    virDomainDefPtr nativeCopy = NULL;
+    virDomainDefPtr xmlCopy = NULL;
+    char *filename = NULL;
+    char *xml = NULL;
+    char *nativeXML = NULL;
+    char *expectXML = NULL;
+    int rc;
+
+    if (virAsprintf(&filename, "%s/genericxml2xmlindata/%s.xml",
+                    abs_srcdir, data->filename) < 0)
+        goto cleanup;
+
+    if (data->postParse) {
+        if (!(copyxmlopt = virDomainXMLOptionNew(&testDefCopyPostParseConfig,
+                                                 NULL, NULL, NULL, NULL)))
+            goto cleanup;
+    } else {
+        copyxmlopt = virObjectRef(xmlopt);
+    }
+
+    if (!(def = virDomainDefParseFile(filename, caps, copyxmlopt, NULL, 0)))
+        goto cleanup;
+
+    if ((rc = virDomainDefCopyNative(def, caps, copyxmlopt, &nativeCopy)) < 0)
+        goto cleanup;
+
+    if ((rc > 0) != data->expectNative) {
+        fprintf(stderr, "Expected %s copy of '%s'\n",
+                data->expectNative ? "native" : "XML", filename);
+        goto cleanup;
+    }
+
+    if (!nativeCopy) {
+        ret = 0;
+        goto cleanup;
+    }
+
+    /* the native copy must match the XML round trip it replaces */
+    if (!(xml = virDomainDefFormat(def, caps, VIR_DOMAIN_DEF_FORMAT_SECURE)) ||
+        !(xmlCopy = virDomainDefParseString(xml, caps, xmlopt, NULL,
+                                            VIR_DOMAIN_DEF_PARSE_INACTIVE |
+                                            VIR_DOMAIN_DEF_PARSE_SKIP_VALIDATE)))
+        goto cleanup;
+
+    if (!(expectXML = virDomainDefFormat(xmlCopy, caps,
+                                         VIR_DOMAIN_DEF_FORMAT_SECURE)) ||
+        !(nativeXML = virDomainDefFormat(nativeCopy, caps,
+                                         VIR_DOMAIN_DEF_FORMAT_SECURE)))
+        goto cleanup;
+
+    if (STRNEQ(expectXML, nativeXML)) {
+        virTestDifference(stderr, expectXML, nativeXML);
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    virDomainDefFree(def);
+    virDomainDefFree(nativeCopy);
+    virDomainDefFree(xmlCopy);
+    virObjectUnref(copyxmlopt);
+    VIR_FREE(filename);
+    VIR_FREE(xml);
+    VIR_FREE(nativeXML);
+    VIR_FREE(expectXML);
+    return ret;
+}
+
+struct testDefCheckABIData {
+    const char *filename;
+    bool changeIdentity;
+    bool changeMemory;
+    unsigned int flags;
+    bool expectStable;
+};
+
+static int testDefCheckABI(const void *opaque)
+{
+    int ret = -1;
+    const struct testDefCheckABIData *data = opaque;
+    virDomainDefPtr src = NULL;
+    virDomainDefPtr dst = NULL;
+    char *filename = NULL;
+    bool stable;
+
+    if (virAsprintf(&filename, "%s/genericxml2xmlindata/%s.xml",
+                    abs_srcdir, data->filename) < 0)
+        goto cleanup;
+
+    if (!(src = virDomainDefParseFile(filename, caps, xmlopt, NULL, 0)) ||
+        !(dst = virDomainDefParseFile(filename, caps, xmlopt, NULL, 0)))
+        goto cleanup;
+
+    if (data->changeIdentity) {
+        dst->uuid[0] ^= 0xff;
+        VIR_FREE(dst->name);
+        if (VIR_STRDUP(dst->name, "clone") < 0)
+            goto cleanup;
+    }
+
+    if (data->changeMemory)
+        virDomainDefSetMemoryTotal(dst, virDomainDefGetMemoryTotal(src) * 2);
+
+    stable = virDomainDefCheckABIStabilityFlags(src, dst, xmlopt, data->flags);
+
+    if (stable != data->expectStable) {
+        fprintf(stderr, "Expected '%s' to be %s: %s\n",
+                filename, data->expectStable ? "stable" : "unstable",
+                stable ? "no error" : virGetLastErrorMessage());
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    virDomainDefFree(src);
+    virDomainDefFree(dst);
+    VIR_FREE(filename);
+    return ret;
+}
+
+
 static int
 mymain(void)
 {
@@ -104,6 +258,59 @@ mymain(void)
     DO_TEST_GET_FS("/dev/pts", false);
     DO_TEST_GET_FS("/doesnotexist", false);
 
+#define DO_TEST_DEF_COPY_FULL(desc, name, postparse, native) \
+    do { \
+        struct testDefCopyData data = { \
+            .filename = name, \
+            .postParse = postparse, \
+            .expectNative = native, \
+        }; \
+        if (virTestRun("DefCopy " desc, testDefCopy, &data) < 0) \
+            ret = -1; \
+    } while (0)
+
+#define DO_TEST_DEF_COPY(name, native) \
+    DO_TEST_DEF_COPY_FULL(name, name, false, native)
+
+    DO_TEST_DEF_COPY("disk-virtio", true);
+    DO_TEST_DEF_COPY("disk-network-http", true);
+    DO_TEST_DEF_COPY("graphics-vnc-minimal", true);
+    DO_TEST_DEF_COPY("graphics-vnc-manual-port", true);
+    DO_TEST_DEF_COPY("graphics-vnc-socket-listen", true);
+    DO_TEST_DEF_COPY("graphics-vnc-listen-element-with-address", true);
+    DO_TEST_DEF_COPY("chardev-tcp", true);
+    DO_TEST_DEF_COPY("chardev-udp", true);
+    DO_TEST_DEF_COPY("chardev-reconnect", true);
+    DO_TEST_DEF_COPY("vcpus-individual", true);
+    DO_TEST_DEF_COPY("cpu-cache-passthrough", true);
+    DO_TEST_DEF_COPY("perf", true);
+    DO_TEST_DEF_COPY("tseg", true);
+    DO_TEST_DEF_COPY("launch-security-sev", true);
+    DO_TEST_DEF_COPY("chardev-unix", false);
+    DO_TEST_DEF_COPY("cachetune", false);
+    DO_TEST_DEF_COPY_FULL("disk-virtio with post parse callbacks",
+                          "disk-virtio", true, false);
+
+#define DO_TEST_CHECK_ABI(desc, identity, memory, abiflags, stable) \
+    do { \
+        struct testDefCheckABIData data = { \
+            .filename = "disk-virtio", \
+            .changeIdentity = identity, \
+            .changeMemory = memory, \
+            .flags = abiflags, \
+            .expectStable = stable, \
+        }; \
+        if (virTestRun("CheckABI " desc, testDefCheckABI, &data) < 0) \
+            ret = -1; \
+    } while (0)
+
+    DO_TEST_CHECK_ABI("same", false, false, 0, true);
+    DO_TEST_CHECK_ABI("identity", true, false, 0, false);
+    DO_TEST_CHECK_ABI("identity skipped", true, false,
+                      VIR_DOMAIN_DEF_ABI_CHECK_SKIP_IDENTITY, true);
+    DO_TEST_CHECK_ABI("memory identity skipped", true, true,
+                      VIR_DOMAIN_DEF_ABI_CHECK_SKIP_IDENTITY, false);
+
     virObjectUnref(caps);
     virObjectUnref(xmlopt);
 
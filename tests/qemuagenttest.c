@@ -902,6 +902,96 @@ testQemuAgentGetInterfaces(const void *data)
     return ret;
 }
 
+static int
+testQemuAgentQueryCache(const void *data)
+{
+    virDomainXMLOptionPtr xmlopt = (virDomainXMLOptionPtr)data;
+    qemuMonitorTestPtr test = qemuMonitorTestNewAgent(xmlopt);
+    qemuAgentPtr agent;
+    virDomainInterfacePtr *ifaces = NULL;
+    int nifaces = 0;
+    char *hostname = NULL;
+    size_t i;
+    int ret = -1;
+
+    if (!test)
+        return -1;
+
+    agent = qemuMonitorTestGetAgent(test);
+    qemuAgentSetCacheMaxAge(agent, 60 * 1000);
+
+    if (qemuMonitorTestAddAgentSyncResponse(test) < 0 ||
+        qemuMonitorTestAddItem(test, "guest-get-host-name",
+                               "{\"return\": {\"host-name\": \"first\"}}") < 0)
+        goto cleanup;
+
+    if (qemuAgentGetHostname(agent, &hostname) < 0)
+        goto cleanup;
+    VIR_FREE(hostname);
+
+    /* answered from the cache, the agent would not expect another command */
+    if (qemuAgentGetHostname(agent, &hostname) < 0)
+        goto cleanup;
+
+    if (STRNEQ(hostname, "first")) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       "expected cached hostname 'first', got '%s'", hostname);
+        goto cleanup;
+    }
+    VIR_FREE(hostname);
+
+    if (qemuMonitorTestAddAgentSyncResponse(test) < 0 ||
+        qemuMonitorTestAddItem(test, "guest-network-get-interfaces",
+                               testQemuAgentGetInterfacesResponse) < 0)
+        goto cleanup;
+
+    if ((nifaces = qemuAgentGetInterfaces(agent, &ifaces)) < 0)
+        goto cleanup;
+
+    for (i = 0; i < nifaces; i++)
+        virDomainInterfaceFree(ifaces[i]);
+    VIR_FREE(ifaces);
+    nifaces = 0;
+
+    /* both queries were polled recently, so they are refreshed in one
+     * batch after a single sync once the cache is dropped */
+    qemuAgentNotifyEvent(agent, QEMU_AGENT_EVENT_RESET);
+
+    if (qemuMonitorTestAddAgentSyncResponse(test) < 0 ||
+        qemuMonitorTestAddItem(test, "guest-get-host-name",
+                               "{\"return\": {\"host-name\": \"second\"}}") < 0 ||
+        qemuMonitorTestAddItem(test, "guest-network-get-interfaces",
+                               testQemuAgentGetInterfacesResponse) < 0)
+        goto cleanup;
+
+    if (qemuAgentGetHostname(agent, &hostname) < 0)
+        goto cleanup;
+
+    if (STRNEQ(hostname, "second")) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       "expected hostname 'second', got '%s'", hostname);
+        goto cleanup;
+    }
+
+    if ((nifaces = qemuAgentGetInterfaces(agent, &ifaces)) != 4) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       "expected 4 cached interfaces, got %d", nifaces);
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    if (ifaces) {
+        for (i = 0; i < nifaces; i++)
+            virDomainInterfaceFree(ifaces[i]);
+    }
+    VIR_FREE(ifaces);
+    VIR_FREE(hostname);
+    qemuMonitorTestFree(test);
+    return ret;
+}
+
 static int
 mymain(void)
 {
@@ -931,6 +1021,7 @@ mymain(void)
     DO_TEST(CPU);
     DO_TEST(ArbitraryCommand);
     DO_TEST(GetInterfaces);
+    DO_TEST(QueryCache);
 
     DO_TEST(Timeout); /* Timeout should always be called last */
 
@@ -621,6 +621,169 @@ testQemuMonitorJSONGetTPMModels(const void *data)
 }
 
 
+static int
+testQemuMonitorJSONGetDevicePropsBatch(const void *data)
+{
+    virDomainXMLOptionPtr xmlopt = (virDomainXMLOptionPtr)data;
+    qemuMonitorTestPtr test = qemuMonitorTestNewSimple(true, xmlopt);
+    const char *devices[] = { "virtio-blk-pci", "bogus", "usb-host" };
+    char **props[ARRAY_CARDINALITY(devices)] = { NULL };
+    int nprops[ARRAY_CARDINALITY(devices)] = { 0 };
+    size_t i;
+    int ret = -1;
+
+    if (!test)
+        return -1;
+
+    if (qemuMonitorTestAddItemParams(test, "device-list-properties",
+                                     "{ "
+                                     "  \"return\": [ "
+                                     "    { \"name\": \"scsi\", \"type\": \"bool\" }, "
+                                     "    { \"name\": \"logical_block_size\", \"type\": \"uint16\" } "
+                                     "  ]"
+                                     "}",
+                                     "typename", "\"virtio-blk-pci\"",
+                                     NULL) < 0 ||
+        qemuMonitorTestAddItemParams(test, "device-list-properties",
+                                     "{ "
+                                     "  \"error\": { "
+                                     "    \"class\": \"DeviceNotFound\", "
+                                     "    \"desc\": \"Device 'bogus' not found\" "
+                                     "  }"
+                                     "}",
+                                     "typename", "\"bogus\"",
+                                     NULL) < 0 ||
+        qemuMonitorTestAddItemParams(test, "device-list-properties",
+                                     "{ "
+                                     "  \"return\": [ "
+                                     "    { \"name\": \"hostbus\", \"type\": \"uint32\" } "
+                                     "  ]"
+                                     "}",
+                                     "typename", "\"usb-host\"",
+                                     NULL) < 0)
+        goto cleanup;
+
+    if (qemuMonitorGetDevicePropsBatch(qemuMonitorTestGetMonitor(test),
+                                       devices, ARRAY_CARDINALITY(devices),
+                                       props, nprops) < 0)
+        goto cleanup;
+
+#define CHECK(i, wantn, wantfirst) \
+    do { \
+        if (nprops[i] != (wantn)) { \
+            virReportError(VIR_ERR_INTERNAL_ERROR, \
+                           "nprops[%d] %d is not %d", \
+                           i, nprops[i], (wantn)); \
+            goto cleanup; \
+        } \
+        if (!props[i] || STRNEQ_NULLABLE(props[i][0], (wantfirst))) { \
+            virReportError(VIR_ERR_INTERNAL_ERROR, \
+                           "unexpected property list for %s", \
+                           devices[i]); \
+            goto cleanup; \
+        } \
+    } while (0)
+
+    CHECK(0, 2, "scsi");
+    CHECK(2, 1, "hostbus");
+
+#undef CHECK
+
+    if (nprops[1] != 0 || props[1]) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       "unknown device type has properties");
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    qemuMonitorTestFree(test);
+    for (i = 0; i < ARRAY_CARDINALITY(devices); i++)
+        virStringListFree(props[i]);
+    return ret;
+}
+
+
+/* Replies to a batch are matched by their id, only id-less ones go to
+ * the oldest command still waiting */
+static int
+testQemuMonitorJSONBatchReplyIds(const void *data ATTRIBUTE_UNUSED)
+{
+    qemuMonitorMessage msg;
+    char *ids[] = { (char *) "libvirt-1", (char *) "libvirt-2",
+                    (char *) "libvirt-3" };
+    void *objs[ARRAY_CARDINALITY(ids)] = { NULL };
+    const char *expect[ARRAY_CARDINALITY(ids)] = { "one", "two", "three" };
+    const char *err;
+    size_t i;
+    int ret = -1;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.nrxObjects = ARRAY_CARDINALITY(ids);
+    msg.rxObjects = objs;
+    msg.rxIds = ids;
+
+    if (qemuMonitorJSONIOProcessLine(NULL,
+                                     "{\"return\": \"two\", \"id\": \"libvirt-2\"}",
+                                     &msg) < 0 ||
+        qemuMonitorJSONIOProcessLine(NULL,
+                                     "{\"return\": \"one\", \"id\": \"libvirt-1\"}",
+                                     &msg) < 0)
+        goto cleanup;
+
+    if (msg.finished) {
+        VIR_TEST_VERBOSE("batch finished after 2 of 3 replies\n");
+        goto cleanup;
+    }
+
+    /* neither an unknown id nor one already answered may be accepted */
+    if (qemuMonitorJSONIOProcessLine(NULL,
+                                     "{\"return\": \"bogus\", \"id\": \"libvirt-9\"}",
+                                     &msg) == 0 ||
+        !(err = virGetLastErrorMessage()) ||
+        !strstr(err, "Unexpected JSON reply")) {
+        VIR_TEST_VERBOSE("reply with unknown id was accepted\n");
+        goto cleanup;
+    }
+    virResetLastError();
+
+    if (qemuMonitorJSONIOProcessLine(NULL,
+                                     "{\"return\": \"bogus\", \"id\": \"libvirt-1\"}",
+                                     &msg) == 0) {
+        VIR_TEST_VERBOSE("second reply for the same id was accepted\n");
+        goto cleanup;
+    }
+    virResetLastError();
+
+    if (qemuMonitorJSONIOProcessLine(NULL, "{\"return\": \"three\"}",
+                                     &msg) < 0)
+        goto cleanup;
+
+    if (!msg.finished || msg.nrxReceived != ARRAY_CARDINALITY(ids)) {
+        VIR_TEST_VERBOSE("batch not finished after all replies\n");
+        goto cleanup;
+    }
+
+    for (i = 0; i < ARRAY_CARDINALITY(ids); i++) {
+        const char *got = virJSONValueObjectGetString(objs[i], "return");
+
+        if (STRNEQ_NULLABLE(got, expect[i])) {
+            VIR_TEST_VERBOSE("reply for %s is '%s', expected '%s'\n",
+                             ids[i], NULLSTR(got), expect[i]);
+            goto cleanup;
+        }
+    }
+
+    ret = 0;
+
+ cleanup:
+    for (i = 0; i < ARRAY_CARDINALITY(ids); i++)
+        virJSONValueFree(objs[i]);
+    return ret;
+}
+
+
 static int
 testQemuMonitorJSONGetCommandLineOptionParameters(const void *data)
 {
@@ -2953,6 +3116,8 @@ mymain(void)
     DO_TEST(GetCPUDefinitions);
     DO_TEST(GetCommands);
     DO_TEST(GetTPMModels);
+    DO_TEST(GetDevicePropsBatch);
+    DO_TEST(BatchReplyIds);
     DO_TEST(GetCommandLineOptionParameters);
     if (qemuMonitorJSONTestAttachChardev(driver.xmlopt) < 0)
         ret = -1;
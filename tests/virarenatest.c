@@ -0,0 +1,184 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "testutils.h"
+
+#include "viralloc.h"
+#include "virarena.h"
+#include "virxml.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+
+static int
+testArenaStack(const void *opaque ATTRIBUTE_UNUSED)
+{
+    char buf[256];
+    virArena arena = VIR_ARENA_INITIALIZER(buf);
+    size_t nallocs, nbytes, nchunks;
+    char *a, *b;
+    long long *c;
+    int ret = -1;
+
+    if (!(a = virArenaStrdup(&arena, "hello")) ||
+        !(b = virArenaStrndup(&arena, "worldwide", 5)) ||
+        !(c = virArenaAlloc(&arena, sizeof(*c) * 4)))
+        goto cleanup;
+
+    if (STRNEQ(a, "hello") || STRNEQ(b, "world")) {
+        fprintf(stderr, "unexpected strings '%s' '%s'\n", a, b);
+        goto cleanup;
+    }
+
+    if (c[0] != 0 || c[3] != 0 || (uintptr_t)c % sizeof(*c) != 0) {
+        fprintf(stderr, "allocation not zeroed or aligned\n");
+        goto cleanup;
+    }
+
+    if (a < buf || (char *)(c + 4) > buf + sizeof(buf)) {
+        fprintf(stderr, "allocation not served from the initial buffer\n");
+        goto cleanup;
+    }
+
+    virArenaGetStats(&arena, &nallocs, &nbytes, &nchunks);
+    if (nallocs != 3 || nbytes != 12 + sizeof(*c) * 4 || nchunks != 0) {
+        fprintf(stderr, "unexpected stats allocs=%zu bytes=%zu chunks=%zu\n",
+                nallocs, nbytes, nchunks);
+        goto cleanup;
+    }
+
+    if (virArenaStrdup(&arena, NULL) != NULL)
+        goto cleanup;
+
+    ret = 0;
+ cleanup:
+    virArenaClear(&arena);
+    return ret;
+}
+
+
+static int
+testArenaOverflow(const void *opaque ATTRIBUTE_UNUSED)
+{
+    char buf[64];
+    virArena arena = VIR_ARENA_INITIALIZER(buf);
+    char *strs[100];
+    size_t nchunks;
+    size_t i;
+    int ret = -1;
+
+    for (i = 0; i < ARRAY_CARDINALITY(strs); i++) {
+        char tmp[32];
+
+        snprintf(tmp, sizeof(tmp), "string-%zu", i);
+        if (!(strs[i] = virArenaStrdup(&arena, tmp)))
+            goto cleanup;
+    }
+
+    if (!virArenaAlloc(&arena, 10000))
+        goto cleanup;
+
+    for (i = 0; i < ARRAY_CARDINALITY(strs); i++) {
+        char tmp[32];
+
+        snprintf(tmp, sizeof(tmp), "string-%zu", i);
+        if (STRNEQ(strs[i], tmp)) {
+            fprintf(stderr, "string %zu clobbered: '%s'\n", i, strs[i]);
+            goto cleanup;
+        }
+    }
+
+    virArenaGetStats(&arena, NULL, NULL, &nchunks);
+    if (nchunks != 2) {
+        fprintf(stderr, "expected 2 heap chunks, got %zu\n", nchunks);
+        goto cleanup;
+    }
+
+    virArenaClear(&arena);
+
+    if (!(strs[0] = virArenaStrdup(&arena, "again")))
+        goto cleanup;
+
+    if (strs[0] != buf) {
+        fprintf(stderr, "cleared arena did not restart from its buffer\n");
+        goto cleanup;
+    }
+
+    ret = 0;
+ cleanup:
+    virArenaClear(&arena);
+    return ret;
+}
+
+
+static int
+testArenaXMLProp(const void *opaque ATTRIBUTE_UNUSED)
+{
+    const char *xml =
+        "<!DOCTYPE disk [<!ENTITY dev 'vda'>]>"
+        "<disk plain='qcow2' escaped='a&amp;b' entity='x&dev;' empty=''/>";
+    const char *props[] = { "plain", "escaped", "entity", "empty", "missing" };
+    char buf[128];
+    virArena arena = VIR_ARENA_INITIALIZER(buf);
+    xmlDocPtr doc;
+    xmlNodePtr root;
+    size_t i;
+    int ret = -1;
+
+    if (!(doc = virXMLParseStringCtxt(xml, "arena.xml", NULL)))
+        return -1;
+
+    root = xmlDocGetRootElement(doc);
+
+    for (i = 0; i < ARRAY_CARDINALITY(props); i++) {
+        char *expect = virXMLPropString(root, props[i]);
+        char *actual = virXMLPropStringArena(root, props[i], &arena);
+
+        if (STRNEQ_NULLABLE(expect, actual)) {
+            fprintf(stderr, "attribute '%s': expected '%s', got '%s'\n",
+                    props[i], NULLSTR(expect), NULLSTR(actual));
+            VIR_FREE(expect);
+            goto cleanup;
+        }
+        VIR_FREE(expect);
+    }
+
+    ret = 0;
+ cleanup:
+    virArenaClear(&arena);
+    xmlFreeDoc(doc);
+    return ret;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+
+    if (virTestRun("stack buffer", testArenaStack, NULL) < 0)
+        ret = -1;
+    if (virTestRun("heap overflow", testArenaOverflow, NULL) < 0)
+        ret = -1;
+    if (virTestRun("xml property", testArenaXMLProp, NULL) < 0)
+        ret = -1;
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIR_TEST_MAIN(mymain)
@@ -33,6 +33,8 @@ testTypes(const void *data ATTRIBUTE_UNUSED)
 {
     unsigned int u, u2;
     int s, s2;
+    int *p;
+    unsigned long long ull;
     bool res;
 
 #define testAssertEq(a, b) \
@@ -102,6 +104,17 @@ testTypes(const void *data ATTRIBUTE_UNUSED)
     testAssertEq(s2, 12);
     testAssertEq(s, 8);
 
+    virAtomicPointerSet(&p, &s);
+    testAssertEq(virAtomicPointerGet(&p), &s);
+    virAtomicPointerSet(&p, NULL);
+    testAssertEq(p, NULL);
+
+    ull = 0xffffffffULL;
+    testAssertEq(virAtomicULLongAdd(&ull, 1), 0xffffffffULL);
+    testAssertEq(virAtomicULLongGet(&ull), 0x100000000ULL);
+    testAssertEq(virAtomicULLongAdd(&ull, -0x100000000ULL), 0x100000000ULL);
+    testAssertEq(ull, 0);
+
     return 0;
 }
 
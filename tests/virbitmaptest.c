@@ -25,6 +25,7 @@
 #include "testutils.h"
 
 #include "virbitmap.h"
+#include "virtime.h"
 
 static int
 test1(const void *data ATTRIBUTE_UNUSED)
@@ -741,6 +742,186 @@ test14(const void *opaque)
 }
 
 
+static int
+test15(const void *opaque)
+{
+    const struct testBinaryOpData *data = opaque;
+    virBitmapPtr amap = NULL;
+    virBitmapPtr bmap = NULL;
+    virBitmapPtr resmap = NULL;
+    int ret = -1;
+
+    if (!(amap = virBitmapParseUnlimited(data->a)) ||
+        !(bmap = virBitmapParseUnlimited(data->b)) ||
+        !(resmap = virBitmapParseUnlimited(data->res)))
+        goto cleanup;
+
+    if (virBitmapUnion(amap, bmap) < 0)
+        goto cleanup;
+
+    if (!virBitmapEqual(amap, resmap)) {
+        fprintf(stderr,
+                "\n bitmap union failed: union('%s', '%s') != '%s'\n",
+                data->a, data->b, data->res);
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    virBitmapFree(amap);
+    virBitmapFree(bmap);
+    virBitmapFree(resmap);
+
+    return ret;
+}
+
+
+/* ranges crossing unit boundaries survive a parse/format round trip */
+static int
+test16(const void *opaque)
+{
+    const char *str = opaque;
+    virBitmapPtr map = NULL;
+    virBitmapPtr unlimited = NULL;
+    char *actual = NULL;
+    int ret = -1;
+
+    if (virBitmapParse(str, &map, 256) < 0 ||
+        !(unlimited = virBitmapParseUnlimited(str)))
+        goto cleanup;
+
+    if (!virBitmapEqual(map, unlimited)) {
+        fprintf(stderr, "\n bitmaps parsed from '%s' differ\n", str);
+        goto cleanup;
+    }
+
+    if (!(actual = virBitmapFormat(map)))
+        goto cleanup;
+
+    if (STRNEQ(str, actual)) {
+        fprintf(stderr, "\n expected bitmap contents '%s' actual contents "
+                "'%s'\n", str, actual);
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    virBitmapFree(map);
+    virBitmapFree(unlimited);
+    VIR_FREE(actual);
+    return ret;
+}
+
+
+/* the small inline map is moved to the heap when expanded */
+static int
+test17(const void *opaque ATTRIBUTE_UNUSED)
+{
+    virBitmapPtr map = NULL;
+    char *str = NULL;
+    int ret = -1;
+
+    if (!(map = virBitmapNew(8)))
+        return -1;
+
+    if (virBitmapSetBit(map, 3) < 0 ||
+        virBitmapSetBitExpand(map, 63) < 0 ||
+        virBitmapSetBitExpand(map, 200) < 0 ||
+        virBitmapLastSetBit(map) != 200)
+        goto cleanup;
+
+    if (!(str = virBitmapFormat(map)) || STRNEQ(str, "3,63,200"))
+        goto cleanup;
+
+    virBitmapShrink(map, 64);
+    VIR_FREE(str);
+    if (!(str = virBitmapFormat(map)) || STRNEQ(str, "3,63") ||
+        virBitmapLastSetBit(map) != 63)
+        goto cleanup;
+
+    ret = 0;
+
+ cleanup:
+    virBitmapFree(map);
+    VIR_FREE(str);
+    return ret;
+}
+
+
+/* Reports timings of the operations used in hot loops with --debug */
+static int
+test18(const void *opaque ATTRIBUTE_UNUSED)
+{
+    const size_t size = 1 << 16;
+    virBitmapPtr map = NULL;
+    virBitmapPtr parsed = NULL;
+    virBitmapPtr other = NULL;
+    char *str = NULL;
+    unsigned long long then, now;
+    ssize_t pos = -1;
+    size_t count = 0;
+    size_t i;
+    int ret = -1;
+
+    if (!(map = virBitmapNew(size)) ||
+        !(other = virBitmapNew(size)))
+        goto cleanup;
+
+    /* runs of varying length */
+    for (i = 0; i < size; i++) {
+        if ((i / 37) % 3 != 0 && virBitmapSetBit(map, i) < 0)
+            goto cleanup;
+        if (i % 5 == 0 && virBitmapSetBit(other, i) < 0)
+            goto cleanup;
+    }
+
+    ignore_value(virTimeMonotonicMicrosNowRaw(&then));
+    if (!(str = virBitmapFormat(map)))
+        goto cleanup;
+    ignore_value(virTimeMonotonicMicrosNowRaw(&now));
+    VIR_TEST_DEBUG("format: %llu us\n", now - then);
+
+    then = now;
+    if (virBitmapParse(str, &parsed, size) < 0)
+        goto cleanup;
+    ignore_value(virTimeMonotonicMicrosNowRaw(&now));
+    VIR_TEST_DEBUG("parse: %llu us\n", now - then);
+
+    if (!virBitmapEqual(map, parsed))
+        goto cleanup;
+
+    then = now;
+    while ((pos = virBitmapNextSetBit(map, pos)) >= 0)
+        count++;
+    ignore_value(virTimeMonotonicMicrosNowRaw(&now));
+    VIR_TEST_DEBUG("iterate: %llu us\n", now - then);
+
+    if (count != virBitmapCountBits(map))
+        goto cleanup;
+
+    then = now;
+    virBitmapIntersect(parsed, other);
+    if (virBitmapUnion(parsed, other) < 0)
+        goto cleanup;
+    ignore_value(virTimeMonotonicMicrosNowRaw(&now));
+    VIR_TEST_DEBUG("intersect+union: %llu us\n", now - then);
+
+    if (!virBitmapEqual(parsed, other))
+        goto cleanup;
+
+    ret = 0;
+
+ cleanup:
+    virBitmapFree(map);
+    virBitmapFree(parsed);
+    virBitmapFree(other);
+    VIR_FREE(str);
+    return ret;
+}
+
+
 #define TESTBINARYOP(A, B, RES, FUNC) \
     testBinaryOpData.a = A; \
     testBinaryOpData.b = B; \
@@ -798,6 +979,32 @@ mymain(void)
     TESTBINARYOP("0-3", "0,^0", "0-3", test14);
     TESTBINARYOP("0,2", "1,3", "0,2", test14);
 
+    virTestCounterReset("test15-");
+    TESTBINARYOP("0", "0", "0", test15);
+    TESTBINARYOP("0-3", "5", "0-3,5", test15);
+    TESTBINARYOP("0,63", "64,127", "0,63-64,127", test15);
+    TESTBINARYOP("1", "200", "1,200", test15);
+    TESTBINARYOP("0-199", "3", "0-199", test15);
+
+#define TEST_FORMAT(str) \
+    if (virTestRun(virTestCounterNext(), test16, str) < 0) \
+        ret = -1;
+
+    virTestCounterReset("test16-");
+    TEST_FORMAT("0");
+    TEST_FORMAT("0-63");
+    TEST_FORMAT("63-64");
+    TEST_FORMAT("1-62,64-127,129");
+    TEST_FORMAT("0-255");
+    TEST_FORMAT("5,70-200,255");
+
+#undef TEST_FORMAT
+
+    if (virTestRun("test17", test17, NULL) < 0)
+        ret = -1;
+    if (virTestRun("test18", test18, NULL) < 0)
+        ret = -1;
+
     return ret;
 }
 
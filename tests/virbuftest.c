@@ -458,6 +458,123 @@ testBufSetIndent(const void *opaque ATTRIBUTE_UNUSED)
 }
 
 
+static int
+testBufReserve(const void *opaque ATTRIBUTE_UNUSED)
+{
+    virBuffer buf = VIR_BUFFER_INITIALIZER;
+    const char *content;
+    char *actual = NULL;
+    size_t i;
+    int ret = -1;
+
+    virBufferAddLit(&buf, "<a>\n");
+    virBufferReserve(&buf, 16 * 100);
+    content = virBufferCurrentContent(&buf);
+
+    for (i = 0; i < 100; i++)
+        virBufferAddLit(&buf, "0123456789abcde\n");
+
+    if (virBufferCurrentContent(&buf) != content) {
+        VIR_TEST_DEBUG("buffer was reallocated despite the size hint\n");
+        goto cleanup;
+    }
+
+    if (virBufferUse(&buf) != 4 + 16 * 100) {
+        VIR_TEST_DEBUG("unexpected buffer use %u\n", virBufferUse(&buf));
+        goto cleanup;
+    }
+
+    if (!(actual = virBufferContentAndReset(&buf)) ||
+        !STRPREFIX(actual, "<a>\n0123456789abcde\n") ||
+        STRNEQ(actual + strlen(actual) - 16, "0123456789abcde\n"))
+        goto cleanup;
+
+    ret = 0;
+
+ cleanup:
+    virBufferFreeAndReset(&buf);
+    VIR_FREE(actual);
+    return ret;
+}
+
+
+static int
+testBufAddBufferMove(const void *opaque ATTRIBUTE_UNUSED)
+{
+    virBuffer buf1 = VIR_BUFFER_INITIALIZER;
+    virBuffer buf2 = VIR_BUFFER_INITIALIZER;
+    const char *content;
+    char *actual = NULL;
+    int ret = -1;
+
+    virBufferAdjustIndent(&buf1, 2);
+    virBufferAddLit(&buf2, "<child/>\n");
+    content = virBufferCurrentContent(&buf2);
+
+    virBufferAddBuffer(&buf1, &buf2);
+
+    if (virBufferCurrentContent(&buf1) != content) {
+        VIR_TEST_DEBUG("content was copied into an empty buffer\n");
+        goto cleanup;
+    }
+
+    if (virBufferUse(&buf2)) {
+        VIR_TEST_DEBUG("buf2 is not clear even though it should be\n");
+        goto cleanup;
+    }
+
+    /* The indentation of the destination is kept */
+    virBufferAddLit(&buf1, "<next/>\n");
+
+    if (!(actual = virBufferContentAndReset(&buf1)) ||
+        STRNEQ(actual, "<child/>\n  <next/>\n")) {
+        VIR_TEST_DEBUG("unexpected content '%s'\n", NULLSTR(actual));
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    virBufferFreeAndReset(&buf1);
+    virBufferFreeAndReset(&buf2);
+    VIR_FREE(actual);
+    return ret;
+}
+
+
+static int
+testBufLarge(const void *opaque ATTRIBUTE_UNUSED)
+{
+    virBuffer buf = VIR_BUFFER_INITIALIZER;
+    char *actual = NULL;
+    size_t i;
+    int ret = -1;
+
+    /* 8 MiB in 16 byte pieces, which used to take seconds when the
+     * buffer was grown by a fixed amount */
+    for (i = 0; i < 512 * 1024; i++)
+        virBufferAsprintf(&buf, "%015zx\n", i);
+
+    if (virBufferCheckError(&buf) < 0)
+        goto cleanup;
+
+    if (!(actual = virBufferContentAndReset(&buf)))
+        goto cleanup;
+
+    if (strlen(actual) != 16 * 512 * 1024 ||
+        !STRPREFIX(actual + 16 * 1000, "0000000000003e8\n")) {
+        VIR_TEST_DEBUG("unexpected content of the large buffer\n");
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    VIR_FREE(actual);
+    return ret;
+}
+
+
 static int
 mymain(void)
 {
@@ -477,6 +594,9 @@ mymain(void)
     DO_TEST("Trim", testBufTrim, 0);
     DO_TEST("AddBuffer", testBufAddBuffer, 0);
     DO_TEST("set indent", testBufSetIndent, 0);
+    DO_TEST("Reserve", testBufReserve, 0);
+    DO_TEST("AddBuffer move", testBufAddBufferMove, 0);
+    DO_TEST("Large", testBufLarge, 0);
 
 #define DO_TEST_ADD_STR(DATA, EXPECT) \
     do { \
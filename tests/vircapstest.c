@@ -235,6 +235,65 @@ test_virCapsDomainDataLookupLXC(const void *data ATTRIBUTE_UNUSED)
 }
 #endif /* WITH_LXC */
 
+static int
+test_virCapabilitiesFormatXMLIfChanged(const void *data ATTRIBUTE_UNUSED)
+{
+    virCapsPtr caps = NULL;
+    virCapsPtr other = NULL;
+    unsigned long long generation = 0;
+    char *expect = NULL;
+    char *xml = NULL;
+    int ret = -1;
+
+    if (!(caps = virCapabilitiesNew(VIR_ARCH_X86_64, false, false)) ||
+        !(other = virCapabilitiesNew(VIR_ARCH_X86_64, false, false)))
+        goto cleanup;
+
+    if (virTestCapsBuildNUMATopology(caps, 3) < 0)
+        goto cleanup;
+
+    if (!(expect = virCapabilitiesFormatXML(caps)))
+        goto cleanup;
+
+    if (virCapabilitiesFormatXMLIfChanged(caps, &generation, &xml) != 1 ||
+        generation != virCapabilitiesGetGeneration(caps)) {
+        fprintf(stderr, "expected the document for generation 0\n");
+        goto cleanup;
+    }
+
+    if (STRNEQ(expect, xml)) {
+        virTestDifference(stderr, expect, xml);
+        goto cleanup;
+    }
+    VIR_FREE(xml);
+
+    if (virCapabilitiesFormatXMLIfChanged(caps, &generation, &xml) != 0 ||
+        xml) {
+        fprintf(stderr, "expected no document for the current generation\n");
+        goto cleanup;
+    }
+
+    if (virCapabilitiesGetGeneration(other) == generation ||
+        virCapabilitiesFormatXMLIfChanged(other, &generation, &xml) != 1) {
+        fprintf(stderr, "expected a new generation for another object\n");
+        goto cleanup;
+    }
+
+    if (virCapabilitiesIsEqual(caps, other) != 0) {
+        fprintf(stderr, "expected the objects to differ\n");
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    virObjectUnref(caps);
+    virObjectUnref(other);
+    VIR_FREE(expect);
+    VIR_FREE(xml);
+    return ret;
+}
+
 static int
 mymain(void)
 {
@@ -243,6 +302,9 @@ mymain(void)
     if (virTestRun("virCapabilitiesGetCpusForNodemask",
                    test_virCapabilitiesGetCpusForNodemask, NULL) < 0)
         ret = -1;
+    if (virTestRun("virCapabilitiesFormatXMLIfChanged",
+                   test_virCapabilitiesFormatXMLIfChanged, NULL) < 0)
+        ret = -1;
 #ifdef WITH_QEMU
     if (virTestRun("virCapsDomainDataLookupQEMU",
                    test_virCapsDomainDataLookupQEMU, NULL) < 0)
@@ -0,0 +1,652 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "testutils.h"
+#include "virerror.h"
+#include "viralloc.h"
+#include "viratomic.h"
+#include "virfile.h"
+#include "virlog.h"
+#include "virstring.h"
+#include "virthread.h"
+
+#include "virdomainobjlist.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+VIR_LOG_INIT("tests.virdomainobjlisttest");
+
+#define TEST_DOMAIN_NAME "QEMUGuest1"
+#define TEST_DOMAIN_RENAMED "QEMUGuest2"
+#define TEST_MARKER "not parsed from the config"
+
+#define READERS 4
+#define ROUNDS 500
+
+static virCapsPtr caps;
+static virDomainXMLOptionPtr xmlopt;
+
+struct testLoadData {
+    const char *scratchdir;
+    const char *name;
+};
+
+struct testLoadCount {
+    size_t loaded;
+    size_t added;
+};
+
+
+static void
+testLoadNotify(virDomainObjPtr dom ATTRIBUTE_UNUSED,
+               int newDomain,
+               void *opaque)
+{
+    struct testLoadCount *count = opaque;
+
+    count->loaded++;
+    if (newDomain)
+        count->added++;
+}
+
+
+static int
+testLoadWith(virDomainObjListPtr doms,
+             const char *dir,
+             virDomainXMLOptionPtr opt,
+             size_t expectAdded)
+{
+    struct testLoadCount count = { 0 };
+
+    if (virDomainObjListLoadAllConfigs(doms, dir, dir, false, caps, opt,
+                                       testLoadNotify, &count) < 0)
+        return -1;
+
+    if (count.loaded != 1 || count.added != expectAdded) {
+        fprintf(stderr, "Expected 1 domain and %zu new, got %zu and %zu\n",
+                expectAdded, count.loaded, count.added);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+testLoad(virDomainObjListPtr doms,
+         const char *dir,
+         size_t expectAdded)
+{
+    return testLoadWith(doms, dir, xmlopt, expectAdded);
+}
+
+
+/* Writes the test config to a fresh directory below the scratch dir */
+static char *
+testPrepareDir(const struct testLoadData *data)
+{
+    char *dir = NULL;
+    char *src = NULL;
+    char *dst = NULL;
+    char *xml = NULL;
+
+    if (virAsprintf(&dir, "%s/%s", data->scratchdir, data->name) < 0 ||
+        virAsprintf(&src, "%s/genericxml2xmlindata/disk-virtio.xml",
+                    abs_srcdir) < 0 ||
+        virAsprintf(&dst, "%s/" TEST_DOMAIN_NAME ".xml", dir) < 0)
+        goto error;
+
+    if (virFileMakePath(dir) < 0 ||
+        virFileReadAll(src, 1024 * 1024, &xml) < 0 ||
+        virFileWriteStr(dst, xml, 0600) < 0)
+        goto error;
+
+ cleanup:
+    VIR_FREE(src);
+    VIR_FREE(dst);
+    VIR_FREE(xml);
+    return dir;
+
+ error:
+    VIR_FREE(dir);
+    goto cleanup;
+}
+
+
+static int
+testAppendStr(const char *path,
+              const char *str)
+{
+    char *old = NULL;
+    char *new = NULL;
+    int ret = -1;
+
+    if (virFileReadAll(path, 1024 * 1024, &old) < 0 ||
+        virAsprintf(&new, "%s%s", old, str) < 0 ||
+        virFileWriteStr(path, new, 0600) < 0)
+        goto cleanup;
+
+    ret = 0;
+
+ cleanup:
+    VIR_FREE(old);
+    VIR_FREE(new);
+    return ret;
+}
+
+
+/* Marks the loaded definition so that reparsing it can be detected */
+static int
+testSetMarker(virDomainObjListPtr doms)
+{
+    virDomainObjPtr dom;
+    int ret;
+
+    if (!(dom = virDomainObjListFindByName(doms, TEST_DOMAIN_NAME)))
+        return -1;
+
+    VIR_FREE(dom->def->description);
+    ret = VIR_STRDUP(dom->def->description, TEST_MARKER);
+
+    virDomainObjEndAPI(&dom);
+    return ret < 0 ? -1 : 0;
+}
+
+
+static int
+testCheckMarker(virDomainObjListPtr doms,
+                bool expectMarker)
+{
+    virDomainObjPtr dom;
+    bool marker;
+
+    if (!(dom = virDomainObjListFindByName(doms, TEST_DOMAIN_NAME)))
+        return -1;
+
+    marker = STREQ_NULLABLE(dom->def->description, TEST_MARKER);
+    virDomainObjEndAPI(&dom);
+
+    if (marker != expectMarker) {
+        fprintf(stderr, "Expected the config to be %s\n",
+                expectMarker ? "reused" : "parsed again");
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+testLoadStampsUnchanged(const void *opaque)
+{
+    const struct testLoadData *data = opaque;
+    virDomainObjListPtr doms = NULL;
+    char *dir = NULL;
+    char *config = NULL;
+    int ret = -1;
+
+    if (!(dir = testPrepareDir(data)) ||
+        virAsprintf(&config, "%s/" TEST_DOMAIN_NAME ".xml", dir) < 0)
+        goto cleanup;
+
+    if (!(doms = virDomainObjListNew()))
+        goto cleanup;
+
+    if (testLoad(doms, dir, 1) < 0 ||
+        testSetMarker(doms) < 0)
+        goto cleanup;
+
+    /* an unchanged config must not be parsed again */
+    if (testLoad(doms, dir, 0) < 0 ||
+        testCheckMarker(doms, true) < 0)
+        goto cleanup;
+
+    /* a changed one must */
+    if (testAppendStr(config, "\n") < 0 ||
+        testLoad(doms, dir, 0) < 0 ||
+        testCheckMarker(doms, false) < 0)
+        goto cleanup;
+
+    ret = 0;
+
+ cleanup:
+    virObjectUnref(doms);
+    VIR_FREE(dir);
+    VIR_FREE(config);
+    return ret;
+}
+
+
+static int
+testLoadStampsRestart(const void *opaque)
+{
+    const struct testLoadData *data = opaque;
+    virDomainObjListPtr doms = NULL;
+    char *dir = NULL;
+    int ret = -1;
+
+    if (!(dir = testPrepareDir(data)))
+        goto cleanup;
+
+    if (!(doms = virDomainObjListNew()) ||
+        testLoad(doms, dir, 1) < 0)
+        goto cleanup;
+    virObjectUnref(doms);
+    doms = NULL;
+
+    /* a new list knows nothing about the files the old one loaded */
+    if (!(doms = virDomainObjListNew()) ||
+        testLoad(doms, dir, 1) < 0 ||
+        testSetMarker(doms) < 0 ||
+        testLoad(doms, dir, 0) < 0 ||
+        testCheckMarker(doms, true) < 0)
+        goto cleanup;
+
+    ret = 0;
+
+ cleanup:
+    virObjectUnref(doms);
+    VIR_FREE(dir);
+    return ret;
+}
+
+
+static int
+testLoadStampsParser(const void *opaque)
+{
+    const struct testLoadData *data = opaque;
+    virDomainObjListPtr doms = NULL;
+    virDomainXMLOptionPtr newxmlopt = NULL;
+    char *dir = NULL;
+    int ret = -1;
+
+    if (!(dir = testPrepareDir(data)) ||
+        !(newxmlopt = virTestGenericDomainXMLConfInit()))
+        goto cleanup;
+
+    if (!(doms = virDomainObjListNew()) ||
+        testLoad(doms, dir, 1) < 0 ||
+        testSetMarker(doms) < 0)
+        goto cleanup;
+
+    /* a different parser may produce a different definition */
+    if (testLoadWith(doms, dir, newxmlopt, 0) < 0 ||
+        testCheckMarker(doms, false) < 0)
+        goto cleanup;
+
+    if (testSetMarker(doms) < 0 ||
+        testLoadWith(doms, dir, newxmlopt, 0) < 0 ||
+        testCheckMarker(doms, true) < 0)
+        goto cleanup;
+
+    /* going back to the first one is a change as well */
+    if (testLoad(doms, dir, 0) < 0 ||
+        testCheckMarker(doms, false) < 0)
+        goto cleanup;
+
+    ret = 0;
+
+ cleanup:
+    virObjectUnref(doms);
+    virObjectUnref(newxmlopt);
+    VIR_FREE(dir);
+    return ret;
+}
+
+
+static int
+testLoadStampsRemove(const void *opaque)
+{
+    const struct testLoadData *data = opaque;
+    virDomainObjListPtr doms = NULL;
+    virDomainObjPtr dom = NULL;
+    virDomainDefPtr def = NULL;
+    char *dir = NULL;
+    char *config = NULL;
+    int ret = -1;
+
+    if (!(dir = testPrepareDir(data)) ||
+        virAsprintf(&config, "%s/" TEST_DOMAIN_NAME ".xml", dir) < 0)
+        goto cleanup;
+
+    if (!(doms = virDomainObjListNew()) ||
+        testLoad(doms, dir, 1) < 0)
+        goto cleanup;
+
+    if (!(dom = virDomainObjListFindByName(doms, TEST_DOMAIN_NAME)))
+        goto cleanup;
+    virDomainObjListRemove(doms, dom);
+    virDomainObjEndAPI(&dom);
+
+    /* a domain defined again under the same name doesn't come from
+     * the file which was loaded before */
+    if (!(def = virDomainDefParseFile(config, caps, xmlopt, NULL,
+                                      VIR_DOMAIN_DEF_PARSE_INACTIVE)))
+        goto cleanup;
+
+    if (!(dom = virDomainObjListAdd(doms, def, xmlopt, 0, NULL)))
+        goto cleanup;
+    def = NULL;
+    dom->persistent = 1;
+    virDomainObjEndAPI(&dom);
+
+    if (testSetMarker(doms) < 0 ||
+        testLoad(doms, dir, 0) < 0 ||
+        testCheckMarker(doms, false) < 0)
+        goto cleanup;
+
+    ret = 0;
+
+ cleanup:
+    virDomainDefFree(def);
+    virObjectUnref(doms);
+    VIR_FREE(dir);
+    VIR_FREE(config);
+    return ret;
+}
+
+
+static virDomainDefPtr
+testParseDef(void)
+{
+    char *filename = NULL;
+    virDomainDefPtr def = NULL;
+
+    if (virAsprintf(&filename, "%s/genericxml2xmlindata/disk-virtio.xml",
+                    abs_srcdir) < 0)
+        return NULL;
+
+    def = virDomainDefParseFile(filename, caps, xmlopt, NULL,
+                                VIR_DOMAIN_DEF_PARSE_INACTIVE);
+
+    VIR_FREE(filename);
+    return def;
+}
+
+
+/* Checks that the lookups by @uuid and @name find @expect, or nothing
+ * if it is NULL. The caller must not hold the lock of @expect. */
+static int
+testLookupCheck(virDomainObjListPtr doms,
+                const unsigned char *uuid,
+                const char *name,
+                virDomainObjPtr expect)
+{
+    virDomainObjPtr byUUID = NULL;
+    virDomainObjPtr byName;
+    int ret = 0;
+
+    if (uuid) {
+        byUUID = virDomainObjListFindByUUID(doms, uuid);
+        if (byUUID != expect) {
+            fprintf(stderr, "Unexpected lookup by UUID result\n");
+            ret = -1;
+        }
+        virDomainObjEndAPI(&byUUID);
+    }
+
+    byName = virDomainObjListFindByName(doms, name);
+    if (byName != expect) {
+        fprintf(stderr, "Unexpected lookup of '%s'\n", name);
+        ret = -1;
+    }
+    virDomainObjEndAPI(&byName);
+
+    return ret;
+}
+
+
+static int
+testLookupCheckID(virDomainObjListPtr doms,
+                  int id,
+                  virDomainObjPtr expect)
+{
+    virDomainObjPtr byID = virDomainObjListFindByID(doms, id);
+    int ret = 0;
+
+    if (byID != expect) {
+        fprintf(stderr, "Unexpected lookup of ID %d\n", id);
+        ret = -1;
+    }
+    virDomainObjEndAPI(&byID);
+
+    return ret;
+}
+
+
+static int
+testRenameCallback(virDomainObjPtr dom,
+                   const char *new_name,
+                   unsigned int flags ATTRIBUTE_UNUSED,
+                   void *opaque ATTRIBUTE_UNUSED)
+{
+    char *name;
+
+    if (VIR_STRDUP(name, new_name) < 0)
+        return -1;
+
+    VIR_FREE(dom->def->name);
+    dom->def->name = name;
+    return 0;
+}
+
+
+static int
+testLookup(const void *opaque ATTRIBUTE_UNUSED)
+{
+    virDomainObjListPtr doms = NULL;
+    virDomainObjPtr dom = NULL;
+    virDomainDefPtr def = NULL;
+    unsigned char uuid[VIR_UUID_BUFLEN];
+    int ret = -1;
+    int rc;
+
+    if (!(doms = virDomainObjListNew()) ||
+        !(def = testParseDef()))
+        goto cleanup;
+    memcpy(uuid, def->uuid, VIR_UUID_BUFLEN);
+
+    if (!(dom = virDomainObjListAdd(doms, def, xmlopt, 0, NULL)))
+        goto cleanup;
+    def = NULL;
+    virObjectUnlock(dom);
+
+    if (testLookupCheck(doms, uuid, TEST_DOMAIN_NAME, dom) < 0 ||
+        testLookupCheckID(doms, 5, NULL) < 0)
+        goto cleanup;
+
+    /* drivers assign IDs behind the list's back */
+    dom->def->id = 5;
+    if (testLookupCheckID(doms, 5, dom) < 0)
+        goto cleanup;
+
+    dom->def->id = 7;
+    if (testLookupCheckID(doms, 5, NULL) < 0 ||
+        testLookupCheckID(doms, 7, dom) < 0)
+        goto cleanup;
+
+    virObjectLock(dom);
+    rc = virDomainObjListRename(doms, dom, TEST_DOMAIN_RENAMED, 0,
+                                testRenameCallback, NULL);
+    virObjectUnlock(dom);
+    if (rc < 0)
+        goto cleanup;
+
+    if (testLookupCheck(doms, uuid, TEST_DOMAIN_RENAMED, dom) < 0 ||
+        testLookupCheck(doms, NULL, TEST_DOMAIN_NAME, NULL) < 0 ||
+        testLookupCheckID(doms, 7, dom) < 0)
+        goto cleanup;
+
+    virObjectLock(dom);
+    virDomainObjListRemove(doms, dom);
+    virObjectUnlock(dom);
+
+    if (testLookupCheck(doms, uuid, TEST_DOMAIN_RENAMED, NULL) < 0 ||
+        testLookupCheckID(doms, 7, NULL) < 0)
+        goto cleanup;
+
+    ret = 0;
+
+ cleanup:
+    virObjectUnref(dom);
+    virDomainDefFree(def);
+    virObjectUnref(doms);
+    return ret;
+}
+
+
+struct testLookupThreadData {
+    virDomainObjListPtr doms;
+    unsigned char uuid[VIR_UUID_BUFLEN];
+    volatile int stop;
+    volatile int failed;
+};
+
+
+static void
+testLookupReader(void *opaque)
+{
+    struct testLookupThreadData *data = opaque;
+
+    while (!virAtomicIntGet(&data->stop)) {
+        virDomainObjPtr byUUID;
+        virDomainObjPtr byName;
+        virDomainObjPtr byID;
+
+        byUUID = virDomainObjListFindByUUID(data->doms, data->uuid);
+        if (byUUID && STRNEQ(byUUID->def->name, TEST_DOMAIN_NAME))
+            virAtomicIntSet(&data->failed, 1);
+        virDomainObjEndAPI(&byUUID);
+
+        byName = virDomainObjListFindByName(data->doms, TEST_DOMAIN_NAME);
+        if (byName && memcmp(byName->def->uuid, data->uuid, VIR_UUID_BUFLEN))
+            virAtomicIntSet(&data->failed, 1);
+        virDomainObjEndAPI(&byName);
+
+        byID = virDomainObjListFindByID(data->doms, 1);
+        if (byID && memcmp(byID->def->uuid, data->uuid, VIR_UUID_BUFLEN))
+            virAtomicIntSet(&data->failed, 1);
+        virDomainObjEndAPI(&byID);
+    }
+}
+
+
+/* Adds and removes a domain while other threads look it up */
+static int
+testLookupThreads(const void *opaque ATTRIBUTE_UNUSED)
+{
+    struct testLookupThreadData data = { 0 };
+    virThread threads[READERS];
+    virDomainDefPtr def = NULL;
+    size_t nthreads = 0;
+    size_t i;
+    int ret = -1;
+
+    if (!(data.doms = virDomainObjListNew()) ||
+        !(def = testParseDef()))
+        goto cleanup;
+    memcpy(data.uuid, def->uuid, VIR_UUID_BUFLEN);
+    virDomainDefFree(def);
+    def = NULL;
+
+    for (nthreads = 0; nthreads < READERS; nthreads++) {
+        if (virThreadCreate(&threads[nthreads], true,
+                            testLookupReader, &data) < 0)
+            goto cleanup;
+    }
+
+    for (i = 0; i < ROUNDS; i++) {
+        virDomainObjPtr dom;
+
+        if (!(def = testParseDef()) ||
+            !(dom = virDomainObjListAdd(data.doms, def, xmlopt, 0, NULL)))
+            goto cleanup;
+        def = NULL;
+
+        /* started, so that readers look its ID up too */
+        dom->def->id = 1;
+
+        virDomainObjListRemove(data.doms, dom);
+        virDomainObjEndAPI(&dom);
+    }
+
+    ret = 0;
+
+ cleanup:
+    virAtomicIntSet(&data.stop, 1);
+    for (i = 0; i < nthreads; i++)
+        virThreadJoin(&threads[i]);
+
+    if (virAtomicIntGet(&data.failed)) {
+        fprintf(stderr, "Lookup returned a wrong domain\n");
+        ret = -1;
+    }
+
+    virDomainDefFree(def);
+    virObjectUnref(data.doms);
+    return ret;
+}
+
+
+#define SCRATCHDIRTEMPLATE abs_builddir "/virdomainobjlistdir-XXXXXX"
+
+static int
+mymain(void)
+{
+    char scratchdir[] = SCRATCHDIRTEMPLATE;
+    int ret = 0;
+
+    if (!mkdtemp(scratchdir)) {
+        virFilePrintf(stderr, "Cannot create virdomainobjlistdir");
+        abort();
+    }
+
+    if (!(caps = virTestGenericCapsInit()) ||
+        !(xmlopt = virTestGenericDomainXMLConfInit())) {
+        ret = -1;
+        goto cleanup;
+    }
+
+#define DO_TEST_LOAD(name, fnc) \
+    do { \
+        struct testLoadData data = { scratchdir, name }; \
+        if (virTestRun("Load stamps " name, fnc, &data) < 0) \
+            ret = -1; \
+    } while (0)
+
+    DO_TEST_LOAD("unchanged", testLoadStampsUnchanged);
+    DO_TEST_LOAD("restart", testLoadStampsRestart);
+    DO_TEST_LOAD("parser", testLoadStampsParser);
+    DO_TEST_LOAD("remove", testLoadStampsRemove);
+
+    if (virTestRun("Lookup", testLookup, NULL) < 0)
+        ret = -1;
+    if (virTestRun("Lookup threads", testLookupThreads, NULL) < 0)
+        ret = -1;
+
+ cleanup:
+    virObjectUnref(caps);
+    virObjectUnref(xmlopt);
+
+    if (getenv("LIBVIRT_SKIP_CLEANUP") == NULL)
+        virFileDeleteTree(scratchdir);
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIR_TEST_MAIN(mymain)
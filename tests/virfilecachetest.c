@@ -21,8 +21,10 @@
 
 #include "testutils.h"
 
+#include "viratomic.h"
 #include "virfile.h"
 #include "virfilecache.h"
+#include "virthreadpool.h"
 
 
 #define VIR_FROM_THIS VIR_FROM_NONE
@@ -200,6 +202,123 @@ testFileCache(const void *opaque)
 }
 
 
+static int testFileCacheSlowCalls;
+
+
+static bool
+testFileCacheSlowIsValid(void *data ATTRIBUTE_UNUSED,
+                         void *priv ATTRIBUTE_UNUSED)
+{
+    return true;
+}
+
+
+static void *
+testFileCacheSlowNewData(const char *name,
+                         void *priv ATTRIBUTE_UNUSED)
+{
+    virAtomicIntInc(&testFileCacheSlowCalls);
+
+    /* give the other lookups a chance to pile up */
+    usleep(100 * 1000);
+
+    return testFileCacheObjNew(name);
+}
+
+
+static int
+testFileCacheSlowSaveFile(void *data ATTRIBUTE_UNUSED,
+                          const char *filename ATTRIBUTE_UNUSED,
+                          void *priv ATTRIBUTE_UNUSED)
+{
+    return 0;
+}
+
+
+virFileCacheHandlers testFileCacheSlowHandlers = {
+    .isValid = testFileCacheSlowIsValid,
+    .newData = testFileCacheSlowNewData,
+    .loadFile = testFileCacheLoadFile,
+    .saveFile = testFileCacheSlowSaveFile
+};
+
+
+struct _testFileCacheConcurrentData {
+    virFileCachePtr cache;
+    testFileCacheObjPtr objs[4];
+};
+typedef struct _testFileCacheConcurrentData testFileCacheConcurrentData;
+
+
+static void
+testFileCacheConcurrentWorker(size_t idx,
+                              void *opaque)
+{
+    testFileCacheConcurrentData *data = opaque;
+
+    data->objs[idx] = virFileCacheLookup(data->cache, "cacheConcurrent");
+}
+
+
+static int
+testFileCacheConcurrent(const void *opaque ATTRIBUTE_UNUSED)
+{
+    testFileCacheConcurrentData data = { 0 };
+    testFileCacheObjPtr obj = NULL;
+    unsigned long long generation;
+    size_t i;
+    int ret = -1;
+
+    if (!(data.cache = virFileCacheNew(abs_srcdir "/virfilecachedata",
+                                       "cache", &testFileCacheSlowHandlers)))
+        return -1;
+
+    testFileCacheSlowCalls = 0;
+    generation = virFileCacheGetGeneration(data.cache);
+
+    virThreadPoolRunBatch(ARRAY_CARDINALITY(data.objs),
+                          ARRAY_CARDINALITY(data.objs),
+                          testFileCacheConcurrentWorker, &data);
+
+    if (virAtomicIntGet(&testFileCacheSlowCalls) != 1) {
+        fprintf(stderr, "Expected data to be created once, created %d times.\n",
+                virAtomicIntGet(&testFileCacheSlowCalls));
+        goto cleanup;
+    }
+
+    for (i = 0; i < ARRAY_CARDINALITY(data.objs); i++) {
+        if (!data.objs[i] || data.objs[i] != data.objs[0]) {
+            fprintf(stderr, "Lookup %zu returned %p instead of %p.\n",
+                    i, data.objs[i], data.objs[0]);
+            goto cleanup;
+        }
+    }
+
+    if (virFileCacheGetGeneration(data.cache) != generation + 1) {
+        fprintf(stderr, "Expected generation %llu, got %llu.\n",
+                generation + 1, virFileCacheGetGeneration(data.cache));
+        goto cleanup;
+    }
+
+    /* Looking up valid data must not change the generation */
+    generation = virFileCacheGetGeneration(data.cache);
+    if (!(obj = virFileCacheLookup(data.cache, "cacheConcurrent")) ||
+        virFileCacheGetGeneration(data.cache) != generation) {
+        fprintf(stderr, "Lookup of cached data changed the generation.\n");
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    virObjectUnref(obj);
+    for (i = 0; i < ARRAY_CARDINALITY(data.objs); i++)
+        virObjectUnref(data.objs[i]);
+    virObjectUnref(data.cache);
+    return ret;
+}
+
+
 static int
 mymain(void)
 {
@@ -230,6 +349,9 @@ mymain(void)
 
     virObjectUnref(cache);
 
+    if (virTestRun("cacheConcurrent", testFileCacheConcurrent, NULL) < 0)
+        ret = -1;
+
     return ret != 0 ? EXIT_FAILURE : EXIT_SUCCESS;
 }
 
@@ -9,6 +9,7 @@
 #include "viralloc.h"
 #include "virlog.h"
 #include "virstring.h"
+#include "virtime.h"
 
 #define VIR_FROM_THIS VIR_FROM_NONE
 
@@ -23,9 +24,6 @@ testHashInit(int size)
     if (!(hash = virHashCreate(size, NULL)))
         return NULL;
 
-    /* entries are added in reverse order so that they will be linked in
-     * collision list in the same order as in the uuids array
-     */
     for (i = ARRAY_CARDINALITY(uuids) - 1; i >= 0; i--) {
         ssize_t oldsize = virHashTableSize(hash);
         if (virHashAddEntry(hash, uuids[i], (void *) uuids[i]) < 0) {
@@ -513,6 +511,152 @@ testHashEqual(const void *data ATTRIBUTE_UNUSED)
 }
 
 
+static int
+testHashLargeCountIter(void *payload,
+                       const void *name ATTRIBUTE_UNUSED,
+                       void *data)
+{
+    unsigned long long *sum = data;
+    *sum += (uintptr_t) payload;
+    return 0;
+}
+
+
+static int
+testHashLarge(const void *data)
+{
+    const struct testInfo *info = data;
+    virHashTablePtr hash;
+    char **keys = NULL;
+    unsigned long long sum = 0;
+    unsigned long long then, now;
+    ssize_t size;
+    size_t i;
+    int ret = -1;
+
+    if (VIR_ALLOC_N(keys, info->count) < 0)
+        return -1;
+
+    for (i = 0; i < info->count; i++) {
+        if (virAsprintf(&keys[i], "%08zx-%zu", i * 2654435761U, i) < 0)
+            goto cleanup;
+    }
+
+    if (!(hash = virHashCreate(0, NULL)))
+        goto cleanup;
+
+    ignore_value(virTimeMonotonicMicrosNowRaw(&then));
+    for (i = 0; i < info->count; i++) {
+        if (virHashAddEntry(hash, keys[i], (void *)(uintptr_t) (i + 1)) < 0) {
+            VIR_TEST_VERBOSE("\nfailed to add entry \"%s\"\n", keys[i]);
+            goto cleanup_hash;
+        }
+    }
+    ignore_value(virTimeMonotonicMicrosNowRaw(&now));
+    VIR_TEST_DEBUG("add %zu: %llu us\n", info->count, now - then);
+
+    /* The table had to grow many times, every key must have survived */
+    if ((size = virHashTableSize(hash)) < 0 || (size_t) size < info->count) {
+        VIR_TEST_VERBOSE("\ntable of %zd slots can't hold %zu entries\n",
+                         size, info->count);
+        goto cleanup_hash;
+    }
+
+    then = now;
+    for (i = 0; i < info->count; i++) {
+        if (virHashLookup(hash, keys[i]) != (void *)(uintptr_t) (i + 1)) {
+            VIR_TEST_VERBOSE("\nwrong payload for \"%s\"\n", keys[i]);
+            goto cleanup_hash;
+        }
+    }
+    ignore_value(virTimeMonotonicMicrosNowRaw(&now));
+    VIR_TEST_DEBUG("lookup %zu: %llu us\n", info->count, now - then);
+
+    if (virHashForEach(hash, testHashLargeCountIter, &sum) < 0 ||
+        sum != (unsigned long long) info->count * (info->count + 1) / 2) {
+        VIR_TEST_VERBOSE("\niteration returned wrong entries\n");
+        goto cleanup_hash;
+    }
+
+    /* Remove every other entry and make sure the rest survives the
+     * tombstones left behind */
+    for (i = 0; i < info->count; i += 2) {
+        if (virHashRemoveEntry(hash, keys[i]) < 0) {
+            VIR_TEST_VERBOSE("\nfailed to remove entry \"%s\"\n", keys[i]);
+            goto cleanup_hash;
+        }
+    }
+
+    if (testHashCheckCount(hash, info->count / 2) < 0)
+        goto cleanup_hash;
+
+    for (i = 0; i < info->count; i++) {
+        void *payload = virHashLookup(hash, keys[i]);
+
+        if ((i % 2 == 0 && payload) ||
+            (i % 2 == 1 && payload != (void *)(uintptr_t) (i + 1))) {
+            VIR_TEST_VERBOSE("\nunexpected payload for \"%s\"\n", keys[i]);
+            goto cleanup_hash;
+        }
+    }
+
+    /* Re-adding fills the tombstones, so the table must not grow */
+    size = virHashTableSize(hash);
+    for (i = 0; i < info->count; i += 2) {
+        if (virHashAddEntry(hash, keys[i], (void *)(uintptr_t) (i + 1)) < 0)
+            goto cleanup_hash;
+    }
+
+    if (virHashTableSize(hash) != size) {
+        VIR_TEST_VERBOSE("\ntable resized from %zd to %zd slots on reinsertion\n",
+                         size, virHashTableSize(hash));
+        goto cleanup_hash;
+    }
+
+    if (testHashCheckCount(hash, info->count) < 0)
+        goto cleanup_hash;
+
+    for (i = 0; i < info->count; i++) {
+        if (virHashLookup(hash, keys[i]) != (void *)(uintptr_t) (i + 1)) {
+            VIR_TEST_VERBOSE("\nwrong payload for \"%s\" after reinsertion\n",
+                             keys[i]);
+            goto cleanup_hash;
+        }
+    }
+
+    /* Finally drop everything, no key may be found afterwards */
+    ignore_value(virTimeMonotonicMicrosNowRaw(&then));
+    for (i = 0; i < info->count; i++) {
+        if (virHashRemoveEntry(hash, keys[i]) < 0) {
+            VIR_TEST_VERBOSE("\nfailed to remove entry \"%s\"\n", keys[i]);
+            goto cleanup_hash;
+        }
+    }
+    ignore_value(virTimeMonotonicMicrosNowRaw(&now));
+    VIR_TEST_DEBUG("remove %zu: %llu us\n", info->count, now - then);
+
+    if (testHashCheckCount(hash, 0) < 0)
+        goto cleanup_hash;
+
+    for (i = 0; i < info->count; i++) {
+        if (virHashLookup(hash, keys[i])) {
+            VIR_TEST_VERBOSE("\nremoved entry \"%s\" still found\n", keys[i]);
+            goto cleanup_hash;
+        }
+    }
+
+    ret = 0;
+
+ cleanup_hash:
+    virHashFree(hash);
+ cleanup:
+    for (i = 0; i < info->count; i++)
+        VIR_FREE(keys[i]);
+    VIR_FREE(keys);
+    return ret;
+}
+
+
 static int
 mymain(void)
 {
@@ -549,6 +693,7 @@ mymain(void)
     DO_TEST("Search", Search);
     DO_TEST("GetItems", GetItems);
     DO_TEST("Equal", Equal);
+    DO_TEST_COUNT("Large", Large, 10000);
 
     return (ret == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -427,6 +427,144 @@ testJSONEscapeObj(const void *data ATTRIBUTE_UNUSED)
 }
 
 
+static int
+testJSONLargeObject(const void *data ATTRIBUTE_UNUSED)
+{
+    virJSONValuePtr json = NULL;
+    virJSONValuePtr val = NULL;
+    char key[32];
+    size_t i;
+    int num;
+    int ret = -1;
+
+    /* large enough to be looked up through the hash index */
+    if (!(json = virJSONValueNewObject()))
+        goto cleanup;
+
+    for (i = 0; i < 200; i++) {
+        snprintf(key, sizeof(key), "key%zu", i);
+        if (virJSONValueObjectAppendNumberInt(json, key, i) < 0) {
+            VIR_TEST_VERBOSE("failed to append key '%s'\n", key);
+            goto cleanup;
+        }
+
+        if (virJSONValueObjectAppendNumberInt(json, key, i) == 0) {
+            VIR_TEST_VERBOSE("duplicate key '%s' was accepted\n", key);
+            goto cleanup;
+        }
+    }
+
+    /* drop every third member, forcing the index to be rebuilt */
+    for (i = 0; i < 200; i += 3) {
+        snprintf(key, sizeof(key), "key%zu", i);
+        if (virJSONValueObjectRemoveKey(json, key, NULL) != 1) {
+            VIR_TEST_VERBOSE("failed to remove key '%s'\n", key);
+            goto cleanup;
+        }
+    }
+
+    for (i = 0; i < 200; i++) {
+        snprintf(key, sizeof(key), "key%zu", i);
+        val = virJSONValueObjectGet(json, key);
+
+        if (i % 3 == 0) {
+            if (val) {
+                VIR_TEST_VERBOSE("removed key '%s' still present\n", key);
+                goto cleanup;
+            }
+            continue;
+        }
+
+        if (!val || virJSONValueGetNumberInt(val, &num) < 0 || num != i) {
+            VIR_TEST_VERBOSE("wrong value of key '%s'\n", key);
+            goto cleanup;
+        }
+    }
+
+    if (virJSONValueObjectHasKey(json, "key") != 0 ||
+        virJSONValueObjectKeysNumber(json) != 133) {
+        VIR_TEST_VERBOSE("unexpected object contents\n");
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    virJSONValueFree(json);
+    return ret;
+}
+
+
+static int
+testJSONWriter(const void *data ATTRIBUTE_UNUSED)
+{
+    virBuffer buf = VIR_BUFFER_INITIALIZER;
+    virJSONWriter writer;
+    virJSONValuePtr json = NULL;
+    char *actual = NULL;
+    const char *expected =
+        "{\"execute\":\"query-block\",\"arguments\":"
+        "{\"str\":\"a\\\"b\\\\c\\n\\u0001\",\"num\":-1,"
+        "\"big\":18446744073709551615,\"list\":[true,false,null,[],{}],"
+        "\"tree\":{\"a\":[1,\"x\"]}}}";
+    int ret = -1;
+
+    if (!(json = virJSONValueFromString("{\"a\":[1,\"x\"]}")))
+        goto cleanup;
+
+    virJSONWriterInit(&writer, &buf);
+    virJSONWriterObjectStart(&writer);
+    virJSONWriterKey(&writer, "execute");
+    virJSONWriterString(&writer, "query-block");
+    virJSONWriterKey(&writer, "arguments");
+    virJSONWriterObjectStart(&writer);
+    virJSONWriterKey(&writer, "str");
+    virJSONWriterString(&writer, "a\"b\\c\n\001");
+    virJSONWriterKey(&writer, "num");
+    virJSONWriterNumberLong(&writer, -1);
+    virJSONWriterKey(&writer, "big");
+    virJSONWriterNumberUlong(&writer, 18446744073709551615ULL);
+    virJSONWriterKey(&writer, "list");
+    virJSONWriterArrayStart(&writer);
+    virJSONWriterBoolean(&writer, true);
+    virJSONWriterBoolean(&writer, false);
+    virJSONWriterNull(&writer);
+    virJSONWriterArrayStart(&writer);
+    virJSONWriterArrayEnd(&writer);
+    virJSONWriterObjectStart(&writer);
+    virJSONWriterObjectEnd(&writer);
+    virJSONWriterArrayEnd(&writer);
+    virJSONWriterKey(&writer, "tree");
+    virJSONWriterValue(&writer, json);
+    virJSONWriterObjectEnd(&writer);
+    virJSONWriterObjectEnd(&writer);
+
+    if (virJSONWriterCheckError(&writer) < 0)
+        goto cleanup;
+
+    actual = virBufferContentAndReset(&buf);
+
+    if (virTestCompareToString(expected, actual) < 0)
+        goto cleanup;
+
+    /* invalid UTF-8 must be refused */
+    virJSONWriterInit(&writer, &buf);
+    virJSONWriterString(&writer, "\x80");
+    if (virJSONWriterCheckError(&writer) == 0) {
+        VIR_TEST_VERBOSE("invalid UTF-8 was formatted\n");
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    virBufferFreeAndReset(&buf);
+    virJSONValueFree(json);
+    VIR_FREE(actual);
+    return ret;
+}
+
+
 static int
 testJSONObjectFormatSteal(const void *opaque ATTRIBUTE_UNUSED)
 {
@@ -636,6 +774,10 @@ mymain(void)
                  NULL, NULL, true);
     DO_TEST_FULL("stealing of attributes while creating objects",
                  ObjectFormatSteal, NULL, NULL, true);
+    DO_TEST_FULL("lookup in large object", LargeObject,
+                 NULL, NULL, true);
+    DO_TEST_FULL("streaming writer", Writer,
+                 NULL, NULL, true);
 
 #define DO_TEST_DEFLATTEN(name, pass) \
     DO_TEST_FULL(name, Deflatten, NULL, NULL, pass)
@@ -0,0 +1,355 @@
+/*
+ * Copyright (C) 2019 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include <poll.h>
+#include <signal.h>
+
+#include "testutils.h"
+#include "virerror.h"
+#include "viralloc.h"
+#include "virlog.h"
+#include "virstring.h"
+#include "virthread.h"
+#include "rpc/virnetsocket.h"
+#include "rpc/virnetclient.h"
+#include "rpc/virnetclientprogram.h"
+
+#define VIR_FROM_THIS VIR_FROM_RPC
+
+VIR_LOG_INIT("tests.netclienttest");
+
+#ifndef WIN32
+
+# define TEST_PROGRAM 0x11223344
+# define TEST_VERSION 1
+# define TEST_SERIAL 100
+
+/* How long the server waits for the next call of a batch, in ms */
+# define TEST_TIMEOUT (10 * 1000)
+
+struct testBatchData {
+    virNetSocketPtr sock;
+    size_t ncalls;
+    size_t failcall; /* call whose reply is an error */
+    bool failed;
+};
+
+
+static int
+testBatchReadAll(virNetSocketPtr sock,
+                 char *buf,
+                 size_t len)
+{
+    struct pollfd fd = { .fd = virNetSocketGetFD(sock), .events = POLLIN };
+
+    while (len > 0) {
+        ssize_t got;
+
+        /* The calls have to be in flight together, a client that waits
+         * for the first reply before sending the next call would block
+         * us here forever */
+        if (poll(&fd, 1, TEST_TIMEOUT) != 1) {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           "Timed out waiting for the next call");
+            return -1;
+        }
+
+        if ((got = virNetSocketRead(sock, buf, len)) <= 0) {
+            if (got == 0)
+                virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                               "Client went away unexpectedly");
+            return -1;
+        }
+
+        buf += got;
+        len -= got;
+    }
+
+    return 0;
+}
+
+
+static int
+testBatchWriteAll(virNetSocketPtr sock,
+                  virNetMessagePtr msg)
+{
+    while (msg->bufferOffset < msg->bufferLength) {
+        ssize_t done;
+
+        if ((done = virNetSocketWrite(sock, msg->buffer + msg->bufferOffset,
+                                      msg->bufferLength - msg->bufferOffset)) < 0)
+            return -1;
+
+        msg->bufferOffset += done;
+    }
+
+    return 0;
+}
+
+
+static virNetMessagePtr
+testBatchReadCall(virNetSocketPtr sock)
+{
+    virNetMessagePtr msg;
+
+    if (!(msg = virNetMessageNew(false)))
+        return NULL;
+
+    msg->bufferLength = VIR_NET_MESSAGE_LEN_MAX;
+    if (VIR_ALLOC_N(msg->buffer, msg->bufferLength) < 0 ||
+        testBatchReadAll(sock, msg->buffer, msg->bufferLength) < 0 ||
+        virNetMessageDecodeLength(msg) < 0 ||
+        testBatchReadAll(sock, msg->buffer + msg->bufferOffset,
+                         msg->bufferLength - msg->bufferOffset) < 0 ||
+        virNetMessageDecodeHeader(msg) < 0) {
+        virNetMessageFree(msg);
+        return NULL;
+    }
+
+    return msg;
+}
+
+
+static int
+testBatchWriteReply(virNetSocketPtr sock,
+                    virNetMessagePtr call,
+                    bool fail)
+{
+    virNetMessagePtr msg;
+    virNetMessageError rerr;
+    int ret = -1;
+
+    memset(&rerr, 0, sizeof(rerr));
+
+    if (!(msg = virNetMessageNew(false)))
+        return -1;
+
+    msg->header = call->header;
+    msg->header.type = VIR_NET_REPLY;
+    msg->header.status = fail ? VIR_NET_ERROR : VIR_NET_OK;
+
+    if (virNetMessageEncodeHeader(msg) < 0)
+        goto cleanup;
+
+    if (fail) {
+        virReportError(VIR_ERR_OPERATION_FAILED,
+                       "call %u failed on purpose", call->header.serial);
+        virNetMessageSaveError(&rerr);
+        virResetLastError();
+
+        if (virNetMessageEncodePayload(msg,
+                                       (xdrproc_t)xdr_virNetMessageError,
+                                       &rerr) < 0)
+            goto cleanup;
+    } else {
+        if (virNetMessageEncodePayloadEmpty(msg) < 0)
+            goto cleanup;
+    }
+
+    msg->bufferOffset = 0;
+    ret = testBatchWriteAll(sock, msg);
+
+ cleanup:
+    xdr_free((xdrproc_t)xdr_virNetMessageError, (void *)&rerr);
+    virNetMessageFree(msg);
+    return ret;
+}
+
+
+/* Read the whole batch before answering any of it and reply in
+ * reverse order, so that the client has to match replies by serial
+ * while all of its calls are in flight */
+static void
+testBatchServer(void *opaque)
+{
+    struct testBatchData *data = opaque;
+    virNetMessagePtr *calls = NULL;
+    size_t ncalls = 0;
+    size_t i;
+
+    if (VIR_ALLOC_N(calls, data->ncalls) < 0)
+        goto cleanup;
+
+    for (ncalls = 0; ncalls < data->ncalls; ncalls++) {
+        if (!(calls[ncalls] = testBatchReadCall(data->sock)))
+            goto cleanup;
+    }
+
+    for (i = ncalls; i > 0; i--) {
+        if (testBatchWriteReply(data->sock, calls[i - 1],
+                                i - 1 == data->failcall) < 0)
+            goto cleanup;
+    }
+
+    data->failed = false;
+
+ cleanup:
+    if (data->failed)
+        virNetSocketClose(data->sock);
+    for (i = 0; i < ncalls; i++)
+        virNetMessageFree(calls[i]);
+    VIR_FREE(calls);
+}
+
+
+static int
+testBatchReply(const void *opaque ATTRIBUTE_UNUSED)
+{
+    virNetSocketPtr lsock = NULL; /* Listen socket */
+    virNetSocketPtr ssock = NULL; /* Server socket */
+    virNetClientPtr client = NULL;
+    virNetClientProgramPtr prog = NULL;
+    virNetClientProgramCallData calls[3];
+    struct testBatchData data = {
+        .ncalls = ARRAY_CARDINALITY(calls),
+        .failcall = 1,
+        .failed = true,
+    };
+    virThread th;
+    bool joined = true;
+    char *path = NULL;
+    char *tmpdir;
+    char template[] = "/tmp/libvirt_XXXXXX";
+    size_t i;
+    int ret = -1;
+
+    memset(calls, 0, sizeof(calls));
+
+    if (!(tmpdir = mkdtemp(template))) {
+        virReportSystemError(errno, "%s",
+                             "Failed to create temporary directory");
+        return -1;
+    }
+    if (virAsprintf(&path, "%s/test.sock", tmpdir) < 0)
+        goto cleanup;
+
+    if (virNetSocketNewListenUNIX(path, 0700, -1, getegid(), &lsock) < 0 ||
+        virNetSocketListen(lsock, 0) < 0)
+        goto cleanup;
+
+    if (!(client = virNetClientNewUNIX(path, false, NULL)))
+        goto cleanup;
+
+    /* The connection is already queued on the listening socket */
+    if (virNetSocketAccept(lsock, &ssock) < 0)
+        goto cleanup;
+
+    if (!ssock) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       "No connection to accept");
+        goto cleanup;
+    }
+
+    if (virNetSocketSetBlocking(ssock, true) < 0)
+        goto cleanup;
+
+    if (!(prog = virNetClientProgramNew(TEST_PROGRAM, TEST_VERSION,
+                                        NULL, 0, NULL)))
+        goto cleanup;
+
+    for (i = 0; i < ARRAY_CARDINALITY(calls); i++) {
+        calls[i].proc = i + 1;
+        calls[i].args_filter = (xdrproc_t)xdr_void;
+        calls[i].ret_filter = (xdrproc_t)xdr_void;
+    }
+
+    data.sock = ssock;
+    if (virThreadCreate(&th, true, testBatchServer, &data) < 0)
+        goto cleanup;
+    joined = false;
+
+    if (virNetClientProgramCallBatch(prog, client, TEST_SERIAL,
+                                     calls, ARRAY_CARDINALITY(calls)) < 0)
+        goto cleanup;
+
+    virThreadJoin(&th);
+    joined = true;
+
+    if (data.failed)
+        goto cleanup;
+
+    for (i = 0; i < ARRAY_CARDINALITY(calls); i++) {
+        if (i == data.failcall) {
+            if (calls[i].result != -1 || !calls[i].error) {
+                virReportError(VIR_ERR_INTERNAL_ERROR,
+                               "Call %zu expected to fail", i);
+                goto cleanup;
+            }
+
+            if (calls[i].error->code != VIR_ERR_OPERATION_FAILED ||
+                !strstr(NULLSTR(calls[i].error->message),
+                        "failed on purpose")) {
+                virReportError(VIR_ERR_INTERNAL_ERROR,
+                               "Unexpected error of call %zu: '%s'",
+                               i, NULLSTR(calls[i].error->message));
+                goto cleanup;
+            }
+        } else if (calls[i].result != 0 || calls[i].error) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           "Call %zu expected to succeed", i);
+            goto cleanup;
+        }
+    }
+
+    ret = 0;
+
+ cleanup:
+    if (!joined) {
+        /* Unblock the server if the client gave up early */
+        virNetClientClose(client);
+        virThreadJoin(&th);
+    }
+    for (i = 0; i < ARRAY_CARDINALITY(calls); i++)
+        virFreeError(calls[i].error);
+    virObjectUnref(prog);
+    if (client)
+        virNetClientClose(client);
+    virObjectUnref(client);
+    virObjectUnref(ssock);
+    if (lsock)
+        virNetSocketClose(lsock);
+    virObjectUnref(lsock);
+    VIR_FREE(path);
+    rmdir(tmpdir);
+    return ret;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+
+    signal(SIGPIPE, SIG_IGN);
+
+    if (virTestRun("Batch with an error reply", testBatchReply, NULL) < 0)
+        ret = -1;
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+#else
+static int
+mymain(void)
+{
+    return EXIT_AM_SKIP;
+}
+#endif
+
+VIR_TEST_MAIN(mymain)
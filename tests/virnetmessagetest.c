@@ -452,6 +452,108 @@ static int testMessagePayloadDecode(const void *args ATTRIBUTE_UNUSED)
     return ret;
 }
 
+static size_t testEncodeFailures;
+
+/* Counts encoding attempts which ran out of buffer space */
+static bool_t
+testMessageCountingFilter(XDR *xdrs, virNetMessageError *objp)
+{
+    if (!xdr_virNetMessageError(xdrs, objp)) {
+        testEncodeFailures++;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static int testMessagePayloadEncodeLarge(const void *args ATTRIBUTE_UNUSED)
+{
+    virNetMessageError err;
+    virNetMessageError decoded;
+    virNetMessagePtr msg = virNetMessageNew(true);
+    char *message = NULL;
+    size_t msglen = VIR_NET_MESSAGE_INITIAL * 8;
+    unsigned int wirelen;
+    XDR xdr;
+    int ret = -1;
+
+    if (!msg)
+        return -1;
+
+    memset(&err, 0, sizeof(err));
+    memset(&decoded, 0, sizeof(decoded));
+
+    /* Much larger than the initial buffer, so it has to grow */
+    if (VIR_ALLOC_N(message, msglen + 1) < 0)
+        goto cleanup;
+    memset(message, 'x', msglen);
+
+    err.code = VIR_ERR_INTERNAL_ERROR;
+    err.domain = VIR_FROM_RPC;
+    err.level = VIR_ERR_ERROR;
+    err.message = &message;
+
+    msg->header.prog = 0x11223344;
+    msg->header.vers = 0x01;
+    msg->header.proc = 0x666;
+    msg->header.type = VIR_NET_MESSAGE;
+    msg->header.serial = 0x99;
+    msg->header.status = VIR_NET_ERROR;
+
+    if (virNetMessageEncodeHeader(msg) < 0)
+        goto cleanup;
+
+    testEncodeFailures = 0;
+    if (virNetMessageEncodePayload(msg, (xdrproc_t)testMessageCountingFilter, &err) < 0)
+        goto cleanup;
+
+#ifdef HAVE_XDR_SIZEOF
+    /* The buffer is sized up front, so the payload is encoded in a
+     * single pass without running out of space */
+    if (testEncodeFailures != 0) {
+        VIR_DEBUG("Expect a single encoding pass, %zu passes failed",
+                  testEncodeFailures);
+        goto cleanup;
+    }
+#endif /* HAVE_XDR_SIZEOF */
+
+    if (msg->bufferOffset != 0) {
+        VIR_DEBUG("Expect message offset 0 got %zu",
+                  msg->bufferOffset);
+        goto cleanup;
+    }
+
+    xdrmem_create(&xdr, msg->buffer, VIR_NET_MESSAGE_LEN_MAX, XDR_DECODE);
+    if (!xdr_u_int(&xdr, &wirelen)) {
+        xdr_destroy(&xdr);
+        goto cleanup;
+    }
+    xdr_destroy(&xdr);
+
+    if (wirelen != msg->bufferLength) {
+        VIR_DEBUG("Expect encoded length %zu got %u",
+                  msg->bufferLength, wirelen);
+        goto cleanup;
+    }
+
+    if (virNetMessageDecodeHeader(msg) < 0)
+        goto cleanup;
+
+    if (virNetMessageDecodePayload(msg, (xdrproc_t)xdr_virNetMessageError, &decoded) < 0)
+        goto cleanup;
+
+    if (!decoded.message || STRNEQ(*decoded.message, message)) {
+        VIR_DEBUG("Decoded message does not match the encoded one");
+        goto cleanup;
+    }
+
+    ret = 0;
+ cleanup:
+    xdr_free((xdrproc_t)xdr_virNetMessageError, (void*)&decoded);
+    VIR_FREE(message);
+    virNetMessageFree(msg);
+    return ret;
+}
+
 static int testMessagePayloadStreamEncode(const void *args ATTRIBUTE_UNUSED)
 {
     char stream[] = "The quick brown fox jumps over the lazy dog";
@@ -519,6 +621,167 @@ static int testMessagePayloadStreamEncode(const void *args ATTRIBUTE_UNUSED)
 }
 
 
+#if WITH_LZ4
+struct testMessageCompressData {
+    bool compressible;
+    size_t threshold;
+    bool expectCompressed;
+};
+
+static int testMessagePayloadCompress(const void *args)
+{
+    const struct testMessageCompressData *data = args;
+    virNetMessageError err;
+    virNetMessageError decoded;
+    virNetMessageCompressStats txstats;
+    virNetMessageCompressStats rxstats;
+    virNetMessagePtr msg = virNetMessageNew(true);
+    const size_t offset = VIR_NET_MESSAGE_LEN_MAX + VIR_NET_MESSAGE_HEADER_MAX;
+    char *message = NULL;
+    char *orig = NULL;
+    size_t origlen;
+    size_t msglen = VIR_NET_MESSAGE_INITIAL;
+    unsigned int wirelen;
+    unsigned int seed = 1;
+    size_t i;
+    XDR xdr;
+    int ret = -1;
+
+    if (!msg)
+        return -1;
+
+    memset(&err, 0, sizeof(err));
+    memset(&decoded, 0, sizeof(decoded));
+    memset(&txstats, 0, sizeof(txstats));
+    memset(&rxstats, 0, sizeof(rxstats));
+
+    if (VIR_ALLOC_N(message, msglen + 1) < 0)
+        goto cleanup;
+
+    for (i = 0; i < msglen; i++) {
+        if (data->compressible) {
+            message[i] = 'a' + i % 4;
+        } else {
+            seed = seed * 1103515245 + 12345;
+            message[i] = 1 + (seed >> 16) % 255;
+        }
+    }
+
+    err.code = VIR_ERR_INTERNAL_ERROR;
+    err.domain = VIR_FROM_RPC;
+    err.level = VIR_ERR_ERROR;
+    err.message = &message;
+
+    msg->header.prog = 0x11223344;
+    msg->header.vers = 0x01;
+    msg->header.proc = 0x666;
+    msg->header.type = VIR_NET_REPLY;
+    msg->header.serial = 0x99;
+    msg->header.status = VIR_NET_OK;
+
+    if (virNetMessageEncodeHeader(msg) < 0)
+        goto cleanup;
+
+    if (virNetMessageEncodePayload(msg, (xdrproc_t)xdr_virNetMessageError, &err) < 0)
+        goto cleanup;
+
+    origlen = msg->bufferLength;
+    if (VIR_ALLOC_N(orig, origlen) < 0)
+        goto cleanup;
+    memcpy(orig, msg->buffer, origlen);
+
+    if (virNetMessageCompress(msg, VIR_NET_MESSAGE_COMPRESSION_LZ4,
+                              data->threshold, &txstats) < 0)
+        goto cleanup;
+
+    if (!data->expectCompressed) {
+        if (msg->header.type != VIR_NET_REPLY ||
+            txstats.messages != 0 ||
+            msg->bufferLength != origlen ||
+            memcmp(msg->buffer, orig, origlen) != 0) {
+            VIR_DEBUG("Expect the message to be left untouched");
+            goto cleanup;
+        }
+
+        ret = 0;
+        goto cleanup;
+    }
+
+    if (msg->header.type != VIR_NET_REPLY_COMPRESSED ||
+        msg->bufferLength >= origlen) {
+        VIR_DEBUG("Expect a compressed message shorter than %zu, got %zu",
+                  origlen, msg->bufferLength);
+        goto cleanup;
+    }
+
+    if (txstats.messages != 1 ||
+        txstats.rawBytes != origlen - offset ||
+        txstats.wireBytes != msg->bufferLength - offset - VIR_NET_MESSAGE_LEN_MAX) {
+        VIR_DEBUG("Unexpected compression stats %llu/%llu/%llu",
+                  txstats.messages, txstats.rawBytes, txstats.wireBytes);
+        goto cleanup;
+    }
+
+    xdrmem_create(&xdr, msg->buffer, VIR_NET_MESSAGE_LEN_MAX, XDR_DECODE);
+    if (!xdr_u_int(&xdr, &wirelen)) {
+        xdr_destroy(&xdr);
+        goto cleanup;
+    }
+    xdr_destroy(&xdr);
+
+    if (wirelen != msg->bufferLength) {
+        VIR_DEBUG("Expect encoded length %zu got %u",
+                  msg->bufferLength, wirelen);
+        goto cleanup;
+    }
+
+    /* Now receive it the way the client does */
+    if (virNetMessageDecodeHeader(msg) < 0)
+        goto cleanup;
+
+    if (msg->header.type != VIR_NET_REPLY_COMPRESSED) {
+        VIR_DEBUG("Expect message type %d got %d",
+                  VIR_NET_REPLY_COMPRESSED, msg->header.type);
+        goto cleanup;
+    }
+
+    if (virNetMessageDecompress(msg, VIR_NET_MESSAGE_COMPRESSION_LZ4,
+                                &rxstats) < 0)
+        goto cleanup;
+
+    if (msg->header.type != VIR_NET_REPLY ||
+        msg->bufferLength != origlen ||
+        msg->bufferOffset != offset ||
+        memcmp(msg->buffer + offset, orig + offset, origlen - offset) != 0) {
+        VIR_DEBUG("Decompressed payload does not match the original one");
+        goto cleanup;
+    }
+
+    if (rxstats.messages != 1 ||
+        rxstats.rawBytes != txstats.rawBytes ||
+        rxstats.wireBytes != txstats.wireBytes) {
+        VIR_DEBUG("Decompression stats do not match compression stats");
+        goto cleanup;
+    }
+
+    if (virNetMessageDecodePayload(msg, (xdrproc_t)xdr_virNetMessageError, &decoded) < 0)
+        goto cleanup;
+
+    if (!decoded.message || STRNEQ(*decoded.message, message)) {
+        VIR_DEBUG("Decoded message does not match the encoded one");
+        goto cleanup;
+    }
+
+    ret = 0;
+ cleanup:
+    xdr_free((xdrproc_t)xdr_virNetMessageError, (void*)&decoded);
+    VIR_FREE(message);
+    VIR_FREE(orig);
+    virNetMessageFree(msg);
+    return ret;
+}
+#endif /* WITH_LZ4 */
+
 static int
 mymain(void)
 {
@@ -538,9 +801,30 @@ mymain(void)
     if (virTestRun("Message Payload Decode", testMessagePayloadDecode, NULL) < 0)
         ret = -1;
 
+    if (virTestRun("Message Payload Encode Large", testMessagePayloadEncodeLarge, NULL) < 0)
+        ret = -1;
+
     if (virTestRun("Message Payload Stream Encode", testMessagePayloadStreamEncode, NULL) < 0)
         ret = -1;
 
+#if WITH_LZ4
+# define DO_TEST_COMPRESS(name, compress, thresh, expect) \
+    do { \
+        struct testMessageCompressData data = { \
+            .compressible = compress, \
+            .threshold = thresh, \
+            .expectCompressed = expect, \
+        }; \
+        if (virTestRun("Message Payload Compress " name, \
+                       testMessagePayloadCompress, &data) < 0) \
+            ret = -1; \
+    } while (0)
+
+    DO_TEST_COMPRESS("round trip", true, 1024, true);
+    DO_TEST_COMPRESS("below threshold", true, VIR_NET_MESSAGE_INITIAL * 2, false);
+    DO_TEST_COMPRESS("incompressible", false, 1024, false);
+#endif /* WITH_LZ4 */
+
     return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
@@ -0,0 +1,152 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "testutils.h"
+
+#include "viralloc.h"
+#include "viratomic.h"
+#include "virrcu.h"
+#include "virthread.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+#define READERS 4
+#define ROUNDS 2000
+#define MAGIC 0x5eed
+
+struct testData {
+    int magic;
+    int round;
+};
+
+static struct testData *shared;
+static volatile int stop;
+static volatile int failed;
+
+
+static void
+testReader(void *opaque ATTRIBUTE_UNUSED)
+{
+    while (!virAtomicIntGet(&stop)) {
+        struct testData *data;
+        size_t i;
+
+        if (virRCUReadLock() < 0) {
+            virAtomicIntSet(&failed, 1);
+            return;
+        }
+
+        data = virAtomicPointerGet(&shared);
+        for (i = 0; i < 10; i++) {
+            if (data->magic != MAGIC)
+                virAtomicIntSet(&failed, 1);
+        }
+
+        virRCUReadUnlock();
+    }
+}
+
+
+static int
+testRCUThreads(const void *opaque ATTRIBUTE_UNUSED)
+{
+    virThread threads[READERS];
+    size_t nthreads = 0;
+    size_t i;
+    int ret = -1;
+
+    if (VIR_ALLOC(shared) < 0)
+        return -1;
+    shared->magic = MAGIC;
+    stop = failed = 0;
+
+    for (nthreads = 0; nthreads < READERS; nthreads++) {
+        if (virThreadCreate(&threads[nthreads], true, testReader, NULL) < 0)
+            goto cleanup;
+    }
+
+    for (i = 0; i < ROUNDS; i++) {
+        struct testData *old = shared;
+        struct testData *data;
+
+        if (VIR_ALLOC(data) < 0)
+            goto cleanup;
+        data->magic = MAGIC;
+        data->round = i;
+
+        virAtomicPointerSet(&shared, data);
+        virRCUSynchronize();
+
+        /* no reader may see this anymore */
+        old->magic = 0;
+        VIR_FREE(old);
+    }
+
+    ret = 0;
+
+ cleanup:
+    virAtomicIntSet(&stop, 1);
+    for (i = 0; i < nthreads; i++)
+        virThreadJoin(&threads[i]);
+    VIR_FREE(shared);
+
+    if (virAtomicIntGet(&failed)) {
+        VIR_TEST_VERBOSE("reader saw a freed structure\n");
+        ret = -1;
+    }
+
+    return ret;
+}
+
+
+static int
+testRCUNested(const void *opaque ATTRIBUTE_UNUSED)
+{
+    if (virRCUReadLock() < 0)
+        return -1;
+    if (virRCUReadLock() < 0) {
+        virRCUReadUnlock();
+        return -1;
+    }
+    virRCUReadUnlock();
+    virRCUReadUnlock();
+
+    /* With no active section this must not block */
+    virRCUSynchronize();
+
+    return 0;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+
+    if (virThreadInitialize() < 0)
+        return -1;
+
+    if (virTestRun("nested", testRCUNested, NULL) < 0)
+        ret = -1;
+    if (virTestRun("threads", testRCUThreads, NULL) < 0)
+        ret = -1;
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIR_TEST_MAIN(mymain)
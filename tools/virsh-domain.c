@@ -5253,6 +5253,10 @@ static const vshCmdOptDef opts_restore[] = {
      .type = VSH_OT_BOOL,
      .help = N_("restore domain into paused state")
     },
+    {.name = "clone",
+     .type = VSH_OT_BOOL,
+     .help = N_("start a new domain from the state, as described by --xml")
+    },
     {.name = NULL}
 };
 
@@ -5275,6 +5279,10 @@ cmdRestore(vshControl *ctl, const vshCmd *cmd)
         flags |= VIR_DOMAIN_SAVE_RUNNING;
     if (vshCommandOptBool(cmd, "paused"))
         flags |= VIR_DOMAIN_SAVE_PAUSED;
+    if (vshCommandOptBool(cmd, "clone"))
+        flags |= VIR_DOMAIN_SAVE_CLONE;
+
+    VSH_REQUIRE_OPTION("clone", "xml");
 
     if (vshCommandOptStringReq(ctl, cmd, "xml", &xmlfile) < 0)
         return false;
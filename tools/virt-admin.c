@@ -894,6 +894,187 @@ cmdSrvClientsInfo(vshControl *ctl, const vshCmd *cmd)
     return ret;
 }
 
+/* -------------------------
+ * Command server-proc-stats
+ * -------------------------
+ */
+
+static const vshCmdInfo info_srv_proc_stats[] = {
+    {.name = "help",
+     .data = N_("get server's per procedure RPC statistics")
+    },
+    {.name = "desc",
+     .data = N_("Retrieve call counts, transferred bytes and wait and "
+                "execution times of the RPC procedures called on a server")
+    },
+    {.name = NULL}
+};
+
+static const vshCmdOptDef opts_srv_proc_stats[] = {
+    {.name = "server",
+     .type = VSH_OT_DATA,
+     .flags = VSH_OFLAG_REQ,
+     .completer = vshAdmServerCompleter,
+     .help = N_("Server to retrieve the statistics from."),
+    },
+    {.name = "histogram",
+     .type = VSH_OT_BOOL,
+     .help = N_("print wait and execution time histograms"),
+    },
+    {.name = "reset",
+     .type = VSH_OT_BOOL,
+     .help = N_("reset the statistics after retrieving them"),
+    },
+    {.name = NULL}
+};
+
+static void
+vshAdmPrintProcHistogram(vshControl *ctl,
+                         virTypedParameterPtr params,
+                         int nparams,
+                         unsigned int nbuckets,
+                         size_t idx,
+                         const char *which)
+{
+    char field[VIR_TYPED_PARAM_FIELD_LENGTH];
+    unsigned long long count;
+    size_t i;
+
+    for (i = 0; i < nbuckets; i++) {
+        snprintf(field, sizeof(field), "proc.%zu.%s_hist.%zu", idx, which, i);
+        if (virTypedParamsGetULLong(params, nparams, field, &count) <= 0)
+            continue;
+
+        if (i > 0 && i == nbuckets - 1)
+            vshPrint(ctl, "  %-5s >= %-10llu us: %llu\n",
+                     which, 1ULL << (i - 1), count);
+        else
+            vshPrint(ctl, "  %-5s <  %-10llu us: %llu\n",
+                     which, 1ULL << i, count);
+    }
+}
+
+static bool
+cmdSrvProcStats(vshControl *ctl, const vshCmd *cmd)
+{
+    bool ret = false;
+    virTypedParameterPtr params = NULL;
+    int nparams = 0;
+    unsigned int count = 0;
+    unsigned int nbuckets = 0;
+    size_t i;
+    const char *srvname = NULL;
+    virAdmServerPtr srv = NULL;
+    vshAdmControlPtr priv = ctl->privData;
+    vshTablePtr table = NULL;
+    bool histogram = vshCommandOptBool(cmd, "histogram");
+    unsigned int flags = 0;
+
+    if (vshCommandOptBool(cmd, "reset"))
+        flags |= VIR_ADMIN_SERVER_PROC_STATS_RESET;
+
+    if (vshCommandOptStringReq(ctl, cmd, "server", &srvname) < 0)
+        return false;
+
+    if (!(srv = virAdmConnectLookupServer(priv->conn, srvname, 0)))
+        goto cleanup;
+
+    if (virAdmServerGetProcStats(srv, &params, &nparams, flags) < 0) {
+        vshError(ctl, "%s", _("Unable to retrieve procedure statistics "
+                              "from server"));
+        goto cleanup;
+    }
+
+    if (virTypedParamsGetUInt(params, nparams,
+                              VIR_SERVER_PROC_STATS_COUNT, &count) < 0 ||
+        virTypedParamsGetUInt(params, nparams,
+                              VIR_SERVER_PROC_STATS_HIST_BUCKETS,
+                              &nbuckets) < 0)
+        goto cleanup;
+
+    table = vshTableNew(_("Procedure"), _("Calls"), _("Errors"),
+                        _("Avg wait (us)"), _("Avg exec (us)"),
+                        _("Bytes in"), _("Bytes out"), NULL);
+    if (!table)
+        goto cleanup;
+
+    for (i = 0; i < count; i++) {
+        char field[VIR_TYPED_PARAM_FIELD_LENGTH];
+        const char *name = NULL;
+        unsigned int program = 0;
+        unsigned int procedure = 0;
+        unsigned long long calls = 0;
+        unsigned long long errors = 0;
+        unsigned long long waitTime = 0;
+        unsigned long long execTime = 0;
+        unsigned long long bytesIn = 0;
+        unsigned long long bytesOut = 0;
+        VIR_AUTOFREE(char *) nameStr = NULL;
+        VIR_AUTOFREE(char *) callsStr = NULL;
+        VIR_AUTOFREE(char *) errorsStr = NULL;
+        VIR_AUTOFREE(char *) waitStr = NULL;
+        VIR_AUTOFREE(char *) execStr = NULL;
+        VIR_AUTOFREE(char *) inStr = NULL;
+        VIR_AUTOFREE(char *) outStr = NULL;
+
+#define GET_STAT(type, suffix, var) \
+        do { \
+            snprintf(field, sizeof(field), "proc.%zu." suffix, i); \
+            if (virTypedParamsGet ## type(params, nparams, field, &var) < 0) \
+                goto cleanup; \
+        } while (0)
+
+        GET_STAT(String, "name", name);
+        GET_STAT(UInt, "program", program);
+        GET_STAT(UInt, "procedure", procedure);
+        GET_STAT(ULLong, "calls", calls);
+        GET_STAT(ULLong, "errors", errors);
+        GET_STAT(ULLong, "wait_time", waitTime);
+        GET_STAT(ULLong, "exec_time", execTime);
+        GET_STAT(ULLong, "bytes_in", bytesIn);
+        GET_STAT(ULLong, "bytes_out", bytesOut);
+
+#undef GET_STAT
+
+        if (histogram) {
+            if (name)
+                vshPrint(ctl, "%s\n", name);
+            else
+                vshPrint(ctl, "%x:%u\n", program, procedure);
+            vshAdmPrintProcHistogram(ctl, params, nparams, nbuckets,
+                                     i, "wait");
+            vshAdmPrintProcHistogram(ctl, params, nparams, nbuckets,
+                                     i, "exec");
+            continue;
+        }
+
+        if ((name ? VIR_STRDUP(nameStr, name) :
+                    virAsprintf(&nameStr, "%x:%u", program, procedure)) < 0 ||
+            virAsprintf(&callsStr, "%llu", calls) < 0 ||
+            virAsprintf(&errorsStr, "%llu", errors) < 0 ||
+            virAsprintf(&waitStr, "%llu", calls ? waitTime / calls : 0) < 0 ||
+            virAsprintf(&execStr, "%llu", calls ? execTime / calls : 0) < 0 ||
+            virAsprintf(&inStr, "%llu", bytesIn) < 0 ||
+            virAsprintf(&outStr, "%llu", bytesOut) < 0)
+            goto cleanup;
+
+        if (vshTableRowAppend(table, nameStr, callsStr, errorsStr,
+                              waitStr, execStr, inStr, outStr, NULL) < 0)
+            goto cleanup;
+    }
+
+    if (!histogram)
+        vshTablePrintToStdout(table, ctl);
+
+    ret = true;
+
+ cleanup:
+    vshTableFree(table);
+    virTypedParamsFree(params, nparams);
+    virAdmServerFree(srv);
+    return ret;
+}
+
 /* -----------------------
  * Command srv-clients-set
  * -----------------------
@@ -1448,6 +1629,16 @@ static const vshCmdDef monitoringCmds[] = {
      .info = info_srv_clients_info,
      .flags = 0
     },
+    {.name = "srv-proc-stats",
+     .flags = VSH_CMD_FLAG_ALIAS,
+     .alias = "server-proc-stats"
+    },
+    {.name = "server-proc-stats",
+     .handler = cmdSrvProcStats,
+     .opts = opts_srv_proc_stats,
+     .info = info_srv_proc_stats,
+     .flags = 0
+    },
     {.name = NULL}
 };
 